@@ -5,8 +5,42 @@
  */
 
 #include "errno.h"
+#include <cJSON_os.h>
 #include "codec.h"
 
+/* JSON encoding of the schema fields that have a shadow key. */
+#define JSON_SCHEMA_ENCODE_FIELD(type, name, wire, json)                         \
+	if ((json) != NULL && !cJSON_AddNumberToObject(obj, json, val->name)) {  \
+		return false;                                                    \
+	}
+
+#define JSON_SCHEMA_DECODE_FIELD(type, name, wire, json)                         \
+	if ((json) != NULL) {                                                    \
+		cJSON *item = cJSON_GetObjectItem(obj, json);                    \
+		if (item != NULL) {                                              \
+			val->name = (type)item->valueint;                        \
+			found = true;                                            \
+		}                                                                \
+	}
+
+#define JSON_SCHEMA_CODEC_DEFINE(_name, _fields)                                 \
+	static bool json_encode_##_name(cJSON *obj, const struct _name *val)     \
+	{                                                                        \
+		_fields(JSON_SCHEMA_ENCODE_FIELD)                                \
+		return true;                                                     \
+	}                                                                        \
+	static bool json_decode_##_name(cJSON *obj, struct _name *val)           \
+	{                                                                        \
+		bool found = false;                                              \
+		_fields(JSON_SCHEMA_DECODE_FIELD)                                \
+		return found;                                                    \
+	}
+
+JSON_SCHEMA_CODEC_DEFINE(bt_mesh_movement_set, BT_MESH_MOVEMENT_SET_FIELDS)
+JSON_SCHEMA_CODEC_DEFINE(bt_mesh_telemetry_report, BT_MESH_TELEMETRY_REPORT_FIELDS)
+JSON_SCHEMA_CODEC_DEFINE(bt_mesh_telemetry_power, BT_MESH_TELEMETRY_POWER_FIELDS)
+JSON_SCHEMA_CODEC_DEFINE(bt_mesh_calibration_status, BT_MESH_CALIBRATION_STATUS_FIELDS)
+
 static cJSON *json_parse_root_object(const char *input, size_t len)
 {
 	cJSON *obj = NULL;
@@ -17,6 +51,7 @@ static cJSON *json_parse_root_object(const char *input, size_t len)
 
 	/* Verify that the incoming JSON string is an object. */
 	if (!cJSON_IsObject(obj)) {
+		cJSON_Delete(obj);
 		return NULL;
 	}
 
@@ -28,30 +63,48 @@ static cJSON *json_object_decode(cJSON *obj, const char *str)
 	return obj ? cJSON_GetObjectItem(obj, str) : NULL;
 }
 
+/* Adds item to obj under str. On failure the item has no parent to be
+ * freed with, so it is deleted here.
+ */
+static bool json_add_item(cJSON *obj, const char *str, cJSON *item)
+{
+	if (!cJSON_AddItemToObject(obj, str, item)) {
+		cJSON_Delete(item);
+		return false;
+	}
+
+	return true;
+}
+
+/* Wraps obj in {"state":{"reported":{str: obj}}}. Takes ownership of obj,
+ * which is freed if the wrapper cannot be created.
+ */
 static cJSON *json_create_reported_object(cJSON *obj, char* str) 
 {
 	cJSON *root_obj = cJSON_CreateObject();
 	if (root_obj == NULL) {
+		cJSON_Delete(obj);
 		return NULL;
 	}
 
 	cJSON *state_obj = cJSON_CreateObject();
-	if (state_obj == NULL) {
+	if (state_obj == NULL || !json_add_item(root_obj, "state", state_obj)) {
+		cJSON_Delete(obj);
 		cJSON_Delete(root_obj);
 		return NULL;
 	} 
 
-	cJSON_AddItemToObject(root_obj, "state", state_obj);
 	cJSON *reported_obj = cJSON_CreateObject();
-	if (reported_obj == NULL) {
+	if (reported_obj == NULL || !json_add_item(state_obj, "reported", reported_obj)) {
+		cJSON_Delete(obj);
 		cJSON_Delete(root_obj);
 		return NULL;
 	} 
-	
-	cJSON_AddItemToObject(state_obj, "reported", reported_obj);
 
-
-	cJSON_AddItemToObject(reported_obj, str, obj);
+	if (!json_add_item(reported_obj, str, obj)) {
+		cJSON_Delete(root_obj);
+		return NULL;
+	}
 
 	return root_obj;
 }
@@ -73,65 +126,79 @@ static cJSON *json_get_object_in_state(cJSON *root_obj, char *str)
 	return desired_obj;
 }
 
+static char *json_print_reported_object(cJSON *obj, char *str)
+{
+	char *msg;
+	cJSON *root_obj = json_create_reported_object(obj, str);
+	if (root_obj == NULL) {
+		return NULL;
+	}
+
+	msg = cJSON_PrintUnformatted(root_obj);
+	cJSON_Delete(root_obj);
+
+	return msg;
+}
+
+void codec_init(void)
+{
+	cJSON_Init();
+}
+
 int codec_decode_version(const char *input, size_t len)
 {
+	int version;
 	cJSON *version_obj;
-    cJSON *root_obj = json_parse_root_object(input, len);
+	cJSON *root_obj = json_parse_root_object(input, len);
+	if (root_obj == NULL) {
+		return -EINVAL;
+	}
 
 	version_obj = cJSON_GetObjectItem(root_obj, "version");
 	if (version_obj == NULL) {
 		/* No version number present in message. */
+		cJSON_Delete(root_obj);
 		return -ENODATA;
 	}
 
-    cJSON_Delete(root_obj);
+	version = version_obj->valueint;
+	cJSON_Delete(root_obj);
 
-	return version_obj->valueint;
+	return version;
 }
 
-bool codec_decode_movement(char *id, const char *input, size_t len, struct codec_movement *movement)
+bool codec_decode_movement(char *id, const char *input, size_t len, struct bt_mesh_movement_set *movement)
 {
     bool movement_config = false;
 
     cJSON *root_obj;
 	cJSON *robots_obj;
 	cJSON *robot_obj;
-	cJSON *value_obj;
     
     root_obj = json_parse_root_object(input, len);
+	if (root_obj == NULL) {
+		return movement_config;
+	}
+
 	robots_obj = json_get_object_in_state(root_obj, "robots");
 	if (robots_obj == NULL) {
+		cJSON_Delete(root_obj);
 		return movement_config;
 	}
 
     robot_obj = cJSON_GetObjectItem(robots_obj, id);
-    if (robots_obj == NULL) {
-        return 0;
+    if (robot_obj == NULL) {
+        cJSON_Delete(root_obj);
+        return movement_config;
     }
 
-    value_obj = json_object_decode(robot_obj, "driveTimeMs");
-    if(value_obj != NULL) {
-        movement->drive_time = value_obj->valueint;
-        movement_config = true;
-    }
-
-    value_obj = json_object_decode(robot_obj, "angleDeg");
-    if (value_obj != NULL) {
-        movement->rotation = value_obj->valueint;
-        movement_config = true;
-    }
-
-    // value_obj = json_object_decode(robot_obj, "speedPct");
-    // if (value_obj != NULL) {
-    //     movement->speed = value_obj->valueint;
-    //     movement_config = true;
-    // }
+    movement_config = json_decode_bt_mesh_movement_set(robot_obj, movement);
     cJSON_Delete(root_obj);
 
 	return movement_config;
 }
 
-bool codec_decode_led(char *id, const char *input, size_t len, struct codec_led *led)
+bool codec_decode_led(char *id, const char *input, size_t len, struct bt_mesh_light_rgb_set *led)
 {
     bool led_config = false;
 
@@ -142,13 +209,19 @@ bool codec_decode_led(char *id, const char *input, size_t len, struct codec_led
 	cJSON *value_obj;
     
     root_obj = json_parse_root_object(input, len);
+	if (root_obj == NULL) {
+		return led_config;
+	}
+
 	robots_obj = json_get_object_in_state(root_obj, "robots");
 	if (robots_obj == NULL) {
+		cJSON_Delete(root_obj);
 		return led_config;
 	}
 
     robot_obj = cJSON_GetObjectItem(robots_obj, id);
-    if (robots_obj == NULL) {
+    if (robot_obj == NULL) {
+        cJSON_Delete(root_obj);
         return led_config;
     }
     
@@ -172,7 +245,7 @@ bool codec_decode_led(char *id, const char *input, size_t len, struct codec_led
 
         value_obj = cJSON_GetArrayItem(led_obj, 3);
         if(value_obj != NULL) {
-            led->time = value_obj->valueint;
+            led->blink_time = value_obj->valueint;
         }
     }
 
@@ -181,11 +254,135 @@ bool codec_decode_led(char *id, const char *input, size_t len, struct codec_led
 	return led_config;
 }
 
-char* codec_encode_movement_report(char *id, struct codec_movement movement)
+bool codec_decode_team(char *id, const char *input, size_t len, uint8_t *team)
+{
+    bool team_config = false;
+
+    cJSON *root_obj;
+	cJSON *robots_obj;
+	cJSON *robot_obj;
+	cJSON *team_obj;
+
+    root_obj = json_parse_root_object(input, len);
+	if (root_obj == NULL) {
+		return team_config;
+	}
+
+	robots_obj = json_get_object_in_state(root_obj, "robots");
+	if (robots_obj == NULL) {
+		cJSON_Delete(root_obj);
+		return team_config;
+	}
+
+    robot_obj = cJSON_GetObjectItem(robots_obj, id);
+    team_obj = json_object_decode(robot_obj, "team");
+    if (team_obj != NULL && cJSON_IsNumber(team_obj)) {
+        team_config = true;
+        *team = team_obj->valueint;
+    }
+
+    cJSON_Delete(root_obj);
+
+	return team_config;
+}
+
+bool codec_decode_stop_mode(char *id, const char *input, size_t len, uint8_t *stop)
+{
+    bool stop_config = false;
+
+    cJSON *root_obj;
+	cJSON *robots_obj;
+	cJSON *robot_obj;
+	cJSON *stop_obj;
+
+    root_obj = json_parse_root_object(input, len);
+	if (root_obj == NULL) {
+		return stop_config;
+	}
+
+	robots_obj = json_get_object_in_state(root_obj, "robots");
+	if (robots_obj == NULL) {
+		cJSON_Delete(root_obj);
+		return stop_config;
+	}
+
+    robot_obj = cJSON_GetObjectItem(robots_obj, id);
+    stop_obj = json_object_decode(robot_obj, "stopMode");
+    if (stop_obj != NULL && cJSON_IsNumber(stop_obj)) {
+        stop_config = true;
+        *stop = stop_obj->valueint;
+    }
+
+    cJSON_Delete(root_obj);
+
+	return stop_config;
+}
+
+bool codec_decode_calibrate(char *id, const char *input, size_t len, uint8_t *request)
+{
+    bool calibrate = false;
+
+    cJSON *root_obj;
+	cJSON *robots_obj;
+	cJSON *robot_obj;
+	cJSON *calibrate_obj;
+
+    root_obj = json_parse_root_object(input, len);
+	if (root_obj == NULL) {
+		return calibrate;
+	}
+
+	robots_obj = json_get_object_in_state(root_obj, "robots");
+	if (robots_obj == NULL) {
+		cJSON_Delete(root_obj);
+		return calibrate;
+	}
+
+    robot_obj = cJSON_GetObjectItem(robots_obj, id);
+    calibrate_obj = json_object_decode(robot_obj, "calibrate");
+    if (calibrate_obj != NULL && cJSON_IsNumber(calibrate_obj)) {
+        calibrate = true;
+        *request = calibrate_obj->valueint;
+    }
+
+    cJSON_Delete(root_obj);
+
+	return calibrate;
+}
+
+int codec_decode_reported_ids(const char *input, size_t len,
+			      codec_id_cb cb, void *user_data)
 {
-	char *msg;
 	cJSON *root_obj;
+	cJSON *reported_obj;
+	cJSON *robots_obj;
+	cJSON *robot_obj;
 
+	root_obj = json_parse_root_object(input, len);
+	if (root_obj == NULL) {
+		return -EINVAL;
+	}
+
+	reported_obj = json_get_object_in_state(root_obj, "reported");
+	robots_obj = json_object_decode(reported_obj, "robots");
+	if (robots_obj == NULL || !cJSON_IsObject(robots_obj)) {
+		cJSON_Delete(root_obj);
+		return -ENODATA;
+	}
+
+	cJSON_ArrayForEach(robot_obj, robots_obj) {
+		if (robot_obj->string != NULL && !cJSON_IsNull(robot_obj)) {
+			cb(robot_obj->string, user_data);
+		}
+	}
+
+	cJSON_Delete(root_obj);
+
+	return 0;
+}
+
+char* codec_encode_movement_report(char *id, struct bt_mesh_movement_set movement)
+{
 	cJSON *robots_obj = cJSON_CreateObject();
 	if (robots_obj == NULL) {
 		return NULL;
@@ -197,31 +394,22 @@ char* codec_encode_movement_report(char *id, struct codec_movement movement)
 		return NULL;
 	} 
 
-	if (!cJSON_AddNumberToObject(robot_obj, "driveTimeMs", movement.drive_time)) {
+	if (!json_add_item(robots_obj, id, robot_obj)) {
+		cJSON_Delete(robots_obj);
 		return NULL;
 	}
 
-	if (!cJSON_AddNumberToObject(robot_obj, "angleDeg", movement.rotation)) {
+	if (!json_encode_bt_mesh_movement_set(robot_obj, &movement)) {
+		cJSON_Delete(robots_obj);
 		return NULL;
 	}
 
-	// if (!cJSON_AddNumberToObject(robot_obj, "speed", movement.speed)) {
-	// 	return NULL;
-	// }
-
-	cJSON_AddItemToObject(robots_obj, id, robot_obj);
-	root_obj = json_create_reported_object(robots_obj, "robots");
-	msg = cJSON_PrintUnformatted(root_obj);
-	cJSON_Delete(root_obj);
-
-	return msg;
+	return json_print_reported_object(robots_obj, "robots");
 }
 
 char* codec_encode_led_report(char *id, uint8_t red, uint8_t green, uint8_t blue, uint16_t time)
 {
-	char *msg;
 	int led[4];
-	cJSON *root_obj;
 
 	cJSON *robots_obj = cJSON_CreateObject();
 	if (robots_obj == NULL) {
@@ -229,12 +417,15 @@ char* codec_encode_led_report(char *id, uint8_t red, uint8_t green, uint8_t blue
 	}
 
 	cJSON *robot_obj = cJSON_CreateObject();
-	if (robots_obj == NULL) {
+	if (robot_obj == NULL) {
+		cJSON_Delete(robots_obj);
 		return NULL;
 	}
 
-
-	cJSON_AddItemToObject(robots_obj, id, robot_obj);
+	if (!json_add_item(robots_obj, id, robot_obj)) {
+		cJSON_Delete(robots_obj);
+		return NULL;
+	}
 
 	led[0] = red;
 	led[1] = green;
@@ -242,51 +433,128 @@ char* codec_encode_led_report(char *id, uint8_t red, uint8_t green, uint8_t blue
 	led[3] = time;
 
 	cJSON *led_obj = cJSON_CreateIntArray(led, 4);
-	if (!cJSON_AddItemToObject(robot_obj, "led", led_obj)) {
+	if (led_obj == NULL) {
+		cJSON_Delete(robots_obj);
 		return NULL;
-	};
+	}
 
-	root_obj = json_create_reported_object(robots_obj, "robots");
+	if (!json_add_item(robot_obj, "led", led_obj)) {
+		cJSON_Delete(robots_obj);
+		return NULL;
+	}
 
-	msg = cJSON_PrintUnformatted(root_obj);
-	cJSON_Delete(root_obj);
-	return msg;
+	return json_print_reported_object(robots_obj, "robots");
 }
 
 char* codec_encode_revolution_count_report(char *id, uint8_t revolutions)
 {
-	char *msg;
-	cJSON *root_obj;
-
 	cJSON *robots_obj = cJSON_CreateObject();
 	if (robots_obj == NULL) {
 		return NULL;
 	}
 
     cJSON *robot_obj = cJSON_CreateObject();
-    if (robots_obj == NULL) {
+    if (robot_obj == NULL) {
+        cJSON_Delete(robots_obj);
         return NULL;
     } 
 
+    if (!json_add_item(robots_obj, id, robot_obj)) {
+        cJSON_Delete(robots_obj);
+        return NULL;
+    }
 
-    cJSON_AddItemToObject(robots_obj, id, robot_obj);
+    struct bt_mesh_telemetry_report report = {
+        .revolutions = revolutions,
+    };
 
-    if (!cJSON_AddNumberToObject(robot_obj, "revolutionCount", revolutions)) {
+    if (!json_encode_bt_mesh_telemetry_report(robot_obj, &report)) {
+        cJSON_Delete(robots_obj);
         return NULL;
     }
 
-	root_obj = json_create_reported_object(robots_obj, "robots");
+	return json_print_reported_object(robots_obj, "robots");
+}
 
-	msg = cJSON_PrintUnformatted(root_obj);
-	cJSON_Delete(root_obj);
-	return msg;
+char* codec_encode_calibration_report(char *id, uint8_t request,
+				      const struct bt_mesh_calibration_status *status)
+{
+	cJSON *robots_obj = cJSON_CreateObject();
+	if (robots_obj == NULL) {
+		return NULL;
+	}
+
+	cJSON *robot_obj = cJSON_CreateObject();
+	if (robot_obj == NULL) {
+		cJSON_Delete(robots_obj);
+		return NULL;
+	}
+
+	if (!json_add_item(robots_obj, id, robot_obj)) {
+		cJSON_Delete(robots_obj);
+		return NULL;
+	}
+
+	cJSON *calibration_obj = cJSON_CreateObject();
+	if (calibration_obj == NULL) {
+		cJSON_Delete(robots_obj);
+		return NULL;
+	}
+
+	if (!json_add_item(robot_obj, "calibration", calibration_obj)) {
+		cJSON_Delete(robots_obj);
+		return NULL;
+	}
+
+	if (!cJSON_AddNumberToObject(robot_obj, "calibrate", request) ||
+	    !cJSON_AddNumberToObject(calibration_obj, "err", status->err) ||
+	    !json_encode_bt_mesh_calibration_status(calibration_obj, status)) {
+		cJSON_Delete(robots_obj);
+		return NULL;
+	}
+
+	return json_print_reported_object(robots_obj, "robots");
 }
 
-char* codec_encode_remove_robot_report(char *id) 
+char* codec_encode_power_report(char *id, const struct bt_mesh_telemetry_power *power)
 {
-	char *msg;
-	cJSON *root_obj;
+	cJSON *robots_obj = cJSON_CreateObject();
+	if (robots_obj == NULL) {
+		return NULL;
+	}
+
+	cJSON *robot_obj = cJSON_CreateObject();
+	if (robot_obj == NULL) {
+		cJSON_Delete(robots_obj);
+		return NULL;
+	}
+
+	if (!json_add_item(robots_obj, id, robot_obj)) {
+		cJSON_Delete(robots_obj);
+		return NULL;
+	}
+
+	cJSON *power_obj = cJSON_CreateObject();
+	if (power_obj == NULL) {
+		cJSON_Delete(robots_obj);
+		return NULL;
+	}
 
+	if (!json_add_item(robot_obj, "power", power_obj)) {
+		cJSON_Delete(robots_obj);
+		return NULL;
+	}
+
+	if (!json_encode_bt_mesh_telemetry_power(power_obj, power)) {
+		cJSON_Delete(robots_obj);
+		return NULL;
+	}
+
+	return json_print_reported_object(robots_obj, "robots");
+}
+
+char* codec_encode_remove_robot_report(char *id) 
+{
 	cJSON *robots_obj = cJSON_CreateObject();
 	if (robots_obj == NULL) {
 		return NULL;
@@ -294,16 +562,16 @@ char* codec_encode_remove_robot_report(char *id)
 
 	cJSON *robot_obj = cJSON_CreateNull();
 	if (robot_obj == NULL) {
+		cJSON_Delete(robots_obj);
 		return NULL;
 	}  
 
-	cJSON_AddItemToObject(robots_obj, id, robot_obj);
-	
-	root_obj = json_create_reported_object(robots_obj, "robots");
+	if (!json_add_item(robots_obj, id, robot_obj)) {
+		cJSON_Delete(robots_obj);
+		return NULL;
+	}
 
-	msg = cJSON_PrintUnformatted(root_obj);
-	cJSON_Delete(root_obj);
-	return msg;
+	return json_print_reported_object(robots_obj, "robots");
 }
 
 char* codec_encode_remove_robots_report(void) 
@@ -320,11 +588,85 @@ char* codec_encode_remove_robots_report(void)
 		return NULL;
 	} 
 
-	cJSON_AddItemToObject(root_obj, "state", state_obj);
+	if (!json_add_item(root_obj, "state", state_obj)) {
+		cJSON_Delete(root_obj);
+		return NULL;
+	}
 
 	msg = cJSON_PrintUnformatted(root_obj);
 	cJSON_Delete(root_obj);
 	return msg;
 }
 
- 
\ No newline at end of file
+static cJSON *json_create_robot_object(const struct codec_robot *robot)
+{
+	int led[4];
+	cJSON *led_obj;
+	cJSON *robot_obj;
+
+	if (robot->removed) {
+		return cJSON_CreateNull();
+	}
+
+	robot_obj = cJSON_CreateObject();
+	if (robot_obj == NULL) {
+		return NULL;
+	}
+
+	struct bt_mesh_telemetry_report report = {
+		.revolutions = robot->revolutions,
+	};
+
+	if (((robot->fields & CODEC_ROBOT_MOVEMENT) &&
+	     !json_encode_bt_mesh_movement_set(robot_obj, &robot->movement)) ||
+	    ((robot->fields & CODEC_ROBOT_REVOLUTIONS) &&
+	     !json_encode_bt_mesh_telemetry_report(robot_obj, &report))) {
+		cJSON_Delete(robot_obj);
+		return NULL;
+	}
+
+	if (!(robot->fields & CODEC_ROBOT_LED)) {
+		return robot_obj;
+	}
+
+	led[0] = robot->led.red;
+	led[1] = robot->led.green;
+	led[2] = robot->led.blue;
+	led[3] = robot->led.blink_time;
+
+	led_obj = cJSON_CreateIntArray(led, 4);
+	if (led_obj == NULL) {
+		cJSON_Delete(robot_obj);
+		return NULL;
+	}
+
+	if (!json_add_item(robot_obj, "led", led_obj)) {
+		cJSON_Delete(robot_obj);
+		return NULL;
+	}
+
+	return robot_obj;
+}
+
+char* codec_encode_robots_report(const struct codec_robot *robots, size_t count)
+{
+	cJSON *robots_obj = cJSON_CreateObject();
+	if (robots_obj == NULL) {
+		return NULL;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		cJSON *robot_obj = json_create_robot_object(&robots[i]);
+		if (robot_obj == NULL) {
+			cJSON_Delete(robots_obj);
+			return NULL;
+		}
+
+		if (!json_add_item(robots_obj, robots[i].id, robot_obj)) {
+			cJSON_Delete(robots_obj);
+			return NULL;
+		}
+	}
+
+	return json_print_reported_object(robots_obj, "robots");
+}
@@ -16,34 +16,72 @@
 #include <stdio.h>
 #include <stdbool.h>
 #include <cJSON.h>
-
-struct codec_led {
-    uint16_t time;
-    uint8_t red, green, blue;
+#include <bluetooth/mesh/vnd/schema.h>
+
+/* Fields of a robot included in a robots report. */
+#define CODEC_ROBOT_MOVEMENT    (1 << 0)
+#define CODEC_ROBOT_REVOLUTIONS (1 << 1)
+#define CODEC_ROBOT_LED         (1 << 2)
+#define CODEC_ROBOT_ALL (CODEC_ROBOT_MOVEMENT | CODEC_ROBOT_REVOLUTIONS | CODEC_ROBOT_LED)
+
+/** Reported state of one robot. */
+struct codec_robot {
+	char *id;
+	/* Report the robot as removed, other fields are ignored */
+	bool removed;
+	/* CODEC_ROBOT_* fields to report */
+	uint8_t fields;
+	struct bt_mesh_movement_set movement;
+	uint8_t revolutions;
+	struct bt_mesh_light_rgb_set led;
 };
 
-struct codec_movement {
-	uint32_t drive_time;
-	int32_t rotation;
-	uint8_t speed;
-};
+/** @brief Make the codec allocate from the kernel heap, so that encoded
+ *         messages can be released with k_free().
+ */
+void codec_init(void);
 
 int codec_decode_version(const char *input, size_t len);
 
-bool codec_decode_movement(char *id, const char *input, size_t len, struct codec_movement *movement);
+bool codec_decode_movement(char *id, const char *input, size_t len, struct bt_mesh_movement_set *movement);
+
+bool codec_decode_led(char *id, const char *input, size_t len, struct bt_mesh_light_rgb_set *led);
 
-bool codec_decode_led(char *id, const char *input, size_t len, struct codec_led *led);
+bool codec_decode_team(char *id, const char *input, size_t len, uint8_t *team);
 
-char* codec_encode_movement_report(char *id, struct codec_movement movement);
+bool codec_decode_stop_mode(char *id, const char *input, size_t len, uint8_t *stop);
+
+bool codec_decode_calibrate(char *id, const char *input, size_t len, uint8_t *request);
+
+/** Callback for every robot id found in a shadow document. */
+typedef void (*codec_id_cb)(const char *id, void *user_data);
+
+/** @brief Decode the ids of the robots in the reported state of a shadow
+ *         document, as returned by a shadow get.
+ *
+ * @retval 0 on success, -ENODATA if no robot is reported, -EINVAL if the
+ *         document is malformed.
+ */
+int codec_decode_reported_ids(const char *input, size_t len,
+			      codec_id_cb cb, void *user_data);
+
+char* codec_encode_movement_report(char *id, struct bt_mesh_movement_set movement);
 
 char* codec_encode_led_report(char *id, uint8_t red, uint8_t green, uint8_t blue, uint16_t blink_time);
 
 char* codec_encode_revolution_count_report(char *id, uint8_t revolutions);
 
+char* codec_encode_calibration_report(char *id, uint8_t request,
+				      const struct bt_mesh_calibration_status *status);
+
+char* codec_encode_power_report(char *id, const struct bt_mesh_telemetry_power *power);
+
 char* codec_encode_remove_robot_report(char *id);
 
 char* codec_encode_remove_robots_report(void);
 
+char* codec_encode_robots_report(const struct codec_robot *robots, size_t count);
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -0,0 +1,208 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr/sys/util.h>
+#include <zcbor_encode.h>
+#include <zcbor_decode.h>
+
+#include "codec_cbor.h"
+
+/* Deepest nesting is message list, robot list and field list. */
+#define CBOR_STATE_COUNT 5
+
+/* CBOR encoding of the schema fields, as a list of integers in schema order. */
+#define CBOR_SCHEMA_FIELD_COUNT_ONE(type, name, wire, json) +1
+#define CBOR_SCHEMA_FIELD_COUNT(_fields) (0 _fields(CBOR_SCHEMA_FIELD_COUNT_ONE))
+
+#define CBOR_SCHEMA_ENCODE_FIELD(type, name, wire, json)                         \
+	ok = ok && zcbor_int64_put(state, val->name);
+
+#define CBOR_SCHEMA_DECODE_FIELD(type, name, wire, json)                         \
+	if (ok && zcbor_int64_decode(state, &value) &&                           \
+	    (int64_t)(type)value == value) {                                     \
+		val->name = (type)value;                                         \
+	} else {                                                                 \
+		ok = false;                                                      \
+	}
+
+#define CBOR_SCHEMA_ENCODE_DEFINE(_name, _fields)                                \
+	static bool cbor_encode_##_name(zcbor_state_t *state,                    \
+					const struct _name *val)                 \
+	{                                                                        \
+		bool ok = true;                                                  \
+		_fields(CBOR_SCHEMA_ENCODE_FIELD)                                \
+		return ok;                                                       \
+	}
+
+#define CBOR_SCHEMA_DECODE_DEFINE(_name, _fields)                                \
+	static bool cbor_decode_##_name(zcbor_state_t *state, struct _name *val) \
+	{                                                                        \
+		bool ok = true;                                                  \
+		int64_t value;                                                   \
+		_fields(CBOR_SCHEMA_DECODE_FIELD)                                \
+		return ok;                                                       \
+	}
+
+CBOR_SCHEMA_ENCODE_DEFINE(bt_mesh_movement_set, BT_MESH_MOVEMENT_SET_FIELDS)
+CBOR_SCHEMA_ENCODE_DEFINE(bt_mesh_telemetry_report, BT_MESH_TELEMETRY_REPORT_FIELDS)
+CBOR_SCHEMA_DECODE_DEFINE(bt_mesh_movement_set, BT_MESH_MOVEMENT_SET_FIELDS)
+CBOR_SCHEMA_DECODE_DEFINE(bt_mesh_light_rgb_set, BT_MESH_LIGHT_RGB_SET_FIELDS)
+
+/* Decodes a nil, or the field list of message @p _name into @p val. */
+#define CBOR_DECODE_OPTIONAL(state, _name, val, present)                         \
+	(zcbor_nil_expect(state, NULL) ||                                        \
+	 (zcbor_list_start_decode(state) &&                                      \
+	  cbor_decode_##_name(state, val) &&                                     \
+	  zcbor_list_end_decode(state) &&                                        \
+	  ((present) = true)))
+
+/* Returns -ENOENT if there are no more robots in the message. */
+static int cbor_decode_robot(zcbor_state_t *state, struct codec_cbor_command *cmd)
+{
+	struct zcbor_string id;
+
+	memset(cmd, 0, sizeof(*cmd));
+
+	if (!zcbor_list_start_decode(state)) {
+		return -ENOENT;
+	}
+
+	if (!zcbor_tstr_decode(state, &id)) {
+		return -EBADMSG;
+	}
+
+	cmd->id = (const char *)id.value;
+	cmd->id_len = id.len;
+
+	if (!CBOR_DECODE_OPTIONAL(state, bt_mesh_movement_set,
+				  &cmd->movement, cmd->has_movement) ||
+	    !CBOR_DECODE_OPTIONAL(state, bt_mesh_light_rgb_set,
+				  &cmd->led, cmd->has_led) ||
+	    !zcbor_list_end_decode(state)) {
+		return -EBADMSG;
+	}
+
+	return 0;
+}
+
+static int cbor_decode_commands(const uint8_t *input, size_t len,
+				codec_cbor_command_cb cb, void *user_data)
+{
+	zcbor_state_t states[CBOR_STATE_COUNT];
+	struct codec_cbor_command cmd;
+	uint32_t version;
+	int err;
+
+	zcbor_new_state(states, ARRAY_SIZE(states), input, len, 1);
+
+	if (!zcbor_list_start_decode(states) ||
+	    !zcbor_uint32_decode(states, &version)) {
+		return -EBADMSG;
+	}
+
+	while ((err = cbor_decode_robot(states, &cmd)) == 0) {
+		if (cb) {
+			cb(&cmd, user_data);
+		}
+	}
+
+	if (err != -ENOENT || !zcbor_list_end_decode(states)) {
+		return -EBADMSG;
+	}
+
+	return 0;
+}
+
+int codec_cbor_decode_version(const uint8_t *input, size_t len)
+{
+	zcbor_state_t states[CBOR_STATE_COUNT];
+	uint32_t version;
+
+	zcbor_new_state(states, ARRAY_SIZE(states), input, len, 1);
+
+	if (!zcbor_list_start_decode(states) ||
+	    !zcbor_uint32_decode(states, &version) ||
+	    version > INT32_MAX) {
+		return -EBADMSG;
+	}
+
+	return version;
+}
+
+int codec_cbor_decode_commands(const uint8_t *input, size_t len,
+			       codec_cbor_command_cb cb, void *user_data)
+{
+	int err;
+
+	/* Validate the whole message before acting on any of it. */
+	err = cbor_decode_commands(input, len, NULL, NULL);
+	if (err) {
+		return err;
+	}
+
+	return cbor_decode_commands(input, len, cb, user_data);
+}
+
+static int cbor_encode_report(uint8_t *buf, size_t size,
+			      enum codec_cbor_report_kind kind, const char *id,
+			      const void *val)
+{
+	zcbor_state_t states[CBOR_STATE_COUNT];
+	struct zcbor_string id_str = {
+		.value = (const uint8_t *)id,
+		.len = strlen(id),
+	};
+	size_t field_count;
+	bool ok;
+
+	switch (kind) {
+	case CODEC_CBOR_REPORT_MOVEMENT:
+		field_count = CBOR_SCHEMA_FIELD_COUNT(BT_MESH_MOVEMENT_SET_FIELDS);
+		break;
+	case CODEC_CBOR_REPORT_TELEMETRY:
+		field_count = CBOR_SCHEMA_FIELD_COUNT(BT_MESH_TELEMETRY_REPORT_FIELDS);
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	zcbor_new_state(states, ARRAY_SIZE(states), buf, size, 1);
+
+	ok = zcbor_list_start_encode(states, 2 + field_count) &&
+	     zcbor_uint32_put(states, kind) &&
+	     zcbor_tstr_encode(states, &id_str);
+
+	if (kind == CODEC_CBOR_REPORT_MOVEMENT) {
+		ok = ok && cbor_encode_bt_mesh_movement_set(states, val);
+	} else {
+		ok = ok && cbor_encode_bt_mesh_telemetry_report(states, val);
+	}
+
+	ok = ok && zcbor_list_end_encode(states, 2 + field_count);
+	if (!ok) {
+		return -ENOMEM;
+	}
+
+	return states[0].payload - buf;
+}
+
+int codec_cbor_encode_movement_report(uint8_t *buf, size_t size, const char *id,
+				      const struct bt_mesh_movement_set *movement)
+{
+	return cbor_encode_report(buf, size, CODEC_CBOR_REPORT_MOVEMENT, id, movement);
+}
+
+int codec_cbor_encode_revolution_count_report(uint8_t *buf, size_t size,
+					      const char *id, uint8_t revolutions)
+{
+	struct bt_mesh_telemetry_report report = {
+		.revolutions = revolutions,
+	};
+
+	return cbor_encode_report(buf, size, CODEC_CBOR_REPORT_TELEMETRY, id, &report);
+}
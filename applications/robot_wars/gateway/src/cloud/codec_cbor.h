@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef CODEC_CBOR_H_
+#define CODEC_CBOR_H_
+
+/**
+ * @brief Binary robot command and report codec.
+ * @defgroup codec_cbor Binary Cloud Codec
+ * @{
+ *
+ * Compact alternative to the JSON shadow for the per round messages, used
+ * on dedicated MQTT topics. Field order follows the message schema in
+ * bluetooth/mesh/vnd/schema.h.
+ *
+ * Command message:
+ *   [version, robot, robot, ...]
+ *   robot = [id, movement / nil, led / nil]
+ *   movement = [time, angle, speed]
+ *   led = [blink_time, red, green, blue]
+ *
+ * Report message:
+ *   [kind, id, fields...] with kind CODEC_CBOR_REPORT_*, and the fields of
+ *   the movement or telemetry schema.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <bluetooth/mesh/vnd/schema.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum codec_cbor_report_kind {
+	CODEC_CBOR_REPORT_MOVEMENT,
+	CODEC_CBOR_REPORT_TELEMETRY,
+};
+
+/** Command for one robot. */
+struct codec_cbor_command {
+	/* Robot id, not null terminated */
+	const char *id;
+	size_t id_len;
+	bool has_movement;
+	struct bt_mesh_movement_set movement;
+	bool has_led;
+	struct bt_mesh_light_rgb_set led;
+};
+
+typedef void (*codec_cbor_command_cb)(const struct codec_cbor_command *cmd,
+				      void *user_data);
+
+/** Upper bound of the encoded size of a single robot report. */
+#define CODEC_CBOR_REPORT_SIZE_MAX 40
+
+/** @brief Decode the version of a command message.
+ *
+ * @retval Version of the message, or -EBADMSG if the message is malformed.
+ */
+int codec_cbor_decode_version(const uint8_t *input, size_t len);
+
+/** @brief Decode a command message.
+ *
+ * @param[in] input Encoded message.
+ * @param[in] len Length of the message.
+ * @param[in] cb Called for every robot in the message, after the whole
+ *               message has been validated.
+ * @param[in] user_data Passed to @p cb.
+ *
+ * @retval 0 on success, -EBADMSG if the message is malformed.
+ */
+int codec_cbor_decode_commands(const uint8_t *input, size_t len,
+			       codec_cbor_command_cb cb, void *user_data);
+
+/** @brief Encode a movement report.
+ *
+ * @retval Length of the encoded report, or -ENOMEM if @p size is too small.
+ */
+int codec_cbor_encode_movement_report(uint8_t *buf, size_t size, const char *id,
+				      const struct bt_mesh_movement_set *movement);
+
+/** @brief Encode a revolution count report.
+ *
+ * @retval Length of the encoded report, or -ENOMEM if @p size is too small.
+ */
+int codec_cbor_encode_revolution_count_report(uint8_t *buf, size_t size,
+					      const char *id, uint8_t revolutions);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @}
+ */
+
+#endif /* CODEC_CBOR_H_ */
@@ -32,6 +32,10 @@ static char *type_to_str(enum cloud_module_event_type type)
         return "CLOUD_EVT_SEND_QOS_CLEAR";
     case CLOUD_EVT_UPDATE_DELTA:
         return "CLOUD_EVT_UPDATE_DELTA";
+    case CLOUD_EVT_COMMAND:
+        return "CLOUD_EVT_COMMAND";
+    case CLOUD_EVT_SHADOW:
+        return "CLOUD_EVT_SHADOW";
     case CLOUD_EVT_ERROR:
         return "CLOUD_EVT_ERROR";
     default:
@@ -30,6 +30,9 @@ enum cloud_module_event_type {
 	CLOUD_EVT_SEND_QOS,
 	CLOUD_EVT_SEND_QOS_CLEAR,
 	CLOUD_EVT_UPDATE_DELTA,
+	CLOUD_EVT_COMMAND,
+	/* Shadow document requested by ROBOT_EVT_SHADOW_GET, empty if there is none */
+	CLOUD_EVT_SHADOW,
 	CLOUD_EVT_ERROR,
 };
 
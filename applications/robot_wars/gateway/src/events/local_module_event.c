@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <stdio.h>
+
+#include "local_module_event.h"
+
+
+static void profile_local_module_event(struct log_event_buf *buf,
+			      const struct app_event_header *aeh)
+{
+}
+
+static char *type_to_str(enum local_module_event_type type)
+{
+    switch (type)
+    {
+    case LOCAL_EVT_UPDATE_DELTA:
+        return "LOCAL_EVT_UPDATE_DELTA";
+    case LOCAL_EVT_ERROR:
+        return "LOCAL_EVT_ERROR";
+    default:
+        return "UNKNOWN";
+    }
+}
+
+static void log_local_module_evt(const struct app_event_header *evt)
+{
+
+    struct local_module_event *local_module_evt = cast_local_module_event(evt);
+
+    APP_EVENT_MANAGER_LOG(evt, "Type: %s", type_to_str(local_module_evt->type));
+}
+
+APP_EVENT_INFO_DEFINE(local_module_event,
+		  ENCODE(),
+		  ENCODE(),
+		  profile_local_module_event);
+
+APP_EVENT_TYPE_DEFINE(local_module_event,
+		  log_local_module_evt,
+		  &local_module_event_info,
+		  APP_EVENT_FLAGS_CREATE(APP_EVENT_TYPE_FLAGS_INIT_LOG_ENABLE));
@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef _LOCAL_MODULE_EVENT_H_
+#define _LOCAL_MODULE_EVENT_H_
+
+/**
+ * @brief LOCAL Event
+ * @defgroup local_module_event LOCAL Event
+ * @{
+ */
+
+#include <app_event_manager.h>
+#include <app_event_manager_profiler_tracer.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum local_module_event_type {
+	LOCAL_EVT_UPDATE_DELTA,
+	LOCAL_EVT_ERROR,
+};
+
+struct local_delta {
+	/* Delta document, freed with k_free() by the receiver */
+	char *ptr;
+	size_t len;
+};
+
+struct local_module_event {
+	struct app_event_header header;
+	enum local_module_event_type type;
+	union {
+		struct local_delta delta;
+		int err;
+	} data;
+};
+
+APP_EVENT_TYPE_DECLARE(local_module_event);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @}
+ */
+
+#endif /* _LOCAL_MODULE_EVENT_H_ */
@@ -23,6 +23,10 @@ static char *type_to_str(enum mesh_module_event_type type)
         return "MESH_EVT_MOVEMENT_CONFIGURED";
     case MESH_EVT_TELEMETRY_REPORTED:
         return "MESH_EVT_TELEMETRY_REPORTED";
+    case MESH_EVT_GROUPS:
+        return "MESH_EVT_GROUPS";
+    case MESH_EVT_CALIBRATED:
+        return "MESH_EVT_CALIBRATED";
     default:
         return "UNKNOWN";
     }
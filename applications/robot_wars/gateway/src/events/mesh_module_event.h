@@ -14,6 +14,7 @@
 
 #include <app_event_manager.h>
 #include <app_event_manager_profiler_tracer.h>
+#include <bluetooth/mesh/vnd/schema.h>
 
 // #include "bluetooth/mesh/vnd/robot_cli.h"
 
@@ -33,24 +34,53 @@ extern "C" {
 #define BT_MESH_MOVEMENT_OP_READY_SET BT_MESH_MODEL_OP_3(0x0D, 0x0059)
 #define BT_MESH_TELEMETRY_OP_TELEMETRY_REPORT BT_MESH_MODEL_OP_3(0x0F, 0x0059)
 #define BT_MESH_LIGHT_RGB_OP_RGB_SET BT_MESH_MODEL_OP_3(0x10, 0x0059)
+#define BT_MESH_MOVEMENT_OP_CALIBRATE BT_MESH_MODEL_OP_3(0x11, 0x0059)
+#define BT_MESH_MOVEMENT_OP_CALIBRATION_STATUS BT_MESH_MODEL_OP_3(0x12, 0x0059)
+
+/* Access layer payload length of the id status, as sent through the bridge. */
+#define BT_MESH_ID_STATUS_LEN 6
+
+/* Bridge control messages, handled by the bridge instead of being sent on
+ * the mesh.
+ */
+#define BRIDGE_CTRL_ID 0xFFFF
+#define BRIDGE_CTRL_OP_TEAM_SET 0x01
+#define BRIDGE_CTRL_OP_GROUPS_STATUS 0x02
+
+/* Team of robots that are in no team. */
+#define MESH_TEAM_NONE 0xFF
+
+#define MESH_GROUP_ADDR_ALL CONFIG_MESH_GROUPS_BASE_ADDR
+#define MESH_GROUP_ADDR_TEAM(_team) (CONFIG_MESH_GROUPS_BASE_ADDR + 1 + (_team))
 
 enum mesh_module_event_type {
     MESH_EVT_READY,
 	MESH_EVT_ROBOT_ID,
 	MESH_EVT_MOVEMENT_CONFIGURED,
 	MESH_EVT_TELEMETRY_REPORTED,
+	MESH_EVT_GROUPS,
+	MESH_EVT_CALIBRATED,
 };
 
+/** Group subscriptions applied on a robot, as reported by the bridge. */
+struct mesh_groups_status {
+	/* Team group the robot is subscribed to, or MESH_TEAM_NONE */
+	uint8_t team;
+	/* Light and movement models subscribed to the all robots group */
+	uint8_t all;
+} __packed;
+
 /** Id status message parameters.  */
 struct bt_mesh_id_status {
 	/** static identity of device */
 	uint64_t id;
 };
 
-/** Id status message parameters.  */
-struct bt_mesh_telemetry_report {
-	/** static identity of device */
-	uint8_t revolutions;
+/** Telemetry report, with the power summary of robots that send one. */
+struct mesh_telemetry {
+	struct bt_mesh_telemetry_report report;
+	struct bt_mesh_telemetry_power power;
+	bool has_power;
 };
 
 struct mesh_module_event {
@@ -59,7 +89,11 @@ struct mesh_module_event {
     uint16_t addr;
     union {
         struct bt_mesh_id_status robot_id;
-        struct bt_mesh_telemetry_report report;
+        struct mesh_telemetry telemetry;
+        /* Round of an acknowledged movement */
+        uint8_t round;
+        struct mesh_groups_status groups;
+        struct bt_mesh_calibration_status calibration;
     } data;
 };
 
@@ -29,6 +29,10 @@ static char *type_to_str(enum modem_module_event_type type)
         return "MODEM_EVT_LTE_CONNECTED"; 
     case MODEM_EVT_LTE_DISCONNECTED:
         return "MODEM_EVT_LTE_DISCONNECTED";
+    case MODEM_EVT_RRC_CONNECTED:
+        return "MODEM_EVT_RRC_CONNECTED";
+    case MODEM_EVT_RRC_IDLE:
+        return "MODEM_EVT_RRC_IDLE";
     case MODEM_EVT_ERROR:
         return "MODEM_EVT_ERROR";
     default:
@@ -24,6 +24,8 @@ enum modem_module_event_type {
 	MODEM_EVT_LTE_CONNECTING,
 	MODEM_EVT_LTE_CONNECTED,
 	MODEM_EVT_LTE_DISCONNECTED,
+	MODEM_EVT_RRC_CONNECTED,
+	MODEM_EVT_RRC_IDLE,
 	MODEM_EVT_ERROR,
 };
 
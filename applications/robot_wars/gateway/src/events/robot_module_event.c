@@ -35,6 +35,18 @@ static char *type_to_str(enum robot_module_event_type type)
         return "ROBOT_EVT_ERROR";
     case ROBOT_EVT_CLEAR_TO_MOVE:
         return "ROBOT_EVT_CLEAR_TO_MOVE";
+    case ROBOT_EVT_ROUND_DEADLINE:
+        return "ROBOT_EVT_ROUND_DEADLINE";
+    case ROBOT_EVT_TEAM_SET:
+        return "ROBOT_EVT_TEAM_SET";
+    case ROBOT_EVT_ROUND_METRICS:
+        return "ROBOT_EVT_ROUND_METRICS";
+    case ROBOT_EVT_CALIBRATE:
+        return "ROBOT_EVT_CALIBRATE";
+    case ROBOT_EVT_SHADOW_GET:
+        return "ROBOT_EVT_SHADOW_GET";
+    case ROBOT_EVT_SHADOW_TIMEOUT:
+        return "ROBOT_EVT_SHADOW_TIMEOUT";
     default:
         return "UNKNOWN";
     }
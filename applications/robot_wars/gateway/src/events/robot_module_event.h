@@ -27,16 +27,83 @@ enum robot_module_event_type {
 	ROBOT_EVT_LED_CONFIGURE,
 	ROBOT_EVT_ERROR,
 	ROBOT_EVT_CLEAR_TO_MOVE,
+	ROBOT_EVT_ROUND_DEADLINE,
+	ROBOT_EVT_TEAM_SET,
+	ROBOT_EVT_ROUND_METRICS,
+	ROBOT_EVT_CALIBRATE,
+	ROBOT_EVT_SHADOW_GET,
+	ROBOT_EVT_SHADOW_TIMEOUT,
+};
+
+/* Round phase a deadline applies to. */
+enum robot_round_phase {
+	/* Movements of the next round are acknowledged */
+	ROBOT_ROUND_PHASE_CONFIGURE,
+	/* Robots have moved and reported telemetry for the running round */
+	ROBOT_ROUND_PHASE_MOVE,
+};
+
+/* Field class of a report. A pending report is replaced by a newer report
+ * of the same robot and class.
+ */
+enum robot_report_field {
+	/* Batched report with the latest value of every field reported since
+	 * the previous batch, replaces all pending field reports.
+	 */
+	ROBOT_REPORT_FIELD_NONE,
+	ROBOT_REPORT_FIELD_MOVEMENT,
+	ROBOT_REPORT_FIELD_REVOLUTIONS,
+	ROBOT_REPORT_FIELD_CALIBRATION,
+	ROBOT_REPORT_FIELD_POWER,
+};
+
+/* Robot covered by a batch report. */
+struct robot_report_covered {
+	uint16_t addr;
+	/* BIT(ROBOT_REPORT_FIELD_*) of the fields the batch carries */
+	uint8_t fields;
+};
+
+struct robot_report {
+	uint8_t *ptr;
+	size_t len;
+	/* Binary report for the robot report topic, JSON shadow update otherwise */
+	bool binary;
+	enum robot_report_field field;
+	/* Robots a batch report covers, freed with ptr */
+	struct robot_report_covered *covered;
+	size_t covered_count;
+};
+
+/* Timing of a completed round, in milliseconds, -1 where not measured. */
+struct robot_round_metrics {
+	/* Robots the round started with */
+	uint16_t robots;
+	/* Robots that missed a deadline of the round */
+	uint16_t degraded;
+	/* First movement configuration sent until the round started */
+	int32_t configure_ms;
+	/* First movement configuration sent until the last ack */
+	int32_t ack_ms;
+	/* Round start until the last telemetry report */
+	int32_t telemetry_ms;
 };
 
 struct robot_module_event {
 	struct app_event_header header;
 	enum robot_module_event_type type;
 	uint16_t addr;
+	/* Round of a movement configuration or clear to move */
+	uint8_t round;
+	/* Stop mode of a movement configuration */
+	uint8_t stop;
 	union {
-		struct codec_movement *movement;
-		struct codec_led *led;
-		char* str;
+		struct bt_mesh_movement_set *movement;
+		struct bt_mesh_light_rgb_set *led;
+		struct robot_report report;
+		enum robot_round_phase phase;
+		uint8_t team;
+		struct robot_round_metrics metrics;
 		int err;
 	} data;
 };
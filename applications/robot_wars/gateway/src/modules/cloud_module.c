@@ -7,10 +7,11 @@
 #include <zephyr/kernel.h>
 #include <zephyr/device.h>
 #include <net/aws_iot.h>
-#include <nrf_modem_at.h>
 #include <string.h>
+#include <errno.h>
 #include <qos.h>
 #include <net/socket.h>
+#include <zephyr/random/rand32.h>
 
 #define MODULE cloud_module
 
@@ -25,11 +26,47 @@ LOG_MODULE_REGISTER(MODULE, CONFIG_CLOUD_MODULE_LOG_LEVEL);
 
 #define TOPIC_UPDATE_DELTA "$aws/things/" CONFIG_AWS_IOT_CLIENT_ID_STATIC "/shadow/update/delta"
 #define TOPIC_GET_ACCEPTED "$aws/things/" CONFIG_AWS_IOT_CLIENT_ID_STATIC "/shadow/get/accepted"
+#define TOPIC_GET_REJECTED "$aws/things/" CONFIG_AWS_IOT_CLIENT_ID_STATIC "/shadow/get/rejected"
 #define TOPIC_UPDATE_ACCEPTED "$aws/things/" CONFIG_AWS_IOT_CLIENT_ID_STATIC "/shadow/update/accepted"
 #define TOPIC_UPDATE_REJECTED "$aws/things/" CONFIG_AWS_IOT_CLIENT_ID_STATIC "/shadow/update/rejected"
 
-QOS_MESSAGE_TYPES_REGISTER(CLOUD_SHADOW_UPDATE);
-QOS_MESSAGE_TYPES_REGISTER(CLOUD_SHADOW_CLEAR);
+#if defined(CONFIG_CLOUD_CODEC_CBOR)
+#define TOPIC_ROBOTS_COMMAND CONFIG_AWS_IOT_CLIENT_ID_STATIC "/" CONFIG_CLOUD_CODEC_CBOR_TOPIC_COMMAND
+#define TOPIC_ROBOTS_REPORT CONFIG_AWS_IOT_CLIENT_ID_STATIC "/" CONFIG_CLOUD_CODEC_CBOR_TOPIC_REPORT
+
+static const struct aws_iot_topic_data app_topics[] = {
+	{
+		.str = TOPIC_ROBOTS_COMMAND,
+		.len = sizeof(TOPIC_ROBOTS_COMMAND) - 1,
+	},
+};
+#endif
+
+/* All types are registered at once, as every call starts a new enumeration. */
+QOS_MESSAGE_TYPES_REGISTER(CLOUD_SHADOW_UPDATE, CLOUD_SHADOW_CLEAR,
+			   CLOUD_SHADOW_REPORT, CLOUD_ROBOTS_REPORT);
+
+/* Pending replaceable report, one per robot and field class. */
+struct pending_report {
+	uint16_t addr;
+	enum robot_report_field field;
+	/* QoS message type of the report */
+	uint8_t type;
+	uint32_t id;
+	bool used;
+};
+
+static struct pending_report pending_reports[CONFIG_QOS_PENDING_MESSAGES_MAX];
+static struct k_spinlock pending_lock;
+
+/* Reports are held while the RRC connection is idle, see
+ * CONFIG_CLOUD_UPLINK_HOLD_MS.
+ */
+static atomic_t rrc_connected = ATOMIC_INIT(1);
+static atomic_t uplink_held;
+
+static void uplink_flush_work_fn(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(uplink_flush_work, uplink_flush_work_fn);
 
 struct aws_iot_config aws_config;
 
@@ -56,22 +93,27 @@ static enum sub_state_type {
 
 static struct k_work_delayable connect_check_work;
 
-struct cloud_backoff_delay_lookup {
-	int delay;
-};
-
-/* Lookup table for backoff reconnection to cloud. Binary scaling. */
-static struct cloud_backoff_delay_lookup backoff_delay[] = {
-	{ 32 }, { 64 }, { 128 }, { 256 }, { 512 },
-	{ 2048 }, { 4096 }, { 8192 }, { 16384 }, { 32768 },
-	{ 65536 }, { 131072 }, { 262144 }, { 524288 }, { 1048576 }
-};
+BUILD_ASSERT(CONFIG_CLOUD_BACKOFF_BASE_SEC > 0 &&
+	     CONFIG_CLOUD_BACKOFF_BASE_SEC <= CONFIG_CLOUD_BACKOFF_MAX_SEC,
+	     "Invalid cloud backoff bounds");
 
 /* Variable that keeps track of how many times a reconnection to cloud
  * has been tried without success.
  */
 static int connect_retries;
 
+/* Previous delay between connection attempts. */
+static uint32_t backoff_sec = CONFIG_CLOUD_BACKOFF_BASE_SEC;
+
+/* Time to reconnect after losing the cloud connection. */
+static struct {
+	int64_t disconnected_at;
+	uint32_t count;
+	uint32_t last_ms;
+	uint32_t max_ms;
+	uint64_t total_ms;
+} reconnect_stats;
+
 /* Cloud module message queue. */
 #define CLOUD_QUEUE_ENTRY_COUNT		20
 #define CLOUD_QUEUE_BYTE_ALIGNMENT	4
@@ -135,6 +177,205 @@ static void sub_state_set(enum sub_state_type new_state)
 	sub_state = new_state;
 }
 
+static bool is_report_type(uint8_t type)
+{
+	return type == CLOUD_SHADOW_REPORT || type == CLOUD_ROBOTS_REPORT;
+}
+
+/* Makes message id the pending report of the robot and field class.
+ * Returns the id of the report it replaces, or -ENOENT.
+ */
+static int pending_report_replace(uint16_t addr, enum robot_report_field field,
+				  uint8_t type, uint32_t id)
+{
+	struct pending_report *free_slot = NULL;
+	k_spinlock_key_t key;
+	int old_id = -ENOENT;
+
+	key = k_spin_lock(&pending_lock);
+	for (size_t i = 0; i < ARRAY_SIZE(pending_reports); i++) {
+		struct pending_report *slot = &pending_reports[i];
+
+		if (!slot->used) {
+			free_slot = free_slot ? free_slot : slot;
+			continue;
+		}
+
+		if (slot->addr == addr && slot->field == field) {
+			old_id = slot->id;
+			slot->type = type;
+			slot->id = id;
+			k_spin_unlock(&pending_lock, key);
+			return old_id;
+		}
+	}
+
+	if (free_slot) {
+		free_slot->addr = addr;
+		free_slot->field = field;
+		free_slot->type = type;
+		free_slot->id = id;
+		free_slot->used = true;
+	}
+	k_spin_unlock(&pending_lock, key);
+
+	return old_id;
+}
+
+/* Called when a message leaves the QoS list, acknowledged or not. */
+static void pending_report_release(uint32_t id)
+{
+	k_spinlock_key_t key = k_spin_lock(&pending_lock);
+
+	for (size_t i = 0; i < ARRAY_SIZE(pending_reports); i++) {
+		if (pending_reports[i].used && pending_reports[i].id == id) {
+			pending_reports[i].used = false;
+			break;
+		}
+	}
+	k_spin_unlock(&pending_lock, key);
+}
+
+static bool report_covered(const struct pending_report *slot,
+			   const struct robot_report_covered *covered, size_t count)
+{
+	for (size_t i = 0; i < count; i++) {
+		if (covered[i].addr == slot->addr) {
+			return covered[i].fields & BIT(slot->field);
+		}
+	}
+
+	return false;
+}
+
+/* Removes the pending shadow reports a batch report supersedes from the QoS
+ * list, those of the fields it carries for the robots it covers. Binary
+ * reports go to another topic, and stay pending.
+ */
+static void pending_report_remove_covered(const struct robot_report_covered *covered,
+					  size_t covered_count)
+{
+	uint32_t ids[ARRAY_SIZE(pending_reports)];
+	size_t count = 0;
+	k_spinlock_key_t key = k_spin_lock(&pending_lock);
+
+	for (size_t i = 0; i < ARRAY_SIZE(pending_reports); i++) {
+		const struct pending_report *slot = &pending_reports[i];
+
+		if (slot->used && slot->type == CLOUD_SHADOW_REPORT &&
+		    report_covered(slot, covered, covered_count)) {
+			ids[count++] = slot->id;
+		}
+	}
+	k_spin_unlock(&pending_lock, key);
+
+	/* Removal releases the slot through the QoS event handler. */
+	for (size_t i = 0; i < count; i++) {
+		int err = qos_message_remove(ids[i]);
+
+		if (err && err != -ENODATA) {
+			LOG_ERR("qos_message_remove, error: %d", err);
+		}
+	}
+}
+
+static bool pending_report_is_current(uint32_t id)
+{
+	bool current = false;
+	k_spinlock_key_t key = k_spin_lock(&pending_lock);
+
+	for (size_t i = 0; i < ARRAY_SIZE(pending_reports); i++) {
+		if (pending_reports[i].used && pending_reports[i].id == id) {
+			current = true;
+			break;
+		}
+	}
+	k_spin_unlock(&pending_lock, key);
+
+	return current;
+}
+
+/* Submits a send of a QoS message with its own copy of the payload. The
+ * QoS list frees the original once the message is acknowledged or replaced,
+ * which can happen while the send is still queued.
+ */
+static void qos_send_submit(enum cloud_module_event_type type,
+			    const struct qos_data *message)
+{
+	struct cloud_module_event *event;
+	uint8_t *buf = k_malloc(message->data.len + 1);
+
+	if (buf == NULL) {
+		LOG_ERR("Cannot copy message %d, sent on the next retry", message->id);
+		return;
+	}
+
+	memcpy(buf, message->data.buf, message->data.len);
+	buf[message->data.len] = '\0';
+
+	event = new_cloud_module_event();
+	event->type = type;
+	event->data.qos_msg = *message;
+	event->data.qos_msg.data.buf = buf;
+	event->data.qos_msg.heap_allocated = true;
+
+	APP_EVENT_SUBMIT(event);
+}
+
+/* Frees the payload copy of a send once it is handled or dropped. */
+static void qos_send_release(struct cloud_msg_data *msg)
+{
+	if (is_cloud_module_event((struct app_event_header *)(&msg->event.cloud)) &&
+	    (msg->event.cloud.type == CLOUD_EVT_SEND_QOS ||
+	     msg->event.cloud.type == CLOUD_EVT_SEND_QOS_CLEAR)) {
+		k_free(msg->event.cloud.data.qos_msg.data.buf);
+	}
+}
+
+/* Returns true if a new report must wait for the radio to wake up. */
+static bool uplink_hold(void)
+{
+	if (CONFIG_CLOUD_UPLINK_HOLD_MS == 0 || atomic_get(&rrc_connected)) {
+		return false;
+	}
+
+	if (!atomic_set(&uplink_held, 1)) {
+		k_work_schedule(&uplink_flush_work, K_MSEC(CONFIG_CLOUD_UPLINK_HOLD_MS));
+	}
+
+	return true;
+}
+
+/* Sends the held reports. Messages awaiting acknowledgment are sent again
+ * as well, which is harmless as reports only carry the latest state.
+ */
+static void uplink_flush_work_fn(struct k_work *work)
+{
+	if (atomic_set(&uplink_held, 0)) {
+		LOG_DBG("Sending held reports");
+		qos_message_notify_all();
+	}
+}
+
+static void on_rrc_update(bool connected)
+{
+	atomic_set(&rrc_connected, connected);
+
+	if (!connected) {
+		return;
+	}
+
+	if (atomic_get(&uplink_held)) {
+		k_work_reschedule(&uplink_flush_work, K_NO_WAIT);
+	}
+
+	/* Piggyback the keepalive on the radio being up if it is due soon. */
+	if (sub_state == SUB_STATE_CLOUD_CONNECTED &&
+	    aws_iot_keepalive_time_left() < (CONFIG_MQTT_KEEPALIVE * MSEC_PER_SEC) / 2) {
+		aws_iot_ping();
+	}
+}
+
 static inline int is_topic(const struct aws_iot_evt *evt, char* topic) 
 {
 	return (0 == strcmp(evt->data.msg.topic.str, topic));
@@ -172,6 +413,7 @@ static bool app_event_handler(const struct app_event_header *aeh)
 		if (err)
 		{
 			LOG_ERR("Message could not be enqueued");
+			qos_send_release(&msg);
 		}
 	}
 
@@ -209,6 +451,39 @@ switch (evt->type) {
 			event->data.pub_msg.len = evt->data.msg.len;
 			APP_EVENT_SUBMIT(event);
 		}
+
+		if (is_topic(evt, TOPIC_GET_ACCEPTED)) {
+			LOG_DBG("received shadow of length %d", evt->data.msg.len);
+
+			struct cloud_module_event *event = new_cloud_module_event();
+			event->type = CLOUD_EVT_SHADOW;
+			event->data.pub_msg.ptr = evt->data.msg.ptr;
+			event->data.pub_msg.len = evt->data.msg.len;
+			APP_EVENT_SUBMIT(event);
+		}
+
+		/* Rejected if the shadow does not exist yet. */
+		if (is_topic(evt, TOPIC_GET_REJECTED)) {
+			LOG_DBG("shadow get rejected");
+
+			struct cloud_module_event *event = new_cloud_module_event();
+			event->type = CLOUD_EVT_SHADOW;
+			event->data.pub_msg.ptr = NULL;
+			event->data.pub_msg.len = 0;
+			APP_EVENT_SUBMIT(event);
+		}
+
+#if defined(CONFIG_CLOUD_CODEC_CBOR)
+		if (is_topic(evt, TOPIC_ROBOTS_COMMAND)) {
+			LOG_DBG("received robot command of length %d", evt->data.msg.len);
+
+			struct cloud_module_event *event = new_cloud_module_event();
+			event->type = CLOUD_EVT_COMMAND;
+			event->data.pub_msg.ptr = evt->data.msg.ptr;
+			event->data.pub_msg.len = evt->data.msg.len;
+			APP_EVENT_SUBMIT(event);
+		}
+#endif
 		
 	    } break;
 	case AWS_IOT_EVT_PUBACK: {
@@ -236,39 +511,35 @@ static void qos_event_handler(const struct qos_evt *evt)
 	switch (evt->type) {
 	case QOS_EVT_MESSAGE_NEW: {
 		// LOG_DBG("QOS_EVT_MESSAGE_NEW");
-		if (evt->message.type == CLOUD_SHADOW_UPDATE) {
-			struct cloud_module_event *event = new_cloud_module_event();
-
-			event->type = CLOUD_EVT_SEND_QOS;
-			event->data.qos_msg = evt->message;
+		if (is_report_type(evt->message.type) && uplink_hold()) {
+			LOG_DBG("Holding report %d until the radio is connected",
+				evt->message.id);
+			break;
+		}
 
-			APP_EVENT_SUBMIT(event);
+		if (evt->message.type == CLOUD_SHADOW_UPDATE ||
+		    is_report_type(evt->message.type)) {
+			qos_send_submit(CLOUD_EVT_SEND_QOS, &evt->message);
 		}
 
 		if (evt->message.type == CLOUD_SHADOW_CLEAR) {
-			struct cloud_module_event *event = new_cloud_module_event();
-
-			event->type = CLOUD_EVT_SEND_QOS_CLEAR;
-			event->data.qos_msg = evt->message;
-
-			APP_EVENT_SUBMIT(event);
+			qos_send_submit(CLOUD_EVT_SEND_QOS_CLEAR, &evt->message);
 		}	
 	}
 		break;
 	case QOS_EVT_MESSAGE_TIMER_EXPIRED: {
 		LOG_DBG("QOS_EVT_MESSAGE_TIMER_EXPIRED");
 
-		struct cloud_module_event *event = new_cloud_module_event();
-
-		event->type = CLOUD_EVT_SEND_QOS;
-		event->data.qos_msg = evt->message;
-
-		APP_EVENT_SUBMIT(event);
+		qos_send_submit(CLOUD_EVT_SEND_QOS, &evt->message);
 	}
 		break;
 	case QOS_EVT_MESSAGE_REMOVED_FROM_LIST:
 		// LOG_DBG("QOS_EVT_MESSAGE_REMOVED_FROM_LIST");
 
+		if (is_report_type(evt->message.type)) {
+			pending_report_release(evt->message.id);
+		}
+
 		if (evt->message.heap_allocated) {
 			LOG_DBG("Freeing pointer: %p", evt->message.data.buf);
 			k_free(evt->message.data.buf);
@@ -290,6 +561,13 @@ static int setup(void)
 		LOG_ERR("Failed initializing aws, error: %d", err);
 	}
 
+#if defined(CONFIG_CLOUD_CODEC_CBOR)
+	err = aws_iot_subscription_topics_add(app_topics, ARRAY_SIZE(app_topics));
+	if (err) {
+		LOG_ERR("aws_iot_subscription_topics_add, error: %d", err);
+	}
+#endif
+
 	err = qos_init(qos_event_handler);
 	if (err) {
 		LOG_ERR("qos_init, error: %d", err);
@@ -301,16 +579,67 @@ static int setup(void)
 	return err;
 }
 
+/* Decorrelated jitter: random delay between the base and three times the
+ * previous delay, within the configured bounds.
+ */
+static uint32_t backoff_next(void)
+{
+	uint32_t upper = MIN((uint64_t)backoff_sec * 3, CONFIG_CLOUD_BACKOFF_MAX_SEC);
+	uint32_t lower = CONFIG_CLOUD_BACKOFF_BASE_SEC;
+
+	backoff_sec = lower + sys_rand32_get() % (upper - lower + 1);
+
+	return backoff_sec;
+}
+
+static void backoff_reset(void)
+{
+	connect_retries = 0;
+	backoff_sec = CONFIG_CLOUD_BACKOFF_BASE_SEC;
+}
+
+static void reconnect_stats_disconnected(void)
+{
+	if (reconnect_stats.disconnected_at == 0) {
+		reconnect_stats.disconnected_at = k_uptime_get();
+	}
+}
+
+static void reconnect_stats_connected(void)
+{
+	uint32_t elapsed;
+
+	if (reconnect_stats.disconnected_at == 0) {
+		return;
+	}
+
+	elapsed = k_uptime_get() - reconnect_stats.disconnected_at;
+	reconnect_stats.disconnected_at = 0;
+	reconnect_stats.count++;
+	reconnect_stats.last_ms = elapsed;
+	reconnect_stats.max_ms = MAX(reconnect_stats.max_ms, elapsed);
+	reconnect_stats.total_ms += elapsed;
+
+	LOG_INF("Reconnected in %u ms, %u reconnects, average %u ms, max %u ms",
+		elapsed, reconnect_stats.count,
+		(uint32_t)(reconnect_stats.total_ms / reconnect_stats.count),
+		reconnect_stats.max_ms);
+}
+
 static void connect_cloud(void)
 {
 	int err;
-	int backoff_sec = backoff_delay[connect_retries].delay;
+	uint32_t delay_sec = backoff_next();
 
 	LOG_DBG("Connecting to cloud");
 
-	if (connect_retries > CONFIG_CLOUD_CONNECT_RETRIES) {
+	if (connect_retries == CONFIG_CLOUD_CONNECT_RETRIES) {
 		LOG_WRN("Too many failed cloud connection attempts");
-		return;
+
+		struct cloud_module_event *event = new_cloud_module_event();
+		event->type = CLOUD_EVT_ERROR;
+		event->data.err = -ETIMEDOUT;
+		APP_EVENT_SUBMIT(event);
 	}
 	/* The cloud will return error if cloud_wrap_connect() is called while
 	 * the socket is polled on in the internal cloud thread or the
@@ -321,16 +650,18 @@ static void connect_cloud(void)
 	err = aws_iot_connect(&aws_config);
 	if (err) {
 		LOG_ERR("cloud_connect failed, error: %d", err);
+	} else {
+		/* Start polling the new socket. */
+		k_sem_give(&cloud_connected_sem);
 	}
 
 	connect_retries++;
 
 	LOG_INF("Cloud connection establishment in progress");
 	LOG_INF("New connection attempt in %d seconds if not successful",
-		backoff_sec);
-	k_sem_give(&cloud_connected_sem);
+		delay_sec);
 	/* Start timer to check connection status after backoff */
-	k_work_reschedule(&connect_check_work, K_SECONDS(backoff_sec));
+	k_work_reschedule(&connect_check_work, K_SECONDS(delay_sec));
 }
 
 static void disconnect_cloud(void)
@@ -340,10 +671,9 @@ static void disconnect_cloud(void)
 	err = aws_iot_disconnect();
 	if (err) {
 		LOG_ERR("aws_iot_disconnect, error: %d", err);
-		return;
 	}
 
-	connect_retries = 0;
+	backoff_reset();
 	qos_timer_reset();
 
 	k_work_cancel_delayable(&connect_check_work);
@@ -369,6 +699,54 @@ static void add_qos_message(uint8_t *ptr, size_t len, uint8_t type,
 	} else if (err) {
 		LOG_ERR("qos_message_add, error: %d", err);
 	}
+
+	if (err && heap_allocated) {
+		k_free(ptr);
+	}
+}
+
+/* Adds a robot report, replacing the pending report of the same robot and
+ * field class so that stale values are not retried after newer ones.
+ */
+static void add_qos_report(const struct robot_module_event *evt)
+{
+	const struct robot_report *report = &evt->data.report;
+	uint8_t type = report->binary ? CLOUD_ROBOTS_REPORT : CLOUD_SHADOW_REPORT;
+	int old_id;
+	int err;
+
+	if (report->field == ROBOT_REPORT_FIELD_NONE) {
+		pending_report_remove_covered(report->covered, report->covered_count);
+		k_free(report->covered);
+		add_qos_message(report->ptr, report->len, CLOUD_SHADOW_UPDATE,
+				QOS_FLAG_RELIABILITY_ACK_REQUIRED, true);
+		return;
+	}
+
+	struct qos_data message = {
+		.heap_allocated = true,
+		.data.buf = report->ptr,
+		.data.len = report->len,
+		.id = qos_message_id_get_next(),
+		.type = type,
+		.flags = QOS_FLAG_RELIABILITY_ACK_REQUIRED
+	};
+
+	old_id = pending_report_replace(evt->addr, report->field, type, message.id);
+	if (old_id >= 0) {
+		LOG_DBG("Report %d replaces pending report %d", message.id, old_id);
+		err = qos_message_remove(old_id);
+		if (err && err != -ENODATA) {
+			LOG_ERR("qos_message_remove, error: %d", err);
+		}
+	}
+
+	err = qos_message_add(&message);
+	if (err) {
+		LOG_ERR("qos_message_add, error: %d", err);
+		pending_report_release(message.id);
+		k_free(report->ptr);
+	}
 }
 
 /* If this work is executed, it means that the connection attempt was not
@@ -389,9 +767,21 @@ static void connect_check_work_fn(struct k_work *work)
 	APP_EVENT_SUBMIT(event);
 }
 
+/* Reports cannot be sent while the cloud is disconnected. */
+static void drop_report(struct cloud_msg_data *msg)
+{
+	if (is_robot_module_event((struct app_event_header *)(&msg->event.robot)) &&
+	    msg->event.robot.type == ROBOT_EVT_REPORT) {
+		k_free(msg->event.robot.data.report.ptr);
+		k_free(msg->event.robot.data.report.covered);
+	}
+}
+
 /* Message handler for STATE_LTE_DISCONNECTED. */
 static void on_state_lte_disconnected(struct cloud_msg_data *msg)
 {
+	drop_report(msg);
+
 	if (is_modem_module_event((struct app_event_header *)(&msg->event.modem)))
     {
         if (msg->event.modem.type == MODEM_EVT_LTE_CONNECTED)
@@ -411,6 +801,9 @@ static void on_state_lte_connected(struct cloud_msg_data *msg)
     {
         if (msg->event.modem.type == MODEM_EVT_LTE_DISCONNECTED)
         {
+			if (sub_state == SUB_STATE_CLOUD_CONNECTED) {
+				reconnect_stats_disconnected();
+			}
 			sub_state_set(SUB_STATE_CLOUD_DISCONNECTED);
 			state_set(STATE_LTE_DISCONNECTED);
 
@@ -419,12 +812,19 @@ static void on_state_lte_connected(struct cloud_msg_data *msg)
 			*/
 			disconnect_cloud();
 		}
+
+		if (msg->event.modem.type == MODEM_EVT_RRC_CONNECTED ||
+		    msg->event.modem.type == MODEM_EVT_RRC_IDLE) {
+			on_rrc_update(msg->event.modem.type == MODEM_EVT_RRC_CONNECTED);
+		}
 	}
 }
 
 /* Message handler for STATE_LTE_CONNECTED. */
 static void on_sub_state_cloud_disconnected(struct cloud_msg_data *msg)
 {
+	drop_report(msg);
+
 	if (is_cloud_module_event((struct app_event_header *)(&msg->event.cloud)))
     {
         if (msg->event.cloud.type == CLOUD_EVT_CONNECTED)
@@ -432,8 +832,9 @@ static void on_sub_state_cloud_disconnected(struct cloud_msg_data *msg)
 			sub_state_set(SUB_STATE_CLOUD_CONNECTED);
 			LOG_INF("Cloud connected");
 
-			connect_retries = 0;
+			backoff_reset();
 			k_work_cancel_delayable(&connect_check_work);
+			reconnect_stats_connected();
 		}
 	}
 
@@ -451,16 +852,43 @@ static void on_sub_state_cloud_connected(struct cloud_msg_data *msg)
 {
 	int err = 0;
 
+	if (is_cloud_module_event((struct app_event_header *)(&msg->event.cloud)))
+    {
+        if (msg->event.cloud.type == CLOUD_EVT_DISCONNECTED)
+        {
+			sub_state_set(SUB_STATE_CLOUD_DISCONNECTED);
+			LOG_WRN("Cloud connection lost");
+
+			reconnect_stats_disconnected();
+			/* Resume right away, later attempts back off. */
+			connect_cloud();
+			return;
+		}
+	}
+
 	if (is_robot_module_event((struct app_event_header *)(&msg->event.robot)))
     {
         if (msg->event.robot.type == ROBOT_EVT_REPORT)
         {
-		// char *str = cloud_encode_add_robot(msg->event.robot.data.str);
-		add_qos_message(msg->event.robot.data.str, 
-				strlen(msg->event.robot.data.str),
-				CLOUD_SHADOW_UPDATE,
-				QOS_FLAG_RELIABILITY_ACK_REQUIRED,
-				false);
+		add_qos_report(&msg->event.robot);
+		}
+	}
+
+	if (is_robot_module_event((struct app_event_header *)(&msg->event.robot)))
+    {
+        if (msg->event.robot.type == ROBOT_EVT_SHADOW_GET)
+        {
+			struct aws_iot_data message = {
+				.ptr = "",
+				.len = 0,
+				.qos = MQTT_QOS_0_AT_MOST_ONCE,
+				.topic.type = AWS_IOT_SHADOW_TOPIC_GET,
+			};
+
+			err = aws_iot_send(&message);
+			if (err) {
+				LOG_ERR("Failed to request the shadow, error: %d", err);
+			}
 		}
 	}
 
@@ -470,6 +898,14 @@ static void on_sub_state_cloud_connected(struct cloud_msg_data *msg)
         {
 			struct qos_payload *qos_payload = &msg->event.cloud.data.qos_msg.data;
 
+			/* A replaced report is not retried. */
+			if (is_report_type(msg->event.cloud.data.qos_msg.type) &&
+			    !pending_report_is_current(msg->event.cloud.data.qos_msg.id)) {
+				LOG_DBG("Skipping replaced report %d",
+					msg->event.cloud.data.qos_msg.id);
+				return;
+			}
+
 			struct aws_iot_data message = {
 				.ptr = qos_payload->buf,
 				.len = qos_payload->len,
@@ -477,7 +913,20 @@ static void on_sub_state_cloud_connected(struct cloud_msg_data *msg)
 				.qos = MQTT_QOS_1_AT_LEAST_ONCE,
 				.topic.type = AWS_IOT_SHADOW_TOPIC_UPDATE,
 			};
+
+#if defined(CONFIG_CLOUD_CODEC_CBOR)
+			/* Binary reports go to their own topic, not the shadow. */
+			if (msg->event.cloud.data.qos_msg.type == CLOUD_ROBOTS_REPORT) {
+				message.topic.type = 0;
+				message.topic.str = TOPIC_ROBOTS_REPORT;
+				message.topic.len = sizeof(TOPIC_ROBOTS_REPORT) - 1;
+				LOG_DBG("Sending binary report of length %d", qos_payload->len);
+			} else {
+				LOG_DBG("Sending payload: %s", qos_payload->buf);
+			}
+#else
 			LOG_DBG("Sending payload: %s", qos_payload->buf);
+#endif
 			err = aws_iot_send(&message);
 			if (err) {
 				LOG_ERR("aws_iot_send, error: %d", err);
@@ -548,26 +997,28 @@ static void module_thread_fn(void)
 		default:
 			break;
 		}
+
+		qos_send_release(&msg);
 	}
 }
 
-static void aws_poll_thread_fn(void)
+/* Polls the socket of one connection. Returns when the socket fails. */
+static void aws_poll(int socket)
 {
 	int err;
-	LOG_INF("polling thread started");
-	k_sem_take(&cloud_connected_sem, K_FOREVER);
 	struct pollfd fds[] = {
 		{
-			.fd = aws_config.socket,
+			.fd = socket,
 			.events = POLLIN
 		}
 	};
 
 	while (true) {
-		err = poll(fds, ARRAY_SIZE(fds),4000);
+		/* Only wake up when the broker keepalive is due. */
+		err = poll(fds, ARRAY_SIZE(fds), aws_iot_keepalive_time_left());
 		if (err < 0) {
-			LOG_ERR("poll() returned an error: %d", err);
-			continue;
+			LOG_ERR("poll() returned an error: %d", errno);
+			return;
 		}
 
 		if (err == 0) {
@@ -580,25 +1031,39 @@ static void aws_poll_thread_fn(void)
 		}
 
 		if ((fds[0].revents & POLLNVAL) == POLLNVAL) {
-			LOG_ERR("Socket error: POLLNVAL");
-			LOG_ERR("The AWS IoT socket was unexpectedly closed.");
+			/* Closed by the library, which has reported the disconnect. */
+			LOG_DBG("Socket closed");
 			return;
 		}
 
 		if ((fds[0].revents & POLLHUP) == POLLHUP) {
 			LOG_ERR("Socket error: POLLHUP");
 			LOG_ERR("Connection was closed by the AWS IoT broker.");
+			/* Let the library read the error and report the disconnect. */
+			aws_iot_input();
 			return;
 		}
 
 		if ((fds[0].revents & POLLERR) == POLLERR) {
 			LOG_ERR("Socket error: POLLERR");
 			LOG_ERR("AWS IoT broker connection was unexpectedly closed.");
+			aws_iot_input();
 			return;
 		}
 	}
 }
 
+static void aws_poll_thread_fn(void)
+{
+	LOG_INF("polling thread started");
+
+	while (true) {
+		/* Given after every successful connect. */
+		k_sem_take(&cloud_connected_sem, K_FOREVER);
+		aws_poll(aws_config.socket);
+	}
+}
+
 K_THREAD_DEFINE(cloud_module_thread, CONFIG_CLOUD_THREAD_STACK_SIZE,
 		module_thread_fn, NULL, NULL, NULL,
 		K_LOWEST_APPLICATION_THREAD_PRIO, 0, 0);
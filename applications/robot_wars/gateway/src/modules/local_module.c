@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/shell/shell_uart.h>
+#include <string.h>
+
+#define MODULE local_module
+
+#include "local_module_event.h"
+#include "robot_module_event.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(MODULE, CONFIG_LOCAL_MODULE_LOG_LEVEL);
+
+/* Delta document being received in shell bypass mode. */
+static char delta_buf[CONFIG_LOCAL_CONTROL_DELTA_MAX];
+static size_t delta_len;
+static bool delta_overflow;
+
+static void delta_submit(const struct shell *sh)
+{
+	struct local_module_event *event;
+	char *delta;
+
+	if (delta_overflow) {
+		shell_error(sh, "error: delta longer than %d bytes",
+			    CONFIG_LOCAL_CONTROL_DELTA_MAX);
+		return;
+	}
+
+	if (delta_len == 0) {
+		return;
+	}
+
+	delta = k_malloc(delta_len);
+	if (delta == NULL) {
+		shell_error(sh, "error: out of memory");
+		return;
+	}
+
+	memcpy(delta, delta_buf, delta_len);
+
+	event = new_local_module_event();
+	event->type = LOCAL_EVT_UPDATE_DELTA;
+	event->data.delta.ptr = delta;
+	event->data.delta.len = delta_len;
+	APP_EVENT_SUBMIT(event);
+
+	shell_print(sh, "ok");
+}
+
+/* Collects one line of raw input, so that the quotes of the JSON document
+ * are not interpreted by the shell.
+ */
+static void delta_bypass_cb(const struct shell *sh, uint8_t *data, size_t len)
+{
+	for (size_t i = 0; i < len; i++) {
+		if (data[i] == '\r' || data[i] == '\n') {
+			shell_set_bypass(sh, NULL);
+			delta_submit(sh);
+			return;
+		}
+
+		if (delta_len == sizeof(delta_buf)) {
+			delta_overflow = true;
+			continue;
+		}
+
+		delta_buf[delta_len++] = data[i];
+	}
+}
+
+static int cmd_delta(const struct shell *sh, size_t argc, char **argv)
+{
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	delta_len = 0;
+	delta_overflow = false;
+	shell_set_bypass(sh, delta_bypass_cb);
+
+	return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(game_cmds,
+	SHELL_CMD(delta, NULL,
+		  "Apply a versioned delta document, given on the next line, "
+		  "in the format of the device shadow",
+		  cmd_delta),
+	SHELL_SUBCMD_SET_END
+);
+
+SHELL_CMD_REGISTER(game, &game_cmds, "Local game control", NULL);
+
+/* Handlers */
+static bool app_event_handler(const struct app_event_header *aeh)
+{
+	if (is_robot_module_event(aeh)) {
+		struct robot_module_event *evt = cast_robot_module_event(aeh);
+		const struct shell *sh = shell_backend_uart_get_ptr();
+
+		if (evt->type == ROBOT_EVT_ROUND_METRICS) {
+			const struct robot_round_metrics *metrics = &evt->data.metrics;
+
+			shell_print(sh, "metrics {\"round\":%d,\"robots\":%d,\"degraded\":%d,"
+				    "\"configure_ms\":%d,\"ack_ms\":%d,"
+				    "\"telemetry_ms\":%d}", evt->round, metrics->robots,
+				    metrics->degraded, (int)metrics->configure_ms,
+				    (int)metrics->ack_ms, (int)metrics->telemetry_ms);
+			return false;
+		}
+
+		if (evt->type != ROBOT_EVT_REPORT) {
+			return false;
+		}
+
+		/* Printed before the cloud module queues the report, which
+		 * hands it over to be freed once sent.
+		 */
+		if (evt->data.report.binary) {
+			shell_print(sh, "report-cbor %d", (int)evt->data.report.len);
+			shell_hexdump(sh, evt->data.report.ptr, evt->data.report.len);
+		} else {
+			shell_print(sh, "report %.*s", (int)evt->data.report.len,
+				    (char *)evt->data.report.ptr);
+		}
+	}
+
+	return false;
+}
+
+APP_EVENT_LISTENER(MODULE, app_event_handler);
+APP_EVENT_SUBSCRIBE_EARLY(MODULE, robot_module_event);
@@ -75,7 +75,7 @@ int uart_send(const struct device *dev, uint8_t *data, uint32_t len, uint32_t ty
 	pos = pos + sizeof(uint32_t);
 	memcpy(pos, &addr, sizeof(uint32_t));
 
-	if (data != NULL) {
+	if (data != NULL && len != 0) {
 		pos = pos + sizeof(uint32_t);
 		memcpy(pos, data, len);
 	}
@@ -103,17 +103,22 @@ static int uart_data_rx_rdy_handler(const struct device *dev, struct uart_event_
 		if (!msg){
 			LOG_ERR("Unable to allocate msg");
 		}
-		data = k_malloc(expected_data_len);
-		if (!data){
-			LOG_ERR("Unable to allocate msg data buffer");
-		}
 		msg_buf = (uint8_t*)msg;
-		msg->data = data;
+
+		if (expected_data_len != 0) {
+			data = k_malloc(expected_data_len);
+			if (!data){
+				LOG_ERR("Unable to allocate msg data buffer");
+			}
+			msg->data = data;
+		} else {
+			msg->data = NULL;
+		}
 	} 
 	if (current_msg_len < header_size) {
 		/* Second byte received, read type of message */
 		memcpy((void*)(msg_buf + (current_msg_len)), (event_data.buf), 1);
-	} else {
+	} else if (expected_data_len != 0) {
 		/* Data byte received, store in message*/
 		memcpy((void*)(data + (current_msg_len-header_size)), (event_data.buf), 1);
 	}
@@ -251,15 +256,41 @@ static bool app_event_handler(const struct app_event_header *aeh)
 	return false;
 }
 
+/* Payloads are serialised in the mesh access layer format, and sent
+ * unchanged by the bridge.
+ */
+static void send_movement_set(uint16_t addr, const struct bt_mesh_movement_set *movement,
+			      uint8_t round, uint8_t stop)
+{
+	uint8_t payload[BT_MESH_MOVEMENT_SET_LEN + BT_MESH_MOVEMENT_ROUND_LEN +
+			BT_MESH_MOVEMENT_STOP_LEN];
+
+	bt_mesh_movement_set_encode(movement, payload);
+	payload[BT_MESH_MOVEMENT_SET_LEN] = round;
+	payload[BT_MESH_MOVEMENT_SET_LEN + BT_MESH_MOVEMENT_ROUND_LEN] = stop;
+
+	uart_send(uart, payload, sizeof(payload),
+		BT_MESH_MOVEMENT_OP_MOVEMENT_SET, MOVEMENT_CLI_MODEL_ID, addr);
+}
+
+static void send_light_rgb_set(uint16_t addr, const struct bt_mesh_light_rgb_set *led)
+{
+	uint8_t payload[BT_MESH_LIGHT_RGB_SET_LEN];
+
+	bt_mesh_light_rgb_set_encode(led, payload);
+
+	uart_send(uart, payload, sizeof(payload),
+		BT_MESH_LIGHT_RGB_OP_RGB_SET, LIGHT_RGB_CLI_MODEL_ID, addr);
+}
+
 static void on_all_states(struct mesh_msg_data *msg)
 {
 	if (is_robot_module_event((struct app_event_header *)(&msg->event.robot)))
     {
 		if (msg->event.robot.type == ROBOT_EVT_MOVEMENT_CONFIGURE)
         {	
-			uart_send(uart, (uint8_t*)msg->event.robot.data.movement, 9,
-					BT_MESH_MOVEMENT_OP_MOVEMENT_SET, MOVEMENT_CLI_MODEL_ID,
-					msg->event.robot.addr);
+			send_movement_set(msg->event.robot.addr, msg->event.robot.data.movement,
+					  msg->event.robot.round, msg->event.robot.stop);
 		}
 	}
 
@@ -267,8 +298,9 @@ static void on_all_states(struct mesh_msg_data *msg)
     {
 		if (msg->event.robot.type == ROBOT_EVT_CLEAR_TO_MOVE)
         {	
-			uart_send(uart, NULL, 0, BT_MESH_MOVEMENT_OP_READY_SET, 
-				MOVEMENT_CLI_MODEL_ID, 0xFFFF);
+			uart_send(uart, &msg->event.robot.round, BT_MESH_MOVEMENT_ROUND_LEN,
+				BT_MESH_MOVEMENT_OP_READY_SET, MOVEMENT_CLI_MODEL_ID,
+				msg->event.robot.addr);
 		}
 	}
 	
@@ -277,9 +309,25 @@ static void on_all_states(struct mesh_msg_data *msg)
 		if (msg->event.robot.type == ROBOT_EVT_LED_CONFIGURE)
         {	
 			LOG_INF("LED event!");
-			uart_send(uart, (uint8_t*)msg->event.robot.data.led, 5,
-					BT_MESH_LIGHT_RGB_OP_RGB_SET, LIGHT_RGB_CLI_MODEL_ID,
-					msg->event.robot.addr);
+			send_light_rgb_set(msg->event.robot.addr, msg->event.robot.data.led);
+		}
+	}
+
+	if (is_robot_module_event((struct app_event_header *)(&msg->event.robot)))
+    {
+		if (msg->event.robot.type == ROBOT_EVT_TEAM_SET)
+        {	
+			uart_send(uart, &msg->event.robot.data.team, sizeof(msg->event.robot.data.team),
+				BRIDGE_CTRL_OP_TEAM_SET, BRIDGE_CTRL_ID, msg->event.robot.addr);
+		}
+	}
+
+	if (is_robot_module_event((struct app_event_header *)(&msg->event.robot)))
+    {
+		if (msg->event.robot.type == ROBOT_EVT_CALIBRATE)
+        {	
+			uart_send(uart, NULL, 0, BT_MESH_MOVEMENT_OP_CALIBRATE,
+				MOVEMENT_CLI_MODEL_ID, msg->event.robot.addr);
 		}
 	}
 }
@@ -312,43 +360,97 @@ static void uart_rx_thread_fn(void *arg1, void *arg2, void *arg3)
 	struct mesh_module_event *event;
 	while (true)
 	{
+		bool accepted = true;
+
 		msg = k_fifo_get(&rx_fifo, K_FOREVER);
 		event = new_mesh_module_event();
 		switch (msg->header.id)
 		{
 		case ID_CLI_MODEL_ID:
-			if(msg->header.type == BT_MESH_ID_OP_STATUS)
+			if(msg->header.type == BT_MESH_ID_OP_STATUS &&
+			   msg->header.len == BT_MESH_ID_STATUS_LEN)
 			{
 				event->type = MESH_EVT_ROBOT_ID;
-				struct bt_mesh_id_status id;
-				memcpy((void*)&id.id, msg->data, 6);
+				struct bt_mesh_id_status id = {0};
+				memcpy((void*)&id.id, msg->data, BT_MESH_ID_STATUS_LEN);
 				event->data.robot_id = id;
 				event->addr = msg->header.addr;
 			} 
+			else
+			{
+				accepted = false;
+			}
 			break;
 		case MOVEMENT_CLI_MODEL_ID:
 			if(msg->header.type == BT_MESH_MOVEMENT_OP_MOVEMENT_ACK)
 			{
 				event->type = MESH_EVT_MOVEMENT_CONFIGURED;
 				event->addr = msg->header.addr;
+				event->data.round = 0;
+				if (msg->header.len >= BT_MESH_MOVEMENT_ROUND_LEN) {
+					event->data.round = msg->data[0];
+				}
 			} 
+			else if(msg->header.type == BT_MESH_MOVEMENT_OP_CALIBRATION_STATUS &&
+				msg->header.len == BT_MESH_CALIBRATION_STATUS_LEN)
+			{
+				event->type = MESH_EVT_CALIBRATED;
+				event->addr = msg->header.addr;
+				bt_mesh_calibration_status_decode(&event->data.calibration, msg->data);
+			}
+			else
+			{
+				accepted = false;
+			}
 			break;
 		case TELEMETRY_CLI_MODEL_ID:
-			if(msg->header.type == BT_MESH_TELEMETRY_OP_TELEMETRY_REPORT)
+			if(msg->header.type == BT_MESH_TELEMETRY_OP_TELEMETRY_REPORT &&
+			   (msg->header.len == BT_MESH_TELEMETRY_REPORT_LEN ||
+			    msg->header.len == BT_MESH_TELEMETRY_REPORT_LEN + BT_MESH_TELEMETRY_POWER_LEN))
 			{
 				event->type = MESH_EVT_TELEMETRY_REPORTED;
 				event->addr = msg->header.addr;
-				struct bt_mesh_telemetry_report report;
-				memcpy((void*)&report.revolutions, msg->data, 1);
-				event->data.report = report;
+				bt_mesh_telemetry_report_decode(&event->data.telemetry.report, msg->data);
+				event->data.telemetry.has_power =
+					msg->header.len > BT_MESH_TELEMETRY_REPORT_LEN;
+				if (event->data.telemetry.has_power) {
+					bt_mesh_telemetry_power_decode(&event->data.telemetry.power,
+						msg->data + BT_MESH_TELEMETRY_REPORT_LEN);
+				}
+			}
+			else
+			{
+				accepted = false;
+			}
+			break;
+		case BRIDGE_CTRL_ID:
+			if(msg->header.type == BRIDGE_CTRL_OP_GROUPS_STATUS &&
+			   msg->header.len == sizeof(struct mesh_groups_status))
+			{
+				event->type = MESH_EVT_GROUPS;
+				event->addr = msg->header.addr;
+				memcpy(&event->data.groups, msg->data, sizeof(event->data.groups));
+			}
+			else
+			{
+				accepted = false;
 			}
 			break;		
 		default:
+			accepted = false;
 			break;
 		}
 		
-		APP_EVENT_SUBMIT(event);
+		if (accepted) {
+			APP_EVENT_SUBMIT(event);
+		} else {
+			LOG_DBG("Dropping message 0x%x of model 0x%x from 0x%x",
+				(unsigned int)msg->header.type, (unsigned int)msg->header.id,
+				(unsigned int)msg->header.addr);
+			app_event_manager_free(event);
+		}
 
+		k_free(msg->data);
 		k_free(msg);
 	}
 }
@@ -38,6 +38,24 @@ struct modem_msg_data {
 K_MSGQ_DEFINE(msgq_modem, sizeof(struct modem_msg_data),
 	      MODEM_QUEUE_ENTRY_COUNT, MODEM_QUEUE_BYTE_ALIGNMENT);
 
+#if defined(CONFIG_MODEM_MODULE_PSM)
+struct psm_timer_unit {
+	uint8_t bits;
+	uint32_t seconds;
+};
+
+/* GPRS timer 3 units of the periodic TAU, 3GPP TS 24.008 table 10.5.163a. */
+static const struct psm_timer_unit tau_units[] = {
+	{ 0x3, 2 }, { 0x4, 30 }, { 0x5, 60 }, { 0x0, 600 },
+	{ 0x1, 3600 }, { 0x2, 36000 }, { 0x6, 1152000 },
+};
+
+/* GPRS timer 2 units of the active time, 3GPP TS 24.008 table 10.5.163. */
+static const struct psm_timer_unit active_time_units[] = {
+	{ 0x0, 2 }, { 0x1, 60 }, { 0x2, 360 },
+};
+#endif
+
 /* Convenience functions used in internal state handling. */
 static char *state2str(enum state_type state)
 {
@@ -103,6 +121,21 @@ static void lte_evt_handler(const struct lte_lc_evt *const evt)
 {
 	
 	switch (evt->type) {
+	case LTE_LC_EVT_RRC_UPDATE: {
+		struct modem_module_event *event = new_modem_module_event();
+		event->type = (evt->rrc_mode == LTE_LC_RRC_MODE_CONNECTED) ?
+			      MODEM_EVT_RRC_CONNECTED : MODEM_EVT_RRC_IDLE;
+		APP_EVENT_SUBMIT(event);
+		break;
+	}
+	case LTE_LC_EVT_PSM_UPDATE:
+		LOG_INF("PSM granted, TAU: %d s, active time: %d s",
+			evt->psm_cfg.tau, evt->psm_cfg.active_time);
+		break;
+	case LTE_LC_EVT_EDRX_UPDATE:
+		LOG_INF("eDRX granted, cycle: %d ms, PTW: %d ms",
+			(int)(evt->edrx_cfg.edrx * 1000), (int)(evt->edrx_cfg.ptw * 1000));
+		break;
 	case LTE_LC_EVT_NW_REG_STATUS: {
 		if (evt->nw_reg_status == LTE_LC_NW_REG_NOT_REGISTERED) {
 			struct modem_module_event *event = new_modem_module_event();
@@ -144,6 +177,77 @@ static int lte_connect(void)
 	return 0;
 }
 
+#if defined(CONFIG_MODEM_MODULE_PSM)
+/* Encodes seconds as the bit string of a PSM timer, using the smallest unit
+ * that fits and rounding up.
+ */
+static void psm_timer_encode(char *str, const struct psm_timer_unit *units,
+			     size_t count, uint32_t seconds)
+{
+	uint32_t value = 31;
+	uint8_t bits = units[count - 1].bits;
+	uint8_t timer;
+
+	for (size_t i = 0; i < count; i++) {
+		if (DIV_ROUND_UP(seconds, units[i].seconds) <= 31) {
+			value = DIV_ROUND_UP(seconds, units[i].seconds);
+			bits = units[i].bits;
+			break;
+		}
+	}
+
+	timer = (bits << 5) | value;
+	for (int i = 0; i < 8; i++) {
+		str[i] = (timer & BIT(7 - i)) ? '1' : '0';
+	}
+	str[8] = '\0';
+}
+#endif
+
+static int power_saving_setup(void)
+{
+	int err = 0;
+
+#if defined(CONFIG_MODEM_MODULE_PSM)
+	char tau[9];
+	char active_time[9];
+
+	psm_timer_encode(tau, tau_units, ARRAY_SIZE(tau_units),
+			 CONFIG_MODEM_MODULE_PSM_TAU_SEC);
+	psm_timer_encode(active_time, active_time_units,
+			 ARRAY_SIZE(active_time_units),
+			 CONFIG_MODEM_MODULE_PSM_ACTIVE_TIME_SEC);
+
+	err = lte_lc_psm_param_set(tau, active_time);
+	if (err) {
+		LOG_ERR("lte_lc_psm_param_set, error: %d", err);
+		return err;
+	}
+
+	err = lte_lc_psm_req(true);
+	if (err) {
+		LOG_ERR("lte_lc_psm_req, error: %d", err);
+		return err;
+	}
+#endif
+
+#if defined(CONFIG_MODEM_MODULE_EDRX)
+	err = lte_lc_edrx_param_set(LTE_LC_LTE_MODE_LTEM, CONFIG_MODEM_MODULE_EDRX_CYCLE);
+	if (err) {
+		LOG_ERR("lte_lc_edrx_param_set, error: %d", err);
+		return err;
+	}
+
+	err = lte_lc_edrx_req(true);
+	if (err) {
+		LOG_ERR("lte_lc_edrx_req, error: %d", err);
+		return err;
+	}
+#endif
+
+	return err;
+}
+
 /* Static module functions. */
 static int setup(void)
 {
@@ -155,6 +259,12 @@ static int setup(void)
 		return err;
 	}
 
+	/* Not fatal, the gateway works without power saving. */
+	err = power_saving_setup();
+	if (err) {
+		LOG_WRN("Power saving not requested, error: %d", err);
+	}
+
 	err = lte_connect();
 	if (err) {
 		LOG_ERR("Failed connecting to LTE, error: %d", err);
@@ -10,6 +10,10 @@
 #include <stdbool.h>
 #include <sys/slist.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/settings/settings.h>
+#include <cloud/codec_cbor.h>
 
 #define MODULE robot_module
 
@@ -17,6 +21,7 @@
 #include "cloud_module_event.h"
 #include "mesh_module_event.h"
 #include "ui_module_event.h"
+#include "local_module_event.h"
 
 #include <zephyr/logging/log.h>
 #define ROBOT_MODULE_LOG_LEVEL 4
@@ -39,19 +44,113 @@ struct robot {
 	char id[13];
 	uint16_t addr;
 	enum robot_state state;
-	struct codec_movement movement;
+	/* Executing the movement of the current round */
+	bool moving;
+	/* Missed a round deadline, rounds continue without it until it
+	 * acknowledges a movement again
+	 */
+	bool degraded;
+	/* Missed the configure deadline, its movement is staged again */
+	bool resync;
+	/* Uptime the awaited movement configuration was sent, 0 if resent */
+	int64_t configure_time;
+	/* Expected duration of the movement of the running round */
+	int32_t duration_ms;
+	struct bt_mesh_movement_set movement;
+	/* Stop mode sent with the movement configurations */
+	uint8_t stop;
+	/* Last calibration request, counted by the shadow */
+	uint8_t calibrate;
+	/* Turn rate in degrees per second and ground speed of the slower
+	 * wheel in mm/s at full power from the last calibration, 0 if the
+	 * robot is not calibrated, and the time in ms a turn and a drive take
+	 * beyond them
+	 */
+	uint16_t turn_rate;
+	uint16_t speed;
+	int16_t turn_offset;
+	int16_t drive_offset;
 	uint8_t revolutions;
-	struct codec_led led;
+	struct bt_mesh_light_rgb_set led;
+	/* Last LED configuration sent, robots do not acknowledge them */
+	struct bt_mesh_light_rgb_set led_sent;
+	/* Commanded team, and the team group its LED is subscribed to */
+	uint8_t team;
+	uint8_t team_joined;
+	/* LED and movement server are subscribed to the all robots group */
+	bool all_joined;
+	/* CODEC_ROBOT_MOVEMENT and CODEC_ROBOT_LED fields the robot does not
+	 * hold yet. The movement is held once acknowledged for the next round.
+	 */
+	uint8_t unsynced;
+	/* Roster entry differs from the stored one */
+	bool dirty;
+	/* CODEC_ROBOT_* and ROBOT_JOURNAL_* fields changed or reported since
+	 * the last batched report
+	 */
+	uint8_t journal;
+	/* Last calibration status and power summary, sent again from the
+	 * journal
+	 */
+	struct bt_mesh_calibration_status calibration;
+	struct bt_mesh_telemetry_power power;
 };
 
+/* Journaled fields that are not part of the batched report. They are sent
+ * again as single reports when the journal is flushed.
+ */
+#define ROBOT_JOURNAL_CALIBRATION BIT(6)
+#define ROBOT_JOURNAL_POWER       BIT(7)
+
+BUILD_ASSERT(((ROBOT_JOURNAL_CALIBRATION | ROBOT_JOURNAL_POWER) & CODEC_ROBOT_ALL) == 0,
+	     "Journal fields overlap the report fields");
+
+/* Roster entry stored in settings, keyed by mesh address. */
+struct robot_record {
+	char id[13];
+	struct bt_mesh_movement_set movement;
+	struct bt_mesh_light_rgb_set led;
+	uint8_t revolutions;
+	/* Not in records stored before robots were calibrated */
+	uint16_t turn_rate;
+	uint16_t speed;
+	/* Not in records stored before the offsets were reported, whose speed
+	 * is the average of the wheels
+	 */
+	int16_t turn_offset;
+	int16_t drive_offset;
+};
+
+#define ROBOT_RECORD_LEGACY_LEN offsetof(struct robot_record, turn_rate)
+#define ROBOT_RECORD_AVERAGE_SPEED_LEN offsetof(struct robot_record, turn_offset)
+
+#define ROSTER_SETTINGS_KEY "robot"
+
 static sys_slist_t robot_list;
 
+/* Id of a robot that was replaced on its address, or found in the shadow
+ * but not in the roster, not yet reported as removed.
+ */
+struct removed_id {
+	sys_snode_t node;
+	char id[13];
+};
+
+static sys_slist_t removed_list;
+
+/* The full roster has been reported since boot. */
+static bool roster_reported;
+
+/* Reports the full roster if the shadow does not arrive in time. */
+static struct k_work_delayable shadow_timeout_work;
+
 struct robot_msg_data {
 	union {
 		struct ui_module_event ui;
 		struct robot_module_event robot;
 		struct cloud_module_event cloud;
 		struct mesh_module_event mesh;
+		struct local_module_event local;
 	} event;
 };
 
@@ -68,6 +167,47 @@ K_MSGQ_DEFINE(msgq_robot, sizeof(struct robot_msg_data),
 
 int version_prev = 0;
 
+/* Round that movements are staged for. Robots stage the movement of the next
+ * round while the current one is executing, and the clear to move message
+ * only starts it. Round 0 is the untagged round of the movement model.
+ */
+static uint8_t round_next = 1;
+
+/* Round whose movement is executing. */
+static uint8_t round_running;
+
+/* Deadline of a round phase, expired by submitting ROBOT_EVT_ROUND_DEADLINE. */
+struct round_deadline {
+	struct k_work_delayable work;
+	enum robot_round_phase phase;
+	uint8_t round;
+};
+
+static struct round_deadline deadlines[] = {
+	[ROBOT_ROUND_PHASE_CONFIGURE] = { .phase = ROBOT_ROUND_PHASE_CONFIGURE },
+	[ROBOT_ROUND_PHASE_MOVE] = { .phase = ROBOT_ROUND_PHASE_MOVE },
+};
+
+/* Smoothed mesh round trip time and its mean deviation, measured from a
+ * movement configuration to its ack.
+ */
+static bool rtt_measured;
+static int32_t rtt_srtt_ms;
+static int32_t rtt_var_ms;
+
+/* Timing of a round for the round metrics, uptimes are 0 until set. */
+struct round_timing {
+	int64_t configure_time;
+	int64_t ack_time;
+	int64_t start_time;
+	int64_t telemetry_time;
+	uint16_t robots;
+	uint16_t degraded;
+};
+
+static struct round_timing timing_next;
+static struct round_timing timing_running;
+
 /* Convenience functions used in internal state handling. */
 static char *state2str(enum state_type state)
 {
@@ -127,6 +267,13 @@ static bool app_event_handler(const struct app_event_header *aeh)
 		enqueue_msg = true;
 	}
 
+	if (IS_ENABLED(CONFIG_LOCAL_CONTROL) && is_local_module_event(aeh)) {
+		struct local_module_event *evt = cast_local_module_event(aeh);
+
+		msg.event.local = *evt;
+		enqueue_msg = true;
+	}
+
 	if (enqueue_msg)
 	{
 		int err = k_msgq_put(&msgq_robot, &msg, K_NO_WAIT);
@@ -141,34 +288,86 @@ static bool app_event_handler(const struct app_event_header *aeh)
 }
 
 /* Internal robot functions */
-static void set_led_event(struct robot *robot)
+static bool movement_equal(const struct bt_mesh_movement_set *a,
+			   const struct bt_mesh_movement_set *b)
 {
-	struct robot_module_event *event = new_robot_module_event();
+	return a->time == b->time && a->angle == b->angle && a->speed == b->speed;
+}
+
+static bool led_equal(const struct bt_mesh_light_rgb_set *a,
+		      const struct bt_mesh_light_rgb_set *b)
+{
+	return a->blink_time == b->blink_time && a->red == b->red &&
+	       a->green == b->green && a->blue == b->blue;
+}
+
+/* Sends the LED configuration unless the robot already shows it. Status
+ * animations are run by the robots, so only commanded colours are sent.
+ */
+static void sync_led(struct robot *robot)
+{
+	struct robot_module_event *event;
+
+	if (!(robot->unsynced & CODEC_ROBOT_LED) &&
+	    led_equal(&robot->led_sent, &robot->led)) {
+		return;
+	}
+
+	robot->led_sent = robot->led;
+	robot->unsynced &= ~CODEC_ROBOT_LED;
+
+	event = new_robot_module_event();
 	event->type = ROBOT_EVT_LED_CONFIGURE;
 	event->addr = robot->addr;
-	event->data.led = &robot->led;
+	event->data.led = &robot->led_sent;
 	APP_EVENT_SUBMIT(event);
 }
 
+static void robot_id_format(char *str, uint64_t id)
+{
+	sprintf(str, "%x", (uint32_t) ((id >> 16) & 0xffffffff));
+	sprintf(&str[4], "%x", (uint32_t) (id & 0xffffffff));
+}
+
 static struct robot * add_robot(uint64_t id, uint16_t addr) 
 {
 	struct robot *robot;
 
-	robot = k_malloc(sizeof(struct robot));
-	sprintf(robot->id, "%x", (uint32_t) ((id >> 16) & 0xffffffff));
-	sprintf(&robot->id[4], "%x", (uint32_t) (id & 0xffffffff));
+	robot = k_calloc(1, sizeof(struct robot));
+	if (robot == NULL) {
+		LOG_ERR("Failed to allocate robot");
+		return NULL;
+	}
+
+	robot_id_format(robot->id, id);
 	
 	robot->addr = addr;
-	robot->movement.drive_time = 0;
-	robot->movement.rotation = 0;
+	robot->movement.time = 0;
+	robot->movement.angle = 0;
 	robot->movement.speed = 100;
 	robot->revolutions = 0;
 	robot->state = ROBOT_STATE_READY;
+	robot->unsynced = CODEC_ROBOT_MOVEMENT | CODEC_ROBOT_LED;
+	robot->team = MESH_TEAM_NONE;
+	robot->team_joined = MESH_TEAM_NONE;
+	robot->stop = BT_MESH_MOVEMENT_STOP_DEFAULT;
+	robot->dirty = true;
 
 	sys_slist_append(&robot_list, &robot->node);
 	return robot;
 }
 
+static struct robot *get_robot_by_id(const char *id, size_t len)
+{
+	struct robot *robot;
+	SYS_SLIST_FOR_EACH_CONTAINER(&robot_list, robot, node) {
+		if (strlen(robot->id) == len && memcmp(robot->id, id, len) == 0) {
+			return robot;
+		}
+	}
+	return NULL;
+}
+
 static struct robot* get_robot_by_addr(uint16_t addr)
 {
 	struct robot *robot;
@@ -190,239 +389,1497 @@ static void for_each_robot(robot_fn *func)
 	}
 }
 
-static void report_event(char * report)
+/* Submits a JSON report. Field reports carry the address of the robot, so
+ * that they replace older pending reports of the same field.
+ */
+static bool report_event(struct robot *robot, enum robot_report_field field,
+			 char *report)
 {
+	if (report == NULL) {
+		LOG_ERR("Failed to encode report");
+		return false;
+	}
+
 	struct robot_module_event *event = new_robot_module_event();
 	event->type = ROBOT_EVT_REPORT;
-	event->data.str = report;
+	event->addr = robot ? robot->addr : 0;
+	event->data.report.ptr = report;
+	event->data.report.len = strlen(report);
+	event->data.report.binary = false;
+	event->data.report.field = field;
+	event->data.report.covered = NULL;
+	event->data.report.covered_count = 0;
 	APP_EVENT_SUBMIT(event);
+	return true;
 }
 
-static void report_clear_robot_list(void) 
+/* Submits a JSON batch report, with the addresses of the robots it covers.
+ * Both are freed if encoding failed.
+ */
+static bool report_batch_event(char *report, struct robot_report_covered *covered,
+			       size_t covered_count)
 {
-	report_event(codec_encode_remove_robots_report());
+	if (report == NULL) {
+		LOG_ERR("Failed to encode report");
+		k_free(covered);
+		return false;
+	}
+
+	struct robot_module_event *event = new_robot_module_event();
+	event->type = ROBOT_EVT_REPORT;
+	event->addr = 0;
+	event->data.report.ptr = report;
+	event->data.report.len = strlen(report);
+	event->data.report.binary = false;
+	event->data.report.field = ROBOT_REPORT_FIELD_NONE;
+	event->data.report.covered = covered;
+	event->data.report.covered_count = covered_count;
+	APP_EVENT_SUBMIT(event);
+	return true;
 }
 
-static void report_robot_movement(struct robot *robot) 
+/* Submits a binary report of length len, or frees buf if encoding failed. */
+static bool report_binary_event(struct robot *robot, enum robot_report_field field,
+				uint8_t *buf, int len)
 {
-	report_event(codec_encode_movement_report(robot->id, robot->movement));
+	if (len < 0) {
+		LOG_ERR("Failed to encode report: Error %d", len);
+		k_free(buf);
+		return false;
+	}
+
+	struct robot_module_event *event = new_robot_module_event();
+	event->type = ROBOT_EVT_REPORT;
+	event->addr = robot->addr;
+	event->data.report.ptr = buf;
+	event->data.report.len = len;
+	event->data.report.binary = true;
+	event->data.report.field = field;
+	event->data.report.covered = NULL;
+	event->data.report.covered_count = 0;
+	APP_EVENT_SUBMIT(event);
+	return true;
 }
 
-static void report_robot_revolution_count(struct robot *robot) 
+static uint8_t *report_binary_alloc(void)
 {
-	LOG_INF("revolution count: %d", robot->revolutions);
-	report_event(codec_encode_revolution_count_report(robot->id, robot->revolutions));
+	uint8_t *buf = k_malloc(CODEC_CBOR_REPORT_SIZE_MAX);
+
+	if (buf == NULL) {
+		LOG_ERR("Failed to allocate report");
+	}
+
+	return buf;
 }
 
-static void report_robot(struct robot *robot) 
-{	
-	report_robot_movement(robot);
-	report_robot_revolution_count(robot);
+/* Field reports, on the binary report topic if enabled. Return true if the
+ * report was submitted.
+ */
+static bool report_send_movement(struct robot *robot)
+{
+	if (IS_ENABLED(CONFIG_CLOUD_CODEC_CBOR)) {
+		uint8_t *buf = report_binary_alloc();
+
+		if (buf == NULL) {
+			return false;
+		}
 
+		return report_binary_event(robot, ROBOT_REPORT_FIELD_MOVEMENT, buf,
+					   codec_cbor_encode_movement_report(
+						   buf, CODEC_CBOR_REPORT_SIZE_MAX,
+						   robot->id, &robot->movement));
+	}
+
+	return report_event(robot, ROBOT_REPORT_FIELD_MOVEMENT,
+			    codec_encode_movement_report(robot->id, robot->movement));
 }
 
-static bool all_robots_are_in_state(enum robot_state state) 
+static bool report_send_revolutions(struct robot *robot)
 {
-	struct robot *robot;
-	SYS_SLIST_FOR_EACH_CONTAINER(&robot_list, robot, node) {
-		if (robot->state != state) {
+	if (IS_ENABLED(CONFIG_CLOUD_CODEC_CBOR)) {
+		uint8_t *buf = report_binary_alloc();
+
+		if (buf == NULL) {
 			return false;
 		}
+
+		return report_binary_event(robot, ROBOT_REPORT_FIELD_REVOLUTIONS, buf,
+					   codec_cbor_encode_revolution_count_report(
+						   buf, CODEC_CBOR_REPORT_SIZE_MAX,
+						   robot->id, robot->revolutions));
 	}
-	return true;
+
+	return report_event(robot, ROBOT_REPORT_FIELD_REVOLUTIONS,
+			    codec_encode_revolution_count_report(robot->id,
+								 robot->revolutions));
 }
 
-static void process_delta_for_each_robot(robot_delta_fn *func, const char *delta, size_t len)
+static bool report_send_calibration(struct robot *robot)
+{
+	return report_event(robot, ROBOT_REPORT_FIELD_CALIBRATION,
+			    codec_encode_calibration_report(robot->id, robot->calibrate,
+							    &robot->calibration));
+}
+
+static bool report_send_power(struct robot *robot)
+{
+	return report_event(robot, ROBOT_REPORT_FIELD_POWER,
+			    codec_encode_power_report(robot->id, &robot->power));
+}
+
+/* Roster persistence */
+static int roster_save(struct robot *robot)
+{
+	struct robot_record record = {0};
+	char key[sizeof(ROSTER_SETTINGS_KEY "/ffff")];
+	int err;
+
+	if (!IS_ENABLED(CONFIG_ROBOT_MODULE_ROSTER)) {
+		return 0;
+	}
+
+	memcpy(record.id, robot->id, sizeof(record.id));
+	record.movement = robot->movement;
+	record.led = robot->led;
+	record.revolutions = robot->revolutions;
+	record.turn_rate = robot->turn_rate;
+	record.speed = robot->speed;
+	record.turn_offset = robot->turn_offset;
+	record.drive_offset = robot->drive_offset;
+
+	snprintk(key, sizeof(key), ROSTER_SETTINGS_KEY "/%x", robot->addr);
+	err = settings_save_one(key, &record, sizeof(record));
+	if (err) {
+		LOG_ERR("Failed to store robot %x: Error %d", robot->addr, err);
+		return err;
+	}
+
+	robot->dirty = false;
+	return 0;
+}
+
+/* Deletes the stored robot of an address. */
+static void roster_delete(uint16_t addr)
+{
+	char key[sizeof(ROSTER_SETTINGS_KEY "/ffff")];
+	int err;
+
+	if (!IS_ENABLED(CONFIG_ROBOT_MODULE_ROSTER)) {
+		return;
+	}
+
+	snprintk(key, sizeof(key), ROSTER_SETTINGS_KEY "/%x", addr);
+	err = settings_delete(key);
+	if (err) {
+		LOG_ERR("Failed to delete stored robot %x: Error %d", addr, err);
+	}
+}
+
+/* Stores every robot that changed since it was last stored. */
+static void roster_flush(void)
 {
 	struct robot *robot;
 	SYS_SLIST_FOR_EACH_CONTAINER(&robot_list, robot, node) {
-		if (func) {
-			func(robot, delta, len);
+		if (robot->dirty) {
+			roster_save(robot);
 		}
 	}
 }
 
-static void process_delta_led(struct robot *robot, const char *delta, size_t len) 
+#if defined(CONFIG_ROBOT_MODULE_ROSTER)
+static int roster_settings_set(const char *name, size_t len,
+			       settings_read_cb read_cb, void *cb_arg)
 {
-	struct codec_led led;
-	struct robot_module_event *event;
+	struct robot_record record = {0};
+	struct robot *robot;
+	unsigned long addr;
+	char *end;
+	int rc;
 
-	if(codec_decode_led(robot->id, delta, len, &led)) {
-		robot->led = led;
-		event = new_robot_module_event();
-		event->type = ROBOT_EVT_LED_CONFIGURE;
-		event->addr = robot->addr;
-		event->data.led = &robot->led;
-		APP_EVENT_SUBMIT(event);
+	addr = strtoul(name, &end, 16);
+	if (end == name || addr == 0 || addr > UINT16_MAX) {
+		return -ENOENT;
+	}
+
+	if (len != sizeof(record) && len != ROBOT_RECORD_LEGACY_LEN &&
+	    len != ROBOT_RECORD_AVERAGE_SPEED_LEN) {
+		LOG_WRN("Discarding stored robot %lx of unexpected size", addr);
+		return -EINVAL;
+	}
+
+	rc = read_cb(cb_arg, &record, len);
+	if (rc < 0) {
+		return rc;
+	}
+	record.id[sizeof(record.id) - 1] = '\0';
+
+	/* The durations would be estimated from the wrong speed, keep the
+	 * robot uncalibrated until it is calibrated again.
+	 */
+	if (len == ROBOT_RECORD_AVERAGE_SPEED_LEN) {
+		record.turn_rate = 0;
+		record.speed = 0;
+	}
+
+	robot = get_robot_by_addr(addr);
+	if (robot == NULL) {
+		robot = add_robot(0, addr);
+		if (robot == NULL) {
+			return -ENOMEM;
+		}
 	}
+
+	memcpy(robot->id, record.id, sizeof(robot->id));
+	robot->movement = record.movement;
+	robot->led = record.led;
+	robot->revolutions = record.revolutions;
+	robot->turn_rate = record.turn_rate;
+	robot->speed = record.speed;
+	robot->turn_offset = record.turn_offset;
+	robot->drive_offset = record.drive_offset;
+	robot->dirty = false;
+
+	LOG_INF("Restored robot %s on addr %x", robot->id, robot->addr);
+	return 0;
 }
 
-static void process_delta_movement(struct robot *robot, const char *delta, size_t len) 
+SETTINGS_STATIC_HANDLER_DEFINE(robot_roster, ROSTER_SETTINGS_KEY, NULL,
+			       roster_settings_set, NULL, NULL);
+#endif
+
+static void roster_load(void)
 {
-	struct codec_movement movement;
-	struct robot_module_event *event;
+	int err;
 
-	if(codec_decode_movement(robot->id, delta, len, &movement)) {
-		robot->movement = movement;
-		robot->movement.speed = 100;
-		LOG_INF("robot->movement.drive_time: %d", robot->movement.drive_time);
+	if (!IS_ENABLED(CONFIG_ROBOT_MODULE_ROSTER)) {
+		return;
+	}
 
-		event = new_robot_module_event();
-		event->type = ROBOT_EVT_MOVEMENT_CONFIGURE;
-		event->addr = robot->addr;
-		event->data.movement = &robot->movement;
-		APP_EVENT_SUBMIT(event);
+	err = settings_subsys_init();
+	if (err) {
+		LOG_ERR("Failed to initialize settings: Error %d", err);
+		return;
+	}
+
+	err = settings_load_subtree(ROSTER_SETTINGS_KEY);
+	if (err) {
+		LOG_ERR("Failed to load robot roster: Error %d", err);
 	}
 }
 
-/* Message handler for STATE_CONFIGURING. */
-static void on_state_cloud_disconnected(struct robot_msg_data *msg)
+/* Remember the old id of a robot whose address now has a new id, so it
+ * can be removed from the shadow.
+ */
+static void roster_remove_id(const char *id)
 {
-	if (is_mesh_module_event((struct app_event_header *)(&msg->event.mesh)))
-    {
-        if (msg->event.mesh.type == MESH_EVT_ROBOT_ID)
-        {
-			LOG_INF("Robot id detected addr: %x, id %llx", msg->event.mesh.addr, msg->event.mesh.data.robot_id.id);
-			if(!get_robot_by_addr(msg->event.mesh.addr)) {
-				add_robot(msg->event.mesh.data.robot_id.id, msg->event.mesh.addr);
-				struct robot *robot = get_robot_by_addr(msg->event.mesh.addr);
-				robot->led.red = 0;
-				robot->led.green = 230;
-				robot->led.blue = 10;
-				robot->led.time = 500;
-
-				set_led_event(robot);
-			}
-			
-		}
+	struct removed_id *removed = k_malloc(sizeof(*removed));
+
+	if (removed == NULL) {
+		LOG_ERR("Failed to allocate removed robot, %s stays in the shadow", id);
+		return;
 	}
 
-	if (is_cloud_module_event((struct app_event_header *)(&msg->event.cloud)))
-    {
-        if (msg->event.cloud.type == CLOUD_EVT_CONNECTED)
-        {
-			report_clear_robot_list();
-			// report_event(codec_encode_remove_robots_report());
-			for_each_robot(report_robot);
+	memcpy(removed->id, id, sizeof(removed->id));
+	sys_slist_append(&removed_list, &removed->node);
+}
 
-			state_set(STATE_CLOUD_CONNECTED);
-		}
+/* Forgets the removed ids once they are reported. */
+static void roster_removed_clear(void)
+{
+	sys_snode_t *node;
+
+	while ((node = sys_slist_get(&removed_list)) != NULL) {
+		k_free(CONTAINER_OF(node, struct removed_id, node));
 	}
 }
 
-/* Message handler for STATE_EXECUTING. */
-static void on_state_cloud_connected(struct robot_msg_data *msg)
+/* Records changed fields of a robot in the journal. Returns true if the
+ * fields can be reported right away. While the cloud is disconnected they are
+ * only journaled, and optionally stored so they survive a reboot. Local
+ * control gets every report, the journal still covers the cloud.
+ */
+static bool journal_mark(struct robot *robot, uint8_t fields)
 {
-	if (is_cloud_module_event((struct app_event_header *)(&msg->event.cloud)))
-    {
-        if (msg->event.cloud.type == CLOUD_EVT_UPDATE_DELTA)
-        {
-			int version;
+	robot->journal |= fields;
 
-			const char * delta = msg->event.cloud.data.pub_msg.ptr;
-			size_t len = msg->event.cloud.data.pub_msg.len;
+	if (state == STATE_CLOUD_CONNECTED) {
+		return true;
+	}
 
-			version = codec_decode_version(delta, len);
-			if (version_prev >= version) {
-				return;
-			}
-			version_prev = version;
-			process_delta_for_each_robot(process_delta_movement, delta, len);
-			process_delta_for_each_robot(process_delta_led, delta, len);
-		}
+	if (IS_ENABLED(CONFIG_ROBOT_MODULE_JOURNAL_PERSIST)) {
+		robot->dirty = true;
+		roster_save(robot);
 	}
 
-	if (is_cloud_module_event((struct app_event_header *)(&msg->event.cloud)))
-    {
-        if (msg->event.cloud.type == CLOUD_EVT_DISCONNECTED)
-        {
-			state_set(STATE_CLOUD_DISCONNECTED);
+	return IS_ENABLED(CONFIG_LOCAL_CONTROL);
+}
+
+/* Marks a robot of the shadow for removal if it is not in the roster. */
+static void roster_reconcile_id(const char *id, void *user_data)
+{
+	struct removed_id *removed;
+	struct robot *robot;
+
+	ARG_UNUSED(user_data);
+
+	if (strlen(id) >= sizeof(removed->id)) {
+		LOG_WRN("Invalid robot id in the shadow: %s", id);
+		return;
+	}
+
+	SYS_SLIST_FOR_EACH_CONTAINER(&robot_list, robot, node) {
+		if (strcmp(robot->id, id) == 0) {
+			return;
 		}
 	}
 
-	if (is_mesh_module_event((struct app_event_header *)(&msg->event.mesh)))
-    {
-        if (msg->event.mesh.type == MESH_EVT_ROBOT_ID)
-        {
-			if(!get_robot_by_addr(msg->event.mesh.addr)) {
-				report_robot(add_robot(msg->event.mesh.data.robot_id.id, msg->event.mesh.addr));
-				struct robot *robot = get_robot_by_addr(msg->event.mesh.addr);
-				robot->led.red = 0;
-				robot->led.green = 230;
-				robot->led.blue = 10;
-				robot->led.time = 500;
-
-				set_led_event(robot);
-			}
+	SYS_SLIST_FOR_EACH_CONTAINER(&removed_list, removed, node) {
+		if (strcmp(removed->id, id) == 0) {
+			return;
 		}
 	}
 
-	if (is_mesh_module_event((struct app_event_header *)(&msg->event.mesh)))
-    {
-        if (msg->event.mesh.type == MESH_EVT_MOVEMENT_CONFIGURED)
-        {
-			struct robot *robot = get_robot_by_addr(msg->event.mesh.addr);
+	roster_remove_id(id);
+}
 
-			report_robot_movement(robot);
-			robot->state = ROBOT_STATE_CONFIGURED;
-			robot->led.red = 230;
-			robot->led.green = 0;
-			robot->led.blue = 10;
-			robot->led.time = 150;
+static bool report_batch_covers(const struct robot *robot, bool full)
+{
+	return full || (robot->journal & CODEC_ROBOT_ALL);
+}
 
-			set_led_event(robot);
+/* Reports robots in one message, and removes replaced robots. A full report
+ * has every field of every robot, otherwise only the journaled fields are
+ * included. Either way the report holds the latest value of every field
+ * reported since the previous one, so it replaces the pending reports of
+ * those fields of the robots it covers. Their journal starts over once the
+ * report is submitted.
+ */
+static void report_batch_json(bool full)
+{
+	struct robot_report_covered *covered;
+	struct codec_robot *robots;
+	struct removed_id *removed;
+	struct robot *robot;
+	size_t covered_count = 0;
+	size_t count = 0;
+	size_t i = 0;
 
-			if (all_robots_are_in_state(ROBOT_STATE_CONFIGURED)) {
-				struct robot_module_event *clear_to_move_event = new_robot_module_event();
-				clear_to_move_event->type = ROBOT_EVT_CLEAR_TO_MOVE;
-				APP_EVENT_SUBMIT(clear_to_move_event);
-			}
+	SYS_SLIST_FOR_EACH_CONTAINER(&robot_list, robot, node) {
+		if (report_batch_covers(robot, full)) {
+			covered_count++;
 		}
 	}
 
-	if (is_mesh_module_event((struct app_event_header *)(&msg->event.mesh)))
-    {
-        if (msg->event.mesh.type == MESH_EVT_TELEMETRY_REPORTED)
-        {
-			struct robot *robot = get_robot_by_addr(msg->event.mesh.addr);
-			robot->revolutions = msg->event.mesh.data.report.revolutions;
-			robot->state = ROBOT_STATE_READY;
+	count = covered_count;
+	SYS_SLIST_FOR_EACH_CONTAINER(&removed_list, removed, node) {
+		count++;
+	}
+
+	if (count == 0) {
+		return;
+	}
+
+	robots = k_calloc(count, sizeof(struct codec_robot));
+	covered = k_calloc(MAX(covered_count, 1), sizeof(struct robot_report_covered));
+	if (robots == NULL || covered == NULL) {
+		LOG_ERR("Failed to allocate roster report");
+		k_free(robots);
+		k_free(covered);
+		return;
+	}
+
+	SYS_SLIST_FOR_EACH_CONTAINER(&robot_list, robot, node) {
+		if (!report_batch_covers(robot, full)) {
+			continue;
+		}
+
+		robots[i].id = robot->id;
+		robots[i].fields = full ? CODEC_ROBOT_ALL : (robot->journal & CODEC_ROBOT_ALL);
+		robots[i].movement = robot->movement;
+		robots[i].revolutions = robot->revolutions;
+		robots[i].led = robot->led;
 
-			robot->led.red = 0;
-			robot->led.green = 230;
-			robot->led.blue = 10;
-			robot->led.time = 500;
+		covered[i].addr = robot->addr;
+		if (robots[i].fields & CODEC_ROBOT_MOVEMENT) {
+			covered[i].fields |= BIT(ROBOT_REPORT_FIELD_MOVEMENT);
+		}
+		if (robots[i].fields & CODEC_ROBOT_REVOLUTIONS) {
+			covered[i].fields |= BIT(ROBOT_REPORT_FIELD_REVOLUTIONS);
+		}
+		i++;
+	}
 
-			set_led_event(robot);
+	SYS_SLIST_FOR_EACH_CONTAINER(&removed_list, removed, node) {
+		robots[i].id = removed->id;
+		robots[i].removed = true;
+		i++;
+	}
 
-			if (all_robots_are_in_state(ROBOT_STATE_READY)) {
-				for_each_robot(report_robot_revolution_count);
+	if (report_batch_event(codec_encode_robots_report(robots, count),
+			       covered, covered_count)) {
+		SYS_SLIST_FOR_EACH_CONTAINER(&robot_list, robot, node) {
+			if (report_batch_covers(robot, full)) {
+				robot->journal &= ~CODEC_ROBOT_ALL;
 			}
 		}
+		roster_removed_clear();
 	}
+	k_free(robots);
 }
 
-static void module_thread_fn(void)
+/* Sends the journaled field of a robot again, and takes it off the journal
+ * once the report is submitted.
+ */
+static void journal_flush_field(struct robot *robot, uint8_t field,
+				bool (*send)(struct robot *robot))
 {
-	struct robot_msg_data msg;
+	if ((robot->journal & field) && send(robot)) {
+		robot->journal &= ~field;
+	}
+}
 
-	LOG_INF("Robot module thread started");
+/* Flushes the journal. With the binary protocol, journaled movements and
+ * revolutions are sent on the report topic, and the batch only removes
+ * replaced robots, or carries what could not be sent. A full report always
+ * goes to the shadow, as it reconciles the roster. Journaled calibration and
+ * power reports are sent on their own.
+ */
+static void report_batch(bool full)
+{
+	struct robot *robot;
 
-	sys_slist_init(&robot_list);
+	if (IS_ENABLED(CONFIG_CLOUD_CODEC_CBOR) && !full) {
+		SYS_SLIST_FOR_EACH_CONTAINER(&robot_list, robot, node) {
+			journal_flush_field(robot, CODEC_ROBOT_MOVEMENT, report_send_movement);
+			journal_flush_field(robot, CODEC_ROBOT_REVOLUTIONS,
+					    report_send_revolutions);
+		}
+	}
 
-	while (true) {
-		k_msgq_get(&msgq_robot, &msg, K_FOREVER);
+	report_batch_json(full);
 
-		switch (state) {
-		case STATE_CLOUD_DISCONNECTED:
-			on_state_cloud_disconnected(&msg);
-			break;
-		case STATE_CLOUD_CONNECTED:
-			on_state_cloud_connected(&msg);
+	SYS_SLIST_FOR_EACH_CONTAINER(&robot_list, robot, node) {
+		journal_flush_field(robot, ROBOT_JOURNAL_CALIBRATION, report_send_calibration);
+		journal_flush_field(robot, ROBOT_JOURNAL_POWER, report_send_power);
+	}
+}
+
+/* Reports the full roster once after boot, reconciled with the shadow if it
+ * was received.
+ */
+static void report_roster(void)
+{
+	k_work_cancel_delayable(&shadow_timeout_work);
+	report_batch(true);
+	roster_reported = true;
+}
+
+static void shadow_timeout_work_fn(struct k_work *work)
+{
+	struct robot_module_event *event = new_robot_module_event();
+
+	ARG_UNUSED(work);
+
+	event->type = ROBOT_EVT_SHADOW_TIMEOUT;
+	APP_EVENT_SUBMIT(event);
+}
+
+/* Moves a known robot to the address it was provisioned on again. The stored
+ * robot of the old address is deleted, and a robot on the new address is
+ * replaced.
+ */
+static void move_robot(struct robot *robot, uint16_t addr)
+{
+	struct robot *replaced = get_robot_by_addr(addr);
+
+	LOG_INF("Robot %s moved: addr %x -> %x", robot->id, robot->addr, addr);
+
+	if (replaced != NULL) {
+		LOG_INF("Robot on addr %x replaced: %s -> %s", addr, replaced->id, robot->id);
+		roster_remove_id(replaced->id);
+		sys_slist_find_and_remove(&robot_list, &replaced->node);
+		k_free(replaced);
+	}
+
+	roster_delete(robot->addr);
+	robot->addr = addr;
+	roster_save(robot);
+}
+
+/* Handles an identifying robot. Known robots are not added again, but a new
+ * id on a known address replaces the old one, and a known id on a new address
+ * moves the robot.
+ */
+static struct robot *identify_robot(uint64_t id, uint16_t addr, bool *added)
+{
+	struct robot *robot;
+	char id_str[13];
+
+	*added = false;
+
+	robot_id_format(id_str, id);
+	robot = get_robot_by_id(id_str, strlen(id_str));
+	if (robot != NULL && robot->addr != addr) {
+		move_robot(robot, addr);
+		return robot;
+	}
+
+	robot = get_robot_by_addr(addr);
+	if (robot == NULL) {
+		robot = add_robot(id, addr);
+		if (robot == NULL) {
+			return NULL;
+		}
+		*added = true;
+		roster_save(robot);
+		return robot;
+	}
+
+	if (strcmp(id_str, robot->id) != 0) {
+		LOG_INF("Robot on addr %x replaced: %s -> %s", addr, robot->id, id_str);
+		roster_remove_id(robot->id);
+		memcpy(robot->id, id_str, sizeof(robot->id));
+		robot->turn_rate = 0;
+		robot->speed = 0;
+		robot->turn_offset = 0;
+		robot->drive_offset = 0;
+		*added = true;
+		roster_save(robot);
+	}
+
+	return robot;
+}
+
+static void report_robot_movement(struct robot *robot) 
+{
+	if (!journal_mark(robot, CODEC_ROBOT_MOVEMENT)) {
+		return;
+	}
+
+	report_send_movement(robot);
+}
+
+static void report_robot_revolution_count(struct robot *robot) 
+{
+	LOG_INF("revolution count: %d", robot->revolutions);
+
+	if (!journal_mark(robot, CODEC_ROBOT_REVOLUTIONS)) {
+		return;
+	}
+
+	report_send_revolutions(robot);
+}
+
+static void report_robot(struct robot *robot) 
+{	
+	report_robot_movement(robot);
+	report_robot_revolution_count(robot);
+
+}
+
+/* Round deadlines */
+static void round_deadline_work_fn(struct k_work *work)
+{
+	struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+	struct round_deadline *deadline = CONTAINER_OF(dwork, struct round_deadline, work);
+	struct robot_module_event *event = new_robot_module_event();
+
+	event->type = ROBOT_EVT_ROUND_DEADLINE;
+	event->round = deadline->round;
+	event->data.phase = deadline->phase;
+	APP_EVENT_SUBMIT(event);
+}
+
+static void round_deadline_init(void)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(deadlines); i++) {
+		k_work_init_delayable(&deadlines[i].work, round_deadline_work_fn);
+	}
+}
+
+static void round_deadline_arm(enum robot_round_phase phase, uint8_t round,
+			       int32_t timeout_ms)
+{
+	if (!IS_ENABLED(CONFIG_ROBOT_MODULE_ROUND_DEADLINES)) {
+		return;
+	}
+
+	deadlines[phase].round = round;
+	k_work_reschedule(&deadlines[phase].work,
+			  K_MSEC(timeout_ms + CONFIG_ROBOT_MODULE_DEADLINE_MARGIN_MS));
+}
+
+static void round_deadline_cancel(enum robot_round_phase phase)
+{
+	k_work_cancel_delayable(&deadlines[phase].work);
+}
+
+/* Jacobson/Karels estimator, as used for the TCP retransmission timeout. */
+static void rtt_sample(int32_t rtt_ms)
+{
+	if (!rtt_measured) {
+		rtt_srtt_ms = rtt_ms;
+		rtt_var_ms = rtt_ms / 2;
+		rtt_measured = true;
+		return;
+	}
+
+	rtt_var_ms += (abs(rtt_srtt_ms - rtt_ms) - rtt_var_ms) / 4;
+	rtt_srtt_ms += (rtt_ms - rtt_srtt_ms) / 8;
+}
+
+static int32_t rtt_timeout_ms(void)
+{
+	if (!rtt_measured) {
+		return CONFIG_ROBOT_MODULE_RTT_INITIAL_MS;
+	}
+
+	return rtt_srtt_ms + 4 * rtt_var_ms;
+}
+
+/* Time the robot firmware takes to turn and drive its movement. Like the
+ * motor module of the robot, a calibrated robot turns at its measured
+ * rate, drives longer when its slower wheel can not reach the calibrated
+ * speed, and both take the measured offsets on top.
+ */
+static int32_t movement_duration_ms(const struct robot *robot)
+{
+	const struct bt_mesh_movement_set *movement = &robot->movement;
+	int32_t angle = MIN(abs(movement->angle), 180);
+	int64_t turn_ms = angle * CONFIG_ROBOT_MODULE_TURN_MS_PER_DEGREE;
+	int64_t drive_ms = movement->time;
+	uint32_t target = CONFIG_ROBOT_MODULE_CALIBRATED_SPEED_MM_S * movement->speed / 100;
+
+	if (robot->turn_rate && angle) {
+		turn_ms = MAX(angle * MSEC_PER_SEC / robot->turn_rate + robot->turn_offset, 0);
+	}
+
+	if (robot->speed && movement->speed && drive_ms) {
+		if (target > robot->speed) {
+			drive_ms = drive_ms * target / robot->speed;
+		}
+		drive_ms = MAX(drive_ms + robot->drive_offset, 0);
+	}
+
+	return (int32_t)MIN(turn_ms + drive_ms, INT32_MAX);
+}
+
+static int32_t timing_interval_ms(int64_t from, int64_t to)
+{
+	return (from && to) ? (int32_t)(to - from) : -1;
+}
+
+static void round_timing_telemetry(void)
+{
+	timing_running.telemetry_time = k_uptime_get();
+}
+
+/* Submits the timing of the running round once it is done. */
+static void round_metrics_report(void)
+{
+	struct round_timing *timing = &timing_running;
+	struct robot_module_event *event;
+
+	if (!IS_ENABLED(CONFIG_ROBOT_MODULE_ROUND_METRICS)) {
+		return;
+	}
+
+	event = new_robot_module_event();
+	event->type = ROBOT_EVT_ROUND_METRICS;
+	event->round = round_running;
+	event->data.metrics = (struct robot_round_metrics){
+		.robots = timing->robots,
+		.degraded = timing->degraded,
+		.configure_ms = timing_interval_ms(timing->configure_time, timing->start_time),
+		.ack_ms = timing_interval_ms(timing->configure_time, timing->ack_time),
+		.telemetry_ms = timing_interval_ms(timing->start_time, timing->telemetry_time),
+	};
+
+	LOG_INF("Round %d: %d robots, %d degraded, configure %d ms, ack %d ms, "
+		"telemetry %d ms", round_running,
+		event->data.metrics.robots, event->data.metrics.degraded,
+		(int)event->data.metrics.configure_ms, (int)event->data.metrics.ack_ms,
+		(int)event->data.metrics.telemetry_ms);
+
+	APP_EVENT_SUBMIT(event);
+}
+
+/* Continues the rounds without a robot until it acknowledges a movement
+ * again. A robot that misses a configure deadline may still be executing
+ * the running round, only the move deadline stops waiting for it.
+ */
+static void robot_degrade(struct robot *robot, bool resync)
+{
+	if (!robot->degraded) {
+		LOG_WRN("Robot %s degraded", robot->id);
+	}
+
+	robot->degraded = true;
+	robot->resync |= resync;
+	robot->state = ROBOT_STATE_READY;
+	robot->unsynced |= CODEC_ROBOT_MOVEMENT | CODEC_ROBOT_LED;
+}
+
+/* Arms the configure deadline after a batch of movement configurations. */
+static void round_configured(void)
+{
+	struct robot *robot;
+
+	SYS_SLIST_FOR_EACH_CONTAINER(&robot_list, robot, node) {
+		if (robot->state == ROBOT_STATE_CONFIGURING) {
+			round_deadline_arm(ROBOT_ROUND_PHASE_CONFIGURE, round_next,
+					   rtt_timeout_ms());
+			return;
+		}
+	}
+}
+
+static void process_delta_for_each_robot(robot_delta_fn *func, const char *delta, size_t len)
+{
+	struct robot *robot;
+	SYS_SLIST_FOR_EACH_CONTAINER(&robot_list, robot, node) {
+		if (func) {
+			func(robot, delta, len);
+		}
+	}
+}
+
+/* Updates the commanded LED configuration, sent by sync_leds(). */
+static void configure_led(struct robot *robot, const struct bt_mesh_light_rgb_set *led)
+{
+	if (!led_equal(&robot->led, led)) {
+		robot->led = *led;
+		robot->dirty = true;
+		robot->journal |= CODEC_ROBOT_LED;
+	}
+}
+
+static bool led_is_pending(struct robot *robot)
+{
+	return (robot->unsynced & CODEC_ROBOT_LED) || !led_equal(&robot->led_sent, &robot->led);
+}
+
+/* Pseudo team of the all robots group. */
+#define TEAM_ALL 0xFE
+
+static bool group_has_member(uint8_t team, struct robot *robot)
+{
+	return team == TEAM_ALL || robot->team == team;
+}
+
+/* Sends the pending LED changes of a group as one group set, if every robot
+ * of the group changes to the same colour. Robots outside the group must
+ * not be subscribed to it, and every robot in it must be.
+ */
+static bool sync_leds_group(uint8_t team, uint16_t group_addr)
+{
+	struct robot_module_event *event;
+	struct robot *first = NULL;
+	struct robot *robot;
+	size_t count = 0;
+
+	SYS_SLIST_FOR_EACH_CONTAINER(&robot_list, robot, node) {
+		if (!group_has_member(team, robot)) {
+			if (robot->team_joined == team) {
+				return false;
+			}
+			continue;
+		}
+
+		if (team == TEAM_ALL ? !robot->all_joined : robot->team_joined != team) {
+			return false;
+		}
+
+		if (!led_is_pending(robot) ||
+		    (first && !led_equal(&first->led, &robot->led))) {
+			return false;
+		}
+
+		if (!first) {
+			first = robot;
+		}
+		count++;
+	}
+
+	if (count < 2) {
+		return false;
+	}
+
+	SYS_SLIST_FOR_EACH_CONTAINER(&robot_list, robot, node) {
+		if (group_has_member(team, robot)) {
+			robot->led_sent = robot->led;
+			robot->unsynced &= ~CODEC_ROBOT_LED;
+		}
+	}
+
+	LOG_INF("LED of %d robots set on group %x", (int)count, group_addr);
+
+	event = new_robot_module_event();
+	event->type = ROBOT_EVT_LED_CONFIGURE;
+	event->addr = group_addr;
+	event->data.led = &first->led_sent;
+	APP_EVENT_SUBMIT(event);
+
+	return true;
+}
+
+/* Sends the pending LED changes, as group sets where whole groups change
+ * together, and unicast otherwise.
+ */
+static void sync_leds(void)
+{
+	if (!sync_leds_group(TEAM_ALL, MESH_GROUP_ADDR_ALL)) {
+		for (uint8_t team = 0; team < CONFIG_MESH_GROUPS_TEAM_COUNT; team++) {
+			sync_leds_group(team, MESH_GROUP_ADDR_TEAM(team));
+		}
+	}
+
+	for_each_robot(sync_led);
+}
+
+static void process_delta_team(struct robot *robot, const char *delta, size_t len)
+{
+	struct robot_module_event *event;
+	uint8_t team;
+
+	if (!codec_decode_team(robot->id, delta, len, &team) || team == robot->team) {
+		return;
+	}
+
+	if (team >= CONFIG_MESH_GROUPS_TEAM_COUNT && team != MESH_TEAM_NONE) {
+		LOG_WRN("Invalid team %d for robot %s", team, robot->id);
+		return;
+	}
+
+	robot->team = team;
+
+	event = new_robot_module_event();
+	event->type = ROBOT_EVT_TEAM_SET;
+	event->addr = robot->addr;
+	event->data.team = team;
+	APP_EVENT_SUBMIT(event);
+}
+
+/* A calibration is requested by changing the request count of the robot,
+ * which is reported back with the result.
+ */
+static void process_delta_calibrate(struct robot *robot, const char *delta, size_t len)
+{
+	struct robot_module_event *event;
+	uint8_t request;
+
+	if (!codec_decode_calibrate(robot->id, delta, len, &request) ||
+	    request == robot->calibrate) {
+		return;
+	}
+
+	robot->calibrate = request;
+	LOG_INF("Calibrating robot %s", robot->id);
+
+	event = new_robot_module_event();
+	event->type = ROBOT_EVT_CALIBRATE;
+	event->addr = robot->addr;
+	APP_EVENT_SUBMIT(event);
+}
+
+static void on_calibrated(struct robot *robot,
+			  const struct bt_mesh_calibration_status *status)
+{
+	LOG_INF("Robot %s calibrated: err %d, turn rate %d deg/s, speed %d mm/s",
+		robot->id, status->err, status->turn_rate, status->speed);
+
+	/* Movement durations are estimated with the new calibration. */
+	if (!status->err) {
+		robot->turn_rate = status->turn_rate;
+		robot->speed = status->speed;
+		robot->turn_offset = status->turn_offset;
+		robot->drive_offset = status->drive_offset;
+		robot->dirty = true;
+		roster_save(robot);
+	}
+
+	robot->calibration = *status;
+	if (journal_mark(robot, ROBOT_JOURNAL_CALIBRATION)) {
+		report_send_calibration(robot);
+	}
+}
+
+/* Applies with the next movement configuration of the robot. */
+static void process_delta_stop(struct robot *robot, const char *delta, size_t len)
+{
+	uint8_t stop;
+
+	if (!codec_decode_stop_mode(robot->id, delta, len, &stop) || stop == robot->stop) {
+		return;
+	}
+
+	if (stop > BT_MESH_MOVEMENT_STOP_BRAKE_COAST) {
+		LOG_WRN("Invalid stop mode %d for robot %s", stop, robot->id);
+		return;
+	}
+
+	robot->stop = stop;
+}
+
+static void configure_movement(struct robot *robot,
+			       const struct bt_mesh_movement_set *movement)
+{
+	struct robot_module_event *event;
+
+	/* Already staged for the next round, or on its way to be. A movement
+	 * equal to the one of the previous round is a new command though.
+	 */
+	if ((!(robot->unsynced & CODEC_ROBOT_MOVEMENT) ||
+	     robot->state == ROBOT_STATE_CONFIGURING) &&
+	    movement_equal(&robot->movement, movement)) {
+		return;
+	}
+
+	robot->movement = *movement;
+	robot->unsynced |= CODEC_ROBOT_MOVEMENT;
+	robot->dirty = true;
+	/* A resent configuration gives an ambiguous round trip sample. */
+	robot->configure_time = (robot->state == ROBOT_STATE_CONFIGURING) ? 0 : k_uptime_get();
+	robot->state = ROBOT_STATE_CONFIGURING;
+	LOG_INF("robot->movement.time: %d, round: %d", robot->movement.time, round_next);
+
+	if (!timing_next.configure_time) {
+		timing_next.configure_time = k_uptime_get();
+	}
+
+	event = new_robot_module_event();
+	event->type = ROBOT_EVT_MOVEMENT_CONFIGURE;
+	event->addr = robot->addr;
+	event->round = round_next;
+	event->stop = robot->stop;
+	event->data.movement = &robot->movement;
+	APP_EVENT_SUBMIT(event);
+}
+
+static void process_delta_led(struct robot *robot, const char *delta, size_t len) 
+{
+	struct bt_mesh_light_rgb_set led;
+
+	if(codec_decode_led(robot->id, delta, len, &led)) {
+		configure_led(robot, &led);
+	}
+}
+
+static void process_delta_movement(struct robot *robot, const char *delta, size_t len) 
+{
+	struct bt_mesh_movement_set movement;
+
+	if(codec_decode_movement(robot->id, delta, len, &movement)) {
+		/* The shadow carries no speed. */
+		movement.speed = 100;
+		configure_movement(robot, &movement);
+	}
+}
+
+/* Applies a delta document, from the cloud or local control. Both share one
+ * version sequence, so a document is only applied once whichever path it
+ * arrives on first.
+ */
+static void process_delta(const char *delta, size_t len)
+{
+	int version;
+
+	version = codec_decode_version(delta, len);
+	if (version_prev >= version) {
+		return;
+	}
+	version_prev = version;
+	process_delta_for_each_robot(process_delta_stop, delta, len);
+	process_delta_for_each_robot(process_delta_movement, delta, len);
+	process_delta_for_each_robot(process_delta_team, delta, len);
+	process_delta_for_each_robot(process_delta_led, delta, len);
+	process_delta_for_each_robot(process_delta_calibrate, delta, len);
+	sync_leds();
+	round_configured();
+	roster_flush();
+}
+
+static void process_command(const struct codec_cbor_command *cmd, void *user_data)
+{
+	struct robot *robot = get_robot_by_id(cmd->id, cmd->id_len);
+
+	if (robot == NULL) {
+		LOG_WRN("Command for unknown robot %.*s", (int)cmd->id_len, cmd->id);
+		return;
+	}
+
+	if (cmd->has_movement) {
+		configure_movement(robot, &cmd->movement);
+	}
+
+	if (cmd->has_led) {
+		configure_led(robot, &cmd->led);
+	}
+}
+
+static bool any_robot_is_moving(void)
+{
+	struct robot *robot;
+	SYS_SLIST_FOR_EACH_CONTAINER(&robot_list, robot, node) {
+		if (robot->moving) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/* Stages the last movement of robots that missed the configure deadline for
+ * the next round, without holding the round back for them.
+ */
+static void round_resync(void)
+{
+	struct robot *robot;
+
+	SYS_SLIST_FOR_EACH_CONTAINER(&robot_list, robot, node) {
+		if (robot->resync) {
+			robot->resync = false;
+			sync_led(robot);
+			configure_movement(robot, &robot->movement);
+		}
+	}
+}
+
+/* Starts the staged round once the previous one is done and every robot
+ * that is not degraded has acknowledged its movement for it.
+ */
+static void round_advance(void)
+{
+	struct robot_module_event *clear_to_move_event;
+	struct robot *robot;
+	int32_t duration_ms = 0;
+	size_t participants = 0;
+
+	if (any_robot_is_moving()) {
+		return;
+	}
+
+	SYS_SLIST_FOR_EACH_CONTAINER(&robot_list, robot, node) {
+		if (robot->degraded) {
+			continue;
+		}
+		if (robot->state != ROBOT_STATE_CONFIGURED) {
+			return;
+		}
+		participants++;
+	}
+
+	/* With every robot degraded no round starts, so the missed movements
+	 * are staged again here, each retry under a new configure deadline.
+	 */
+	if (participants == 0) {
+		round_resync();
+		round_configured();
+		return;
+	}
+
+	round_deadline_cancel(ROBOT_ROUND_PHASE_CONFIGURE);
+
+	SYS_SLIST_FOR_EACH_CONTAINER(&robot_list, robot, node) {
+		if (robot->degraded) {
+			continue;
+		}
+		robot->state = ROBOT_STATE_READY;
+		robot->moving = true;
+		robot->unsynced |= CODEC_ROBOT_MOVEMENT;
+		robot->duration_ms = movement_duration_ms(robot);
+		duration_ms = MAX(duration_ms, robot->duration_ms);
+	}
+
+	timing_running = timing_next;
+	timing_running.start_time = k_uptime_get();
+	timing_running.robots = participants;
+	timing_next = (struct round_timing){0};
+
+	/* One ready message on the all robots group starts every body of every
+	 * robot at once. Robots that are not subscribed to it yet get their
+	 * own right after.
+	 */
+	clear_to_move_event = new_robot_module_event();
+	clear_to_move_event->type = ROBOT_EVT_CLEAR_TO_MOVE;
+	clear_to_move_event->addr = MESH_GROUP_ADDR_ALL;
+	clear_to_move_event->round = round_next;
+	APP_EVENT_SUBMIT(clear_to_move_event);
+
+	SYS_SLIST_FOR_EACH_CONTAINER(&robot_list, robot, node) {
+		if (robot->degraded || robot->all_joined) {
+			continue;
+		}
+		clear_to_move_event = new_robot_module_event();
+		clear_to_move_event->type = ROBOT_EVT_CLEAR_TO_MOVE;
+		clear_to_move_event->addr = robot->addr;
+		clear_to_move_event->round = round_next;
+		APP_EVENT_SUBMIT(clear_to_move_event);
+	}
+
+	LOG_INF("Round %d started with %d robots", round_next, (int)participants);
+
+	/* Telemetry is sent when the movement is done. */
+	round_running = round_next;
+	round_deadline_arm(ROBOT_ROUND_PHASE_MOVE, round_running,
+			   duration_ms + rtt_timeout_ms());
+
+	round_next++;
+	if (round_next == 0) {
+		round_next = 1;
+	}
+
+	round_resync();
+}
+
+static void on_round_deadline(enum robot_round_phase phase, uint8_t round)
+{
+	struct robot *robot;
+
+	if (phase == ROBOT_ROUND_PHASE_CONFIGURE) {
+		if (round != round_next) {
+			return;
+		}
+
+		SYS_SLIST_FOR_EACH_CONTAINER(&robot_list, robot, node) {
+			if (!robot->degraded && robot->state != ROBOT_STATE_CONFIGURED) {
+				LOG_WRN("Robot %s missed the configure deadline of round %d",
+					robot->id, round);
+				timing_next.degraded++;
+				robot_degrade(robot, robot->state == ROBOT_STATE_CONFIGURING);
+			}
+		}
+	} else {
+		if (round != round_running || !any_robot_is_moving()) {
+			return;
+		}
+
+		SYS_SLIST_FOR_EACH_CONTAINER(&robot_list, robot, node) {
+			if (robot->moving) {
+				LOG_WRN("Robot %s missed the move deadline of round %d",
+					robot->id, round);
+				robot->moving = false;
+				robot_degrade(robot, false);
+				timing_running.degraded++;
+			}
+		}
+
+		for_each_robot(report_robot_revolution_count);
+		round_metrics_report();
+	}
+
+	round_advance();
+}
+
+static void on_movement_configured(struct robot *robot, uint8_t round)
+{
+	/* Ack of a movement that was replaced before its round started. */
+	if (round != round_next || robot->state != ROBOT_STATE_CONFIGURING) {
+		LOG_DBG("Stale movement ack from %x, round %d", robot->addr, round);
+		return;
+	}
+
+	if (robot->configure_time) {
+		rtt_sample((int32_t)(k_uptime_get() - robot->configure_time));
+	}
+	timing_next.ack_time = k_uptime_get();
+
+	if (robot->degraded) {
+		LOG_INF("Robot %s rejoins in round %d", robot->id, round);
+		robot->degraded = false;
+	}
+
+	report_robot_movement(robot);
+	robot->state = ROBOT_STATE_CONFIGURED;
+	robot->unsynced &= ~CODEC_ROBOT_MOVEMENT;
+
+	round_advance();
+}
+
+static void on_power_reported(struct robot *robot, const struct bt_mesh_telemetry_power *power)
+{
+	if (power->flags & BT_MESH_TELEMETRY_POWER_FLAG_STALL) {
+		LOG_WRN("Robot %s stalled, movement aborted", robot->id);
+	}
+	if (power->flags & BT_MESH_TELEMETRY_POWER_FLAG_BATTERY_LOW) {
+		LOG_WRN("Robot %s battery low: %d mV", robot->id, power->battery);
+	}
+
+	robot->power = *power;
+	if (journal_mark(robot, ROBOT_JOURNAL_POWER)) {
+		report_send_power(robot);
+	}
+}
+
+static void on_telemetry_reported(struct robot *robot, const struct mesh_telemetry *telemetry)
+{
+	bool was_moving = robot->moving;
+
+	if (telemetry->has_power) {
+		on_power_reported(robot, &telemetry->power);
+	}
+
+	robot->revolutions = telemetry->report.revolutions;
+	robot->moving = false;
+
+	/* Late report of a robot the round already continued without. */
+	if (!was_moving) {
+		report_robot_revolution_count(robot);
+		return;
+	}
+
+	round_timing_telemetry();
+
+	if (!any_robot_is_moving()) {
+		round_deadline_cancel(ROBOT_ROUND_PHASE_MOVE);
+		for_each_robot(report_robot_revolution_count);
+		round_metrics_report();
+		round_advance();
+	}
+}
+
+/* Robot progress is tracked in every state, reports are journaled while the
+ * cloud is disconnected.
+ */
+static void on_all_states(struct robot_msg_data *msg)
+{
+	if (is_mesh_module_event((struct app_event_header *)(&msg->event.mesh)))
+    {
+        if (msg->event.mesh.type == MESH_EVT_GROUPS)
+        {
+			struct robot *robot = get_robot_by_addr(msg->event.mesh.addr);
+
+			if (robot) {
+				robot->team_joined = msg->event.mesh.data.groups.team;
+				robot->all_joined = msg->event.mesh.data.groups.all;
+			}
+		}
+	}
+
+	if (is_robot_module_event((struct app_event_header *)(&msg->event.robot)))
+    {
+        if (msg->event.robot.type == ROBOT_EVT_ROUND_DEADLINE)
+        {
+			on_round_deadline(msg->event.robot.data.phase, msg->event.robot.round);
+		}
+	}
+
+	if (IS_ENABLED(CONFIG_LOCAL_CONTROL) &&
+	    is_local_module_event((struct app_event_header *)(&msg->event.local)))
+    {
+        if (msg->event.local.type == LOCAL_EVT_UPDATE_DELTA)
+        {
+			process_delta(msg->event.local.data.delta.ptr,
+				      msg->event.local.data.delta.len);
+			k_free(msg->event.local.data.delta.ptr);
+		}
+	}
+
+	if (is_mesh_module_event((struct app_event_header *)(&msg->event.mesh)))
+    {
+        if (msg->event.mesh.type == MESH_EVT_MOVEMENT_CONFIGURED)
+        {
+			struct robot *robot = get_robot_by_addr(msg->event.mesh.addr);
+
+			if (robot) {
+				on_movement_configured(robot, msg->event.mesh.data.round);
+			}
+		}
+	}
+
+	if (is_mesh_module_event((struct app_event_header *)(&msg->event.mesh)))
+    {
+        if (msg->event.mesh.type == MESH_EVT_CALIBRATED)
+        {
+			struct robot *robot = get_robot_by_addr(msg->event.mesh.addr);
+
+			if (robot) {
+				on_calibrated(robot, &msg->event.mesh.data.calibration);
+			}
+		}
+	}
+
+	if (is_mesh_module_event((struct app_event_header *)(&msg->event.mesh)))
+    {
+        if (msg->event.mesh.type == MESH_EVT_TELEMETRY_REPORTED)
+        {
+			struct robot *robot = get_robot_by_addr(msg->event.mesh.addr);
+
+			if (robot) {
+				on_telemetry_reported(robot, &msg->event.mesh.data.telemetry);
+			}
+		}
+	}
+}
+
+/* Message handler for STATE_CONFIGURING. */
+static void on_state_cloud_disconnected(struct robot_msg_data *msg)
+{
+	if (is_mesh_module_event((struct app_event_header *)(&msg->event.mesh)))
+    {
+        if (msg->event.mesh.type == MESH_EVT_ROBOT_ID)
+        {
+			bool added;
+
+			LOG_INF("Robot id detected addr: %x, id %llx", msg->event.mesh.addr, msg->event.mesh.data.robot_id.id);
+			identify_robot(msg->event.mesh.data.robot_id.id,
+				       msg->event.mesh.addr, &added);
+		}
+	}
+
+	if (is_cloud_module_event((struct app_event_header *)(&msg->event.cloud)))
+    {
+        if (msg->event.cloud.type == CLOUD_EVT_CONNECTED)
+        {
+			state_set(STATE_CLOUD_CONNECTED);
+
+			/* The first report after boot reconciles the shadow with
+			 * the whole roster once the shadow is known, later ones
+			 * flush the journal.
+			 */
+			if (roster_reported) {
+				report_batch(false);
+			} else {
+				struct robot_module_event *event = new_robot_module_event();
+
+				event->type = ROBOT_EVT_SHADOW_GET;
+				APP_EVENT_SUBMIT(event);
+
+				k_work_reschedule(&shadow_timeout_work,
+						  K_MSEC(CONFIG_ROBOT_MODULE_SHADOW_TIMEOUT_MS));
+			}
+		}
+	}
+}
+
+/* Message handler for STATE_EXECUTING. */
+static void on_state_cloud_connected(struct robot_msg_data *msg)
+{
+	if (is_cloud_module_event((struct app_event_header *)(&msg->event.cloud)))
+    {
+        if (msg->event.cloud.type == CLOUD_EVT_SHADOW && !roster_reported)
+        {
+			/* Robots in the shadow but not in the roster are reported
+			 * as null, so the shadow ends up with exactly the roster.
+			 */
+			if (msg->event.cloud.data.pub_msg.len > 0) {
+				int err = codec_decode_reported_ids(msg->event.cloud.data.pub_msg.ptr,
+								    msg->event.cloud.data.pub_msg.len,
+								    roster_reconcile_id, NULL);
+				if (err == -EINVAL) {
+					LOG_WRN("Malformed shadow, not removing stale robots");
+				}
+			}
+
+			report_roster();
+		}
+	}
+
+	if (is_robot_module_event((struct app_event_header *)(&msg->event.robot)))
+    {
+        if (msg->event.robot.type == ROBOT_EVT_SHADOW_TIMEOUT && !roster_reported)
+        {
+			LOG_WRN("No shadow received, not removing stale robots");
+			report_roster();
+		}
+	}
+
+	if (is_cloud_module_event((struct app_event_header *)(&msg->event.cloud)))
+    {
+        if (msg->event.cloud.type == CLOUD_EVT_UPDATE_DELTA)
+        {
+			process_delta(msg->event.cloud.data.pub_msg.ptr,
+				      msg->event.cloud.data.pub_msg.len);
+		}
+	}
+
+	if (is_cloud_module_event((struct app_event_header *)(&msg->event.cloud)))
+    {
+        if (IS_ENABLED(CONFIG_CLOUD_CODEC_CBOR) &&
+	    msg->event.cloud.type == CLOUD_EVT_COMMAND)
+        {
+			int version;
+			int err;
+
+			const uint8_t *command = (const uint8_t *)msg->event.cloud.data.pub_msg.ptr;
+			size_t len = msg->event.cloud.data.pub_msg.len;
+
+			/* Commands share the version sequence with the shadow deltas. */
+			version = codec_cbor_decode_version(command, len);
+			if (version < 0) {
+				LOG_WRN("Discarding malformed robot command");
+				return;
+			}
+			if (version_prev >= version) {
+				return;
+			}
+
+			err = codec_cbor_decode_commands(command, len, process_command, NULL);
+			if (err) {
+				LOG_WRN("Discarding malformed robot command");
+				return;
+			}
+			version_prev = version;
+			sync_leds();
+			round_configured();
+			roster_flush();
+		}
+	}
+
+	if (is_cloud_module_event((struct app_event_header *)(&msg->event.cloud)))
+    {
+        if (msg->event.cloud.type == CLOUD_EVT_DISCONNECTED)
+        {
+			state_set(STATE_CLOUD_DISCONNECTED);
+		}
+	}
+
+	if (is_mesh_module_event((struct app_event_header *)(&msg->event.mesh)))
+    {
+        if (msg->event.mesh.type == MESH_EVT_ROBOT_ID)
+        {
+			bool added;
+			struct robot *robot = identify_robot(msg->event.mesh.data.robot_id.id,
+							     msg->event.mesh.addr, &added);
+			if (robot && added) {
+				if (!sys_slist_is_empty(&removed_list)) {
+					report_batch(true);
+				} else {
+					report_robot(robot);
+				}
+			}
+		}
+	}
+
+}
+
+static void module_thread_fn(void)
+{
+	struct robot_msg_data msg;
+
+	LOG_INF("Robot module thread started");
+
+	sys_slist_init(&robot_list);
+	sys_slist_init(&removed_list);
+	k_work_init_delayable(&shadow_timeout_work, shadow_timeout_work_fn);
+	round_deadline_init();
+	codec_init();
+	roster_load();
+
+	while (true) {
+		k_msgq_get(&msgq_robot, &msg, K_FOREVER);
+
+		switch (state) {
+		case STATE_CLOUD_DISCONNECTED:
+			on_state_cloud_disconnected(&msg);
+			break;
+		case STATE_CLOUD_CONNECTED:
+			on_state_cloud_connected(&msg);
 			break;
 		default:
 			break;
 		}
+
+		on_all_states(&msg);
 	}
 }
 
@@ -435,4 +1892,5 @@ APP_EVENT_SUBSCRIBE(MODULE, robot_module_event);
 APP_EVENT_SUBSCRIBE(MODULE, cloud_module_event);
 APP_EVENT_SUBSCRIBE(MODULE, ui_module_event);
 APP_EVENT_SUBSCRIBE(MODULE, mesh_module_event);
+APP_EVENT_SUBSCRIBE(MODULE, local_module_event);
 // }
\ No newline at end of file
@@ -0,0 +1,241 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/bluetooth/mesh.h>
+#include "bluetooth/mesh/vnd/light_rgb_srv.h"
+#include "bluetooth/mesh/vnd/movement_srv.h"
+
+#include "groups.h"
+#include "topology.h"
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(groups, CONFIG_GROUPS_LOG_LEVEL);
+
+/* Primary subnet, the only one used by the robots. */
+#define GROUPS_NET_IDX 0
+
+BUILD_ASSERT(BT_MESH_ADDR_IS_GROUP(GROUPS_ADDR_ALL) &&
+             BT_MESH_ADDR_IS_GROUP(GROUPS_ADDR_TEAM(CONFIG_GROUPS_TEAM_COUNT - 1)),
+             "Group addresses out of range");
+
+struct groups_node {
+    uint16_t addr;
+    bool all_wanted;
+    bool all_applied;
+    uint8_t team_wanted;
+    uint8_t team_applied;
+    /* Subscriptions must be configured and reported */
+    bool pending;
+};
+
+static struct groups_node nodes[CONFIG_GROUPS_MAX_NODES];
+static size_t node_count;
+static struct k_spinlock lock;
+static groups_status_cb status_cb;
+
+static void groups_update_work_fn(struct k_work *work);
+K_WORK_DEFINE(groups_update_work, groups_update_work_fn);
+
+static struct groups_node *node_get(uint16_t addr)
+{
+    for (size_t i = 0; i < node_count; i++) {
+        if (nodes[i].addr == addr) {
+            return &nodes[i];
+        }
+    }
+
+    if (node_count == ARRAY_SIZE(nodes)) {
+        return NULL;
+    }
+
+    nodes[node_count] = (struct groups_node){
+        .addr = addr,
+        .team_wanted = GROUPS_TEAM_NONE,
+        .team_applied = GROUPS_TEAM_NONE,
+    };
+    return &nodes[node_count++];
+}
+
+static struct groups_node *node_next_pending(void)
+{
+    for (size_t i = 0; i < node_count; i++) {
+        if (nodes[i].pending) {
+            return &nodes[i];
+        }
+    }
+    return NULL;
+}
+
+/* Address of the configuration server of the node with element addr, which
+ * is on the primary element only.
+ */
+static uint16_t primary_addr(uint16_t addr)
+{
+#if defined(CONFIG_BT_MESH_CDB)
+    struct bt_mesh_cdb_node *node = bt_mesh_cdb_node_get(addr);
+
+    if (node) {
+        return node->addr;
+    }
+#endif
+    return addr;
+}
+
+static int sub_set(uint16_t addr, uint16_t group, uint16_t model_id, bool add)
+{
+    uint8_t status = 0;
+    int err;
+
+    /* Configuration messages are encrypted with the device key of the
+     * robot, so this only succeeds for robots known to this node.
+     */
+    if (add) {
+        err = bt_mesh_cfg_mod_sub_add_vnd(GROUPS_NET_IDX, primary_addr(addr), addr, group,
+                        model_id, CONFIG_BT_COMPANY_ID, &status);
+    } else {
+        err = bt_mesh_cfg_mod_sub_del_vnd(GROUPS_NET_IDX, primary_addr(addr), addr, group,
+                        model_id, CONFIG_BT_COMPANY_ID, &status);
+    }
+
+    if (err) {
+        LOG_WRN("Failed to %s group %x on addr %x model %x: Error %d",
+            add ? "add" : "remove", group, addr, model_id, err);
+        return err;
+    }
+
+    if (status) {
+        LOG_WRN("Failed to %s group %x on addr %x model %x: Status %d",
+            add ? "add" : "remove", group, addr, model_id, status);
+        return -EIO;
+    }
+
+    return 0;
+}
+
+static void groups_update_work_fn(struct k_work *work)
+{
+    struct groups_node *node;
+    struct groups_status status;
+    k_spinlock_key_t key;
+    uint16_t addr;
+    bool all_wanted;
+    bool all_applied;
+    uint8_t team_wanted;
+    uint8_t team_applied;
+
+    key = k_spin_lock(&lock);
+    node = node_next_pending();
+    if (!node) {
+        k_spin_unlock(&lock, key);
+        return;
+    }
+    node->pending = false;
+    addr = node->addr;
+    all_wanted = node->all_wanted;
+    all_applied = node->all_applied;
+    team_wanted = node->team_wanted;
+    team_applied = node->team_applied;
+    k_spin_unlock(&lock, key);
+
+    /* The movement server takes the ready message of every round on the
+     * all robots group, on whichever element the body is.
+     */
+    if (all_wanted && !all_applied) {
+        all_applied = (sub_set(addr, GROUPS_ADDR_ALL, LIGHT_RGB_SRV_MODEL_ID, true) == 0 &&
+                       sub_set(addr, GROUPS_ADDR_ALL, MOVEMENT_SRV_MODEL_ID, true) == 0);
+    }
+
+    if (team_applied != team_wanted && team_applied != GROUPS_TEAM_NONE) {
+        if (sub_set(addr, GROUPS_ADDR_TEAM(team_applied), LIGHT_RGB_SRV_MODEL_ID, false) == 0) {
+            team_applied = GROUPS_TEAM_NONE;
+        }
+    }
+
+    /* Never leave a robot in two teams. */
+    if (team_applied == GROUPS_TEAM_NONE && team_wanted != GROUPS_TEAM_NONE) {
+        if (sub_set(addr, GROUPS_ADDR_TEAM(team_wanted), LIGHT_RGB_SRV_MODEL_ID, true) == 0) {
+            team_applied = team_wanted;
+        }
+    }
+
+    key = k_spin_lock(&lock);
+    node->all_applied = all_applied;
+    node->team_applied = team_applied;
+    k_spin_unlock(&lock, key);
+
+    LOG_INF("Addr %x groups: all %d, team %d", addr, all_applied, team_applied);
+
+    if (status_cb) {
+        status.team = team_applied;
+        status.all = all_applied;
+        status_cb(addr, &status);
+    }
+
+    /* Failed subscriptions are not retried until the next request, the
+     * gateway falls back to unicast for the robot meanwhile.
+     */
+    k_work_submit_to_queue(topology_cfg_work_q(), &groups_update_work);
+}
+
+void groups_init(groups_status_cb cb)
+{
+    status_cb = cb;
+}
+
+void groups_robot_join(uint16_t addr)
+{
+    struct groups_node *node;
+    k_spinlock_key_t key;
+
+    if (!BT_MESH_ADDR_IS_UNICAST(addr)) {
+        return;
+    }
+
+    key = k_spin_lock(&lock);
+    node = node_get(addr);
+    if (!node) {
+        k_spin_unlock(&lock, key);
+        LOG_WRN("No room for addr %x in groups", addr);
+        return;
+    }
+
+    /* Robots identify after a reset, which may have cleared the
+     * subscriptions, so they are added again. Adding is idempotent.
+     */
+    node->all_wanted = true;
+    node->all_applied = false;
+    if (node->team_applied == node->team_wanted) {
+        node->team_applied = GROUPS_TEAM_NONE;
+    }
+    node->pending = true;
+    k_spin_unlock(&lock, key);
+
+    k_work_submit_to_queue(topology_cfg_work_q(), &groups_update_work);
+}
+
+int groups_team_set(uint16_t addr, uint8_t team)
+{
+    struct groups_node *node;
+    k_spinlock_key_t key;
+
+    if (!BT_MESH_ADDR_IS_UNICAST(addr) ||
+        (team >= CONFIG_GROUPS_TEAM_COUNT && team != GROUPS_TEAM_NONE)) {
+        return -EINVAL;
+    }
+
+    key = k_spin_lock(&lock);
+    node = node_get(addr);
+    if (!node) {
+        k_spin_unlock(&lock, key);
+        return -ENOMEM;
+    }
+
+    node->team_wanted = team;
+    node->pending = true;
+    k_spin_unlock(&lock, key);
+
+    k_work_submit_to_queue(topology_cfg_work_q(), &groups_update_work);
+    return 0;
+}
@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+
+#ifndef GROUPS_H__
+#define GROUPS_H__
+
+#include <zephyr/bluetooth/mesh.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Bridge control messages. They share the UART framing with the mesh
+ * messages, but are handled by the bridge instead of being sent.
+ */
+#define BRIDGE_CTRL_ID 0xFFFF
+/* Gateway to bridge, addr is the robot and the payload its team. */
+#define BRIDGE_CTRL_OP_TEAM_SET 0x01
+/* Bridge to gateway, addr is the robot and the payload a
+ * struct groups_status.
+ */
+#define BRIDGE_CTRL_OP_GROUPS_STATUS 0x02
+
+/* Team of robots that are in no team. */
+#define GROUPS_TEAM_NONE 0xFF
+
+/** Group address all robot LEDs and movement servers are subscribed to. */
+#define GROUPS_ADDR_ALL CONFIG_GROUPS_BASE_ADDR
+
+/** Group address the LEDs of a team are subscribed to. */
+#define GROUPS_ADDR_TEAM(_team) (CONFIG_GROUPS_BASE_ADDR + 1 + (_team))
+
+/** Group subscriptions applied on a robot. */
+struct groups_status {
+    /* Team group the robot is subscribed to, or GROUPS_TEAM_NONE */
+    uint8_t team;
+    /* Light and movement models subscribed to the all robots group */
+    uint8_t all;
+} __packed;
+
+/** @brief Handler for applied group subscriptions.
+ *
+ * @param[in] addr Address of the robot.
+ * @param[in] status Subscriptions applied on the robot.
+ */
+typedef void (*groups_status_cb)(uint16_t addr, const struct groups_status *status);
+
+/** @brief Set the handler for applied group subscriptions.
+ *
+ * @param[in] cb Handler, called from the configuration work queue.
+ */
+void groups_init(groups_status_cb cb);
+
+/** @brief Subscribe the light and movement models of a robot to the all
+ *         robots group.
+ *
+ * @param[in] addr Address of the robot.
+ */
+void groups_robot_join(uint16_t addr);
+
+/** @brief Move the light model of a robot to the group of a team.
+ *
+ * @param[in] addr Address of the robot.
+ * @param[in] team Team, or GROUPS_TEAM_NONE to leave the current team.
+ *
+ * @retval 0 The change is scheduled.
+ * @retval -EINVAL The team is out of range.
+ * @retval -ENOMEM No room for the robot.
+ */
+int groups_team_set(uint16_t addr, uint8_t team);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GROUPS_H__ */
@@ -18,8 +18,15 @@ LOG_MODULE_REGISTER(MODULE, CONFIG_APPLICATION_MODULE_LOG_LEVEL);
 
 #include "uart_handler.h"
 #include "model_handler.h"
+#include "groups.h"
+#include "provisioner.h"
 
+/* UART to the nRF9160, or a device chosen to stand in for it. */
+#if DT_HAS_CHOSEN(nordic_bridge_uart)
+static const struct device *uart = DEVICE_DT_GET(DT_CHOSEN(nordic_bridge_uart));
+#else
 static const struct device *uart = DEVICE_DT_GET(DT_NODELABEL(uart1));
+#endif
 
 static void mesh_rx(uint8_t *data, uint8_t len, uint32_t type, uint16_t model_id, uint16_t addr)
 {
@@ -32,11 +39,37 @@ struct model_handlers mesh_handlers = {
 	.rx = mesh_rx,
 };
 
+static void groups_status(uint16_t addr, const struct groups_status *status)
+{
+	uart_send(uart, (uint8_t *)status, sizeof(*status),
+		  BRIDGE_CTRL_OP_GROUPS_STATUS, BRIDGE_CTRL_ID, addr);
+}
+
+/* Bridge control messages from the gateway. */
+static void ctrl_rx(uint8_t *data, uint8_t len, uint32_t type, uint16_t addr)
+{
+	int err;
+
+	if (type == BRIDGE_CTRL_OP_TEAM_SET && len == 1) {
+		err = groups_team_set(addr, data[0]);
+		if (err) {
+			LOG_WRN("Failed to set team %d on addr %x: Error %d", data[0], addr, err);
+		}
+		return;
+	}
+
+	LOG_WRN("Unknown bridge control message %x, len %d", type, len);
+}
+
 
 static void uart_rx(const struct device *dev, uint8_t *data, uint8_t len, uint32_t type, uint16_t id, uint16_t addr)
 {
 	LOG_INF("Received uart message, type: %x, len: %x, id: %x",  type, len, id);
 	LOG_HEXDUMP_INF(data, len, "message:");
+	if (id == BRIDGE_CTRL_ID) {
+		ctrl_rx(data, len, type, addr);
+		return;
+	}
 	mesh_tx(data, len, type, id, addr);
 
 }
@@ -62,7 +95,9 @@ static int setup_mesh()
 		return err;
 	}
 	LOG_DBG("Bluetooth initialized");
-	err = bt_mesh_init(bt_mesh_dk_prov_init(), model_handler_init(&mesh_handlers));
+	err = bt_mesh_init(IS_ENABLED(CONFIG_BRIDGE_PROVISIONER) ?
+			   provisioner_init() : bt_mesh_dk_prov_init(),
+			   model_handler_init(&mesh_handlers));
 	if (err)
 	{
 		LOG_ERR("Failed to initialize mesh: Error %d", err);
@@ -78,6 +113,16 @@ static int setup_mesh()
 		}
 	}
 
+	if (IS_ENABLED(CONFIG_BRIDGE_PROVISIONER))
+	{
+		err = provisioner_start();
+		if (err != -EALREADY)
+		{
+			return err;
+		}
+		LOG_WRN("Provisioned by another provisioner, not provisioning robots");
+	}
+
 	err = bt_mesh_prov_enable(BT_MESH_PROV_ADV | BT_MESH_PROV_GATT);
 	if (err == -EALREADY)
 	{
@@ -98,6 +143,8 @@ void main(void)
 		return;
 	}
 
+	groups_init(groups_status);
+
 	err = init_uart(uart, &uart_handlers);
 	if (err)
 	{
@@ -4,6 +4,8 @@
 
 
 #include "model_handler.h"
+#include "topology.h"
+#include "groups.h"
 #include <zephyr/logging/log.h>
 LOG_MODULE_REGISTER(model_handler);
 
@@ -31,7 +33,7 @@ static struct bt_mesh_health_srv health_srv = {
 
 BT_MESH_HEALTH_PUB_DEFINE(health_pub, 0);
 
-
+static struct bt_mesh_cfg_cli cfg_cli;
 
 
 void app_handle_rx(void *data, size_t len, uint32_t opcode, uint16_t model_id, uint16_t addr)
@@ -45,21 +47,43 @@ void app_handle_rx(void *data, size_t len, uint32_t opcode, uint16_t model_id, u
 
 void handle_robot_id(struct bt_mesh_robot_cli *cli, struct bt_mesh_id_status id, struct bt_mesh_msg_ctx *ctx) 
 {    
+    topology_record(ctx);
+    groups_robot_join(ctx->addr);
 	LOG_HEXDUMP_INF(id.id, CONFIG_BT_MESH_ID_LEN, "Id detected:");
-    app_handle_rx(&id, sizeof(struct bt_mesh_id_status), BT_MESH_ID_OP_STATUS, ID_CLI_MODEL_ID, ctx->addr);
+    app_handle_rx(id.id, sizeof(id.id), BT_MESH_ID_OP_STATUS, ID_CLI_MODEL_ID, ctx->addr);
 }
 
-void handle_robot_movement_configured(struct bt_mesh_robot_cli *cli, struct bt_mesh_msg_ctx *ctx) 
+void handle_robot_movement_configured(struct bt_mesh_robot_cli *cli, struct bt_mesh_msg_ctx *ctx,
+                                      uint8_t round) 
 {    
-	LOG_INF("movement configured on addr %x", ctx->addr);
-    uint8_t ack = 0;
-    app_handle_rx(&ack, sizeof(uint8_t), BT_MESH_MOVEMENT_OP_MOVEMENT_ACK, MOVEMENT_CLI_MODEL_ID, ctx->addr);
+    topology_record(ctx);
+	LOG_INF("movement configured on addr %x, round %d", ctx->addr, round);
+    app_handle_rx(&round, sizeof(round), BT_MESH_MOVEMENT_OP_MOVEMENT_ACK, MOVEMENT_CLI_MODEL_ID, ctx->addr);
 }
 
-void handle_robot_telemetry_reported(struct bt_mesh_robot_cli *cli, struct bt_mesh_telemetry_report report, struct bt_mesh_msg_ctx *ctx) 
+void handle_robot_telemetry_reported(struct bt_mesh_robot_cli *cli, struct bt_mesh_telemetry_report report,
+                                     const struct bt_mesh_telemetry_power *power, struct bt_mesh_msg_ctx *ctx) 
 {    
+    uint8_t payload[BT_MESH_TELEMETRY_REPORT_LEN + BT_MESH_TELEMETRY_POWER_LEN];
+    size_t len;
+
+    topology_record(ctx);
 	LOG_INF("telemetry reported from addr %x", ctx->addr);
-    app_handle_rx(&report, sizeof(struct bt_mesh_telemetry_report), BT_MESH_TELEMETRY_OP_TELEMETRY_REPORT, TELEMETRY_CLI_MODEL_ID, ctx->addr);
+    len = bt_mesh_telemetry_report_encode(&report, payload);
+    if (power) {
+        len += bt_mesh_telemetry_power_encode(power, &payload[len]);
+    }
+    app_handle_rx(payload, len, BT_MESH_TELEMETRY_OP_TELEMETRY_REPORT, TELEMETRY_CLI_MODEL_ID, ctx->addr);
+}
+
+void handle_robot_calibrated(struct bt_mesh_robot_cli *cli, struct bt_mesh_calibration_status status, struct bt_mesh_msg_ctx *ctx) 
+{    
+    uint8_t payload[BT_MESH_CALIBRATION_STATUS_LEN];
+
+    topology_record(ctx);
+	LOG_INF("calibration done on addr %x, err %d", ctx->addr, status.err);
+    bt_mesh_calibration_status_encode(&status, payload);
+    app_handle_rx(payload, sizeof(payload), BT_MESH_MOVEMENT_OP_CALIBRATION_STATUS, MOVEMENT_CLI_MODEL_ID, ctx->addr);
 }
 
 /* Vendor models */
@@ -67,6 +91,7 @@ static const struct bt_mesh_robot_cli_handlers robot_cb = {
 	.id = handle_robot_id,
     .movement_configured = handle_robot_movement_configured,
     .telemetry_reported = handle_robot_telemetry_reported,
+    .calibrated = handle_robot_calibrated,
 };
 
 struct bt_mesh_robot_cli robot = BT_MESH_ROBOT_CLI_INIT(&robot_cb);
@@ -79,6 +104,7 @@ static struct bt_mesh_elem elements[] = {
 		0,
         BT_MESH_MODEL_LIST(
             BT_MESH_MODEL_CFG_SRV,
+            BT_MESH_MODEL_CFG_CLI(&cfg_cli),
             BT_MESH_MODEL_HEALTH_SRV(&health_srv, &health_pub)
         ),
         BT_MESH_MODEL_LIST( 
@@ -102,76 +128,37 @@ const struct bt_mesh_comp *model_handler_init(struct model_handlers *handlers)
 
 int mesh_tx(uint8_t *data, uint8_t len, uint32_t type, uint16_t model_id, uint16_t addr)
 {
-    switch (model_id)
-	{
-	case MOVEMENT_CLI_MODEL_ID:
-	{
-		if (type == BT_MESH_MOVEMENT_OP_MOVEMENT_SET) {
-            struct bt_mesh_movement_set set;
-
-            struct bt_mesh_msg_ctx ctx = {
-                .addr = addr,
-                .app_idx = robot.model->keys[0],
-                .send_ttl = BT_MESH_TTL_DEFAULT
-            };
-
-            uint8_t *set_ptr = (uint8_t*)&set;
-	        memcpy(set_ptr, data, sizeof(uint32_t));
-
-            set_ptr = set_ptr + sizeof(uint32_t);
-            data = data +  sizeof(uint32_t);
-            memcpy(set_ptr, data, sizeof(uint32_t));
-
-            set_ptr = set_ptr + sizeof(uint32_t);
-            data = data +  sizeof(uint32_t);
-            memcpy(set_ptr, data, sizeof(uint8_t));
-
-            
-            bt_mesh_robot_cli_movement_set(&robot, &ctx, set);
-		}
-        else if (type == BT_MESH_MOVEMENT_OP_READY_SET) {
-
-            struct bt_mesh_msg_ctx ctx = {
-                .addr = 0xFFFF,
-                .app_idx = robot.model->keys[0],
-                .send_ttl = BT_MESH_TTL_DEFAULT
-            };
-
-            bt_mesh_robot_cli_ready_set(&robot, &ctx);
-		}
-	} break;
-	case LIGHT_RGB_CLI_MODEL_ID:
-    {
-        if (type == BT_MESH_LIGHT_RGB_OP_RGB_SET) {
-            struct bt_mesh_light_rgb_set set;
-
-            struct bt_mesh_msg_ctx ctx = {
-                .addr = addr,
-                .app_idx = light_rgb.model->keys[0],
-                .send_ttl = BT_MESH_TTL_DEFAULT
-            };
-
-            uint8_t *set_ptr = (uint8_t*)&set;
-	        memcpy(set_ptr, data, sizeof(uint16_t));
-
-            set_ptr = set_ptr + sizeof(uint16_t);
-            data = data +  sizeof(uint16_t);
-            memcpy(set_ptr, data, sizeof(uint8_t));
-
-            set_ptr = set_ptr + sizeof(uint8_t);
-            data = data +  sizeof(uint8_t);
-            memcpy(set_ptr, data, sizeof(uint8_t));
-            
-            set_ptr = set_ptr + sizeof(uint8_t);
-            data = data +  sizeof(uint8_t);
-            memcpy(set_ptr, data, sizeof(uint8_t));
-
-            bt_mesh_light_rgb_cli_rgb_set(&light_rgb, &ctx, set);
-		}
-    } break;
-   
-	default:
-		break;
-	}
-    return 0;
-}
\ No newline at end of file
+    struct bt_mesh_model *model;
+    int err;
+
+    /* The payload is already serialised in the access layer format by the
+     * sender, so it is passed on unchanged by the model it belongs to.
+     */
+    model = bt_mesh_model_find_vnd(&elements[0], CONFIG_BT_COMPANY_ID, model_id);
+    if (model == NULL) {
+        LOG_WRN("No vendor model %x for opcode %x", model_id, type);
+        return -ENOENT;
+    }
+
+    if (BT_MESH_MODEL_OP_LEN(type) + len + BT_MESH_MIC_SHORT > BT_MESH_TX_SDU_MAX) {
+        LOG_ERR("Payload of opcode %x too long: %d", type, len);
+        return -EMSGSIZE;
+    }
+
+    NET_BUF_SIMPLE_DEFINE(buf, BT_MESH_TX_SDU_MAX);
+    bt_mesh_model_msg_init(&buf, type);
+    net_buf_simple_add_mem(&buf, data, len);
+
+    struct bt_mesh_msg_ctx ctx = {
+        .addr = addr,
+        .app_idx = model->keys[0],
+        .send_ttl = BT_MESH_ADDR_IS_UNICAST(addr) ? topology_ttl(addr) : topology_ttl_all(),
+    };
+
+    err = bt_mesh_model_send(model, &ctx, &buf, NULL, NULL);
+    if (err) {
+        LOG_ERR("Failed to send opcode %x to addr %x: Error %d", type, addr, err);
+    }
+
+    return err;
+}
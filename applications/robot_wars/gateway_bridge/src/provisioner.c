@@ -0,0 +1,453 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <string.h>
+#include <zephyr/drivers/hwinfo.h>
+#include <zephyr/bluetooth/crypto.h>
+#include <zephyr/bluetooth/mesh.h>
+#include "bluetooth/mesh/vnd/robot_cli.h"
+#include "bluetooth/mesh/vnd/robot_srv.h"
+#include "bluetooth/mesh/vnd/light_rgb_cli.h"
+#include "bluetooth/mesh/vnd/light_rgb_srv.h"
+
+#include "provisioner.h"
+#include "topology.h"
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(provisioner, CONFIG_PROVISIONER_LOG_LEVEL);
+
+/* Primary subnet and the application key used by every robot. */
+#define PROVISIONER_NET_IDX 0
+#define PROVISIONER_APP_IDX 0
+
+/* Beacons of a node that was just added may still be in flight. */
+#define PROVISIONER_ADDED_GUARD_MS 10000
+
+/* Vendor models bound on the bridge, and on every element of the robots. */
+static const uint16_t bridge_models[] = {
+    ID_CLI_MODEL_ID,
+    MOVEMENT_CLI_MODEL_ID,
+    TELEMETRY_CLI_MODEL_ID,
+    ROBOT_CLI_MODEL_ID,
+    LIGHT_RGB_CLI_MODEL_ID,
+};
+
+static const uint16_t robot_models[] = {
+    ID_SRV_MODEL_ID,
+    MOVEMENT_SRV_MODEL_ID,
+    TELEMETRY_SRV_MODEL_ID,
+    ROBOT_SRV_MODEL_ID,
+    LIGHT_RGB_SRV_MODEL_ID,
+};
+
+static uint8_t dev_uuid[16];
+
+/* Unprovisioned devices waiting for the provisioning link. */
+static uint8_t beacon_queue[CONFIG_BRIDGE_PROVISIONER_QUEUE_SIZE][16];
+static size_t beacon_count;
+static bool link_busy;
+static uint8_t link_uuid[16];
+static uint8_t added_uuid[16];
+static int64_t added_time;
+static struct k_spinlock lock;
+
+/* Address of the last node configuration was attempted on. */
+static uint16_t cfg_cursor;
+static bool cfg_failed;
+
+static void prov_work_fn(struct k_work *work);
+K_WORK_DEFINE(prov_work, prov_work_fn);
+
+static void cfg_work_fn(struct k_work *work);
+K_WORK_DELAYABLE_DEFINE(cfg_work, cfg_work_fn);
+
+static bool beacon_is_queued(const uint8_t uuid[16])
+{
+    for (size_t i = 0; i < beacon_count; i++) {
+        if (!memcmp(beacon_queue[i], uuid, 16)) {
+            return true;
+        }
+    }
+    return (link_busy && !memcmp(link_uuid, uuid, 16));
+}
+
+static uint8_t node_find_uuid_cb(struct bt_mesh_cdb_node *node, void *user_data)
+{
+    struct bt_mesh_cdb_node **found = user_data;
+
+    if (!memcmp(node->uuid, (*found)->uuid, 16)) {
+        *found = node;
+        return BT_MESH_CDB_ITER_STOP;
+    }
+    return BT_MESH_CDB_ITER_CONTINUE;
+}
+
+static struct bt_mesh_cdb_node *node_find_uuid(const uint8_t uuid[16])
+{
+    struct bt_mesh_cdb_node key;
+    struct bt_mesh_cdb_node *found = &key;
+
+    memcpy(key.uuid, uuid, 16);
+    bt_mesh_cdb_node_foreach(node_find_uuid_cb, &found);
+
+    return (found == &key) ? NULL : found;
+}
+
+/* Opens a provisioning link to the next queued device. PB-ADV has a single
+ * link, so devices are provisioned back to back, and configured on the
+ * configuration work queue while the next one is provisioned.
+ */
+static void prov_work_fn(struct k_work *work)
+{
+    struct bt_mesh_cdb_node *node;
+    k_spinlock_key_t key;
+    uint8_t uuid[16];
+    int err;
+
+    key = k_spin_lock(&lock);
+    if (link_busy || beacon_count == 0) {
+        k_spin_unlock(&lock, key);
+        return;
+    }
+    memcpy(uuid, beacon_queue[0], 16);
+    beacon_count--;
+    memmove(beacon_queue[0], beacon_queue[1], beacon_count * 16);
+
+    if (!memcmp(uuid, added_uuid, 16) &&
+        k_uptime_get() - added_time < PROVISIONER_ADDED_GUARD_MS) {
+        k_spin_unlock(&lock, key);
+        k_work_submit(&prov_work);
+        return;
+    }
+
+    link_busy = true;
+    memcpy(link_uuid, uuid, 16);
+    k_spin_unlock(&lock, key);
+
+    /* A known device sending beacons has been reset. */
+    node = node_find_uuid(uuid);
+    if (node) {
+        LOG_INF("Addr %x was reset, provisioning it again", node->addr);
+        bt_mesh_cdb_node_del(node, true);
+    }
+
+    err = bt_mesh_provision_adv(uuid, PROVISIONER_NET_IDX, 0, 0);
+    if (err) {
+        LOG_WRN("Failed to open provisioning link: Error %d", err);
+        key = k_spin_lock(&lock);
+        link_busy = false;
+        k_spin_unlock(&lock, key);
+        k_work_submit(&prov_work);
+    }
+}
+
+static void unprovisioned_beacon(uint8_t uuid[16], bt_mesh_prov_oob_info_t oob_info,
+                 uint32_t *uri_hash)
+{
+    k_spinlock_key_t key;
+
+    key = k_spin_lock(&lock);
+    if (beacon_is_queued(uuid) || beacon_count == ARRAY_SIZE(beacon_queue)) {
+        k_spin_unlock(&lock, key);
+        return;
+    }
+    memcpy(beacon_queue[beacon_count++], uuid, 16);
+    k_spin_unlock(&lock, key);
+
+    LOG_HEXDUMP_DBG(uuid, 16, "Unprovisioned beacon:");
+    k_work_submit(&prov_work);
+}
+
+static void node_added(uint16_t net_idx, uint8_t uuid[16], uint16_t addr, uint8_t num_elem)
+{
+    k_spinlock_key_t key;
+
+    LOG_INF("Provisioned addr %x with %d elements", addr, num_elem);
+
+    key = k_spin_lock(&lock);
+    memcpy(added_uuid, uuid, 16);
+    added_time = k_uptime_get();
+    k_spin_unlock(&lock, key);
+
+    k_work_reschedule_for_queue(topology_cfg_work_q(), &cfg_work, K_NO_WAIT);
+}
+
+static void link_close(bt_mesh_prov_bearer_t bearer)
+{
+    k_spinlock_key_t key;
+
+    if (bearer != BT_MESH_PROV_ADV) {
+        return;
+    }
+
+    key = k_spin_lock(&lock);
+    link_busy = false;
+    k_spin_unlock(&lock, key);
+
+    k_work_submit(&prov_work);
+}
+
+static const struct bt_mesh_prov prov = {
+    .uuid = dev_uuid,
+    .unprovisioned_beacon = unprovisioned_beacon,
+    .node_added = node_added,
+    .link_close = link_close,
+};
+
+static int app_key_add(uint16_t addr)
+{
+    struct bt_mesh_cdb_app_key *app_key;
+    uint8_t status;
+    int err;
+
+    app_key = bt_mesh_cdb_app_key_get(PROVISIONER_APP_IDX);
+    if (!app_key) {
+        return -ENOENT;
+    }
+
+    err = bt_mesh_cfg_app_key_add(PROVISIONER_NET_IDX, addr, PROVISIONER_NET_IDX,
+                      PROVISIONER_APP_IDX, app_key->keys[0].app_key, &status);
+    if (!err && status) {
+        LOG_WRN("App key add on addr %x failed with status %x", addr, status);
+        err = -EIO;
+    }
+    return err;
+}
+
+static int models_bind(uint16_t addr, uint16_t elem_addr, const uint16_t *models, size_t count)
+{
+    uint8_t status;
+    int err;
+
+    for (size_t i = 0; i < count; i++) {
+        err = bt_mesh_cfg_mod_app_bind_vnd(PROVISIONER_NET_IDX, addr, elem_addr,
+                           PROVISIONER_APP_IDX, models[i],
+                           CONFIG_BT_COMPANY_ID, &status);
+        if (!err && status) {
+            LOG_WRN("Bind of model %x on addr %x failed with status %x",
+                models[i], elem_addr, status);
+            err = -EIO;
+        }
+        if (err) {
+            return err;
+        }
+    }
+    return 0;
+}
+
+static int model_pub_set(uint16_t addr, uint16_t elem_addr, uint16_t model, uint8_t period)
+{
+    struct bt_mesh_cfg_mod_pub pub = {
+        .addr = CONFIG_BRIDGE_PROVISIONER_ADDR,
+        .app_idx = PROVISIONER_APP_IDX,
+        /* Hop counts are measured from the TTL the robots send with. */
+        .ttl = CONFIG_TOPOLOGY_ROBOT_TTL,
+        .period = period,
+    };
+    uint8_t status;
+    int err;
+
+    err = bt_mesh_cfg_mod_pub_set_vnd(PROVISIONER_NET_IDX, addr, elem_addr, model,
+                      CONFIG_BT_COMPANY_ID, &pub, &status);
+    if (!err && status) {
+        LOG_WRN("Publication of model %x on addr %x failed with status %x",
+            model, elem_addr, status);
+        err = -EIO;
+    }
+    return err;
+}
+
+static int configure_bridge(uint16_t addr)
+{
+    int err;
+
+    err = app_key_add(addr);
+    if (err) {
+        return err;
+    }
+
+    return models_bind(addr, addr, bridge_models, ARRAY_SIZE(bridge_models));
+}
+
+/* Every element of a robot is one robot body. The id and telemetry servers
+ * publish to the bridge, the light and movement server subscriptions are
+ * managed by the groups once the robot has identified itself.
+ */
+static int configure_robot(uint16_t addr, uint8_t num_elem)
+{
+    int err;
+
+    err = app_key_add(addr);
+    if (err) {
+        return err;
+    }
+
+    for (uint8_t i = 0; i < num_elem; i++) {
+        uint16_t elem_addr = addr + i;
+
+        err = models_bind(addr, elem_addr, robot_models, ARRAY_SIZE(robot_models));
+        if (err) {
+            return err;
+        }
+
+        err = model_pub_set(addr, elem_addr, TELEMETRY_SRV_MODEL_ID, 0);
+        if (err) {
+            return err;
+        }
+
+        err = model_pub_set(addr, elem_addr, ID_SRV_MODEL_ID,
+                    BT_MESH_PUB_PERIOD_SEC(CONFIG_BRIDGE_PROVISIONER_ID_PUB_PERIOD_SEC));
+        if (err) {
+            return err;
+        }
+    }
+    return 0;
+}
+
+struct node_next {
+    uint16_t after;
+    struct bt_mesh_cdb_node *node;
+};
+
+static uint8_t node_next_cb(struct bt_mesh_cdb_node *node, void *user_data)
+{
+    struct node_next *next = user_data;
+
+    if (!atomic_test_bit(node->flags, BT_MESH_CDB_NODE_CONFIGURED) &&
+        node->addr > next->after &&
+        (!next->node || node->addr < next->node->addr)) {
+        next->node = node;
+    }
+    return BT_MESH_CDB_ITER_CONTINUE;
+}
+
+/* Returns the unconfigured node with the lowest address above after. */
+static struct bt_mesh_cdb_node *node_next_unconfigured(uint16_t after)
+{
+    struct node_next next = {
+        .after = after,
+    };
+
+    bt_mesh_cdb_node_foreach(node_next_cb, &next);
+    return next.node;
+}
+
+/* Configures one node per run, going through the nodes in address order so
+ * that a node out of range does not hold back the others. Failed nodes are
+ * retried once every node has been tried.
+ */
+static void cfg_work_fn(struct k_work *work)
+{
+    struct bt_mesh_cdb_node *node;
+    uint8_t num_elem;
+    uint16_t addr;
+    int err;
+
+    node = node_next_unconfigured(cfg_cursor);
+    if (!node) {
+        cfg_cursor = 0;
+        if (cfg_failed) {
+            cfg_failed = false;
+            k_work_reschedule_for_queue(topology_cfg_work_q(), &cfg_work,
+                K_SECONDS(CONFIG_BRIDGE_PROVISIONER_RETRY_SEC));
+            return;
+        }
+
+        node = node_next_unconfigured(0);
+        if (!node) {
+            return;
+        }
+    }
+
+    addr = node->addr;
+    num_elem = node->num_elem;
+    cfg_cursor = addr;
+
+    if (addr == CONFIG_BRIDGE_PROVISIONER_ADDR) {
+        err = configure_bridge(addr);
+    } else {
+        err = configure_robot(addr, num_elem);
+    }
+
+    if (err) {
+        LOG_WRN("Failed to configure addr %x: Error %d", addr, err);
+        cfg_failed = true;
+    } else {
+        node = bt_mesh_cdb_node_get(addr);
+        if (node) {
+            atomic_set_bit(node->flags, BT_MESH_CDB_NODE_CONFIGURED);
+            if (IS_ENABLED(CONFIG_BT_SETTINGS)) {
+                bt_mesh_cdb_node_store(node);
+            }
+        }
+        LOG_INF("Configured addr %x", addr);
+    }
+
+    k_work_reschedule_for_queue(topology_cfg_work_q(), &cfg_work, K_NO_WAIT);
+}
+
+const struct bt_mesh_prov *provisioner_init(void)
+{
+    ssize_t len;
+
+    len = hwinfo_get_device_id(dev_uuid, sizeof(dev_uuid));
+    if (len <= 0) {
+        LOG_WRN("No device id, using a random UUID");
+        bt_rand(dev_uuid, sizeof(dev_uuid));
+    }
+
+    return &prov;
+}
+
+int provisioner_start(void)
+{
+    struct bt_mesh_cdb_app_key *app_key;
+    struct bt_mesh_cdb_subnet *subnet;
+    uint8_t net_key[16];
+    uint8_t dev_key[16];
+    int err;
+
+    if (bt_mesh_is_provisioned() &&
+        !atomic_test_bit(bt_mesh_cdb.flags, BT_MESH_CDB_VALID)) {
+        return -EALREADY;
+    }
+
+    bt_rand(net_key, sizeof(net_key));
+    err = bt_mesh_cdb_create(net_key);
+    if (err == -EALREADY) {
+        LOG_INF("Using stored network");
+    } else if (err) {
+        LOG_ERR("Failed to create network: Error %d", err);
+        return err;
+    } else {
+        app_key = bt_mesh_cdb_app_key_alloc(PROVISIONER_NET_IDX, PROVISIONER_APP_IDX);
+        if (!app_key) {
+            return -ENOMEM;
+        }
+        bt_rand(app_key->keys[0].app_key, sizeof(app_key->keys[0].app_key));
+        if (IS_ENABLED(CONFIG_BT_SETTINGS)) {
+            bt_mesh_cdb_app_key_store(app_key);
+        }
+        LOG_INF("Created network");
+    }
+
+    subnet = bt_mesh_cdb_subnet_get(PROVISIONER_NET_IDX);
+    if (!subnet) {
+        return -ENOENT;
+    }
+
+    bt_rand(dev_key, sizeof(dev_key));
+    err = bt_mesh_provision(subnet->keys[0].net_key, PROVISIONER_NET_IDX, 0, 0,
+                CONFIG_BRIDGE_PROVISIONER_ADDR, dev_key);
+    if (err && err != -EALREADY) {
+        LOG_ERR("Failed to provision the bridge: Error %d", err);
+        return err;
+    }
+
+    /* Finish configuration interrupted by a restart. */
+    k_work_reschedule_for_queue(topology_cfg_work_q(), &cfg_work, K_NO_WAIT);
+
+    return 0;
+}
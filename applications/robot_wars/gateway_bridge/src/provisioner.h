@@ -0,0 +1,40 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+
+#ifndef PROVISIONER_H__
+#define PROVISIONER_H__
+
+#include <zephyr/bluetooth/mesh.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Get the provisioning properties of the bridge.
+ *
+ * @retval Provisioning properties to initialize the mesh stack with.
+ */
+const struct bt_mesh_prov *provisioner_init(void);
+
+/** @brief Provision the bridge into its own network and start provisioning
+ *         and configuring robots.
+ *
+ * Must be called after the settings are loaded. A network and application
+ * key are created on first start, and kept in the configuration database.
+ *
+ * @retval 0 The provisioner is running.
+ * @retval -EALREADY The bridge was provisioned by another provisioner, and
+ *         provisioning of robots is left to it.
+ * @retval Other negative error code from the mesh stack.
+ */
+int provisioner_start(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PROVISIONER_H__ */
@@ -0,0 +1,343 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/init.h>
+#include <zephyr/bluetooth/mesh.h>
+
+#include "topology.h"
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(topology, CONFIG_TOPOLOGY_LOG_LEVEL);
+
+/* Primary subnet, the only one used by the robots. */
+#define TOPOLOGY_NET_IDX 0
+
+/* Relay retransmit parameters pushed together with the relay state. */
+#define TOPOLOGY_RELAY_TRANSMIT BT_MESH_TRANSMIT(2, 20)
+
+struct topology_node {
+    uint16_t addr;
+    /* Number of relays between the node and the bridge */
+    uint8_t hops;
+    int8_t rssi;
+    bool relay_wanted;
+    bool relay_applied;
+    bool relay_known;
+    /* Disabling the relay cut other nodes off from the bridge */
+    bool relay_required;
+};
+
+static struct topology_node nodes[CONFIG_TOPOLOGY_MAX_NODES];
+static size_t node_count;
+/* Node the search for pending relay changes starts at, moved past nodes
+ * that fail so that they do not hold back the others.
+ */
+static size_t relay_cursor;
+static struct k_spinlock lock;
+
+static K_THREAD_STACK_DEFINE(topology_stack, CONFIG_TOPOLOGY_THREAD_STACK_SIZE);
+static struct k_work_q topology_work_q;
+
+static void relay_update_work_fn(struct k_work *work);
+K_WORK_DELAYABLE_DEFINE(relay_update_work, relay_update_work_fn);
+
+static struct topology_node *node_find(uint16_t addr)
+{
+    for (size_t i = 0; i < node_count; i++) {
+        if (nodes[i].addr == addr) {
+            return &nodes[i];
+        }
+    }
+    return NULL;
+}
+
+static uint8_t hops_to_ttl(uint8_t hops)
+{
+    /* TTL 0 is never relayed, and TTL 1 is not allowed for sending. */
+    if (hops == 0 && CONFIG_TOPOLOGY_TTL_MARGIN == 0) {
+        return 0;
+    }
+
+    return MIN(MAX(hops + 1 + CONFIG_TOPOLOGY_TTL_MARGIN, 2), BT_MESH_TTL_MAX);
+}
+
+/* Pick the relays needed to reach every measured node. Nodes heard directly
+ * need no relay. If some nodes are further away, the strongest direct
+ * neighbours and every node short of the furthest hop count keep relaying,
+ * as do the nodes that turned out to be on the path of another node.
+ * Everything else stops relaying.
+ */
+static void relay_set_compute(void)
+{
+    uint8_t max_hops = 0;
+
+    for (size_t i = 0; i < node_count; i++) {
+        max_hops = MAX(max_hops, nodes[i].hops);
+        nodes[i].relay_wanted = nodes[i].relay_required;
+    }
+
+    if (max_hops == 0) {
+        return;
+    }
+
+    for (size_t i = 0; i < node_count; i++) {
+        if (nodes[i].hops > 0 && nodes[i].hops < max_hops) {
+            nodes[i].relay_wanted = true;
+        }
+    }
+
+    for (int n = 0; n < CONFIG_TOPOLOGY_DIRECT_RELAY_COUNT; n++) {
+        struct topology_node *best = NULL;
+
+        for (size_t i = 0; i < node_count; i++) {
+            if (nodes[i].hops != 0 || nodes[i].relay_wanted) {
+                continue;
+            }
+            if (!best || nodes[i].rssi > best->rssi) {
+                best = &nodes[i];
+            }
+        }
+
+        if (!best) {
+            break;
+        }
+        best->relay_wanted = true;
+    }
+}
+
+/* Returns the next node whose relay state must change. Nodes that must
+ * start relaying are handled first so that no node loses its path.
+ */
+static struct topology_node *relay_next_pending(void)
+{
+    for (int enable = 1; enable >= 0; enable--) {
+        for (size_t n = 0; n < node_count; n++) {
+            size_t i = (relay_cursor + n) % node_count;
+
+            if (nodes[i].relay_wanted == enable &&
+                (!nodes[i].relay_known ||
+                 nodes[i].relay_applied != nodes[i].relay_wanted)) {
+                return &nodes[i];
+            }
+        }
+    }
+    return NULL;
+}
+
+/* Configuration messages are encrypted with the device key of the robot,
+ * so this only succeeds for robots known to this node.
+ */
+static int relay_set(uint16_t addr, bool relay, bool *applied)
+{
+    uint8_t status;
+    uint8_t transmit;
+    int err;
+
+    err = bt_mesh_cfg_relay_set(TOPOLOGY_NET_IDX, addr,
+                    relay ? BT_MESH_RELAY_ENABLED : BT_MESH_RELAY_DISABLED,
+                    TOPOLOGY_RELAY_TRANSMIT, &status, &transmit);
+    if (err) {
+        LOG_WRN("Failed to %s relay on addr %x: Error %d",
+            relay ? "enable" : "disable", addr, err);
+        return err;
+    }
+
+    LOG_INF("Relay %s on addr %x", relay ? "enabled" : "disabled", addr);
+    *applied = (status == BT_MESH_RELAY_ENABLED);
+    return 0;
+}
+
+/* Checks that every node out of direct range still answers after the relay
+ * of addr was disabled. Only nodes whose relay state was configured are
+ * checked, the others do not answer configuration requests at all.
+ */
+static bool paths_confirm(uint16_t addr)
+{
+    uint16_t far[CONFIG_TOPOLOGY_MAX_NODES];
+    size_t far_count = 0;
+    k_spinlock_key_t key;
+    uint8_t status;
+    uint8_t transmit;
+    int err;
+
+    key = k_spin_lock(&lock);
+    for (size_t i = 0; i < node_count; i++) {
+        if (nodes[i].addr != addr && nodes[i].hops > 0 && nodes[i].relay_known) {
+            far[far_count++] = nodes[i].addr;
+        }
+    }
+    k_spin_unlock(&lock, key);
+
+    for (size_t i = 0; i < far_count; i++) {
+        err = bt_mesh_cfg_relay_get(TOPOLOGY_NET_IDX, far[i], &status, &transmit);
+        if (err) {
+            LOG_WRN("Addr %x unreachable without relay %x: Error %d", far[i], addr, err);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void relay_update_work_fn(struct k_work *work)
+{
+    struct topology_node *node;
+    k_spinlock_key_t key;
+    uint16_t addr;
+    bool relay;
+    bool applied;
+    bool required = false;
+    int err;
+
+    key = k_spin_lock(&lock);
+    node = relay_next_pending();
+    if (!node) {
+        k_spin_unlock(&lock, key);
+        return;
+    }
+    addr = node->addr;
+    relay = node->relay_wanted;
+    k_spin_unlock(&lock, key);
+
+    err = relay_set(addr, relay, &applied);
+
+    /* A node only stops relaying once the nodes beyond direct range have
+     * been confirmed to be reachable without it.
+     */
+    if (!err && !relay && !applied && !paths_confirm(addr)) {
+        required = true;
+        err = relay_set(addr, true, &applied);
+    }
+
+    key = k_spin_lock(&lock);
+    node = node_find(addr);
+    if (node) {
+        if (required) {
+            node->relay_required = true;
+            node->relay_wanted = true;
+        }
+
+        if (err) {
+            /* Retried after the other pending nodes. */
+            node->relay_known = false;
+            relay_cursor = (node - nodes) + 1;
+        } else {
+            node->relay_known = true;
+            node->relay_applied = applied;
+            if (node->relay_applied != node->relay_wanted) {
+                /* Not supported by the node, leave it as is. */
+                node->relay_wanted = node->relay_applied;
+            }
+        }
+    }
+    k_spin_unlock(&lock, key);
+
+    k_work_reschedule_for_queue(&topology_work_q, &relay_update_work,
+        err ? K_MSEC(CONFIG_TOPOLOGY_RETRY_MS) : K_NO_WAIT);
+}
+
+void topology_record(const struct bt_mesh_msg_ctx *ctx)
+{
+    struct topology_node *node;
+    k_spinlock_key_t key;
+    uint8_t hops;
+
+    if (!BT_MESH_ADDR_IS_UNICAST(ctx->addr)) {
+        return;
+    }
+
+    if (ctx->recv_ttl > CONFIG_TOPOLOGY_ROBOT_TTL) {
+        LOG_WRN("Addr %x sends with TTL above %d", ctx->addr, CONFIG_TOPOLOGY_ROBOT_TTL);
+        hops = 0;
+    } else {
+        hops = CONFIG_TOPOLOGY_ROBOT_TTL - ctx->recv_ttl;
+    }
+
+    key = k_spin_lock(&lock);
+    node = node_find(ctx->addr);
+    if (!node) {
+        if (node_count == ARRAY_SIZE(nodes)) {
+            k_spin_unlock(&lock, key);
+            LOG_WRN("No room for addr %x in topology", ctx->addr);
+            return;
+        }
+        node = &nodes[node_count++];
+        node->addr = ctx->addr;
+        /* Force a recomputation for new nodes. */
+        node->hops = UINT8_MAX;
+    }
+
+    node->rssi = ctx->recv_rssi;
+    if (node->hops == hops) {
+        k_spin_unlock(&lock, key);
+        return;
+    }
+
+    LOG_DBG("Addr %x is %d hops away, rssi %d", ctx->addr, hops, ctx->recv_rssi);
+    node->hops = hops;
+
+    /* Paths may have changed, so every relay is confirmed again. */
+    for (size_t i = 0; i < node_count; i++) {
+        nodes[i].relay_required = false;
+    }
+    relay_set_compute();
+    k_spin_unlock(&lock, key);
+
+    k_work_reschedule_for_queue(&topology_work_q, &relay_update_work,
+        K_MSEC(CONFIG_TOPOLOGY_UPDATE_DELAY_MS));
+}
+
+uint8_t topology_ttl(uint16_t addr)
+{
+    struct topology_node *node;
+    k_spinlock_key_t key;
+    uint8_t ttl = BT_MESH_TTL_DEFAULT;
+
+    key = k_spin_lock(&lock);
+    node = node_find(addr);
+    if (node) {
+        ttl = hops_to_ttl(node->hops);
+    }
+    k_spin_unlock(&lock, key);
+
+    return ttl;
+}
+
+uint8_t topology_ttl_all(void)
+{
+    k_spinlock_key_t key;
+    uint8_t max_hops = 0;
+
+    key = k_spin_lock(&lock);
+    if (node_count == 0) {
+        k_spin_unlock(&lock, key);
+        return BT_MESH_TTL_DEFAULT;
+    }
+
+    for (size_t i = 0; i < node_count; i++) {
+        max_hops = MAX(max_hops, nodes[i].hops);
+    }
+    k_spin_unlock(&lock, key);
+
+    return hops_to_ttl(max_hops);
+}
+
+struct k_work_q *topology_cfg_work_q(void)
+{
+    return &topology_work_q;
+}
+
+static int topology_init(const struct device *dev)
+{
+    ARG_UNUSED(dev);
+
+    k_work_queue_start(&topology_work_q, topology_stack,
+        K_THREAD_STACK_SIZEOF(topology_stack),
+        K_LOWEST_APPLICATION_THREAD_PRIO, NULL);
+
+    return 0;
+}
+
+SYS_INIT(topology_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
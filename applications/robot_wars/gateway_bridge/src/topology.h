@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+
+#ifndef TOPOLOGY_H__
+#define TOPOLOGY_H__
+
+#include <zephyr/bluetooth/mesh.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Record the hop count and RSSI of a received message.
+ *
+ * Schedules a relay set update when the hop count of the sender changed.
+ *
+ * @param[in] ctx Context of the received message.
+ */
+void topology_record(const struct bt_mesh_msg_ctx *ctx);
+
+/** @brief Get the TTL to use when sending to an address.
+ *
+ * @param[in] addr Destination address.
+ *
+ * @retval TTL covering the measured hop count of the destination, or
+ *         BT_MESH_TTL_DEFAULT if the destination has not been measured.
+ */
+uint8_t topology_ttl(uint16_t addr);
+
+/** @brief Get the TTL to use for messages to all robots.
+ *
+ * @retval TTL covering the robot furthest away, or BT_MESH_TTL_DEFAULT if
+ *         no robots have been measured.
+ */
+uint8_t topology_ttl_all(void);
+
+/** @brief Get the work queue configuration client requests are made from.
+ *
+ * The configuration client handles one request at a time, so every
+ * blocking request is made from this queue.
+ *
+ * @retval Configuration work queue.
+ */
+struct k_work_q *topology_cfg_work_q(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TOPOLOGY_H__ */
@@ -168,8 +168,10 @@ int uart_send(const struct device *dev, uint8_t *data, uint32_t len, uint32_t ty
 	pos = pos + sizeof(uint32_t);
 	memcpy(pos, &addr, sizeof(uint32_t));
 
-	pos = pos + sizeof(uint32_t);
-	memcpy(pos, data, len);
+	if (len != 0) {
+		pos = pos + sizeof(uint32_t);
+		memcpy(pos, data, len);
+	}
 	// LOG_HEXDUMP_INF(data, len, "message:");
 	k_fifo_put(&tx_fifo, msg);
 	
@@ -6,11 +6,43 @@ typedef int (*drive_continous_t)(const struct device *dev, uint8_t power_numerat
 
 typedef int (*set_position_t)(const struct device *dev, int position, int32_t power, bool hold);
 
+typedef int (*get_position_t)(const struct device *dev, int32_t *position);
+
+/** Power and direction of one motor in a group update. */
+struct motor_command
+{
+    uint8_t power_numerator;
+    uint8_t power_denominator;
+    bool direction;
+};
+
+typedef int (*drive_group_t)(const struct device *const *devs, const struct motor_command *commands, size_t count);
+
+/** How a motor is stopped. */
+enum motor_stop_mode
+{
+    /* Outputs in high impedance, the motor runs out freely */
+    MOTOR_STOP_COAST,
+    /* Motor terminals shorted, the back EMF brakes the motor */
+    MOTOR_STOP_BRAKE,
+};
+
+typedef int (*stop_group_t)(const struct device *const *devs, size_t count, enum motor_stop_mode mode);
 
 struct motor_api
 {
     drive_continous_t drive_continous;
     set_position_t set_position;
+    drive_group_t drive_group;
+    stop_group_t stop_group;
+    get_position_t get_position;
+};
+
+/** Motors that are updated together, like the wheels of a robot body. */
+struct motor_group
+{
+    const struct device *const *motors;
+    size_t count;
 };
 
 /**
@@ -56,4 +88,146 @@ static inline int motor_set_position(const struct device *dev, int32_t position,
     }
 
     return api->set_position(dev, position, power, hold);
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Get position of motor from its encoder.
+ *
+ * @param dev Motor device
+ * @param position Angle of the output shaft in millidegrees. Wraps around
+ *                 when it overflows, so only differences are meaningful.
+ * @return 0 on success, negative errno code otherwise.
+ *         -ENOTSUP if the motor has no encoder.
+ *         Other error codes are defined by the underlying driver.
+ */
+static inline int motor_get_position(const struct device *dev, int32_t *position)
+{
+    const struct motor_api *api = (struct motor_api *)dev->api;
+
+    if (api->get_position == NULL){
+        return -ENOTSUP;
+    }
+
+    return api->get_position(dev, position);
+}
+
+/* Driver API shared by every motor of a non-empty group, or NULL. */
+static inline const struct motor_api *motor_group_api(const struct motor_group *group)
+{
+    for (size_t i = 1; i < group->count; i++){
+        if (group->motors[i]->api != group->motors[0]->api){
+            return NULL;
+        }
+    }
+    return (struct motor_api *)group->motors[0]->api;
+}
+
+/**
+ * @brief Set power of a group of motors in one operation
+ *
+ * Drivers implementing the group update set the direction and power of
+ * every motor with interrupts locked, so that the motors start and stop
+ * together. Motors sharing one PWM instance get the new duty cycles in the
+ * same PWM period. Groups of motors with different drivers are updated
+ * one motor at a time.
+ *
+ * @param group Motors to update
+ * @param commands Power and direction of every motor of the group, in order.
+ * @return 0 on success, negative errno code otherwise.
+ *         -ENOTSUP if a motor does not support continous rotation.
+ *         Other error codes are defined by the underlying driver.
+ */
+static inline int motor_group_drive_continous(const struct motor_group *group, const struct motor_command *commands)
+{
+    const struct motor_api *api;
+    int err;
+
+    if (group->count == 0){
+        return 0;
+    }
+
+    api = motor_group_api(group);
+    if (api && api->drive_group){
+        return api->drive_group(group->motors, commands, group->count);
+    }
+
+    for (size_t i = 0; i < group->count; i++){
+        err = motor_drive_continous(group->motors[i], commands[i].power_numerator,
+                                    commands[i].power_denominator, commands[i].direction);
+        if (err){
+            return err;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Stop a group of motors in one operation
+ *
+ * Coasting lets the motors run out on their own friction. Braking shorts
+ * the motor terminals, which stops the motors in a fraction of the run out
+ * distance, and holds them while the brake is applied. Drivers whose motors
+ * share an enable input can only coast every motor on it, so a coasting
+ * motor may stop its siblings as well.
+ *
+ * @param group Motors to stop
+ * @param mode Stop mode
+ * @return 0 on success, negative errno code otherwise.
+ *         -ENOTSUP if a motor can not stop in the mode. It is stopped in
+ *         the mode it supports.
+ *         Other error codes are defined by the underlying driver.
+ */
+static inline int motor_group_stop(const struct motor_group *group, enum motor_stop_mode mode)
+{
+    const struct motor_api *api;
+    int ret = 0;
+    int err;
+
+    if (group->count == 0){
+        return 0;
+    }
+
+    api = motor_group_api(group);
+    if (api && api->stop_group){
+        return api->stop_group(group->motors, group->count, mode);
+    }
+
+    for (size_t i = 0; i < group->count; i++){
+        api = (struct motor_api *)group->motors[i]->api;
+        if (api->stop_group){
+            err = api->stop_group(&group->motors[i], 1, mode);
+        } else {
+            /* Zero power is the only stop the driver knows of. */
+            err = motor_drive_continous(group->motors[i], 0, 1, true);
+            if (!err && mode != MOTOR_STOP_COAST){
+                err = -ENOTSUP;
+            }
+        }
+
+        if (err && err != -ENOTSUP){
+            return err;
+        }
+        ret = ret ? ret : err;
+    }
+    return ret;
+}
+
+/**
+ * @brief Stop a motor
+ *
+ * @param dev Motor device
+ * @param mode Stop mode
+ * @return 0 on success, negative errno code otherwise.
+ *         -ENOTSUP if the motor can not stop in the mode. It is stopped in
+ *         the mode it supports.
+ *         Other error codes are defined by the underlying driver.
+ */
+static inline int motor_stop(const struct device *dev, enum motor_stop_mode mode)
+{
+    const struct motor_group group = {
+        .motors = &dev,
+        .count = 1,
+    };
+
+    return motor_group_stop(&group, mode);
+}
@@ -0,0 +1,127 @@
+#include <devicetree.h>
+#include <device.h>
+#include <drivers/sensor.h>
+#include "../sim_motor/sim_motor.h"
+
+#define DT_DRV_COMPAT nordic_sim_gyro
+#define SIM_GYRO_INIT_PRIORITY 70
+
+#define SIM_GYRO_PI 3.14159265358979
+
+#include <logging/log.h>
+LOG_MODULE_REGISTER(sim_gyro_driver, CONFIG_SIM_GYRO_DRIVER_LOG_LEVEL);
+
+struct gyro_data
+{
+    /* Yaw rate of the last sample, in rad/s */
+    double rate;
+};
+
+struct gyro_conf
+{
+    const struct device *motor_left;
+    const struct device *motor_right;
+    double wheel_diameter_mm;
+    double track_width_mm;
+    double bias;
+};
+
+/* The yaw rate of a differential drive follows from the difference in
+ * ground speed of its wheels.
+ */
+static int _sample_fetch(const struct device *dev, enum sensor_channel chan)
+{
+    const struct gyro_conf *conf = dev->config;
+    struct gyro_data *data = dev->data;
+    struct sim_motor_state left;
+    struct sim_motor_state right;
+    double speed_mm_s;
+    int err;
+
+    if (chan != SENSOR_CHAN_ALL && chan != SENSOR_CHAN_GYRO_XYZ && chan != SENSOR_CHAN_GYRO_Z)
+    {
+        return -ENOTSUP;
+    }
+
+    err = sim_motor_state_get(conf->motor_left, &left);
+    if (!err)
+    {
+        err = sim_motor_state_get(conf->motor_right, &right);
+    }
+    if (err)
+    {
+        LOG_ERR("Failed to get the motor state: Error %d", err);
+        return err;
+    }
+
+    speed_mm_s = (right.rpm - left.rpm) / 60.0 * SIM_GYRO_PI * conf->wheel_diameter_mm;
+    data->rate = speed_mm_s / conf->track_width_mm + conf->bias;
+    return 0;
+}
+
+static void rate_to_value(double rate, struct sensor_value *val)
+{
+    val->val1 = (int32_t)rate;
+    val->val2 = (int32_t)((rate - val->val1) * 1000000.0);
+}
+
+static int _channel_get(const struct device *dev, enum sensor_channel chan, struct sensor_value *val)
+{
+    struct gyro_data *data = dev->data;
+
+    switch (chan)
+    {
+    case SENSOR_CHAN_GYRO_Z:
+        rate_to_value(data->rate, val);
+        return 0;
+    case SENSOR_CHAN_GYRO_XYZ:
+        rate_to_value(0.0, &val[0]);
+        rate_to_value(0.0, &val[1]);
+        rate_to_value(data->rate, &val[2]);
+        return 0;
+    case SENSOR_CHAN_GYRO_X:
+    case SENSOR_CHAN_GYRO_Y:
+        rate_to_value(0.0, val);
+        return 0;
+    default:
+        return -ENOTSUP;
+    }
+}
+
+static const struct sensor_driver_api sim_gyro_api = {
+    .sample_fetch = _sample_fetch,
+    .channel_get = _channel_get,
+};
+
+static int init_gyro(const struct device *dev)
+{
+    const struct gyro_conf *conf = dev->config;
+
+    if (!device_is_ready(conf->motor_left) || !device_is_ready(conf->motor_right))
+    {
+        LOG_ERR("Motors of gyroscope %s not ready", dev->name);
+        return -ENODEV;
+    }
+    return 0;
+}
+
+#define INIT_SIM_GYRO(inst)                                                     \
+    static const struct gyro_conf conf_##inst = {                               \
+        .motor_left = DEVICE_DT_GET(DT_INST_PHANDLE_BY_IDX(inst, motors, 0)),   \
+        .motor_right = DEVICE_DT_GET(DT_INST_PHANDLE_BY_IDX(inst, motors, 1)),  \
+        .wheel_diameter_mm = DT_INST_PROP(inst, wheel_diameter_mm),             \
+        .track_width_mm = DT_INST_PROP(inst, track_width_mm),                   \
+        .bias = DT_INST_PROP(inst, bias_mdps) * SIM_GYRO_PI / 180000.0,         \
+    };                                                                          \
+    static struct gyro_data data_##inst = {};                                   \
+    DEVICE_DT_INST_DEFINE(                                                      \
+        inst,                                                                   \
+        init_gyro,                                                              \
+        NULL,                                                                   \
+        &data_##inst,                                                           \
+        &conf_##inst,                                                           \
+        POST_KERNEL,                                                            \
+        SIM_GYRO_INIT_PRIORITY,                                                 \
+        &sim_gyro_api);
+
+DT_INST_FOREACH_STATUS_OKAY(INIT_SIM_GYRO)
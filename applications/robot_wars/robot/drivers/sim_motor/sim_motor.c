@@ -0,0 +1,236 @@
+#include <devicetree.h>
+#include <device.h>
+#include <math.h>
+#include "../motors/motor.h"
+#include "sim_motor.h"
+
+#define DT_DRV_COMPAT nordic_sim_motor
+#define SIM_MOTOR_INIT_PRIORITY 60
+
+/* Integration step of the motor response. */
+#define SIM_MOTOR_STEP_US 1000
+
+#include <logging/log.h>
+LOG_MODULE_REGISTER(sim_motor_driver, CONFIG_SIM_MOTOR_DRIVER_LOG_LEVEL);
+
+struct motor_data
+{
+    struct k_spinlock lock;
+    struct sim_motor_state state;
+    /* Uptime the state was last advanced to */
+    int64_t time_us;
+};
+
+struct motor_conf
+{
+    float max_rpm;
+    float time_constant_s;
+    float coast_time_constant_s;
+    float brake_time_constant_s;
+    int32_t ticks_per_revolution;
+    float stall_current_ma;
+};
+
+static int64_t uptime_us(void)
+{
+    return k_ticks_to_us_near64(k_uptime_ticks());
+}
+
+static int32_t floor_ticks(double ticks)
+{
+    int32_t whole = (int32_t)ticks;
+
+    return (ticks < whole) ? whole - 1 : whole;
+}
+
+/* Advances the first order response of the motor speed to the commanded
+ * power, in fixed steps so that the result does not depend on how often
+ * the state is read. A stopped motor loses its speed to friction, or much
+ * faster to the short circuit of a brake. A stalled motor stops as fast as
+ * a braked one.
+ *
+ * The current is the stall current scaled by the share of the supply
+ * voltage the back EMF leaves, so it peaks at a start and at a stall.
+ */
+static void advance(const struct device *dev, int64_t now_us)
+{
+    struct motor_conf *conf = (struct motor_conf *)dev->config;
+    struct motor_data *data = (struct motor_data *)dev->data;
+    struct sim_motor_state *state = &data->state;
+    float target = state->power * conf->max_rpm;
+    float time_constant_s = conf->time_constant_s;
+
+    if (state->power == 0.0f)
+    {
+        time_constant_s = state->braking ? conf->brake_time_constant_s : conf->coast_time_constant_s;
+    }
+    if (state->stalled)
+    {
+        target = 0.0f;
+        time_constant_s = conf->brake_time_constant_s;
+    }
+
+    while (now_us > data->time_us)
+    {
+        int64_t step_us = MIN(now_us - data->time_us, SIM_MOTOR_STEP_US);
+        float dt = step_us / 1000000.0f;
+
+        state->rpm += (target - state->rpm) * MIN(dt / time_constant_s, 1.0f);
+        state->revolutions += state->rpm * dt / 60.0f;
+        data->time_us += step_us;
+    }
+
+    state->ticks = floor_ticks(state->revolutions * conf->ticks_per_revolution);
+    state->current_ma = (state->power == 0.0f) ? 0.0f :
+        conf->stall_current_ma * fabsf(state->power - state->rpm / conf->max_rpm);
+}
+
+static void set_power(const struct device *dev, float power, bool braking)
+{
+    struct motor_data *data = (struct motor_data *)dev->data;
+    struct sim_motor_state *state = &data->state;
+    int64_t now_us = uptime_us();
+    k_spinlock_key_t key;
+
+    key = k_spin_lock(&data->lock);
+    advance(dev, now_us);
+    if (state->power == 0.0f && power != 0.0f)
+    {
+        state->start_time_us = now_us;
+    }
+    else if (state->power != 0.0f && power == 0.0f)
+    {
+        state->stop_time_us = now_us;
+        state->stop_ticks = state->ticks;
+    }
+    state->power = power;
+    state->braking = braking;
+    k_spin_unlock(&data->lock, key);
+}
+
+/* Zero power puts the outputs in high impedance, like the TB6612FNG. */
+static int _drive_continous(const struct device *dev, uint8_t power_numerator, uint8_t power_denominator,  bool direction)
+{
+    float power;
+
+    if (power_denominator == 0 || power_numerator > power_denominator)
+    {
+        return -EINVAL;
+    }
+
+    power = (float)power_numerator / power_denominator;
+    if (!direction)
+    {
+        power = -power;
+    }
+
+    set_power(dev, power, false);
+
+    LOG_DBG("Setting power on motor %s to %d/%d, direction %d", dev->name, power_numerator, power_denominator, direction);
+    return 0;
+}
+
+static int _stop_group(const struct device *const *devs, size_t count, enum motor_stop_mode mode)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        set_power(devs[i], 0.0f, mode == MOTOR_STOP_BRAKE);
+    }
+
+    LOG_DBG("Stopping %d motors, %s", (int)count, (mode == MOTOR_STOP_BRAKE) ? "brake" : "coast");
+    return 0;
+}
+
+static int _get_position(const struct device *dev, int32_t *position)
+{
+    struct motor_conf *conf = (struct motor_conf *)dev->config;
+    struct motor_data *data = (struct motor_data *)dev->data;
+    k_spinlock_key_t key;
+    int64_t ticks;
+
+    key = k_spin_lock(&data->lock);
+    advance(dev, uptime_us());
+    ticks = data->state.ticks;
+    k_spin_unlock(&data->lock, key);
+
+    /* Encoder resolution, as a real encoder would report it */
+    *position = (int32_t)(ticks * 360000 / conf->ticks_per_revolution);
+    return 0;
+}
+
+static const struct motor_api sim_motor_api = {
+    .drive_continous = _drive_continous,
+    .set_position = NULL,
+    .stop_group = _stop_group,
+    .get_position = _get_position,
+};
+
+int sim_motor_state_get(const struct device *dev, struct sim_motor_state *state)
+{
+    struct motor_data *data = (struct motor_data *)dev->data;
+    k_spinlock_key_t key;
+
+    if (dev->api != &sim_motor_api)
+    {
+        return -ENOTSUP;
+    }
+
+    key = k_spin_lock(&data->lock);
+    advance(dev, uptime_us());
+    *state = data->state;
+    k_spin_unlock(&data->lock, key);
+
+    return 0;
+}
+
+void sim_motor_reset(const struct device *dev)
+{
+    struct motor_data *data = (struct motor_data *)dev->data;
+    k_spinlock_key_t key;
+
+    key = k_spin_lock(&data->lock);
+    data->state = (struct sim_motor_state){0};
+    data->time_us = uptime_us();
+    k_spin_unlock(&data->lock, key);
+}
+
+void sim_motor_stall_set(const struct device *dev, bool stalled)
+{
+    struct motor_data *data = (struct motor_data *)dev->data;
+    k_spinlock_key_t key;
+
+    key = k_spin_lock(&data->lock);
+    advance(dev, uptime_us());
+    data->state.stalled = stalled;
+    k_spin_unlock(&data->lock, key);
+}
+
+static int init_motor(const struct device *dev)
+{
+    sim_motor_reset(dev);
+    return 0;
+}
+
+#define INIT_SIM_MOTOR(inst)                                                    \
+    static struct motor_conf conf_##inst = {                                    \
+        .max_rpm = DT_INST_PROP(inst, max_rpm),                                 \
+        .time_constant_s = DT_INST_PROP(inst, time_constant_ms) / 1000.0f,      \
+        .coast_time_constant_s =                                                \
+            DT_INST_PROP(inst, coast_time_constant_ms) / 1000.0f,               \
+        .brake_time_constant_s =                                                \
+            DT_INST_PROP(inst, brake_time_constant_ms) / 1000.0f,               \
+        .ticks_per_revolution = DT_INST_PROP(inst, ticks_per_revolution),       \
+        .stall_current_ma = DT_INST_PROP(inst, stall_current_ma),               \
+    };                                                                          \
+    static struct motor_data data_##inst = {};                                  \
+    DEVICE_DT_INST_DEFINE(                                                      \
+        inst,                                                                   \
+        init_motor,                                                             \
+        NULL,                                                                   \
+        &data_##inst,                                                           \
+        &conf_##inst,                                                           \
+        POST_KERNEL,                                                            \
+        SIM_MOTOR_INIT_PRIORITY,                                                \
+        &sim_motor_api);
+
+DT_INST_FOREACH_STATUS_OKAY(INIT_SIM_MOTOR)
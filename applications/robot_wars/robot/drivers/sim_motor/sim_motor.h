@@ -0,0 +1,51 @@
+#pragma once
+#include <zephyr.h>
+#include <device.h>
+
+/** State of an emulated motor. */
+struct sim_motor_state
+{
+    /* Commanded power, -1 to 1 */
+    float power;
+    /* Speed of the output shaft */
+    float rpm;
+    /* Revolutions of the output shaft since the last reset */
+    double revolutions;
+    /* Encoder count, following the revolutions */
+    int32_t ticks;
+    /* Uptime the motor was last started from and stopped at zero power */
+    int64_t start_time_us;
+    int64_t stop_time_us;
+    /* Encoder count at the last stop, the run out follows from it */
+    int32_t stop_ticks;
+    /* Stopped with the terminals shorted */
+    bool braking;
+    /* Supply current, from the commanded power and the back EMF */
+    float current_ma;
+    /* Output shaft held in place */
+    bool stalled;
+};
+
+/**
+ * @brief Get the state of an emulated motor, advanced to the current time.
+ *
+ * @param dev Motor device
+ * @param state State of the motor.
+ * @return 0 on success, negative errno code otherwise.
+ */
+int sim_motor_state_get(const struct device *dev, struct sim_motor_state *state);
+
+/**
+ * @brief Stop an emulated motor and clear its position and encoder count.
+ *
+ * @param dev Motor device
+ */
+void sim_motor_reset(const struct device *dev);
+
+/**
+ * @brief Hold the output shaft of an emulated motor, as if it was blocked.
+ *
+ * @param dev Motor device
+ * @param stalled Whether the shaft is held.
+ */
+void sim_motor_stall_set(const struct device *dev, bool stalled);
@@ -18,18 +18,42 @@ struct motor_data
 struct motor_conf
 {
     struct gpio_dt_spec phase_gpio;
+    /* Enable input of the IC, shared by both bridges */
+    struct gpio_dt_spec enable_gpio;
     struct pwm_dt_spec pwm;
 };
 
+/* The enable pin is also the open drain fault output of the IC, so it is
+ * only released to enable the bridges.
+ */
+static void enable_set(struct motor_conf *conf, int value)
+{
+    if (conf->enable_gpio.port != NULL)
+    {
+        gpio_pin_set_dt(&conf->enable_gpio, value);
+    }
+}
+
+static uint32_t pulse_get(struct motor_conf *conf, uint8_t power_numerator, uint8_t power_denominator)
+{
+    return (conf->pwm.period/power_denominator)*power_numerator;
+}
+
 static int _drive_continous(const struct device *dev, uint8_t power_numerator, uint8_t power_denominator,  bool direction)
 {
     int err;
     uint32_t pulse;
     struct motor_conf *conf = (struct motor_conf *)dev->config;
 
+    if (power_denominator == 0)
+    {
+        return -EINVAL;
+    }
+
+    enable_set(conf, 1);
     gpio_pin_set_dt(&conf->phase_gpio, direction);
 
-    pulse = (conf->pwm.period/power_denominator)*power_numerator;
+    pulse = pulse_get(conf, power_numerator, power_denominator);
     
     err = pwm_set_pulse_dt(&conf->pwm, pulse);
     if (err)
@@ -42,9 +66,101 @@ static int _drive_continous(const struct device *dev, uint8_t power_numerator, u
     return 0;
 }
 
-struct motor_api api = {
+/* Phases and pulses of the group are set with interrupts locked. Channels of
+ * one PWM instance share its sequence in RAM, which the PWM loads at the
+ * start of every period, so they change in the same period.
+ */
+static int _drive_group(const struct device *const *devs, const struct motor_command *commands, size_t count)
+{
+    struct motor_conf *conf;
+    unsigned int key;
+    int err = 0;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (commands[i].power_denominator == 0)
+        {
+            return -EINVAL;
+        }
+    }
+
+    key = irq_lock();
+    for (size_t i = 0; i < count; i++)
+    {
+        conf = (struct motor_conf *)devs[i]->config;
+        enable_set(conf, 1);
+        gpio_pin_set_dt(&conf->phase_gpio, commands[i].direction);
+    }
+
+    for (size_t i = 0; i < count && !err; i++)
+    {
+        conf = (struct motor_conf *)devs[i]->config;
+        err = pwm_set_pulse_dt(&conf->pwm, pulse_get(conf, commands[i].power_numerator,
+                                                     commands[i].power_denominator));
+    }
+    irq_unlock(key);
+
+    if (err)
+    {
+        LOG_ERR("Failed to set PWM pulse: Error %d", err);
+        return err;
+    }
+
+    LOG_DBG("Setting power on %d motors", (int)count);
+    return 0;
+}
+
+/* A zero duty cycle keeps both low sides of the bridge on, slow decay,
+ * which short brakes the motor. Coasting needs the power stage disabled,
+ * which the IC only does for both bridges at once.
+ */
+static int _stop_group(const struct device *const *devs, size_t count, enum motor_stop_mode mode)
+{
+    struct motor_conf *conf;
+    unsigned int key;
+    int ret = 0;
+    int err = 0;
+
+    key = irq_lock();
+    for (size_t i = 0; i < count && !err; i++)
+    {
+        conf = (struct motor_conf *)devs[i]->config;
+        err = pwm_set_pulse_dt(&conf->pwm, 0);
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        conf = (struct motor_conf *)devs[i]->config;
+        if (mode == MOTOR_STOP_BRAKE)
+        {
+            enable_set(conf, 1);
+        }
+        else if (conf->enable_gpio.port != NULL)
+        {
+            enable_set(conf, 0);
+        }
+        else
+        {
+            ret = -ENOTSUP;
+        }
+    }
+    irq_unlock(key);
+
+    if (err)
+    {
+        LOG_ERR("Failed to set PWM pulse: Error %d", err);
+        return err;
+    }
+
+    LOG_DBG("Stopping %d motors, %s", (int)count, (mode == MOTOR_STOP_BRAKE) ? "brake" : "coast");
+    return ret;
+}
+
+static const struct motor_api api = {
     .drive_continous = _drive_continous,
     .set_position = NULL,
+    .drive_group = _drive_group,
+    .stop_group = _stop_group,
 };
 
 static int init_gpio(const struct device *dev)
@@ -68,6 +184,22 @@ static int init_gpio(const struct device *dev)
         }
     }
 
+    if (conf->enable_gpio.port != NULL)
+    {
+        if (!device_is_ready(conf->enable_gpio.port))
+        {
+            LOG_ERR("Enable gpio, %s, is not ready", conf->enable_gpio.port->name);
+            return -ENODEV;
+        }
+
+        err = gpio_pin_configure_dt(&conf->enable_gpio, GPIO_OUTPUT_ACTIVE | GPIO_OPEN_DRAIN | GPIO_PULL_UP);
+        if (err)
+        {
+            LOG_ERR("Failed to configure enable gpio: Error %d", err);
+            return err;
+        }
+    }
+
     return 0;
 }
 
@@ -112,6 +244,8 @@ static int init_motor(const struct device *dev)
 #define INIT_STSPIN240_MOTOR(inst)                                      \
     static struct motor_conf conf_##inst = {                            \
         .phase_gpio = GPIO_DT_SPEC_INST_GET_OR(inst, phase_gpios, {0}), \
+        .enable_gpio = GPIO_DT_SPEC_GET_OR(DT_INST_PARENT(inst),        \
+                                           enable_fault_gpios, {0}),    \
         .pwm = PWM_DT_SPEC_GET_BY_IDX(DT_INST(inst, DT_DRV_COMPAT), 0), \
     };                                                                  \
     static struct motor_data data_##inst = {};                          \
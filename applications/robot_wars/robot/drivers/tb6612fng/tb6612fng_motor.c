@@ -22,46 +22,152 @@ struct motor_conf
     struct pwm_dt_spec pwm;
 };
 
-static int _drive_continous(const struct device *dev, int32_t power)
+static uint32_t pulse_get(struct motor_conf *conf, uint8_t power_numerator, uint8_t power_denominator)
+{
+    return (conf->pwm.period/power_denominator)*power_numerator;
+}
+
+static void set_direction(const struct device *dev, uint8_t power_numerator, bool direction)
 {
     struct motor_conf *conf = (struct motor_conf *)dev->config;
 
     if (conf->gpio1.port != NULL && conf->gpio2.port != NULL)
     {
-        if (power > 0)
+        if (power_numerator == 0)
+        { // Stop
+            gpio_pin_set_dt(&conf->gpio1, 0);
+            gpio_pin_set_dt(&conf->gpio2, 0);
+        }
+        else if (direction)
         { // CW
             gpio_pin_set_dt(&conf->gpio1, 1);
             gpio_pin_set_dt(&conf->gpio2, 0);
         }
-        else if (power < 0)
+        else
         { // CCW
             gpio_pin_set_dt(&conf->gpio1, 0);
             gpio_pin_set_dt(&conf->gpio2, 1);
-        } else {
-            gpio_pin_set_dt(&conf->gpio1, 0);
-            gpio_pin_set_dt(&conf->gpio2, 0);
         }
     }
-    else if (power < 0)
+    else if (!direction && power_numerator != 0)
+    {
+        LOG_WRN("Reverse direction given but driver has no direction control GPIOs");
+    }
+}
+
+static int _drive_continous(const struct device *dev, uint8_t power_numerator, uint8_t power_denominator,  bool direction)
+{
+    struct motor_conf *conf = (struct motor_conf *)dev->config;
+    uint32_t pulse;
+
+    if (power_denominator == 0)
+    {
+        return -EINVAL;
+    }
+
+    set_direction(dev, power_numerator, direction);
+
+    pulse = pulse_get(conf, power_numerator, power_denominator);
+
+    int err = pwm_set_pulse_dt(&conf->pwm, pulse);
+    if (err) {
+        LOG_ERR("Failed to set PWM pulse: Error %d", err);
+        return err;
+    }
+
+    LOG_DBG("Setting power on motor %s to %d/%d with pulse width %d", dev->name, power_numerator, power_denominator, pulse);
+    return 0;
+}
+
+/* Inputs and pulses of the group are set with interrupts locked. Channels of
+ * one PWM instance share its sequence in RAM, which the PWM loads at the
+ * start of every period, so they change in the same period.
+ */
+static int _drive_group(const struct device *const *devs, const struct motor_command *commands, size_t count)
+{
+    struct motor_conf *conf;
+    unsigned int key;
+    int err = 0;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (commands[i].power_denominator == 0)
+        {
+            return -EINVAL;
+        }
+    }
+
+    key = irq_lock();
+    for (size_t i = 0; i < count; i++)
     {
-        LOG_WRN("Negative power %d given but driver has no direction control GPIOs", power);
+        set_direction(devs[i], commands[i].power_numerator, commands[i].direction);
     }
 
-    int32_t abs_power = power >= 0 ? power : -power;
+    for (size_t i = 0; i < count && !err; i++)
+    {
+        conf = (struct motor_conf *)devs[i]->config;
+        err = pwm_set_pulse_dt(&conf->pwm, pulse_get(conf, commands[i].power_numerator,
+                                                     commands[i].power_denominator));
+    }
+    irq_unlock(key);
 
-    int err = pwm_set_pulse_dt(&conf->pwm, abs_power);
     if (err) {
         LOG_ERR("Failed to set PWM pulse: Error %d", err);
         return err;
     }
 
-    LOG_DBG("Setting power on motor %s to %d", dev->name, abs_power);
+    LOG_DBG("Setting power on %d motors", (int)count);
     return 0;
 }
 
-struct motor_api api = {
+/* Both inputs high short brake the motor, both low put the outputs in high
+ * impedance, whatever the PWM input.
+ */
+static int _stop_group(const struct device *const *devs, size_t count, enum motor_stop_mode mode)
+{
+    struct motor_conf *conf;
+    unsigned int key;
+    int level = (mode == MOTOR_STOP_BRAKE) ? 1 : 0;
+    int ret = 0;
+    int err = 0;
+
+    key = irq_lock();
+    for (size_t i = 0; i < count; i++)
+    {
+        conf = (struct motor_conf *)devs[i]->config;
+        if (conf->gpio1.port != NULL && conf->gpio2.port != NULL)
+        {
+            gpio_pin_set_dt(&conf->gpio1, level);
+            gpio_pin_set_dt(&conf->gpio2, level);
+        }
+        else if (mode == MOTOR_STOP_COAST)
+        {
+            /* Zero duty cycle with fixed inputs brakes the motor. */
+            ret = -ENOTSUP;
+        }
+    }
+
+    for (size_t i = 0; i < count && !err; i++)
+    {
+        conf = (struct motor_conf *)devs[i]->config;
+        err = pwm_set_pulse_dt(&conf->pwm, 0);
+    }
+    irq_unlock(key);
+
+    if (err) {
+        LOG_ERR("Failed to set PWM pulse: Error %d", err);
+        return err;
+    }
+
+    LOG_DBG("Stopping %d motors, %s", (int)count, (mode == MOTOR_STOP_BRAKE) ? "brake" : "coast");
+    return ret;
+}
+
+static const struct motor_api api = {
     .drive_continous = _drive_continous,
     .set_position = NULL,
+    .drive_group = _drive_group,
+    .stop_group = _stop_group,
 };
 
 static int init_gpio(const struct device *dev)
@@ -17,6 +17,12 @@ static char *type_to_str(mesh_module_event_type type)
         case MESH_EVT_RGB: {
             return "MESH_EVT_RGB";
         }
+        case MESH_EVT_CONFIGURED: {
+            return "MESH_EVT_CONFIGURED";
+        }
+        case MESH_EVT_CALIBRATE: {
+            return "MESH_EVT_CALIBRATE";
+        }
     default:
         return "UNKNOWN";
     }
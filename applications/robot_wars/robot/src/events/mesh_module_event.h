@@ -9,13 +9,23 @@ typedef enum {
     MESH_EVT_DISCONNECTED,
     MESH_EVT_MOVE,
     MESH_EVT_RGB,
+    /** A movement is staged for an upcoming round. */
+    MESH_EVT_CONFIGURED,
+    /** Motion calibration is requested. */
+    MESH_EVT_CALIBRATE,
 } mesh_module_event_type;
 
 struct mesh_module_event {
     struct app_event_header header;
     mesh_module_event_type type;
+    /** Index of the robot body the event applies to. */
+    uint8_t body;
     union {
-        struct bt_mesh_movement_set move;
+        struct {
+            struct bt_mesh_movement_set movement;
+            /** How to stop the motors, see bt_mesh_movement_stop. */
+            uint8_t stop;
+        } move;
         struct bt_mesh_light_rgb_set rgb;
     } data;
 };
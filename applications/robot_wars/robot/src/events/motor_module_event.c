@@ -11,6 +11,8 @@ static char *type_to_str(motor_module_event_type type)
         return "MOTOR_EVT_MOVEMENT_DONE";
     case MOTOR_EVT_MOVEMENT_REPORT:
         return "MOTOR_EVT_MOVEMENT_REPORT";
+    case MOTOR_EVT_CALIBRATION_DONE:
+        return "MOTOR_EVT_CALIBRATION_DONE";
     default:
         return "UNKNOWN";
     }
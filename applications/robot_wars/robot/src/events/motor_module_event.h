@@ -6,17 +6,38 @@ typedef enum {
     MOTOR_EVT_MOVEMENT_START,
     MOTOR_EVT_MOVEMENT_DONE,
     MOTOR_EVT_MOVEMENT_REPORT,
+    MOTOR_EVT_CALIBRATION_DONE,
 } motor_module_event_type;
 
 struct movement_report {
     uint8_t revolutions;
+    /* Power summary of the movement, see the power module */
+    uint16_t battery_mv;
+    uint16_t current_ma;
+    /* BT_MESH_TELEMETRY_POWER_FLAG_* */
+    uint8_t power_flags;
+};
+
+struct calibration_report {
+    /* 0, or the negative error code the calibration failed with */
+    int8_t err;
+    /* Turn rate at full power in degrees per second */
+    uint16_t turn_rate;
+    /* Ground speed of the slower wheel at full power in mm/s */
+    uint16_t speed;
+    /* Time a turn and a drive take beyond the steady speed model in ms */
+    int16_t turn_offset;
+    int16_t drive_offset;
 };
 
 struct motor_module_event {
     struct app_event_header header;
     motor_module_event_type type;
+    /** Index of the robot body the event applies to. */
+    uint8_t body;
     union {
         struct movement_report report;
+        struct calibration_report calibration;
     } data;
     
 };
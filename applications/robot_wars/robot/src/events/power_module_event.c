@@ -0,0 +1,29 @@
+#include "power_module_event.h"
+
+static char *type_to_str(power_module_event_type type)
+{
+    switch (type)
+    {
+    case POWER_EVT_MEASUREMENT:
+        return "POWER_EVT_MEASUREMENT";
+    case POWER_EVT_STALL:
+        return "POWER_EVT_STALL";
+    default:
+        return "UNKNOWN";
+    }
+}
+
+static void log_power_event(const struct app_event_header *header)
+{
+    struct power_module_event *evt = cast_power_module_event(header);
+    char *type_str = type_to_str(evt->type);
+
+    APP_EVENT_MANAGER_LOG(header, "Type: %s", type_str);
+}
+
+APP_EVENT_TYPE_DEFINE(
+    power_module_event,
+    log_power_event,
+    NULL,
+    APP_EVENT_FLAGS_CREATE(IF_ENABLED(CONFIG_LOG_POWER_MODULE_EVENT,
+				(APP_EVENT_TYPE_FLAGS_INIT_LOG_ENABLE))));
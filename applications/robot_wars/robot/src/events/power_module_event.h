@@ -0,0 +1,27 @@
+#pragma once
+
+#include <app_event_manager.h>
+
+typedef enum {
+    /** Battery voltage and peak motor current since the last measurement. */
+    POWER_EVT_MEASUREMENT,
+    /** The motor current of a body stayed at its stall level. */
+    POWER_EVT_STALL,
+} power_module_event_type;
+
+struct power_measurement {
+    uint16_t battery_mv;
+    uint16_t current_ma;
+};
+
+struct power_module_event {
+    struct app_event_header header;
+    power_module_event_type type;
+    /** Index of the robot body the event applies to. */
+    uint8_t body;
+    union {
+        struct power_measurement measurement;
+    } data;
+};
+
+APP_EVENT_TYPE_DECLARE(power_module_event);
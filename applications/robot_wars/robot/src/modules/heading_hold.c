@@ -0,0 +1,267 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr.h>
+#include <devicetree.h>
+#include <device.h>
+#include <drivers/sensor.h>
+
+#include "../../drivers/motors/motor.h"
+#include "heading_hold.h"
+#include "robot_body.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(heading_hold, CONFIG_MOTOR_MODULE_LOG_LEVEL);
+
+/* Sample period of the gyroscope and the control loop */
+#define HEADING_PERIOD_US (1000000 / CONFIG_MOTOR_HEADING_ODR_HZ)
+
+/* Microdegrees in a microradian, scaled by 100000 */
+#define HEADING_UDEG_PER_URAD_E5 5729578LL
+
+/* Samples the zero rate offset is averaged over, as a power of two */
+#define HEADING_BIAS_FILTER_SHIFT 6
+
+enum heading_mode
+{
+    /* Motors commanded by the motor module, the heading is only tracked */
+    HEADING_MODE_RELEASED,
+    /* Standing still, the zero rate offset is tracked after the run out */
+    HEADING_MODE_REST,
+    /* Driving, the motor power is corrected to hold the heading */
+    HEADING_MODE_HOLD,
+};
+
+struct heading_body
+{
+    const struct device *gyro;
+    const struct device *motors[2];
+    struct motor_group group;
+    enum heading_mode mode;
+    int64_t mode_time_us;
+    /* Zero rate offset, in microradians per second */
+    int64_t bias_urad_s;
+    /* Heading, and the heading the hold started from, in microdegrees */
+    int64_t heading_udeg;
+    int64_t target_udeg;
+    /* Integral of the heading error, in millidegree milliseconds */
+    int64_t integral;
+    uint8_t power[2];
+    int64_t sample_time_us;
+};
+
+#define HEADING_BODY_GYRO(node)                                                     \
+    COND_CODE_1(DT_NODE_HAS_PROP(node, gyro), (DEVICE_DT_GET(DT_PHANDLE(node, gyro))), (NULL))
+
+#define HEADING_BODY_INIT(inst, _)                                                  \
+    {                                                                               \
+        .gyro = HEADING_BODY_GYRO(ROBOT_BODY_NODE(inst)),                          \
+        .motors = {                                                                 \
+            DEVICE_DT_GET(DT_PHANDLE_BY_IDX(ROBOT_BODY_NODE(inst), motors, 0)),     \
+            DEVICE_DT_GET(DT_PHANDLE_BY_IDX(ROBOT_BODY_NODE(inst), motors, 1)),     \
+        },                                                                          \
+        .group = {                                                                  \
+            .motors = bodies[inst].motors,                                          \
+            .count = 2,                                                             \
+        },                                                                          \
+    }
+
+static struct heading_body bodies[ROBOT_BODY_COUNT] = {
+    LISTIFY(ROBOT_BODY_COUNT, HEADING_BODY_INIT, (,))
+};
+
+/* Held by the control loop while it updates a body, so that a body that
+ * is released is not commanded again after.
+ */
+static K_MUTEX_DEFINE(lock);
+
+K_TIMER_DEFINE(heading_timer, NULL, NULL);
+
+static int64_t uptime_us(void)
+{
+    return k_ticks_to_us_near64(k_uptime_ticks());
+}
+
+static void mode_set(uint8_t body, enum heading_mode mode)
+{
+    struct heading_body *h;
+
+    if (body >= ROBOT_BODY_COUNT)
+    {
+        return;
+    }
+
+    h = &bodies[body];
+    k_mutex_lock(&lock, K_FOREVER);
+    if (h->mode == HEADING_MODE_HOLD && mode != HEADING_MODE_HOLD)
+    {
+        LOG_DBG("Body %d heading held to %d mdeg", body,
+                (int)((h->heading_udeg - h->target_udeg) / 1000));
+    }
+    if (h->mode != mode)
+    {
+        h->mode = mode;
+        h->mode_time_us = uptime_us();
+    }
+    k_mutex_unlock(&lock);
+}
+
+void heading_hold_rest(uint8_t body)
+{
+    mode_set(body, HEADING_MODE_REST);
+}
+
+void heading_hold_release(uint8_t body)
+{
+    mode_set(body, HEADING_MODE_RELEASED);
+}
+
+int heading_hold_drive(uint8_t body, uint8_t power_left, uint8_t power_right)
+{
+    struct heading_body *h;
+
+    if (body >= ROBOT_BODY_COUNT || !bodies[body].gyro)
+    {
+        return -ENODEV;
+    }
+
+    h = &bodies[body];
+    k_mutex_lock(&lock, K_FOREVER);
+    h->mode = HEADING_MODE_HOLD;
+    h->mode_time_us = uptime_us();
+    h->target_udeg = h->heading_udeg;
+    h->integral = 0;
+    h->power[0] = power_left;
+    h->power[1] = power_right;
+    k_mutex_unlock(&lock);
+    return 0;
+}
+
+/* PI control of the heading error. A body that turned left is steered
+ * right by driving the left wheel harder and the right wheel softer, and
+ * the other way around. A wheel that would exceed full power passes the
+ * rest of the correction to the other wheel.
+ */
+static void heading_control(struct heading_body *h, int64_t dt_us)
+{
+    const int32_t max = CONFIG_MOTOR_HEADING_MAX_CORRECTION * 100;
+    int32_t error_mdeg = (h->heading_udeg - h->target_udeg) / 1000;
+    int32_t correction;
+    int32_t left;
+    int32_t right;
+    int err;
+
+    h->integral += error_mdeg * dt_us / 1000;
+    if (CONFIG_MOTOR_HEADING_KI > 0)
+    {
+        int64_t limit = (int64_t)max * 1000000 / CONFIG_MOTOR_HEADING_KI;
+
+        h->integral = CLAMP(h->integral, -limit, limit);
+    }
+
+    /* In hundredths of a percent of power */
+    correction = ((int64_t)CONFIG_MOTOR_HEADING_KP * error_mdeg +
+                  (int64_t)CONFIG_MOTOR_HEADING_KI * h->integral / 1000) / 1000;
+    correction = CLAMP(correction, -max, max) / 100;
+
+    left = h->power[0] + correction;
+    right = h->power[1] - correction;
+    if (left > 100)
+    {
+        right -= left - 100;
+    }
+    else if (right > 100)
+    {
+        left -= right - 100;
+    }
+
+    const struct motor_command commands[] = {
+        { .power_numerator = CLAMP(left, 0, 100), .power_denominator = 100, .direction = 1 },
+        { .power_numerator = CLAMP(right, 0, 100), .power_denominator = 100, .direction = 1 },
+    };
+
+    err = motor_group_drive_continous(&h->group, commands);
+    if (err)
+    {
+        LOG_ERR("Failed to correct the heading: Error %d", err);
+    }
+}
+
+static void heading_update(struct heading_body *h)
+{
+    struct sensor_value rate;
+    int64_t rate_urad_s;
+    int64_t now;
+    int64_t dt_us;
+    int err;
+
+    err = sensor_sample_fetch(h->gyro);
+    if (!err)
+    {
+        err = sensor_channel_get(h->gyro, SENSOR_CHAN_GYRO_Z, &rate);
+    }
+    if (err)
+    {
+        LOG_WRN("Failed to read gyroscope %s: Error %d", h->gyro->name, err);
+        return;
+    }
+
+    now = uptime_us();
+    rate_urad_s = rate.val1 * 1000000LL + rate.val2;
+
+    k_mutex_lock(&lock, K_FOREVER);
+    dt_us = h->sample_time_us ? now - h->sample_time_us : 0;
+    h->sample_time_us = now;
+
+    if (h->mode == HEADING_MODE_REST &&
+        now - h->mode_time_us >= CONFIG_MOTOR_HEADING_SETTLE_MS * 1000)
+    {
+        h->bias_urad_s += (rate_urad_s - h->bias_urad_s) >> HEADING_BIAS_FILTER_SHIFT;
+    }
+
+    h->heading_udeg += (rate_urad_s - h->bias_urad_s) * HEADING_UDEG_PER_URAD_E5 / 100000 *
+                       dt_us / 1000000;
+
+    if (h->mode == HEADING_MODE_HOLD)
+    {
+        heading_control(h, dt_us);
+    }
+    k_mutex_unlock(&lock);
+}
+
+/* Fast inner loop, sampling every gyroscope at the output data rate. */
+static void heading_thread_fn(void)
+{
+    for (size_t i = 0; i < ROBOT_BODY_COUNT; i++)
+    {
+        if (bodies[i].gyro && !device_is_ready(bodies[i].gyro))
+        {
+            LOG_ERR("Gyroscope of body %d not ready", (int)i);
+            bodies[i].gyro = NULL;
+        }
+
+        /* Bodies start out standing still. */
+        heading_hold_rest(i);
+    }
+
+    k_timer_start(&heading_timer, K_USEC(HEADING_PERIOD_US), K_USEC(HEADING_PERIOD_US));
+
+    while (true)
+    {
+        k_timer_status_sync(&heading_timer);
+
+        for (size_t i = 0; i < ROBOT_BODY_COUNT; i++)
+        {
+            if (bodies[i].gyro)
+            {
+                heading_update(&bodies[i]);
+            }
+        }
+    }
+}
+
+K_THREAD_DEFINE(heading_thread, CONFIG_MOTOR_HEADING_THREAD_STACK_SIZE,
+    heading_thread_fn, NULL, NULL, NULL, CONFIG_MOTOR_HEADING_THREAD_PRIORITY, 0, 0);
@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#pragma once
+
+#include <zephyr.h>
+
+#if defined(CONFIG_MOTOR_HEADING_HOLD)
+
+/**
+ * @brief Let the body rest.
+ *
+ * The body is standing still, or about to. Once its run out is over, the
+ * zero rate offset of the gyroscope is tracked.
+ *
+ * @param body Index of the body.
+ */
+void heading_hold_rest(uint8_t body);
+
+/**
+ * @brief Release the motors of the body.
+ *
+ * Ends a heading hold, the caller commands the motors from here on.
+ *
+ * @param body Index of the body.
+ */
+void heading_hold_release(uint8_t body);
+
+/**
+ * @brief Hold the current heading of a driving body.
+ *
+ * The power of the left and right motor is corrected from the gyroscope
+ * until the body is released or put to rest. The motors must already be
+ * driving forward at the given power.
+ *
+ * @param body Index of the body.
+ * @param power_left Power of the left motor, in percent.
+ * @param power_right Power of the right motor, in percent.
+ * @return 0 on success, -ENODEV if the body has no gyroscope.
+ */
+int heading_hold_drive(uint8_t body, uint8_t power_left, uint8_t power_right);
+
+#else
+
+static inline void heading_hold_rest(uint8_t body) {}
+
+static inline void heading_hold_release(uint8_t body) {}
+
+static inline int heading_hold_drive(uint8_t body, uint8_t power_left, uint8_t power_right)
+{
+    return -ENODEV;
+}
+
+#endif
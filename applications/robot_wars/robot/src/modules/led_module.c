@@ -7,7 +7,9 @@
 
 #define MODULE led
 #include "../events/mesh_module_event.h"
+#include "../events/motor_module_event.h"
 #include "../events/ui_module_event.h"
+#include "robot_body.h"
 
 
 #include <zephyr/logging/log.h>
@@ -19,6 +21,7 @@ struct led_msg_data
     {
         struct ui_module_event ui;
         struct mesh_module_event mesh;
+        struct motor_module_event motor;
     } event;
 };
 
@@ -29,24 +32,39 @@ struct led_msg_data
 K_MSGQ_DEFINE(msgq_led, sizeof(struct led_msg_data),
 	      LED_QUEUE_ENTRY_COUNT, LED_QUEUE_BYTE_ALIGNMENT);
 
-static void blink_on_work_fn(struct k_work *work);
-static void blink_off_work_fn(struct k_work *work);
-K_WORK_DELAYABLE_DEFINE(blink_on_work, blink_on_work_fn);
-K_WORK_DELAYABLE_DEFINE(blink_off_work, blink_off_work_fn);
-
-/* Global module data */
+/* Per body module data */
+struct led_body
+{
+    bool has_leds;
+    struct pwm_dt_spec red_pwm_led;
+    struct pwm_dt_spec green_pwm_led;
+    struct pwm_dt_spec blue_pwm_led;
+    struct k_work_delayable blink_on_work;
+    struct k_work_delayable blink_off_work;
+    int blink_time;
+    int r_val;
+    int g_val;
+    int b_val;
+    /* A movement is staged and waits for its round to start */
+    bool staged;
+};
 
-static const struct pwm_dt_spec red_pwm_led =
-	PWM_DT_SPEC_GET(DT_ALIAS(red_pwm_led));
-static const struct pwm_dt_spec green_pwm_led =
-	PWM_DT_SPEC_GET(DT_ALIAS(green_pwm_led));
-static const struct pwm_dt_spec blue_pwm_led =
-	PWM_DT_SPEC_GET(DT_ALIAS(blue_pwm_led));
+#define LED_BODY_SPECS(node)                                                 \
+    .has_leds = true,                                                        \
+    .red_pwm_led = PWM_DT_SPEC_GET(DT_PHANDLE_BY_IDX(node, leds, 0)),        \
+    .green_pwm_led = PWM_DT_SPEC_GET(DT_PHANDLE_BY_IDX(node, leds, 1)),      \
+    .blue_pwm_led = PWM_DT_SPEC_GET(DT_PHANDLE_BY_IDX(node, leds, 2)),
+
+#define LED_BODY_INIT(inst, _)                                               \
+    {                                                                        \
+        COND_CODE_1(DT_NODE_HAS_PROP(ROBOT_BODY_NODE(inst), leds),           \
+            (LED_BODY_SPECS(ROBOT_BODY_NODE(inst))), ())                     \
+        .blink_time = 500,                                                   \
+    }
 
-int blink_time = 500;
-int r_val = 0;
-int g_val = 0;
-int b_val = 0;
+static struct led_body bodies[ROBOT_BODY_COUNT] = {
+    LISTIFY(ROBOT_BODY_COUNT, LED_BODY_INIT, (,))
+};
 
 
 
@@ -68,6 +86,12 @@ static bool app_event_handler(const struct app_event_header *header)
         enqueue = true;
     }
 
+    if (is_motor_module_event(header))
+    {
+        msg.event.motor = *cast_motor_module_event(header);
+        enqueue = true;
+    }
+
     if (enqueue)
     {
         int err = k_msgq_put(&msgq_led, &msg, K_FOREVER);
@@ -99,55 +123,150 @@ static int set_led_value(const struct pwm_dt_spec *spec, uint8_t numerator, uint
 
 static void blink_on_work_fn(struct k_work *work)
 {
-    set_led_value(&red_pwm_led, r_val, 255);
-    set_led_value(&green_pwm_led, g_val, 255);
-    set_led_value(&blue_pwm_led, b_val, 255);
-    if (blink_time != 0) {
-        k_work_schedule(&blink_off_work, K_MSEC(blink_time));
+    struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+    struct led_body *body = CONTAINER_OF(dwork, struct led_body, blink_on_work);
+
+    set_led_value(&body->red_pwm_led, body->r_val, 255);
+    set_led_value(&body->green_pwm_led, body->g_val, 255);
+    set_led_value(&body->blue_pwm_led, body->b_val, 255);
+    if (body->blink_time != 0) {
+        k_work_schedule(&body->blink_off_work, K_MSEC(body->blink_time));
     }
 }
 
 static void blink_off_work_fn(struct k_work *work)
 {
-    set_led_value(&red_pwm_led, 0, 255);
-    set_led_value(&green_pwm_led, 0, 255);
-    set_led_value(&blue_pwm_led, 0, 255);
-    k_work_schedule(&blink_on_work, K_MSEC(blink_time));
+    struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+    struct led_body *body = CONTAINER_OF(dwork, struct led_body, blink_off_work);
+
+    set_led_value(&body->red_pwm_led, 0, 255);
+    set_led_value(&body->green_pwm_led, 0, 255);
+    set_led_value(&body->blue_pwm_led, 0, 255);
+    k_work_schedule(&body->blink_on_work, K_MSEC(body->blink_time));
+}
+
+static void led_body_set(struct led_body *body, int blink_time, int r, int g, int b)
+{
+    body->blink_time = blink_time;
+    body->r_val = r;
+    body->g_val = g;
+    body->b_val = b;
+}
+
+/* Status animations, shown locally so the gateway does not need to send
+ * them. A colour set by the gateway is shown until the next status change.
+ */
+static void led_body_show_staged(struct led_body *body)
+{
+    led_body_set(body, 150, 230, 0, 10);
+    k_work_reschedule(&body->blink_on_work, K_NO_WAIT);
+}
+
+static void led_body_show_ready(struct led_body *body)
+{
+    led_body_set(body, 500, 0, 230, 10);
+    k_work_reschedule(&body->blink_on_work, K_NO_WAIT);
+}
+
+static void on_status(struct led_msg_data *msg)
+{
+    struct led_body *body;
+
+    if (is_mesh_module_event((struct app_event_header *)(&msg->event.mesh)))
+    {
+        if (msg->event.mesh.type == MESH_EVT_PROVISIONED)
+        {
+            for (size_t i = 0; i < ROBOT_BODY_COUNT; i++)
+            {
+                if (bodies[i].has_leds)
+                {
+                    led_body_show_ready(&bodies[i]);
+                }
+            }
+            return;
+        }
+
+        if (msg->event.mesh.body >= ROBOT_BODY_COUNT ||
+            !bodies[msg->event.mesh.body].has_leds)
+        {
+            return;
+        }
+
+        body = &bodies[msg->event.mesh.body];
+        if (msg->event.mesh.type == MESH_EVT_CONFIGURED)
+        {
+            body->staged = true;
+            led_body_show_staged(body);
+        }
+        else if (msg->event.mesh.type == MESH_EVT_MOVE)
+        {
+            body->staged = false;
+        }
+    }
+
+    if (is_motor_module_event((struct app_event_header *)(&msg->event.motor)))
+    {
+        if (msg->event.motor.type == MOTOR_EVT_MOVEMENT_REPORT)
+        {
+            if (msg->event.motor.body >= ROBOT_BODY_COUNT ||
+                !bodies[msg->event.motor.body].has_leds)
+            {
+                return;
+            }
+
+            /* Keep showing a movement staged for the next round. */
+            body = &bodies[msg->event.motor.body];
+            if (!body->staged)
+            {
+                led_body_show_ready(body);
+            }
+        }
+    }
 }
 
 /* State handling*/
 static int on_all_states(struct led_msg_data *msg)
 {
+    /* Buttons control the LEDs of the body on the primary element. */
+    struct led_body *body = &bodies[0];
+
     if (is_mesh_module_event((struct app_event_header *)(&msg->event.mesh)))
     {
         if (msg->event.mesh.type == MESH_EVT_RGB)
         {
+            if (msg->event.mesh.body >= ROBOT_BODY_COUNT ||
+                !bodies[msg->event.mesh.body].has_leds)
+            {
+                LOG_WRN("No LEDs on body %d", msg->event.mesh.body);
+                return 0;
+            }
+
             LOG_INF("rgb set event!");
-            blink_time = msg->event.mesh.data.rgb.blink_time;
-            r_val = msg->event.mesh.data.rgb.red;
-            g_val = msg->event.mesh.data.rgb.green;
-            b_val = msg->event.mesh.data.rgb.blue;
-            k_work_reschedule(&blink_on_work, K_NO_WAIT);
+            body = &bodies[msg->event.mesh.body];
+            led_body_set(body, msg->event.mesh.data.rgb.blink_time,
+                         msg->event.mesh.data.rgb.red,
+                         msg->event.mesh.data.rgb.green,
+                         msg->event.mesh.data.rgb.blue);
+            k_work_reschedule(&body->blink_on_work, K_NO_WAIT);
         }
     }
 
+    if (!body->has_leds)
+    {
+        return 0;
+    }
+
     if (is_ui_module_event((struct app_event_header *)(&msg->event.ui)))
     {
         if (msg->event.ui.type == UI_EVT_BUTTON)
         {
             if (msg->event.ui.data.button.action == BUTTON_PRESS) {
                 if (msg->event.ui.data.button.num == BTN3) {
-                    blink_time = 1000;
-                    r_val = 200;
-                    g_val = 50;
-                    b_val = 20;
-                    k_work_schedule(&blink_on_work, K_MSEC(blink_time));
+                    led_body_set(body, 1000, 200, 50, 20);
+                    k_work_schedule(&body->blink_on_work, K_MSEC(body->blink_time));
                 } else if (msg->event.ui.data.button.num == BTN4) {
-                    blink_time = 500;
-                    r_val = 20;
-                    g_val = 100;
-                    b_val = 100;
-                    k_work_schedule(&blink_on_work, K_MSEC(blink_time));
+                    led_body_set(body, 500, 20, 100, 100);
+                    k_work_schedule(&body->blink_on_work, K_MSEC(body->blink_time));
                 }
                 
             }
@@ -161,32 +280,43 @@ static int init_leds()
 {
     // LOG_DBG("Initializing led drivers");
     int err;
-    err = !device_is_ready(red_pwm_led.dev);
-    if (err)
-    {
-        LOG_ERR("red LED not ready: Error %d", err);
-        return err;
-    }
 
-    err = !device_is_ready(green_pwm_led.dev);
-    if (err)
+    for (size_t i = 0; i < ROBOT_BODY_COUNT; i++)
     {
-        LOG_ERR("red LED not ready: Error %d", err);
-        return err;
-    }
+        struct led_body *body = &bodies[i];
 
-    err = !device_is_ready(blue_pwm_led.dev);
-    if (err)
-    {
-        LOG_ERR("red LED not ready: Error %d", err);
-        return err;
-    }
+        k_work_init_delayable(&body->blink_on_work, blink_on_work_fn);
+        k_work_init_delayable(&body->blink_off_work, blink_off_work_fn);
+
+        if (!body->has_leds)
+        {
+            continue;
+        }
+
+        err = !device_is_ready(body->red_pwm_led.dev);
+        if (err)
+        {
+            LOG_ERR("red LED not ready: Error %d", err);
+            return err;
+        }
 
-    blink_time = 1000;
-    r_val = 10;
-    g_val = 10;
-    b_val = 250;
-    k_work_schedule(&blink_on_work, K_MSEC(blink_time));
+        err = !device_is_ready(body->green_pwm_led.dev);
+        if (err)
+        {
+            LOG_ERR("green LED not ready: Error %d", err);
+            return err;
+        }
+
+        err = !device_is_ready(body->blue_pwm_led.dev);
+        if (err)
+        {
+            LOG_ERR("blue LED not ready: Error %d", err);
+            return err;
+        }
+
+        led_body_set(body, 1000, 10, 10, 250);
+        k_work_schedule(&body->blink_on_work, K_MSEC(body->blink_time));
+    }
 
     return 0;
 }
@@ -210,6 +340,7 @@ static void module_thread_fn(void)
     {
 
         k_msgq_get(&msgq_led, &msg, K_FOREVER);
+        on_status(&msg);
         on_all_states(&msg);
 
     }
@@ -220,4 +351,5 @@ K_THREAD_DEFINE(led_module_thread, CONFIG_LED_THREAD_STACK_SIZE,
 
 APP_EVENT_LISTENER(MODULE, app_event_handler);
 APP_EVENT_SUBSCRIBE(MODULE, mesh_module_event);
+APP_EVENT_SUBSCRIBE(MODULE, motor_module_event);
 APP_EVENT_SUBSCRIBE(MODULE, ui_module_event);
\ No newline at end of file
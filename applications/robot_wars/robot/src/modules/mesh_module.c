@@ -11,6 +11,7 @@
 #define MODULE mesh
 #include "../events/motor_module_event.h"
 #include "../events/mesh_module_event.h"
+#include "robot_body.h"
 
 #include <zephyr/logging/log.h>
 LOG_MODULE_REGISTER(MODULE, CONFIG_MESH_MODULE_LOG_LEVEL);
@@ -48,6 +49,78 @@ K_MSGQ_DEFINE(mesh_module_msg_q, sizeof(struct mesh_msg_data),
 /** Globals */
 bt_addr_le_t addr;
 
+/** Per body identities, derived from the device address. */
+static uint8_t body_ids[ROBOT_BODY_COUNT][CONFIG_BT_MESH_ID_LEN];
+
+#if defined(CONFIG_MESH_MODULE_LPN_FAST_WAKE)
+/** Bodies with a pending movement. While any is, and for a while after, the
+ *  friend is polled at the fast poll interval. The friendship is kept
+ *  throughout, only the poll rate changes.
+ */
+static atomic_t lpn_awake_bodies;
+static atomic_t lpn_fast_poll;
+BUILD_ASSERT(ROBOT_BODY_COUNT <= ATOMIC_BITS, "Too many bodies for wake mask");
+
+static void lpn_poll_work_fn(struct k_work *work);
+static void lpn_idle_work_fn(struct k_work *work);
+
+K_WORK_DELAYABLE_DEFINE(lpn_poll_work, lpn_poll_work_fn);
+K_WORK_DELAYABLE_DEFINE(lpn_idle_work, lpn_idle_work_fn);
+
+static void lpn_poll_work_fn(struct k_work *work)
+{
+    int err;
+
+    if (!atomic_get(&lpn_fast_poll)) {
+        return;
+    }
+
+    /* Fails while the friendship is being (re)established, the stack
+     * polls on its own then.
+     */
+    err = bt_mesh_lpn_poll();
+    if (err && err != -EAGAIN) {
+        LOG_WRN("Failed to poll friend: Error %d", err);
+    }
+
+    k_work_reschedule(&lpn_poll_work, K_MSEC(CONFIG_MESH_MODULE_LPN_FAST_POLL_INTERVAL));
+}
+
+static void lpn_idle_work_fn(struct k_work *work)
+{
+    if (atomic_get(&lpn_awake_bodies)) {
+        LOG_WRN("No movement within wake timeout, resuming idle polling");
+        atomic_clear(&lpn_awake_bodies);
+    }
+
+    atomic_clear(&lpn_fast_poll);
+    k_work_cancel_delayable(&lpn_poll_work);
+}
+
+static void lpn_wake(uint8_t body)
+{
+    atomic_set_bit(&lpn_awake_bodies, body);
+    k_work_reschedule(&lpn_idle_work, K_MSEC(CONFIG_MESH_MODULE_LPN_WAKE_TIMEOUT));
+    if (!atomic_set(&lpn_fast_poll, true)) {
+        k_work_reschedule(&lpn_poll_work, K_NO_WAIT);
+    }
+}
+
+/* Keeps polling fast for the linger time, so the movement of a following
+ * round is picked up as fast as a staged one.
+ */
+static void lpn_sleep(uint8_t body)
+{
+    atomic_clear_bit(&lpn_awake_bodies, body);
+    if (atomic_get(&lpn_awake_bodies) == 0) {
+        k_work_reschedule(&lpn_idle_work, K_MSEC(CONFIG_MESH_MODULE_LPN_LINGER));
+    }
+}
+#else
+static void lpn_wake(uint8_t body) {}
+static void lpn_sleep(uint8_t body) {}
+#endif
+
 /* Convenience functions used in internal state handling. */
 static char *state2str(enum state_type state)
 {
@@ -126,8 +199,12 @@ static struct bt_mesh_health_srv health_srv = {
 
 BT_MESH_HEALTH_PUB_DEFINE(health_pub, 0);
 
+static struct bt_mesh_robot_srv robot[ROBOT_BODY_COUNT];
+static struct bt_mesh_light_rgb_srv light_rgb[ROBOT_BODY_COUNT];
+
 static uint8_t * handle_robot_identify(struct bt_mesh_robot_srv *srv)
 {
+    uint8_t body = srv - robot;
     size_t count;
     
     bt_id_get(&addr, &count);
@@ -135,8 +212,39 @@ static uint8_t * handle_robot_identify(struct bt_mesh_robot_srv *srv)
         LOG_ERR("No ids found");
         return NULL;
     }
+
+    /* Body 0 keeps the device address so single body robots are unchanged,
+     * the others get a unique id by offsetting the first byte.
+     */
+    memcpy(body_ids[body], addr.a.val, CONFIG_BT_MESH_ID_LEN);
+    body_ids[body][0] += body;
     
-    return addr.a.val;
+    return body_ids[body];
+}
+
+static void handle_robot_configure(struct bt_mesh_robot_srv *srv,
+                    const struct bt_mesh_movement_set *movement)
+{
+    /* Poll fast until the movement is done, so the ready message is not
+     * held back in the friend queue until the next idle poll.
+     */
+    lpn_wake(srv - robot);
+
+    struct mesh_module_event *event = new_mesh_module_event();
+    event->type = MESH_EVT_CONFIGURED;
+    event->body = srv - robot;
+    APP_EVENT_SUBMIT(event);
+}
+
+/* A movement for the next round may be staged while the current one runs. */
+static bool robot_has_staged(struct bt_mesh_robot_srv *srv)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(srv->staged); i++) {
+        if (srv->staged[i].valid) {
+            return true;
+        }
+    }
+    return false;
 }
 
 static void handle_robot_move (struct bt_mesh_robot_srv *srv,
@@ -144,28 +252,36 @@ static void handle_robot_move (struct bt_mesh_robot_srv *srv,
 {
     struct mesh_module_event *event = new_mesh_module_event();
     event->type = MESH_EVT_MOVE;
-    event->data.move.time = movement->time;
-    event->data.move.angle = movement->angle;
-    event->data.move.speed = movement->speed;
+    event->body = srv - robot;
+    event->data.move.movement.time = movement->time;
+    event->data.move.movement.angle = movement->angle;
+    event->data.move.movement.speed = movement->speed;
+    event->data.move.stop = srv->movement_stop;
     APP_EVENT_SUBMIT(event);
     
 }
 
+static void handle_robot_calibrate(struct bt_mesh_robot_srv *srv)
+{
+    struct mesh_module_event *event = new_mesh_module_event();
+    event->type = MESH_EVT_CALIBRATE;
+    event->body = srv - robot;
+    APP_EVENT_SUBMIT(event);
+}
+
 static const struct bt_mesh_robot_srv_handlers robot_cb = {
 	.identify = handle_robot_identify,
+    .configure = handle_robot_configure,
     .move = handle_robot_move,
+    .calibrate = handle_robot_calibrate,
 };
 
-static struct bt_mesh_robot_srv robot = {
-    .handlers = &robot_cb,
-};
-
-
 static void handle_light_rgb_set (struct bt_mesh_light_rgb_srv *srv, 
 			struct bt_mesh_light_rgb_set *rgb) 
 {
     struct mesh_module_event *event = new_mesh_module_event();
     event->type = MESH_EVT_RGB;
+    event->body = srv - light_rgb;
     event->data.rgb.red = rgb->red;
     event->data.rgb.green = rgb->green;
     event->data.rgb.blue = rgb->blue;
@@ -177,23 +293,39 @@ static const struct bt_mesh_light_rgb_srv_handlers light_rgb_cb = {
 	.set = handle_light_rgb_set,
 };
 
-static struct bt_mesh_light_rgb_srv light_rgb = {
-    .handlers = &light_rgb_cb,
+static struct bt_mesh_robot_srv robot[ROBOT_BODY_COUNT] = {
+    [0 ... ROBOT_BODY_COUNT - 1] = {
+        .handlers = &robot_cb,
+    },
+};
+
+static struct bt_mesh_light_rgb_srv light_rgb[ROBOT_BODY_COUNT] = {
+    [0 ... ROBOT_BODY_COUNT - 1] = {
+        .handlers = &light_rgb_cb,
+    },
 };
 
 /* Composition */
-static struct bt_mesh_elem elements[] = {
-    BT_MESH_ELEM(
-		0,
-        BT_MESH_MODEL_LIST(
-            BT_MESH_MODEL_CFG_SRV,
-            BT_MESH_MODEL_HEALTH_SRV(&health_srv, &health_pub)
-        ),
-        BT_MESH_MODEL_LIST( 
-            BT_MESH_MODEL_ROBOT_SRV(&robot),
-            BT_MESH_MODEL_LIGHT_RGB_SRV(&light_rgb)
-        )
+
+/* One element per robot body. The primary element also carries the
+ * foundation models.
+ */
+#define ROBOT_BODY_ELEM(inst, _)                                        \
+    BT_MESH_ELEM(                                                       \
+        inst,                                                           \
+        COND_CODE_0(inst,                                               \
+            (BT_MESH_MODEL_LIST(                                        \
+                BT_MESH_MODEL_CFG_SRV,                                  \
+                BT_MESH_MODEL_HEALTH_SRV(&health_srv, &health_pub))),   \
+            (BT_MESH_MODEL_NONE)),                                      \
+        BT_MESH_MODEL_LIST(                                             \
+            BT_MESH_MODEL_ROBOT_SRV(&robot[inst]),                      \
+            BT_MESH_MODEL_LIGHT_RGB_SRV(&light_rgb[inst])               \
+        )                                                               \
     )
+
+static struct bt_mesh_elem elements[] = {
+    LISTIFY(ROBOT_BODY_COUNT, ROBOT_BODY_ELEM, (,))
 };
 
 static struct bt_mesh_comp comp = {
@@ -208,11 +340,45 @@ static void on_all_states(struct mesh_msg_data *msg)
     {
         if (msg->event.motor.type == MOTOR_EVT_MOVEMENT_REPORT)
         {
+            if (msg->event.motor.body >= ROBOT_BODY_COUNT) {
+                LOG_ERR("Invalid body index %d", msg->event.motor.body);
+                return;
+            }
+
             struct bt_mesh_telemetry_report telemetry = {
                 .revolutions = msg->event.motor.data.report.revolutions,
             };
+            struct bt_mesh_telemetry_power power = {
+                .battery = msg->event.motor.data.report.battery_mv,
+                .current = msg->event.motor.data.report.current_ma,
+                .flags = msg->event.motor.data.report.power_flags,
+            };
             
-            bt_mesh_robot_report_telemetry(&robot, telemetry);
+            /* Robots without power monitoring keep the short report. */
+            bt_mesh_robot_report_telemetry(&robot[msg->event.motor.body], telemetry,
+                                           IS_ENABLED(CONFIG_POWER_MODULE) ? &power : NULL);
+
+            /* Stay awake for the ready message of a staged round. */
+            if (!robot_has_staged(&robot[msg->event.motor.body])) {
+                lpn_sleep(msg->event.motor.body);
+            }
+        }
+
+        if (msg->event.motor.type == MOTOR_EVT_CALIBRATION_DONE &&
+            msg->event.motor.body < ROBOT_BODY_COUNT)
+        {
+            struct bt_mesh_calibration_status status = {
+                .err = msg->event.motor.data.calibration.err,
+                .turn_rate = msg->event.motor.data.calibration.turn_rate,
+                .speed = msg->event.motor.data.calibration.speed,
+                .turn_offset = msg->event.motor.data.calibration.turn_offset,
+                .drive_offset = msg->event.motor.data.calibration.drive_offset,
+            };
+            int err = bt_mesh_robot_calibration_status(&robot[msg->event.motor.body], status);
+
+            if (err) {
+                LOG_ERR("Failed to send calibration status: Error %d", err);
+            }
         }
     }
 }
@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr.h>
+#include <settings/settings.h>
+#include <stdlib.h>
+
+#include "motor_calibration.h"
+#include "robot_body.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(motor_calibration, CONFIG_MOTOR_MODULE_LOG_LEVEL);
+
+#define CALIBRATION_SETTINGS_KEY "motor_cal"
+
+static struct motor_calibration calibrations[ROBOT_BODY_COUNT];
+static bool calibrated[ROBOT_BODY_COUNT];
+
+const struct motor_calibration *motor_calibration_get(uint8_t body)
+{
+    if (body >= ROBOT_BODY_COUNT || !calibrated[body])
+    {
+        return NULL;
+    }
+    return &calibrations[body];
+}
+
+int motor_calibration_set(uint8_t body, const struct motor_calibration *cal)
+{
+    char key[sizeof(CALIBRATION_SETTINGS_KEY "/255")];
+    int err;
+
+    if (body >= ROBOT_BODY_COUNT)
+    {
+        return -EINVAL;
+    }
+
+    calibrations[body] = *cal;
+    calibrated[body] = true;
+
+    snprintk(key, sizeof(key), CALIBRATION_SETTINGS_KEY "/%d", body);
+    err = settings_save_one(key, cal, sizeof(*cal));
+    if (err)
+    {
+        LOG_ERR("Failed to store calibration of body %d: Error %d", body, err);
+        return err;
+    }
+    return 0;
+}
+
+static int calibration_settings_set(const char *name, size_t len,
+                                    settings_read_cb read_cb, void *cb_arg)
+{
+    struct motor_calibration cal;
+    unsigned long body;
+    char *end;
+    int rc;
+
+    body = strtoul(name, &end, 10);
+    if (end == name || body >= ROBOT_BODY_COUNT)
+    {
+        return -ENOENT;
+    }
+
+    if (len != sizeof(cal))
+    {
+        LOG_WRN("Discarding stored calibration of body %lu of unexpected size", body);
+        return -EINVAL;
+    }
+
+    rc = read_cb(cb_arg, &cal, sizeof(cal));
+    if (rc < 0)
+    {
+        return rc;
+    }
+
+    calibrations[body] = cal;
+    calibrated[body] = true;
+    LOG_INF("Body %lu calibrated: turn rate %d deg/s", body, cal.turn_rate_dps);
+    return 0;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(motor_calibration, CALIBRATION_SETTINGS_KEY, NULL,
+                               calibration_settings_set, NULL, NULL);
@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#pragma once
+
+#include <zephyr.h>
+
+/** Number of motor powers the wheel speeds are measured at. */
+#define MOTOR_CALIBRATION_POINTS 4
+
+/** Motor power of calibration point @p idx, in percent. */
+#define MOTOR_CALIBRATION_POWER(idx) (100 * ((idx) + 1) / MOTOR_CALIBRATION_POINTS)
+
+/** Measured motion model of a robot body. */
+struct motor_calibration
+{
+    /* Ground speed of the left and right wheel at each calibration power,
+     * in mm/s. Between the points the speed is taken to be linear in the
+     * power, which gives a gain and offset per power range.
+     */
+    uint16_t speed_mm_s[2][MOTOR_CALIBRATION_POINTS];
+    /* Turn rate on the spot at full power, in degrees per second */
+    uint16_t turn_rate_dps;
+    /* Time a turn and a drive take beyond the steady speed model, to spin
+     * up and stop. Negative if the body runs on further than it lags.
+     */
+    int16_t turn_offset_ms;
+    int16_t drive_offset_ms;
+};
+
+#if defined(CONFIG_MOTOR_CALIBRATION)
+
+/**
+ * @brief Get the calibration of a robot body.
+ *
+ * @param body Index of the body.
+ * @return Calibration of the body, or NULL if it is not calibrated.
+ */
+const struct motor_calibration *motor_calibration_get(uint8_t body);
+
+/**
+ * @brief Apply and store the calibration of a robot body.
+ *
+ * @param body Index of the body.
+ * @param cal Calibration of the body.
+ * @return 0 on success, negative errno code if it could not be stored. The
+ *         calibration is applied until reboot in that case.
+ */
+int motor_calibration_set(uint8_t body, const struct motor_calibration *cal);
+
+#else
+
+static inline const struct motor_calibration *motor_calibration_get(uint8_t body)
+{
+    return NULL;
+}
+
+static inline int motor_calibration_set(uint8_t body, const struct motor_calibration *cal)
+{
+    return -ENOTSUP;
+}
+
+#endif
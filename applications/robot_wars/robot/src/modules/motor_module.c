@@ -8,9 +8,13 @@
 #define MODULE motor
 #include "../events/mesh_module_event.h"
 #include "../events/motor_module_event.h"
+#include "../events/power_module_event.h"
 #include "../events/ui_module_event.h"
 
 #include "../../drivers/motors/motor.h"
+#include "heading_hold.h"
+#include "motor_calibration.h"
+#include "robot_body.h"
 
 #include <zephyr/logging/log.h>
 LOG_MODULE_REGISTER(MODULE, CONFIG_MOTOR_MODULE_LOG_LEVEL);
@@ -22,6 +26,7 @@ struct motor_msg_data
         struct ui_module_event ui;
         struct mesh_module_event mesh;
         struct motor_module_event motor;
+        struct power_module_event power;
     } event;
 };
 
@@ -32,19 +37,102 @@ struct motor_msg_data
 K_MSGQ_DEFINE(msgq_motor, sizeof(struct motor_msg_data),
 	      MOTOR_QUEUE_ENTRY_COUNT, MOTOR_QUEUE_BYTE_ALIGNMENT);
 
-struct bt_mesh_movement_set movement;
-
 /* motor module super states. */
 enum state_type
 {
     STATE_MOTOR_STANDBY,
     STATE_MOTOR_TURNING,
     STATE_MOTOR_MOVING, 
-} state;
+    STATE_MOTOR_CALIBRATING,
+};
+
+/* Steps of the motion calibration, each run from the calibration work */
+enum calibration_step
+{
+    CALIBRATION_SPEED_START,
+    CALIBRATION_SPEED_END,
+    CALIBRATION_DRIVE_START,
+    CALIBRATION_DRIVE_STOP,
+    CALIBRATION_DRIVE_END,
+    CALIBRATION_TURN_START,
+    CALIBRATION_TURN_STOP,
+    CALIBRATION_TURN_END,
+};
+
+/* Number of calibration turns, of increasing length */
+#define CALIBRATION_TURNS 2
+
+struct calibration_run
+{
+    enum calibration_step step;
+    /* Calibration point or turn being measured */
+    uint8_t idx;
+    /* Motor positions and uptime at the start of the measurement */
+    int32_t start[2];
+    int64_t start_time;
+    /* Heading change of each turn, in millidegrees */
+    int32_t turn_mdeg[CALIBRATION_TURNS];
+    struct motor_calibration cal;
+};
+
+/* Per body module data */
+struct motor_body
+{
+    /* Left and right motor, updated together through the group */
+    const struct device *motors[2];
+    struct motor_group group;
+    struct bt_mesh_movement_set movement;
+    /* Stop mode of the movement, see bt_mesh_movement_stop */
+    uint8_t stop;
+    enum state_type state;
+    struct k_work_delayable stop_motor_work;
+    /* Releases the motors after a timed brake */
+    struct k_work_delayable coast_work;
+    uint8_t revolution_report;
+    /* Wheel geometry, to measure the motion from the motor positions */
+    uint16_t wheel_diameter_mm;
+    uint16_t track_width_mm;
+    struct calibration_run calibration;
+    struct k_work_delayable calibration_work;
+    /* Power summary of the running movement */
+    uint16_t current_peak_ma;
+    uint8_t power_flags;
+};
+
+#define MOTOR_BODY_INIT(inst, _)                                                     \
+    {                                                                               \
+        .motors = {                                                                 \
+            DEVICE_DT_GET(DT_PHANDLE_BY_IDX(ROBOT_BODY_NODE(inst), motors, 0)),     \
+            DEVICE_DT_GET(DT_PHANDLE_BY_IDX(ROBOT_BODY_NODE(inst), motors, 1)),     \
+        },                                                                          \
+        .group = {                                                                  \
+            .motors = bodies[inst].motors,                                          \
+            .count = 2,                                                             \
+        },                                                                          \
+        .revolution_report = 1,                                                     \
+        .wheel_diameter_mm = DT_PROP(ROBOT_BODY_NODE(inst), wheel_diameter_mm),     \
+        .track_width_mm = DT_PROP(ROBOT_BODY_NODE(inst), track_width_mm),           \
+    }
+
+static struct motor_body bodies[ROBOT_BODY_COUNT] = {
+    LISTIFY(ROBOT_BODY_COUNT, MOTOR_BODY_INIT, (,))
+};
+
+#if defined(CONFIG_MOTOR_STOP_DEFAULT_COAST)
+#define MOTOR_STOP_DEFAULT BT_MESH_MOVEMENT_STOP_COAST
+#elif defined(CONFIG_MOTOR_STOP_DEFAULT_BRAKE)
+#define MOTOR_STOP_DEFAULT BT_MESH_MOVEMENT_STOP_BRAKE
+#else
+#define MOTOR_STOP_DEFAULT BT_MESH_MOVEMENT_STOP_BRAKE_COAST
+#endif
+
+/* Filtered battery voltage, 0 until measured */
+static uint16_t battery_mv;
 
-/* Global module data */
-const struct device *device_motor_a = DEVICE_DT_GET(DT_ALIAS(motora));
-const struct device *device_motor_b = DEVICE_DT_GET(DT_ALIAS(motorb));
+/* Turn time of an uncalibrated body */
+#define MOTOR_TURN_US_PER_DEG 3000
+
+#define MOTOR_PI 3.14159265f
 
 /* Convenience functions used in internal state handling. */
 static char *state2str(enum state_type state)
@@ -57,24 +145,27 @@ static char *state2str(enum state_type state)
 		return "STATE_MOTOR_TURNING";
 	case STATE_MOTOR_MOVING:
 		return "STATE_MOTOR_MOVING";
+	case STATE_MOTOR_CALIBRATING:
+		return "STATE_MOTOR_CALIBRATING";
 	default:
 		return "Unknown state";
 	}
 }
 
-static void state_set(enum state_type new_state)
+static void state_set(struct motor_body *body, enum state_type new_state)
 {
-	if (new_state == state)
+	if (new_state == body->state)
 	{
-		LOG_INF("State: %s", state2str(state));
+		LOG_INF("State: %s", state2str(body->state));
 		return;
 	}
 
-	LOG_INF("State transition %s --> %s",
-			state2str(state),
+	LOG_INF("Body %d state transition %s --> %s",
+			(int)(body - bodies),
+			state2str(body->state),
 			state2str(new_state));
 
-	state = new_state;
+	body->state = new_state;
 }
 
 /* Event handling */
@@ -101,6 +192,12 @@ static bool app_event_handler(const struct app_event_header *header)
         enqueue = true;
     }
 
+    if (is_power_module_event(header))
+    {
+        msg.event.power = *cast_power_module_event(header);
+        enqueue = true;
+    }
+
     if (enqueue)
     {
         int err = k_msgq_put(&msgq_motor, &msg, K_FOREVER);
@@ -114,21 +211,192 @@ static bool app_event_handler(const struct app_event_header *header)
 }
 
 /* Motor actuation */
+
+/* Scales the power up as the battery discharges, so that the motors get
+ * the average voltage they would get from a battery at nominal voltage.
+ */
+static uint8_t battery_compensate(uint8_t power)
+{
+#if defined(CONFIG_POWER_MODULE)
+    if (battery_mv > 0)
+    {
+        return MIN((uint32_t)power * CONFIG_POWER_NOMINAL_BATTERY_MV / battery_mv, 100);
+    }
+#endif
+    return power;
+}
+
+/* Sets both motors of a body in one update, so that they start and stop
+ * together and the body keeps its heading.
+ */
+static int drive_body(struct motor_body *body, uint8_t power_a, bool direction_a,
+                      uint8_t power_b, bool direction_b)
+{
+    const struct motor_command commands[] = {
+        { .power_numerator = battery_compensate(power_a), .power_denominator = 100, .direction = direction_a },
+        { .power_numerator = battery_compensate(power_b), .power_denominator = 100, .direction = direction_b },
+    };
+    struct k_work_sync sync;
+
+    /* A pending release of a timed brake must not stop the new drive, and
+     * a heading hold must not override it.
+     */
+    k_work_cancel_delayable_sync(&body->coast_work, &sync);
+    heading_hold_release(body - bodies);
+    return motor_group_drive_continous(&body->group, commands);
+}
+
+static void coast_work_fn(struct k_work *work)
+{
+    struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+    struct motor_body *body = CONTAINER_OF(dwork, struct motor_body, coast_work);
+
+    motor_group_stop(&body->group, MOTOR_STOP_COAST);
+}
+
+/* Braking stops the body in a fraction of the distance it rolls out when
+ * coasting, so both the turn and the drive end closer to their target.
+ */
+static void stop_body(struct motor_body *body, uint8_t stop)
+{
+    enum motor_stop_mode mode;
+    int err;
+
+    if (stop == BT_MESH_MOVEMENT_STOP_DEFAULT)
+    {
+        stop = MOTOR_STOP_DEFAULT;
+    }
+
+    mode = (stop == BT_MESH_MOVEMENT_STOP_COAST) ? MOTOR_STOP_COAST : MOTOR_STOP_BRAKE;
+    k_work_cancel_delayable(&body->coast_work);
+    heading_hold_rest(body - bodies);
+    err = motor_group_stop(&body->group, mode);
+    if (err == -ENOTSUP)
+    {
+        LOG_DBG("Body %d can not %s, stopped in the supported mode",
+                (int)(body - bodies), (mode == MOTOR_STOP_BRAKE) ? "brake" : "coast");
+    }
+    else if (err)
+    {
+        LOG_ERR("Failed to stop body %d: Error %d", (int)(body - bodies), err);
+    }
+
+    if (stop == BT_MESH_MOVEMENT_STOP_BRAKE_COAST)
+    {
+        k_work_schedule(&body->coast_work, K_MSEC(CONFIG_MOTOR_BRAKE_TIME_MS));
+    }
+}
+
 static void stop_motor_work_fn(struct k_work *work)
 {
-    motor_drive_continous(device_motor_a, 0, 100, 1);
-    motor_drive_continous(device_motor_b, 0, 100, 1);
+    struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+    struct motor_body *body = CONTAINER_OF(dwork, struct motor_body, stop_motor_work);
+
+    stop_body(body, body->stop);
     struct motor_module_event *event = new_motor_module_event();
     event->type = MOTOR_EVT_MOVEMENT_DONE;
+    event->body = body - bodies;
     APP_EVENT_SUBMIT(event);
 }
 
-K_WORK_DELAYABLE_DEFINE(stop_motor_work, stop_motor_work_fn);
+/* Motion model */
+
+/* Time a turn on the spot by angle degrees takes. */
+static uint32_t turn_time_us(struct motor_body *body, uint32_t angle)
+{
+    const struct motor_calibration *cal = motor_calibration_get(body - bodies);
+    int64_t time_us;
+
+    if (!cal)
+    {
+        return angle * MOTOR_TURN_US_PER_DEG;
+    }
+
+    time_us = (int64_t)angle * 1000000 / cal->turn_rate_dps + cal->turn_offset_ms * 1000;
+    return MAX(time_us, 0);
+}
+
+#if defined(CONFIG_MOTOR_CALIBRATION)
+
+/* Power that drives a wheel at speed_mm_s, interpolated between the
+ * calibration points. A point that is no faster than the one below it,
+ * like one in the dead band of the motor, only raises the power the next
+ * range starts from.
+ */
+static uint8_t wheel_power(const uint16_t *speeds, uint16_t speed_mm_s)
+{
+    uint16_t speed_prev = 0;
+    uint8_t power_prev = 0;
+
+    for (size_t i = 0; i < MOTOR_CALIBRATION_POINTS; i++)
+    {
+        uint8_t power = MOTOR_CALIBRATION_POWER(i);
+
+        if (speeds[i] > speed_prev && speed_mm_s <= speeds[i])
+        {
+            return power_prev + (power - power_prev) * (speed_mm_s - speed_prev) /
+                                (speeds[i] - speed_prev);
+        }
+
+        speed_prev = MAX(speed_prev, speeds[i]);
+        power_prev = power;
+    }
+    return 100;
+}
+
+/* Sets the power of each wheel so that the body drives at the calibrated
+ * ground speed for the commanded speed, and straight. A body that can not
+ * reach that speed drives longer, to cover the same distance.
+ */
+static void drive_scale(struct motor_body *body, uint32_t *time, uint8_t speed,
+                        uint8_t power[2])
+{
+    const struct motor_calibration *cal = motor_calibration_get(body - bodies);
+    uint32_t target;
+    uint16_t reach;
+
+    power[0] = speed;
+    power[1] = speed;
+    if (!cal || speed == 0 || *time == 0)
+    {
+        return;
+    }
+
+    target = CONFIG_MOTOR_CALIBRATION_SPEED_MM_S * speed / 100;
+    reach = MIN(cal->speed_mm_s[0][MOTOR_CALIBRATION_POINTS - 1],
+                cal->speed_mm_s[1][MOTOR_CALIBRATION_POINTS - 1]);
+    if (reach == 0)
+    {
+        /* Not a usable calibration, drive uncalibrated. */
+        return;
+    }
+
+    if (target > reach)
+    {
+        *time = (uint64_t)*time * target / reach;
+        target = reach;
+    }
+
+    power[0] = wheel_power(cal->speed_mm_s[0], target);
+    power[1] = wheel_power(cal->speed_mm_s[1], target);
+    *time = MAX((int64_t)*time + cal->drive_offset_ms, 0);
+}
+
+#else
 
-static int turn_degrees(int32_t angle)
+static void drive_scale(struct motor_body *body, uint32_t *time, uint8_t speed,
+                        uint8_t power[2])
+{
+    power[0] = speed;
+    power[1] = speed;
+}
+
+#endif /* CONFIG_MOTOR_CALIBRATION */
+
+static int turn_degrees(struct motor_body *body, int32_t angle)
 {
     if (angle == 0) {
-        k_work_schedule(&stop_motor_work, K_USEC(1000));
+        k_work_schedule(&body->stop_motor_work, K_USEC(1000));
         return 0;
     }
 
@@ -138,111 +406,487 @@ static int turn_degrees(int32_t angle)
 
     if (angle < 0)
     {
-        motor_drive_continous(device_motor_a, 100, 100, 1);
-        motor_drive_continous(device_motor_b, 100, 100, 0);
+        drive_body(body, 100, 1, 100, 0);
     } else {
-        motor_drive_continous(device_motor_a, 100, 100, 0);
-        motor_drive_continous(device_motor_b, 100, 100, 1);
+        drive_body(body, 100, 0, 100, 1);
     }
     
-    k_work_schedule(&stop_motor_work, K_USEC(abs(angle)*3000));
+    k_work_schedule(&body->stop_motor_work, K_USEC(turn_time_us(body, abs(angle))));
     return 0;
 }
 
-static int drive_forward(uint32_t time, uint8_t speed)
+static int drive_forward(struct motor_body *body, uint32_t time, uint8_t speed)
+{
+    uint8_t power[2];
+
+    drive_scale(body, &time, speed, power);
+    drive_body(body, power[0], 1, power[1], 1);
+
+    /* A body that is not to drive stands still, without corrections. */
+    if (speed != 0 && time != 0 &&
+        heading_hold_drive(body - bodies, battery_compensate(power[0]),
+                           battery_compensate(power[1])) == -ENODEV)
+    {
+        LOG_DBG("Body %d has no gyroscope, driving open loop", (int)(body - bodies));
+    }
+    k_work_schedule(&body->stop_motor_work, K_MSEC(time));
+    return 0;
+}
+
+/* Motion calibration
+ *
+ * The body drives and turns on the spot through a fixed routine, and the
+ * motion is measured from the positions of its motors. Every step is run
+ * from the calibration work, so the module thread keeps handling events.
+ */
+
+static void calibration_report(struct motor_body *body, int err)
+{
+    const struct motor_calibration *cal = &body->calibration.cal;
+    struct motor_module_event *event = new_motor_module_event();
+
+    event->type = MOTOR_EVT_CALIBRATION_DONE;
+    event->body = body - bodies;
+    event->data.calibration.err = err;
+    event->data.calibration.turn_rate = cal->turn_rate_dps;
+    /* The slower wheel sets the speed drives are scaled to. */
+    event->data.calibration.speed = MIN(cal->speed_mm_s[0][MOTOR_CALIBRATION_POINTS - 1],
+                                        cal->speed_mm_s[1][MOTOR_CALIBRATION_POINTS - 1]);
+    event->data.calibration.turn_offset = cal->turn_offset_ms;
+    event->data.calibration.drive_offset = cal->drive_offset_ms;
+    APP_EVENT_SUBMIT(event);
+}
+
+#if defined(CONFIG_MOTOR_CALIBRATION)
+
+static int body_position(struct motor_body *body, int32_t position[2])
 {
-    motor_drive_continous(device_motor_a, speed, 100, 1);
-    motor_drive_continous(device_motor_b, speed, 100, 1);
-    k_work_schedule(&stop_motor_work, K_MSEC(time));
+    int err;
+
+    for (size_t i = 0; i < 2; i++)
+    {
+        err = motor_get_position(body->motors[i], &position[i]);
+        if (err)
+        {
+            return err;
+        }
+    }
     return 0;
 }
 
+/* Distance a wheel rolled for a change in motor position in millidegrees. */
+static float wheel_mm(struct motor_body *body, int32_t delta_mdeg)
+{
+    return delta_mdeg * MOTOR_PI * body->wheel_diameter_mm / 360000.0f;
+}
+
+static uint32_t calibration_turn_ms(uint8_t idx)
+{
+    return CONFIG_MOTOR_CALIBRATION_TURN_MS * (idx + 1) / CALIBRATION_TURNS;
+}
+
+static void calibration_next(struct motor_body *body, enum calibration_step step,
+                             uint32_t delay_ms)
+{
+    body->calibration.step = step;
+    k_work_schedule(&body->calibration_work, K_MSEC(delay_ms));
+}
+
+static void calibration_done(struct motor_body *body, int err)
+{
+    stop_body(body, BT_MESH_MOVEMENT_STOP_DEFAULT);
+
+    if (err)
+    {
+        LOG_ERR("Calibration of body %d failed: Error %d", (int)(body - bodies), err);
+    }
+    else
+    {
+        /* A calibration that could not be stored is still applied. */
+        err = motor_calibration_set(body - bodies, &body->calibration.cal);
+    }
+
+    calibration_report(body, err);
+}
+
+/* Fits the turn rate and the spin up and stop offset to the two turns. */
+static int calibration_turn_fit(struct motor_body *body)
+{
+    struct calibration_run *run = &body->calibration;
+    int32_t delta_mdeg = run->turn_mdeg[1] - run->turn_mdeg[0];
+    uint32_t delta_ms = calibration_turn_ms(1) - calibration_turn_ms(0);
+
+    if (run->turn_mdeg[0] <= 0 || delta_mdeg <= 0)
+    {
+        return -EIO;
+    }
+
+    /* Millidegrees per millisecond are degrees per second. */
+    run->cal.turn_rate_dps = delta_mdeg / delta_ms;
+    if (run->cal.turn_rate_dps == 0)
+    {
+        return -EIO;
+    }
+
+    run->cal.turn_offset_ms = calibration_turn_ms(0) -
+                              (int64_t)run->turn_mdeg[0] * delta_ms / delta_mdeg;
+    return 0;
+}
+
+static void calibration_work_fn(struct k_work *work)
+{
+    struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+    struct motor_body *body = CONTAINER_OF(dwork, struct motor_body, calibration_work);
+    struct calibration_run *run = &body->calibration;
+    struct motor_calibration *cal = &run->cal;
+    int64_t now = k_uptime_get();
+    int32_t position[2];
+    float left_mm;
+    float right_mm;
+    uint8_t power;
+    int err;
+
+    err = body_position(body, position);
+    if (err)
+    {
+        calibration_done(body, err);
+        return;
+    }
+
+    left_mm = wheel_mm(body, position[0] - run->start[0]);
+    right_mm = wheel_mm(body, position[1] - run->start[1]);
+
+    switch (run->step)
+    {
+    case CALIBRATION_SPEED_START:
+        /* The speed has settled, measure over the rest of the step. */
+        calibration_next(body, CALIBRATION_SPEED_END, CONFIG_MOTOR_CALIBRATION_STEP_MS / 2);
+        break;
+    case CALIBRATION_SPEED_END:
+        cal->speed_mm_s[0][run->idx] = MAX(left_mm, 0.0f) * 1000 / (now - run->start_time);
+        cal->speed_mm_s[1][run->idx] = MAX(right_mm, 0.0f) * 1000 / (now - run->start_time);
+        LOG_DBG("Body %d at power %d: %d and %d mm/s", (int)(body - bodies),
+                MOTOR_CALIBRATION_POWER(run->idx), cal->speed_mm_s[0][run->idx],
+                cal->speed_mm_s[1][run->idx]);
+
+        if (++run->idx < MOTOR_CALIBRATION_POINTS)
+        {
+            power = MOTOR_CALIBRATION_POWER(run->idx);
+            drive_body(body, power, 1, power, 1);
+            calibration_next(body, CALIBRATION_SPEED_START, CONFIG_MOTOR_CALIBRATION_STEP_MS / 2);
+        }
+        else
+        {
+            stop_body(body, BT_MESH_MOVEMENT_STOP_DEFAULT);
+            calibration_next(body, CALIBRATION_DRIVE_START, CONFIG_MOTOR_CALIBRATION_REST_MS);
+        }
+        return;
+    case CALIBRATION_DRIVE_START:
+        drive_body(body, 100, 1, 100, 1);
+        calibration_next(body, CALIBRATION_DRIVE_STOP, CONFIG_MOTOR_CALIBRATION_STEP_MS);
+        break;
+    case CALIBRATION_DRIVE_STOP:
+    case CALIBRATION_TURN_STOP:
+        stop_body(body, BT_MESH_MOVEMENT_STOP_DEFAULT);
+        calibration_next(body, run->step + 1, CONFIG_MOTOR_CALIBRATION_REST_MS);
+        return;
+    case CALIBRATION_DRIVE_END:
+    {
+        /* Time the drive lost to spin up and gained in run out, against a
+         * steady drive at the full power speed.
+         */
+        uint16_t left = cal->speed_mm_s[0][MOTOR_CALIBRATION_POINTS - 1];
+        uint16_t right = cal->speed_mm_s[1][MOTOR_CALIBRATION_POINTS - 1];
+        float speed = (left + right) / 2.0f;
+
+        /* A wheel that did not turn at full power can not be scaled to. */
+        if (left == 0 || right == 0)
+        {
+            calibration_done(body, -EIO);
+            return;
+        }
+
+        cal->drive_offset_ms = CONFIG_MOTOR_CALIBRATION_STEP_MS -
+                               (left_mm + right_mm) / 2.0f * 1000.0f / speed;
+        run->idx = 0;
+        calibration_next(body, CALIBRATION_TURN_START, 0);
+        return;
+    }
+    case CALIBRATION_TURN_START:
+        drive_body(body, 100, 0, 100, 1);
+        calibration_next(body, CALIBRATION_TURN_STOP, calibration_turn_ms(run->idx));
+        break;
+    case CALIBRATION_TURN_END:
+        run->turn_mdeg[run->idx] = (right_mm - left_mm) * 180000.0f /
+                                   (MOTOR_PI * body->track_width_mm);
+        if (++run->idx < CALIBRATION_TURNS)
+        {
+            calibration_next(body, CALIBRATION_TURN_START, 0);
+            return;
+        }
+
+        calibration_done(body, calibration_turn_fit(body));
+        return;
+    }
+
+    /* The measurement of the step starts here. */
+    run->start[0] = position[0];
+    run->start[1] = position[1];
+    run->start_time = now;
+}
+
+static int calibration_start(struct motor_body *body)
+{
+    int32_t position[2];
+    int err;
+
+    body->calibration = (struct calibration_run){0};
+
+    /* Calibration needs the motor positions, fail before driving off. */
+    err = body_position(body, position);
+    if (err)
+    {
+        LOG_WRN("Body %d can not be calibrated: Error %d", (int)(body - bodies), err);
+        calibration_report(body, err);
+        return err;
+    }
+
+    LOG_INF("Calibrating body %d", (int)(body - bodies));
+    drive_body(body, MOTOR_CALIBRATION_POWER(0), 1, MOTOR_CALIBRATION_POWER(0), 1);
+    calibration_next(body, CALIBRATION_SPEED_START, CONFIG_MOTOR_CALIBRATION_STEP_MS / 2);
+    return 0;
+}
+
+#else
+
+static int calibration_start(struct motor_body *body)
+{
+    calibration_report(body, -ENOTSUP);
+    return -ENOTSUP;
+}
+
+#endif /* CONFIG_MOTOR_CALIBRATION */
+
+/* A body calibrates from standby only, so the routine has the floor. */
+static void calibration_reject(struct motor_body *body, struct motor_msg_data *msg)
+{
+    if (is_mesh_module_event((struct app_event_header *)(&msg->event.mesh)) &&
+        msg->event.mesh.type == MESH_EVT_CALIBRATE)
+    {
+        LOG_WRN("Body %d is busy, calibration rejected", (int)(body - bodies));
+        calibration_report(body, -EBUSY);
+    }
+}
+
+static void movement_report(struct motor_body *body)
+{
+    struct motor_module_event *event = new_motor_module_event();
+    event->type = MOTOR_EVT_MOVEMENT_REPORT;
+    event->body = body - bodies;
+    event->data.report.revolutions = body->revolution_report;
+    event->data.report.battery_mv = battery_mv;
+    event->data.report.current_ma = body->current_peak_ma;
+    event->data.report.power_flags = body->power_flags;
+#if defined(CONFIG_POWER_MODULE)
+    if (battery_mv > 0 && battery_mv < CONFIG_POWER_BATTERY_LOW_MV)
+    {
+        event->data.report.power_flags |= BT_MESH_TELEMETRY_POWER_FLAG_BATTERY_LOW;
+    }
+#endif
+    body->revolution_report++;
+    APP_EVENT_SUBMIT(event);
+}
+
+/* Power monitoring */
+
+static void on_power(struct power_module_event *evt)
+{
+    struct motor_body *body;
+
+    if (evt->body >= ROBOT_BODY_COUNT)
+    {
+        return;
+    }
+
+    body = &bodies[evt->body];
+    if (evt->type == POWER_EVT_MEASUREMENT)
+    {
+        battery_mv = evt->data.measurement.battery_mv;
+        body->current_peak_ma = MAX(body->current_peak_ma, evt->data.measurement.current_ma);
+    }
+    else if (evt->type == POWER_EVT_STALL &&
+             (body->state == STATE_MOTOR_TURNING || body->state == STATE_MOTOR_MOVING) &&
+             (k_work_delayable_busy_get(&body->stop_motor_work) & K_WORK_DELAYED))
+    {
+        /* Stop now, the movement ends as if its time was up. */
+        LOG_WRN("Body %d stalled, movement aborted", (int)(body - bodies));
+        body->power_flags |= BT_MESH_TELEMETRY_POWER_FLAG_STALL;
+        k_work_reschedule(&body->stop_motor_work, K_NO_WAIT);
+    }
+}
+
 /* State handling*/
-static int on_state_standby(struct motor_msg_data *msg)
+static int on_state_standby(struct motor_body *body, struct motor_msg_data *msg)
 {
     if (is_mesh_module_event((struct app_event_header *)(&msg->event.mesh)))
     {
         if (msg->event.mesh.type == MESH_EVT_MOVE)
         {
-            movement = msg->event.mesh.data.move;
-            state_set(STATE_MOTOR_TURNING);
-            turn_degrees(msg->event.mesh.data.move.angle);
+            body->movement = msg->event.mesh.data.move.movement;
+            body->stop = msg->event.mesh.data.move.stop;
+            body->current_peak_ma = 0;
+            body->power_flags = 0;
+            state_set(body, STATE_MOTOR_TURNING);
+            turn_degrees(body, body->movement.angle);
+        }
+        else if (msg->event.mesh.type == MESH_EVT_CALIBRATE)
+        {
+            if (!calibration_start(body))
+            {
+                state_set(body, STATE_MOTOR_CALIBRATING);
+            }
         }
     }
     return 0;
 }
 
-static int on_state_turning(struct motor_msg_data *msg)
+static int on_state_turning(struct motor_body *body, struct motor_msg_data *msg)
 {
     if (is_motor_module_event((struct app_event_header *)(&msg->event.motor)))
     {
-        if (msg->event.motor.type == MOTOR_EVT_MOVEMENT_DONE)
+        if (msg->event.motor.type == MOTOR_EVT_MOVEMENT_DONE &&
+            (body->power_flags & BT_MESH_TELEMETRY_POWER_FLAG_STALL))
+        {
+            /* The drive is skipped after a stalled turn. */
+            state_set(body, STATE_MOTOR_STANDBY);
+            movement_report(body);
+        }
+        else if (msg->event.motor.type == MOTOR_EVT_MOVEMENT_DONE)
         {
-            state_set(STATE_MOTOR_MOVING);
-            drive_forward(movement.time, movement.speed);
+            state_set(body, STATE_MOTOR_MOVING);
+            drive_forward(body, body->movement.time, body->movement.speed);
         }
     }
+    calibration_reject(body, msg);
     return 0;
 }
 
-static int on_state_moving(struct motor_msg_data *msg)
+static int on_state_moving(struct motor_body *body, struct motor_msg_data *msg)
 {
-    static uint8_t revolution_report = 1;
     if (is_motor_module_event((struct app_event_header *)(&msg->event.motor)))
     {
         if (msg->event.motor.type == MOTOR_EVT_MOVEMENT_DONE)
         {
-            state_set(STATE_MOTOR_STANDBY);
-            struct motor_module_event *event = new_motor_module_event();
-            event->type = MOTOR_EVT_MOVEMENT_REPORT;
-            event->data.report.revolutions = revolution_report;
-            revolution_report++;
-            APP_EVENT_SUBMIT(event);
+            state_set(body, STATE_MOTOR_STANDBY);
+            movement_report(body);
         }
     }
+    calibration_reject(body, msg);
+    return 0;
+}
+
+static int on_state_calibrating(struct motor_body *body, struct motor_msg_data *msg)
+{
+    if (is_motor_module_event((struct app_event_header *)(&msg->event.motor)))
+    {
+        if (msg->event.motor.type == MOTOR_EVT_CALIBRATION_DONE)
+        {
+            state_set(body, STATE_MOTOR_STANDBY);
+        }
+    }
+
+    if (is_mesh_module_event((struct app_event_header *)(&msg->event.mesh)) &&
+        msg->event.mesh.type == MESH_EVT_MOVE)
+    {
+        LOG_WRN("Body %d is calibrating, movement dropped", (int)(body - bodies));
+    }
+    calibration_reject(body, msg);
     return 0;
 }
 
 static int on_all_states(struct motor_msg_data *msg)
 {
+    /* Buttons drive the body on the primary element. */
+    struct motor_body *body = &bodies[0];
+
     if (is_ui_module_event((struct app_event_header *)(&msg->event.ui)))
     {
         if (msg->event.ui.type == UI_EVT_BUTTON)
         {
             if (msg->event.ui.data.button.action == BUTTON_PRESS) {
                 if (msg->event.ui.data.button.num == BTN1) {
-                    motor_drive_continous(device_motor_a, 100, 100, 1);
-                    motor_drive_continous(device_motor_b, 100, 100, 1);
+                    drive_body(body, 100, 1, 100, 1);
                 } else if (msg->event.ui.data.button.num == BTN2) {
-                    motor_drive_continous(device_motor_a, 0, 100, 1);
-                    motor_drive_continous(device_motor_b, 0, 100, 1);
+                    stop_body(body, BT_MESH_MOVEMENT_STOP_DEFAULT);
                 } else if (msg->event.ui.data.button.num == BTN3) {
-                    motor_drive_continous(device_motor_a, 100, 100, 0);
-                    motor_drive_continous(device_motor_b, 100, 100, 0);
+                    drive_body(body, 100, 0, 100, 0);
                 }
             }
         }
     }
+
+    if (is_power_module_event((struct app_event_header *)(&msg->event.power)))
+    {
+        on_power(&msg->event.power);
+    }
     return 0;
 }
 
+/* Returns the body a mesh or motor event applies to, or NULL for other events. */
+static struct motor_body *msg_body(struct motor_msg_data *msg)
+{
+    uint8_t idx;
+
+    if (is_mesh_module_event((struct app_event_header *)(&msg->event.mesh)))
+    {
+        idx = msg->event.mesh.body;
+    }
+    else if (is_motor_module_event((struct app_event_header *)(&msg->event.motor)))
+    {
+        idx = msg->event.motor.body;
+    }
+    else
+    {
+        return NULL;
+    }
+
+    if (idx >= ROBOT_BODY_COUNT)
+    {
+        LOG_ERR("Invalid body index %d", idx);
+        return NULL;
+    }
+
+    return &bodies[idx];
+}
+
 /* Setup */
 static int init_motors()
 {
     // LOG_DBG("Initializing motor drivers");
     int err;
-    err = !device_is_ready(device_motor_a);
-    if (err)
-    {
-        LOG_ERR("Motor a not ready: Error %d", err);
-        return err;
-    }
 
-    err = !device_is_ready(device_motor_b);
-    if (err)
+    for (size_t i = 0; i < ROBOT_BODY_COUNT; i++)
     {
-        LOG_ERR("Motor b not ready: Error %d", err);
-        return err;
+        err = !device_is_ready(bodies[i].motors[0]);
+        if (err)
+        {
+            LOG_ERR("Motor a of body %d not ready: Error %d", (int)i, err);
+            return err;
+        }
+
+        err = !device_is_ready(bodies[i].motors[1]);
+        if (err)
+        {
+            LOG_ERR("Motor b of body %d not ready: Error %d", (int)i, err);
+            return err;
+        }
+
+        k_work_init_delayable(&bodies[i].stop_motor_work, stop_motor_work_fn);
+        k_work_init_delayable(&bodies[i].coast_work, coast_work_fn);
+#if defined(CONFIG_MOTOR_CALIBRATION)
+        k_work_init_delayable(&bodies[i].calibration_work, calibration_work_fn);
+#endif
+        state_set(&bodies[i], STATE_MOTOR_STANDBY);
     }
     return 0;
 }
@@ -253,6 +897,7 @@ static void module_thread_fn(void)
     LOG_INF("motor module thread started");
     struct motor_msg_data msg;
 
+    struct motor_body *body;
     int err;
 
     err = init_motors();
@@ -260,32 +905,40 @@ static void module_thread_fn(void)
     { 
         return;
     }
-    state_set(STATE_MOTOR_STANDBY);
 
     while (true)
     {
         k_msgq_get(&msgq_motor, &msg, K_FOREVER);
-        
-        switch (state)
+
+        body = msg_body(&msg);
+        if (body)
         {
-            case STATE_MOTOR_STANDBY:
-            {
-                on_state_standby(&msg);
-                break;
-            }
-            case STATE_MOTOR_TURNING:
+            switch (body->state)
             {
-                on_state_turning(&msg);
-                break;
-            }
-            case STATE_MOTOR_MOVING:
-            {
-                on_state_moving(&msg);
-                break;
-            }
-            default:
-            {
-                LOG_ERR("Unknown motor module state %d", state);
+                case STATE_MOTOR_STANDBY:
+                {
+                    on_state_standby(body, &msg);
+                    break;
+                }
+                case STATE_MOTOR_TURNING:
+                {
+                    on_state_turning(body, &msg);
+                    break;
+                }
+                case STATE_MOTOR_MOVING:
+                {
+                    on_state_moving(body, &msg);
+                    break;
+                }
+                case STATE_MOTOR_CALIBRATING:
+                {
+                    on_state_calibrating(body, &msg);
+                    break;
+                }
+                default:
+                {
+                    LOG_ERR("Unknown motor module state %d", body->state);
+                }
             }
         }
         on_all_states(&msg);
@@ -298,4 +951,5 @@ K_THREAD_DEFINE(motor_module_thread, CONFIG_MOTOR_THREAD_STACK_SIZE,
 APP_EVENT_LISTENER(MODULE, app_event_handler);
 APP_EVENT_SUBSCRIBE(MODULE, mesh_module_event);
 APP_EVENT_SUBSCRIBE(MODULE, motor_module_event);
-APP_EVENT_SUBSCRIBE(MODULE, ui_module_event);
\ No newline at end of file
+APP_EVENT_SUBSCRIBE(MODULE, ui_module_event);
+APP_EVENT_SUBSCRIBE(MODULE, power_module_event);
\ No newline at end of file
@@ -0,0 +1,294 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr.h>
+#include <app_event_manager.h>
+#include <devicetree.h>
+#include <device.h>
+#include <drivers/adc.h>
+
+#if defined(CONFIG_ADC_NRFX_SAADC)
+#include <hal/nrf_saadc.h>
+#endif
+
+#define MODULE power
+#include "../events/power_module_event.h"
+
+#include "robot_body.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(MODULE, CONFIG_POWER_MODULE_LOG_LEVEL);
+
+#define POWER_NODE DT_INST(0, nordic_robot_power)
+
+#define POWER_ADC_RESOLUTION 12
+#define POWER_ADC_GAIN ADC_GAIN_1_6
+
+/* Measured by the channel of the battery voltage instead of a body */
+#define POWER_CHANNEL_BATTERY 0xFF
+
+/* Battery voltage is averaged over this many blocks, as a power of two */
+#define POWER_BATTERY_FILTER_SHIFT 3
+
+#define POWER_BLOCK_MS (CONFIG_POWER_BLOCK_SAMPLES * 1000 / CONFIG_POWER_SAMPLE_RATE_HZ)
+
+/* An ADC input, and the scale from millivolts at the input to the
+ * measured millivolts or milliamperes.
+ */
+struct power_channel
+{
+    uint8_t input;
+    uint8_t body;
+    uint32_t numerator;
+    uint32_t denominator;
+};
+
+#define POWER_BODY_HAS_CURRENT(inst) DT_NODE_HAS_PROP(ROBOT_BODY_NODE(inst), io_channels)
+
+#define POWER_CURRENT_CHANNEL(inst, _)                                              \
+    COND_CODE_1(POWER_BODY_HAS_CURRENT(inst), (                                     \
+    {                                                                               \
+        .input = DT_IO_CHANNELS_INPUT(ROBOT_BODY_NODE(inst)),                       \
+        .body = inst,                                                               \
+        .numerator = 1000,                                                          \
+        .denominator = DT_PROP(ROBOT_BODY_NODE(inst), current_sense_mv_per_a),      \
+    },), ())
+
+#define POWER_CURRENT_SAME_ADC(inst, _)                                             \
+    COND_CODE_1(POWER_BODY_HAS_CURRENT(inst),                                       \
+        (BUILD_ASSERT(DT_SAME_NODE(DT_IO_CHANNELS_CTLR(ROBOT_BODY_NODE(inst)),      \
+                                   DT_IO_CHANNELS_CTLR(POWER_NODE)),                \
+                      "Motor current must be measured on the battery ADC");), ())
+
+LISTIFY(ROBOT_BODY_COUNT, POWER_CURRENT_SAME_ADC, ())
+
+static const struct power_channel channels[] = {
+    {
+        .input = DT_IO_CHANNELS_INPUT(POWER_NODE),
+        .body = POWER_CHANNEL_BATTERY,
+        .numerator = DT_PROP(POWER_NODE, full_ohms),
+        .denominator = DT_PROP(POWER_NODE, output_ohms),
+    },
+    LISTIFY(ROBOT_BODY_COUNT, POWER_CURRENT_CHANNEL, ())
+};
+
+#define POWER_CHANNEL_COUNT ARRAY_SIZE(channels)
+
+static const struct device *adc = DEVICE_DT_GET(DT_IO_CHANNELS_CTLR(POWER_NODE));
+
+/* Filled by the ADC, one row per sampling of all channels */
+static int16_t samples[CONFIG_POWER_BLOCK_SAMPLES][POWER_CHANNEL_COUNT];
+
+/* Column of each channel in the sample rows */
+static uint8_t slots[POWER_CHANNEL_COUNT];
+
+static const struct adc_sequence_options sequence_options = {
+    .interval_us = 1000000 / CONFIG_POWER_SAMPLE_RATE_HZ,
+    .extra_samplings = CONFIG_POWER_BLOCK_SAMPLES - 1,
+};
+
+static struct adc_sequence sequence = {
+    .options = &sequence_options,
+    .buffer = samples,
+    .buffer_size = sizeof(samples),
+    .resolution = POWER_ADC_RESOLUTION,
+    .oversampling = CONFIG_POWER_OVERSAMPLING,
+};
+
+/* Measurement state of every body */
+struct power_body
+{
+    uint16_t peak_ma;
+    /* Time the current has been at the stall level */
+    uint32_t stall_ms;
+    bool stalled;
+};
+
+static struct power_body bodies[ROBOT_BODY_COUNT];
+static uint32_t battery_mv;
+
+/* ADC channel of entry idx. The SAADC routes any input to any channel,
+ * other ADCs have a channel per input.
+ */
+static uint8_t channel_id(size_t idx)
+{
+#if defined(CONFIG_ADC_CONFIGURABLE_INPUTS)
+    return idx;
+#else
+    return channels[idx].input;
+#endif
+}
+
+static int channels_setup(void)
+{
+    int err;
+
+    for (size_t i = 0; i < POWER_CHANNEL_COUNT; i++)
+    {
+        struct adc_channel_cfg cfg = {
+            .gain = POWER_ADC_GAIN,
+            .reference = ADC_REF_INTERNAL,
+            .acquisition_time = ADC_ACQ_TIME_DEFAULT,
+            .channel_id = channel_id(i),
+#if defined(CONFIG_ADC_NRFX_SAADC)
+            .input_positive = NRF_SAADC_INPUT_AIN0 + channels[i].input,
+#endif
+        };
+
+        err = adc_channel_setup(adc, &cfg);
+        if (err)
+        {
+            LOG_ERR("Failed to set up ADC input %d: Error %d", channels[i].input, err);
+            return err;
+        }
+
+        sequence.channels |= BIT(cfg.channel_id);
+    }
+
+    /* The samples of a sampling are stored in the order of the channels. */
+    for (size_t i = 0; i < POWER_CHANNEL_COUNT; i++)
+    {
+        slots[i] = 0;
+        for (size_t j = 0; j < POWER_CHANNEL_COUNT; j++)
+        {
+            if (channel_id(j) < channel_id(i))
+            {
+                slots[i]++;
+            }
+        }
+    }
+    return 0;
+}
+
+/* Average of a channel over the block, in millivolts or milliamperes. */
+static uint32_t channel_value(size_t idx)
+{
+    int32_t sum = 0;
+    int32_t value;
+
+    for (size_t i = 0; i < CONFIG_POWER_BLOCK_SAMPLES; i++)
+    {
+        sum += samples[i][slots[idx]];
+    }
+
+    /* Raw average, converted to millivolts in place */
+    value = MAX(sum / CONFIG_POWER_BLOCK_SAMPLES, 0);
+    adc_raw_to_millivolts(adc_ref_internal(adc), POWER_ADC_GAIN, POWER_ADC_RESOLUTION, &value);
+    return (uint32_t)value * channels[idx].numerator / channels[idx].denominator;
+}
+
+/* A motor that is held draws its stall current until it is stopped, while
+ * the current peak of a start passes within the stall time.
+ */
+static void current_process(uint8_t body, uint32_t current_ma)
+{
+    struct power_body *b = &bodies[body];
+
+    b->peak_ma = MAX(b->peak_ma, MIN(current_ma, UINT16_MAX));
+
+    if (current_ma < CONFIG_POWER_STALL_CURRENT_MA)
+    {
+        b->stall_ms = 0;
+        b->stalled = false;
+        return;
+    }
+
+    b->stall_ms += POWER_BLOCK_MS;
+    if (b->stall_ms >= CONFIG_POWER_STALL_TIME_MS && !b->stalled)
+    {
+        b->stalled = true;
+        LOG_WRN("Body %d stalled at %d mA", body, current_ma);
+
+        struct power_module_event *event = new_power_module_event();
+        event->type = POWER_EVT_STALL;
+        event->body = body;
+        APP_EVENT_SUBMIT(event);
+    }
+}
+
+static void block_process(void)
+{
+    for (size_t i = 0; i < POWER_CHANNEL_COUNT; i++)
+    {
+        uint32_t value = channel_value(i);
+
+        if (channels[i].body != POWER_CHANNEL_BATTERY)
+        {
+            current_process(channels[i].body, value);
+        }
+        else if (battery_mv == 0)
+        {
+            battery_mv = value;
+        }
+        else
+        {
+            battery_mv += ((int32_t)value - (int32_t)battery_mv) >> POWER_BATTERY_FILTER_SHIFT;
+        }
+    }
+}
+
+static void measurement_report(void)
+{
+    for (size_t i = 0; i < ROBOT_BODY_COUNT; i++)
+    {
+        struct power_module_event *event = new_power_module_event();
+        event->type = POWER_EVT_MEASUREMENT;
+        event->body = i;
+        event->data.measurement.battery_mv = MIN(battery_mv, UINT16_MAX);
+        event->data.measurement.current_ma = bodies[i].peak_ma;
+        APP_EVENT_SUBMIT(event);
+
+        bodies[i].peak_ma = 0;
+    }
+
+    LOG_DBG("Battery %d mV", battery_mv);
+}
+
+/* Module thread */
+static void module_thread_fn(void)
+{
+    int64_t report_time;
+    int err;
+
+    if (!device_is_ready(adc))
+    {
+        LOG_ERR("ADC %s not ready", adc->name);
+        return;
+    }
+
+    err = channels_setup();
+    if (err)
+    {
+        return;
+    }
+
+    report_time = k_uptime_get();
+
+    while (true)
+    {
+        /* Samples the whole block at the sample rate, the thread sleeps
+         * until the last sample is in.
+         */
+        err = adc_read(adc, &sequence);
+        if (err)
+        {
+            LOG_ERR("ADC read failed: Error %d", err);
+            k_sleep(K_MSEC(CONFIG_POWER_REPORT_INTERVAL_MS));
+            continue;
+        }
+
+        block_process();
+
+        if (k_uptime_get() - report_time >= CONFIG_POWER_REPORT_INTERVAL_MS)
+        {
+            report_time = k_uptime_get();
+            measurement_report();
+        }
+    }
+}
+
+K_THREAD_DEFINE(power_module_thread, CONFIG_POWER_THREAD_STACK_SIZE,
+    module_thread_fn, NULL, NULL, NULL, K_LOWEST_APPLICATION_THREAD_PRIO, 0, 0);
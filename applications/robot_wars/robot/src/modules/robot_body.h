@@ -0,0 +1,22 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#pragma once
+
+#include <devicetree.h>
+#include <sys/util.h>
+
+/** Number of independently commanded bodies on this node. Each body is
+ *  described by a nordic,robot-body devicetree node and gets its own mesh
+ *  element.
+ */
+#define ROBOT_BODY_COUNT DT_NUM_INST_STATUS_OKAY(nordic_robot_body)
+
+/** Devicetree node of body number @p inst. */
+#define ROBOT_BODY_NODE(inst) DT_INST(inst, nordic_robot_body)
+
+BUILD_ASSERT(ROBOT_BODY_COUNT > 0,
+	     "At least one nordic,robot-body node must be enabled");
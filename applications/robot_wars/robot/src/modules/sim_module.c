@@ -0,0 +1,410 @@
+#include <zephyr.h>
+#include <devicetree.h>
+#include <device.h>
+#include <init.h>
+#include <app_event_manager.h>
+#include <shell/shell.h>
+#include <stdlib.h>
+
+#define MODULE sim
+
+#include "../../drivers/sim_motor/sim_motor.h"
+#include "../events/mesh_module_event.h"
+#include "../events/motor_module_event.h"
+#include "robot_body.h"
+#include "sim_module.h"
+
+#if defined(CONFIG_ADC_EMUL) && defined(CONFIG_POWER_MODULE)
+#include <drivers/adc/adc_emul.h>
+#define SIM_POWER 1
+#endif
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(MODULE, CONFIG_SIM_MODULE_LOG_LEVEL);
+
+#define SIM_PI 3.14159265f
+
+/* Pose of a body, integrated from the encoders of its left and right motor. */
+struct sim_body
+{
+    const struct device *motor_left;
+    const struct device *motor_right;
+    /* Revolutions of the motors at the last integration */
+    double revolutions_left;
+    double revolutions_right;
+    float x_mm;
+    float y_mm;
+    /* Heading in radians, and as a unit vector */
+    float heading;
+    float heading_x;
+    float heading_y;
+    /* Distance driven by the centre of the body */
+    float distance_mm;
+    uint16_t current_sense_mv_per_a;
+};
+
+#define SIM_BODY_INIT(inst, _)                                                      \
+    {                                                                               \
+        .motor_left = DEVICE_DT_GET(DT_PHANDLE_BY_IDX(ROBOT_BODY_NODE(inst), motors, 0)), \
+        .motor_right = DEVICE_DT_GET(DT_PHANDLE_BY_IDX(ROBOT_BODY_NODE(inst), motors, 1)), \
+        .heading_x = 1.0f,                                                          \
+        .current_sense_mv_per_a =                                                   \
+            DT_PROP(ROBOT_BODY_NODE(inst), current_sense_mv_per_a),                 \
+    }
+
+static struct sim_body bodies[ROBOT_BODY_COUNT] = {
+    LISTIFY(ROBOT_BODY_COUNT, SIM_BODY_INIT, (,))
+};
+
+static struct k_spinlock lock;
+
+/* Share of every load period the load thread keeps the CPU busy. */
+static atomic_t load_percent;
+
+/* Open circuit voltage of the battery */
+static atomic_t battery_mv = ATOMIC_INIT(CONFIG_SIM_BATTERY_MV);
+
+static void pose_work_fn(struct k_work *work);
+K_WORK_DELAYABLE_DEFINE(pose_work, pose_work_fn);
+
+/* Rotates the heading vector by a small angle, and normalizes it again. */
+static void heading_rotate(struct sim_body *body, float angle)
+{
+    float c = 1.0f - angle * angle / 2.0f;
+    float s = angle - angle * angle * angle / 6.0f;
+    float x = body->heading_x * c - body->heading_y * s;
+    float y = body->heading_x * s + body->heading_y * c;
+    float scale = (3.0f - (x * x + y * y)) / 2.0f;
+
+    body->heading_x = x * scale;
+    body->heading_y = y * scale;
+    body->heading += angle;
+}
+
+/* Differential drive odometry. The step keeps the turn per update small,
+ * so the body is moved along the heading halfway through the turn.
+ */
+static void pose_update(struct sim_body *body)
+{
+    struct sim_motor_state left;
+    struct sim_motor_state right;
+    float left_mm;
+    float right_mm;
+    float forward_mm;
+    float turn;
+
+    if (sim_motor_state_get(body->motor_left, &left) ||
+        sim_motor_state_get(body->motor_right, &right))
+    {
+        return;
+    }
+
+    left_mm = (left.revolutions - body->revolutions_left) * SIM_PI * CONFIG_SIM_WHEEL_DIAMETER_MM;
+    right_mm = (right.revolutions - body->revolutions_right) * SIM_PI * CONFIG_SIM_WHEEL_DIAMETER_MM;
+    body->revolutions_left = left.revolutions;
+    body->revolutions_right = right.revolutions;
+
+    forward_mm = (left_mm + right_mm) / 2.0f;
+    turn = (right_mm - left_mm) / CONFIG_SIM_TRACK_WIDTH_MM;
+
+    heading_rotate(body, turn / 2.0f);
+    body->x_mm += forward_mm * body->heading_x;
+    body->y_mm += forward_mm * body->heading_y;
+    heading_rotate(body, turn / 2.0f);
+    body->distance_mm += (forward_mm < 0.0f) ? -forward_mm : forward_mm;
+}
+
+static void pose_work_fn(struct k_work *work)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    for (size_t i = 0; i < ROBOT_BODY_COUNT; i++)
+    {
+        pose_update(&bodies[i]);
+    }
+    k_spin_unlock(&lock, key);
+
+    k_work_schedule(&pose_work, K_MSEC(CONFIG_SIM_POSE_STEP_MS));
+}
+
+/* Simulated CPU load, preempting the application threads. */
+static void load_thread_fn(void)
+{
+    while (true)
+    {
+        int percent = atomic_get(&load_percent);
+
+        if (percent > 0)
+        {
+            k_busy_wait(CONFIG_SIM_LOAD_PERIOD_MS * 10 * percent);
+        }
+        k_sleep(K_USEC(CONFIG_SIM_LOAD_PERIOD_MS * 10 * (100 - percent)));
+    }
+}
+
+K_THREAD_DEFINE(sim_load_thread, 1024, load_thread_fn, NULL, NULL, NULL,
+    CONFIG_SIM_LOAD_THREAD_PRIORITY, 0, 0);
+
+/* Power measurement, on the inputs of the emulated ADC */
+#if defined(SIM_POWER)
+#define SIM_POWER_NODE DT_INST(0, nordic_robot_power)
+
+static int battery_value(const struct device *dev, unsigned int chan, void *data,
+                         uint32_t *result)
+{
+    *result = atomic_get(&battery_mv) * DT_PROP(SIM_POWER_NODE, output_ohms) /
+              DT_PROP(SIM_POWER_NODE, full_ohms);
+    return 0;
+}
+
+static int current_value(const struct device *dev, unsigned int chan, void *data,
+                         uint32_t *result)
+{
+    struct sim_body *body = data;
+    struct sim_motor_state left;
+    struct sim_motor_state right;
+
+    if (sim_motor_state_get(body->motor_left, &left) ||
+        sim_motor_state_get(body->motor_right, &right))
+    {
+        return -EIO;
+    }
+
+    *result = (left.current_ma + right.current_ma) * body->current_sense_mv_per_a / 1000.0f;
+    return 0;
+}
+
+#define SIM_CURRENT_SETUP(inst, _)                                                  \
+    COND_CODE_1(DT_NODE_HAS_PROP(ROBOT_BODY_NODE(inst), io_channels),               \
+        (adc_emul_value_func_set(DEVICE_DT_GET(DT_IO_CHANNELS_CTLR(ROBOT_BODY_NODE(inst))), \
+                                 DT_IO_CHANNELS_INPUT(ROBOT_BODY_NODE(inst)),       \
+                                 current_value, &bodies[inst]);), ())
+
+static void power_setup(void)
+{
+    adc_emul_value_func_set(DEVICE_DT_GET(DT_IO_CHANNELS_CTLR(SIM_POWER_NODE)),
+                            DT_IO_CHANNELS_INPUT(SIM_POWER_NODE), battery_value, NULL);
+    LISTIFY(ROBOT_BODY_COUNT, SIM_CURRENT_SETUP, ())
+}
+#else
+static void power_setup(void) {}
+#endif
+
+/* Control, for the shell and tests */
+int sim_pose_get(uint8_t body, struct sim_pose *pose)
+{
+    k_spinlock_key_t key;
+
+    if (body >= ROBOT_BODY_COUNT)
+    {
+        return -EINVAL;
+    }
+
+    key = k_spin_lock(&lock);
+    pose_update(&bodies[body]);
+    *pose = (struct sim_pose){
+        .x_mm = bodies[body].x_mm,
+        .y_mm = bodies[body].y_mm,
+        .heading = bodies[body].heading,
+        .distance_mm = bodies[body].distance_mm,
+    };
+    k_spin_unlock(&lock, key);
+
+    return 0;
+}
+
+int sim_load_set(int percent)
+{
+    if (percent < 0 || percent > 95)
+    {
+        return -EINVAL;
+    }
+
+    atomic_set(&load_percent, percent);
+    return 0;
+}
+
+void sim_reset(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    for (size_t i = 0; i < ROBOT_BODY_COUNT; i++)
+    {
+        sim_motor_reset(bodies[i].motor_left);
+        sim_motor_reset(bodies[i].motor_right);
+        bodies[i] = (struct sim_body){
+            .motor_left = bodies[i].motor_left,
+            .motor_right = bodies[i].motor_right,
+            .heading_x = 1.0f,
+            .current_sense_mv_per_a = bodies[i].current_sense_mv_per_a,
+        };
+    }
+    k_spin_unlock(&lock, key);
+}
+
+/* Shell */
+#if defined(CONFIG_SHELL)
+static int cmd_pose(const struct shell *sh, size_t argc, char **argv)
+{
+    struct sim_pose pose;
+
+    for (size_t i = 0; i < ROBOT_BODY_COUNT; i++)
+    {
+        sim_pose_get(i, &pose);
+        shell_print(sh, "pose {\"body\":%d,\"x_mm\":%d,\"y_mm\":%d,"
+                    "\"heading_mdeg\":%d,\"distance_mm\":%d}", (int)i,
+                    (int)pose.x_mm, (int)pose.y_mm,
+                    (int)(pose.heading * 180000.0f / SIM_PI),
+                    (int)pose.distance_mm);
+    }
+    return 0;
+}
+
+static void motor_print(const struct shell *sh, const struct device *dev)
+{
+    struct sim_motor_state state;
+    bool stopped;
+
+    if (sim_motor_state_get(dev, &state))
+    {
+        return;
+    }
+
+    /* Duration of the last run, from start to stop, and the ticks the motor
+     * ran on since the stop, -1 while running.
+     */
+    stopped = state.stop_time_us > state.start_time_us;
+
+    shell_print(sh, "motor {\"name\":\"%s\",\"power_pct\":%d,\"rpm\":%d,"
+                "\"ticks\":%d,\"run_us\":%d,\"stop\":\"%s\",\"overrun_ticks\":%d,"
+                "\"current_ma\":%d}",
+                dev->name, (int)(state.power * 100.0f), (int)state.rpm,
+                (int)state.ticks,
+                stopped ? (int)(state.stop_time_us - state.start_time_us) : -1,
+                state.braking ? "brake" : "coast",
+                stopped ? abs(state.ticks - state.stop_ticks) : -1,
+                (int)state.current_ma);
+}
+
+static int cmd_motors(const struct shell *sh, size_t argc, char **argv)
+{
+    for (size_t i = 0; i < ROBOT_BODY_COUNT; i++)
+    {
+        motor_print(sh, bodies[i].motor_left);
+        motor_print(sh, bodies[i].motor_right);
+    }
+    return 0;
+}
+
+static int cmd_load(const struct shell *sh, size_t argc, char **argv)
+{
+    if (sim_load_set(atoi(argv[1])))
+    {
+        shell_error(sh, "error: load must be 0 to 95 percent");
+        return -EINVAL;
+    }
+
+    shell_print(sh, "ok");
+    return 0;
+}
+
+static int cmd_battery(const struct shell *sh, size_t argc, char **argv)
+{
+    int mv = atoi(argv[1]);
+
+    if (mv <= 0)
+    {
+        shell_error(sh, "error: battery voltage must be positive");
+        return -EINVAL;
+    }
+
+    atomic_set(&battery_mv, mv);
+    shell_print(sh, "ok");
+    return 0;
+}
+
+static int cmd_stall(const struct shell *sh, size_t argc, char **argv)
+{
+    bool stalled = atoi(argv[1]) != 0;
+
+    for (size_t i = 0; i < ROBOT_BODY_COUNT; i++)
+    {
+        sim_motor_stall_set(bodies[i].motor_left, stalled);
+        sim_motor_stall_set(bodies[i].motor_right, stalled);
+    }
+
+    shell_print(sh, "ok");
+    return 0;
+}
+
+static int cmd_reset(const struct shell *sh, size_t argc, char **argv)
+{
+    sim_reset();
+    shell_print(sh, "ok");
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sim_cmds,
+    SHELL_CMD(pose, NULL, "Print the pose of every body", cmd_pose),
+    SHELL_CMD(motors, NULL, "Print the state of every motor", cmd_motors),
+    SHELL_CMD_ARG(load, NULL, "Keep the CPU busy for <percent> of the time",
+                  cmd_load, 2, 0),
+    SHELL_CMD_ARG(battery, NULL, "Set the battery voltage to <mV>",
+                  cmd_battery, 2, 0),
+    SHELL_CMD_ARG(stall, NULL, "Hold the motors of every body, <1> or release them <0>",
+                  cmd_stall, 2, 0),
+    SHELL_CMD(reset, NULL, "Stop the motors and reset poses and encoders",
+              cmd_reset),
+    SHELL_SUBCMD_SET_END
+);
+
+SHELL_CMD_REGISTER(sim, &sim_cmds, "Robot simulation", NULL);
+#endif /* CONFIG_SHELL */
+
+/* Movement timing, for scripts driving a simulation of several robots. The
+ * uptime of simulated robots started together is a common clock.
+ */
+#if defined(CONFIG_SIM_MODULE_TRACE)
+static bool app_event_handler(const struct app_event_header *header)
+{
+    if (is_mesh_module_event(header))
+    {
+        struct mesh_module_event *event = cast_mesh_module_event(header);
+
+        if (event->type == MESH_EVT_MOVE)
+        {
+            printk("sim {\"event\":\"ready\",\"body\":%d,\"time_us\":%llu}\n",
+                   event->body, k_ticks_to_us_floor64(k_uptime_ticks()));
+        }
+    }
+
+    if (is_motor_module_event(header))
+    {
+        struct motor_module_event *event = cast_motor_module_event(header);
+
+        if (event->type == MOTOR_EVT_MOVEMENT_DONE)
+        {
+            printk("sim {\"event\":\"done\",\"body\":%d,\"time_us\":%llu}\n",
+                   event->body, k_ticks_to_us_floor64(k_uptime_ticks()));
+        }
+    }
+
+    return false;
+}
+
+APP_EVENT_LISTENER(MODULE, app_event_handler);
+APP_EVENT_SUBSCRIBE(MODULE, mesh_module_event);
+APP_EVENT_SUBSCRIBE(MODULE, motor_module_event);
+#endif
+
+/* Setup */
+static int sim_init(const struct device *dev)
+{
+    ARG_UNUSED(dev);
+
+    power_setup();
+    k_work_schedule(&pose_work, K_MSEC(CONFIG_SIM_POSE_STEP_MS));
+    return 0;
+}
+
+SYS_INIT(sim_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
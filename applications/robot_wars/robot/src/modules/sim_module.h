@@ -0,0 +1,37 @@
+#pragma once
+#include <zephyr.h>
+
+/** Pose of a simulated robot body. */
+struct sim_pose
+{
+    /* Position, with the body starting at the origin facing along x */
+    float x_mm;
+    float y_mm;
+    /* Heading in radians, counterclockwise */
+    float heading;
+    /* Distance driven by the centre of the body */
+    float distance_mm;
+};
+
+/**
+ * @brief Get the pose of a body, integrated up to the current time.
+ *
+ * @param body Index of the body.
+ * @param pose Pose of the body.
+ * @return 0 on success, -EINVAL if there is no such body.
+ */
+int sim_pose_get(uint8_t body, struct sim_pose *pose);
+
+/**
+ * @brief Keep the CPU busy for a share of the time, preempting the
+ *        application threads.
+ *
+ * @param percent Share of the time, 0 to 95 percent.
+ * @return 0 on success, -EINVAL if the share is out of range.
+ */
+int sim_load_set(int percent);
+
+/**
+ * @brief Stop the motors, and reset the poses and encoders of every body.
+ */
+void sim_reset(void);
@@ -67,6 +67,10 @@ struct bt_mesh_id_srv {
 		BT_MESH_ID_OP_STATUS, CONFIG_BT_MESH_ID_LEN)];
 	/* Id registration work */
 	struct k_work_delayable id_work;
+	/* Identity returned by the identify handler */
+	uint8_t *id;
+	/* Number of failed identify attempts */
+	uint8_t retries;
 };
 
 extern const struct bt_mesh_model_cb _bt_mesh_id_srv_cb;
@@ -10,23 +10,12 @@
 
 #include <zephyr/bluetooth/mesh.h>
 #include <bluetooth/mesh/model_types.h>
+#include <bluetooth/mesh/vnd/schema.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-/** Light RGB set message parameters.  */
-struct bt_mesh_light_rgb_set {
-	/** Speed the device should move at */
-	uint16_t blink_time;
-	/** Amount of time the device should be moving */
-	uint8_t red;
-	/** Angle device should turn before moving */
-	uint8_t green;
-	/** Speed the device should move at */
-	uint8_t blue;
-};
-
 #define BT_MESH_LIGHT_RGB_OP_RGB_SET BT_MESH_MODEL_OP_3(0x10, \
 				       CONFIG_BT_COMPANY_ID)
 
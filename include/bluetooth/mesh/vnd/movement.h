@@ -10,21 +10,12 @@
 
 #include <zephyr/bluetooth/mesh.h>
 #include <bluetooth/mesh/model_types.h>
+#include <bluetooth/mesh/vnd/schema.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-/** Movement set message parameters.  */
-struct bt_mesh_movement_set {
-	/** Amount of time the device should be moving */
-	uint32_t time;
-	/** Angle device should turn before moving */
-	int32_t angle;
-	/** Speed the device should move at */
-	uint8_t speed;
-};
-
 // /** Movement set status message parameters.  */
 // struct bt_mesh_movement_set_status {
 // 	/** status of received */
@@ -41,11 +32,17 @@ struct bt_mesh_movement_set {
 #define BT_MESH_MOVEMENT_OP_READY_SET BT_MESH_MODEL_OP_3(0x0D, \
 				       CONFIG_BT_COMPANY_ID)
 
+#define BT_MESH_MOVEMENT_OP_CALIBRATE BT_MESH_MODEL_OP_3(0x11, \
+				       CONFIG_BT_COMPANY_ID)
+
+#define BT_MESH_MOVEMENT_OP_CALIBRATION_STATUS BT_MESH_MODEL_OP_3(0x12, \
+				       CONFIG_BT_COMPANY_ID)
+
 #ifdef __cplusplus
 }
 #endif
 
-#define BT_MESH_MOVEMENT_MSG_LEN_SET 10
+#define BT_MESH_MOVEMENT_MSG_LEN_SET 11
 
 #endif /* BT_MESH_MOVEMENT_H__ */
 
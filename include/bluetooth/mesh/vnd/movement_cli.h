@@ -24,9 +24,20 @@ struct bt_mesh_movement_cli_handlers {
 	/** @brief Handler for an ack message. 
 	 *
 	 * @param[in] cli Movement Server that received the set message.
+	 * @param[in] round Round the acknowledged movement is staged for.
 	 */
 	void (*const ack)
-		(struct bt_mesh_movement_cli *cli, struct bt_mesh_msg_ctx *ctx);
+		(struct bt_mesh_movement_cli *cli, struct bt_mesh_msg_ctx *ctx,
+		 uint8_t round);
+
+	/** @brief Handler for a calibration status message.
+	 *
+	 * @param[in] cli Movement Client that received the status message.
+	 * @param[in] status Result of the calibration.
+	 */
+	void (*const calibration_status)
+		(struct bt_mesh_movement_cli *cli, struct bt_mesh_msg_ctx *ctx,
+		 struct bt_mesh_calibration_status status);
 };
 
 /** @def BT_MESH_MODEL_MOVEMENT_CLI
@@ -59,7 +70,8 @@ struct bt_mesh_movement_cli {
 	/* Publication data */
 	uint8_t buf[BT_MESH_MODEL_BUF_LEN(
 		BT_MESH_MOVEMENT_OP_MOVEMENT_SET, 
-		BT_MESH_LEN_MIN(sizeof(struct bt_mesh_movement_set)))];
+		BT_MESH_MOVEMENT_SET_LEN + BT_MESH_MOVEMENT_ROUND_LEN +
+		BT_MESH_MOVEMENT_STOP_LEN)];
 	/** Transaction ID tracker for the set messages. */
 	struct bt_mesh_tid_ctx prev_transaction;
 };
@@ -67,12 +79,16 @@ struct bt_mesh_movement_cli {
 /** @brief Set the movement configuration on a Movement Server.
  *
  *  The movement configuration determines the actions the movement
- *  server will actuate on the next ready event. 
+ *  server will actuate on the ready event of its round. A movement may be
+ *  staged for the next round while the current one is executing.
  *
  *  @param[in]  cli Client model to send on.
  *  @param[in]  ctx Message context, or NULL to use the configured publish
  *                  parameters.
  *  @param[in]  set Set parameters.
+ *  @param[in]  round Round to stage the movement for, or
+ *                    @ref BT_MESH_MOVEMENT_ROUND_NONE.
+ *  @param[in]  stop How to stop the motors, see @ref bt_mesh_movement_stop.
  *
  *  @retval 0              Successfully sent the message.
  *  @retval -EADDRNOTAVAIL A message context was not provided and publishing is
@@ -81,7 +97,8 @@ struct bt_mesh_movement_cli {
  */
 int bt_mesh_movement_cli_movement_set(struct bt_mesh_movement_cli *cli,
 					   struct bt_mesh_msg_ctx *ctx,
-					   struct bt_mesh_movement_set set);
+					   struct bt_mesh_movement_set set,
+					   uint8_t round, uint8_t stop);
 
 /** @brief Notify Movement Server that it is clear to execute movement configuration.
  *
@@ -89,6 +106,7 @@ int bt_mesh_movement_cli_movement_set(struct bt_mesh_movement_cli *cli,
  *  @param[in]  cli Client model to send on.
  *  @param[in]  ctx Message context, or NULL to use the configured publish
  *                  parameters.
+ *  @param[in]  round Round to start, or @ref BT_MESH_MOVEMENT_ROUND_NONE.
  *
  *  @retval 0              Successfully sent the message.
  *  @retval -EADDRNOTAVAIL A message context was not provided and publishing is
@@ -96,11 +114,29 @@ int bt_mesh_movement_cli_movement_set(struct bt_mesh_movement_cli *cli,
  *  @retval -EAGAIN        The device has not been provisioned.
  */
 int bt_mesh_movement_cli_ready_set(struct bt_mesh_movement_cli *cli,
-					   struct bt_mesh_msg_ctx *ctx);
+					   struct bt_mesh_msg_ctx *ctx,
+					   uint8_t round);
 
 extern const struct bt_mesh_model_op _bt_mesh_movement_cli_op[];
 extern const struct bt_mesh_model_cb _bt_mesh_movement_cli_cb;
 
+/** @brief Start the motion calibration of a Movement Server.
+ *
+ *  The robot drives and turns on the spot while it calibrates, and sends
+ *  a calibration status message when it is done.
+ *
+ *  @param[in]  cli Client model to send on.
+ *  @param[in]  ctx Message context, or NULL to use the configured publish
+ *                  parameters.
+ *
+ *  @retval 0              Successfully sent the message.
+ *  @retval -EADDRNOTAVAIL A message context was not provided and publishing is
+ *                         not configured.
+ *  @retval -EAGAIN        The device has not been provisioned.
+ */
+int bt_mesh_movement_cli_calibrate(struct bt_mesh_movement_cli *cli,
+					   struct bt_mesh_msg_ctx *ctx);
+
 #ifdef __cplusplus
 }
 #endif
@@ -27,15 +27,30 @@ struct bt_mesh_movement_srv_handlers {
 	 *
 	 * @param[in] srv Movement Server that received the set message.
 	 * @param[in] movement The message containing the movement data.
+	 * @param[in] round Round the movement is staged for, or
+	 *                  @ref BT_MESH_MOVEMENT_ROUND_NONE.
+	 * @param[in] stop How to stop the motors, see
+	 *                 @ref bt_mesh_movement_stop.
 	 */
 	void (*const set)(struct bt_mesh_movement_srv *srv, 
-			struct bt_mesh_movement_set movement);
+			struct bt_mesh_movement_set movement, uint8_t round,
+			uint8_t stop);
 			
 	/** @brief Handler for a ready to move message. 
 	 *
 	 * @param[in] srv Movement Server that received the ready message.
+	 * @param[in] round Round to start, or @ref BT_MESH_MOVEMENT_ROUND_NONE.
 	 */
-	void (*const ready)(struct bt_mesh_movement_srv *srv);
+	void (*const ready)(struct bt_mesh_movement_srv *srv, uint8_t round);
+
+	/** @brief Handler for a calibrate message.
+	 *
+	 * The calibration runs after the handler returns, and its result is
+	 * sent with @ref bt_mesh_movement_srv_calibration_status.
+	 *
+	 * @param[in] srv Movement Server that received the calibrate message.
+	 */
+	void (*const calibrate)(struct bt_mesh_movement_srv *srv);
 };
 
 /** @def BT_MESH_MODEL_MOVEMENT_SRV
@@ -68,11 +83,25 @@ struct bt_mesh_movement_srv {
 	/* Publication data */
 	uint8_t buf[BT_MESH_MODEL_BUF_LEN(
 		BT_MESH_MOVEMENT_OP_MOVEMENT_ACK, 
-		BT_MESH_LEN_EXACT(sizeof(0)))];
+		BT_MESH_MOVEMENT_ROUND_LEN)];
 	/** Transaction ID tracker for the set messages. */
 	struct bt_mesh_tid_ctx prev_transaction;
+	/** Context of the last calibrate message, answered by the status. */
+	struct bt_mesh_msg_ctx calibrate_ctx;
 };
 
+/** @brief Send the result of a calibration to the client that requested it.
+ *
+ *  @param[in] srv Movement Server that received the calibrate message.
+ *  @param[in] status Result of the calibration.
+ *
+ *  @retval 0              Successfully sent the message.
+ *  @retval -EADDRNOTAVAIL No calibration was requested.
+ *  @retval -EAGAIN        The device has not been provisioned.
+ */
+int bt_mesh_movement_srv_calibration_status(struct bt_mesh_movement_srv *srv,
+		const struct bt_mesh_calibration_status *status);
+
 extern const struct bt_mesh_model_op _bt_mesh_movement_srv_op[];
 extern const struct bt_mesh_model_cb _bt_mesh_movement_srv_cb;
 
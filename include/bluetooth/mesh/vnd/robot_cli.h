@@ -67,8 +67,10 @@ struct bt_mesh_robot_cli_handlers {
 	 *
 	 * @param[in] cli Robot Server.
 	 * @param[in] addr Address of robot client.
+	 * @param[in] round Round the acknowledged movement is staged for.
 	 */
-	void (*const movement_configured)(struct bt_mesh_robot_cli *cli, struct bt_mesh_msg_ctx *ctx);
+	void (*const movement_configured)(struct bt_mesh_robot_cli *cli, struct bt_mesh_msg_ctx *ctx,
+					  uint8_t round);
 
 	/** @brief Handler for robot acknowledgement of movement configuration.
 	 *
@@ -76,7 +78,17 @@ struct bt_mesh_robot_cli_handlers {
 	 * @param[in] addr Address of robot client.
 	 */
 	void (*const telemetry_reported)
-		(struct bt_mesh_robot_cli *cli, struct bt_mesh_telemetry_report report, struct bt_mesh_msg_ctx *ctx);
+		(struct bt_mesh_robot_cli *cli, struct bt_mesh_telemetry_report report,
+		 const struct bt_mesh_telemetry_power *power, struct bt_mesh_msg_ctx *ctx);
+
+	/** @brief Handler for the result of a robot calibration.
+	 *
+	 * @param[in] cli Robot Server.
+	 * @param[in] status Result of the calibration.
+	 * @param[in] addr Address of robot client.
+	 */
+	void (*const calibrated)
+		(struct bt_mesh_robot_cli *cli, struct bt_mesh_calibration_status status, struct bt_mesh_msg_ctx *ctx);
 };
 
 /**
@@ -108,12 +120,14 @@ struct bt_mesh_robot_cli {
 /** @brief Set the movement configuration on a Movement Server.
  *
  *  The movement configuration determines the actions the movement
- *  server will actuate on the next ready event. 
+ *  server will actuate on the ready event of its round. 
  *
  *  @param[in]  cli Client model to send on.
  *  @param[in]  ctx Message context, or NULL to use the configured publish
  *                  parameters.
  *  @param[in]  set Set parameters.
+ *  @param[in]  round Round to stage the movement for.
+ *  @param[in]  stop How to stop the motors, see @ref bt_mesh_movement_stop.
  *
  *  @retval 0              Successfully sent the message.
  *  @retval -EADDRNOTAVAIL A message context was not provided and publishing is
@@ -122,7 +136,8 @@ struct bt_mesh_robot_cli {
  */
 int bt_mesh_robot_cli_movement_set(struct bt_mesh_robot_cli *cli,
 					   	struct bt_mesh_msg_ctx *ctx,
-						struct bt_mesh_movement_set set);
+						struct bt_mesh_movement_set set,
+						uint8_t round, uint8_t stop);
 
 /** @brief Notify Movement Server that it is clear to execute movement configuration.
  *
@@ -130,6 +145,7 @@ int bt_mesh_robot_cli_movement_set(struct bt_mesh_robot_cli *cli,
  *  @param[in]  cli Client model to send on.
  *  @param[in]  ctx Message context, or NULL to use the configured publish
  *                  parameters.
+ *  @param[in]  round Round to start.
  *
  *  @retval 0              Successfully sent the message.
  *  @retval -EADDRNOTAVAIL A message context was not provided and publishing is
@@ -137,10 +153,25 @@ int bt_mesh_robot_cli_movement_set(struct bt_mesh_robot_cli *cli,
  *  @retval -EAGAIN        The device has not been provisioned.
  */
 int bt_mesh_robot_cli_ready_set(struct bt_mesh_robot_cli *cli,
-					   struct bt_mesh_msg_ctx *ctx);
+					   struct bt_mesh_msg_ctx *ctx,
+					   uint8_t round);
 
 extern const struct bt_mesh_model_cb _bt_mesh_robot_cli_cb;
 
+/** @brief Start the motion calibration of a robot.
+ *
+ *  @param[in]  cli Client model to send on.
+ *  @param[in]  ctx Message context, or NULL to use the configured publish
+ *                  parameters.
+ *
+ *  @retval 0              Successfully sent the message.
+ *  @retval -EADDRNOTAVAIL A message context was not provided and publishing is
+ *                         not configured.
+ *  @retval -EAGAIN        The device has not been provisioned.
+ */
+int bt_mesh_robot_cli_calibrate(struct bt_mesh_robot_cli *cli,
+					   	struct bt_mesh_msg_ctx *ctx);
+
 #ifdef __cplusplus
 }
 #endif
@@ -23,6 +23,17 @@ extern "C" {
 
 struct bt_mesh_robot_srv;
 
+/** Movement staged for a round. */
+struct bt_mesh_robot_srv_stage {
+	/** Staged movement. */
+	struct bt_mesh_movement_set movement;
+	/** Round the movement is started in. */
+	uint8_t round;
+	/** Stop mode of the movement, see @ref bt_mesh_movement_stop. */
+	uint8_t stop;
+	/** The slot holds a movement. */
+	bool valid;
+};
 
 
 /** @def BT_MESH_MODEL_ROBOT_SRV
@@ -53,12 +64,30 @@ struct bt_mesh_robot_srv_handlers {
 	 * @retval Robot id
 	 */
 	uint8_t * (*const identify)(struct bt_mesh_robot_srv *srv);
+	/** @brief Handler for incoming movement configurations.
+	 *
+	 * Called when a movement configuration is staged, before the ready
+	 * message of its round is received.
+	 *
+	 * @param[in] srv Robot Server
+	 * @param[in] movement Staged movement configuration
+	 */
+	void (*const configure)(struct bt_mesh_robot_srv *srv,
+				const struct bt_mesh_movement_set *movement);
 	/** @brief Handler for incoming movement configurations.
 	 *
 	 * @param[in] srv Robot Server
 	 */
 	void (*const move)(struct bt_mesh_robot_srv *srv,
 					  struct bt_mesh_movement_set *movement);
+	/** @brief Handler for calibration requests.
+	 *
+	 * The result is sent with @ref bt_mesh_robot_calibration_status
+	 * once the calibration is done.
+	 *
+	 * @param[in] srv Robot Server
+	 */
+	void (*const calibrate)(struct bt_mesh_robot_srv *srv);
 
 };
 
@@ -86,10 +115,20 @@ struct bt_mesh_robot_srv {
 		OP_VND_ROBOT_SET, CONFIG_BT_MESH_ID_LEN)];
 	/** Transaction ID tracker for the set messages. */
 	struct bt_mesh_tid_ctx prev_transaction;
+	/** Movements staged for upcoming rounds. */
+	struct bt_mesh_robot_srv_stage staged[CONFIG_BT_MESH_ROBOT_SRV_STAGED_MAX];
+	/** Movement configuration started by the last ready message. */
+	struct bt_mesh_movement_set movement_config;
+	/** Stop mode of the started movement configuration. */
+	uint8_t movement_stop;
 };
 
 int bt_mesh_robot_report_telemetry(struct bt_mesh_robot_srv *srv,
-					  struct bt_mesh_telemetry_report telemetry);
+					  struct bt_mesh_telemetry_report telemetry,
+					  const struct bt_mesh_telemetry_power *power);
+
+int bt_mesh_robot_calibration_status(struct bt_mesh_robot_srv *srv,
+				     struct bt_mesh_calibration_status status);
 
 extern const struct bt_mesh_model_cb _bt_mesh_robot_srv_cb;
 
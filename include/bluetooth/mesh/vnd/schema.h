@@ -0,0 +1,224 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/**
+ * @file
+ * @brief Wire format schema of the robot vendor model messages.
+ *
+ * Each message is described once as a field list, and the message
+ * structure, its packed length and its access layer encoder and decoder
+ * are generated from it. The list is also used by the gateway to generate
+ * its UART and JSON encoding, so this header must not depend on the
+ * Bluetooth mesh stack.
+ *
+ * A field list is an X-macro taking a macro @c X, which is expanded as
+ * <tt>X(type, name, wire, json)</tt> for every field, where @c wire is one
+ * of @c U8, @c BE16 or @c BE32 and @c json is the key used in the device
+ * shadow, or NULL if the field is not part of it.
+ */
+
+#ifndef BT_MESH_VND_SCHEMA_H__
+#define BT_MESH_VND_SCHEMA_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <zephyr/toolchain.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/util_macro.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Movement set message fields. */
+#define BT_MESH_MOVEMENT_SET_FIELDS(X)                                         \
+	/* Amount of time the device should be moving */                      \
+	X(uint32_t, time, BE32, "driveTimeMs")                                 \
+	/* Angle device should turn before moving */                          \
+	X(int32_t, angle, BE32, "angleDeg")                                    \
+	/* Speed the device should move at */                                 \
+	X(uint8_t, speed, U8, NULL)
+
+/** Light RGB set message fields. */
+#define BT_MESH_LIGHT_RGB_SET_FIELDS(X)                                        \
+	/* Blink period in milliseconds, 0 for constant light */              \
+	X(uint16_t, blink_time, BE16, NULL)                                    \
+	X(uint8_t, red, U8, NULL)                                              \
+	X(uint8_t, green, U8, NULL)                                            \
+	X(uint8_t, blue, U8, NULL)
+
+/** Telemetry report message fields. */
+#define BT_MESH_TELEMETRY_REPORT_FIELDS(X)                                     \
+	X(uint8_t, revolutions, U8, "revolutionCount")
+
+/** Power summary fields, optionally appended to the telemetry report.
+ * Receivers that predate the summary take the report to be exactly
+ * BT_MESH_TELEMETRY_REPORT_LEN long, and drop reports that carry it.
+ */
+#define BT_MESH_TELEMETRY_POWER_FIELDS(X)                                      \
+	/* Battery voltage at the end of the movement, in millivolts */       \
+	X(uint16_t, battery, BE16, "batteryMv")                                \
+	/* Peak motor current of the movement, in milliamperes */             \
+	X(uint16_t, current, BE16, "motorCurrentMa")                           \
+	/* BT_MESH_TELEMETRY_POWER_FLAG_* of the movement */                  \
+	X(uint8_t, flags, U8, "powerFlags")
+
+/** Calibration status message fields. */
+#define BT_MESH_CALIBRATION_STATUS_FIELDS(X)                                   \
+	/* 0, or the negative error code the calibration failed with */       \
+	X(int8_t, err, U8, NULL)                                               \
+	/* Turn rate on the spot at full power, in degrees per second */      \
+	X(uint16_t, turn_rate, BE16, "turnRateDps")                            \
+	/* Ground speed of the slower wheel at full power, in millimetres per \
+	 * second                                                             \
+	 */                                                                   \
+	X(uint16_t, speed, BE16, "speedMms")                                   \
+	/* Time a turn and a drive take beyond the steady speed model, in     \
+	 * milliseconds                                                       \
+	 */                                                                   \
+	X(int16_t, turn_offset, BE16, "turnOffsetMs")                          \
+	X(int16_t, drive_offset, BE16, "driveOffsetMs")
+
+#define _BT_MESH_SCHEMA_WIRE_LEN_U8 1
+#define _BT_MESH_SCHEMA_WIRE_LEN_BE16 2
+#define _BT_MESH_SCHEMA_WIRE_LEN_BE32 4
+
+#define _bt_mesh_schema_put_U8(val, dst) (*(dst) = (uint8_t)(val))
+#define _bt_mesh_schema_put_BE16(val, dst) sys_put_be16((uint16_t)(val), dst)
+#define _bt_mesh_schema_put_BE32(val, dst) sys_put_be32((uint32_t)(val), dst)
+
+#define _bt_mesh_schema_get_U8(src) (*(src))
+#define _bt_mesh_schema_get_BE16(src) sys_get_be16(src)
+#define _bt_mesh_schema_get_BE32(src) sys_get_be32(src)
+
+#define _BT_MESH_SCHEMA_MEMBER(type, name, wire, json) type name;
+
+#define _BT_MESH_SCHEMA_LEN(type, name, wire, json)                            \
+	+_BT_MESH_SCHEMA_WIRE_LEN_##wire
+
+#define _BT_MESH_SCHEMA_ENCODE(type, name, wire, json)                         \
+	_bt_mesh_schema_put_##wire(val->name, buf);                            \
+	buf += _BT_MESH_SCHEMA_WIRE_LEN_##wire;
+
+#define _BT_MESH_SCHEMA_DECODE(type, name, wire, json)                         \
+	val->name = (type)_bt_mesh_schema_get_##wire(buf);                     \
+	buf += _BT_MESH_SCHEMA_WIRE_LEN_##wire;
+
+/** @brief Packed wire length of a message.
+ *
+ * @param _fields Field list of the message.
+ */
+#define BT_MESH_SCHEMA_LEN(_fields) (0 _fields(_BT_MESH_SCHEMA_LEN))
+
+/** @brief Define the structure of a message.
+ *
+ * @param _name Structure tag.
+ * @param _fields Field list of the message.
+ */
+#define BT_MESH_SCHEMA_STRUCT(_name, _fields)                                  \
+	struct _name {                                                         \
+		_fields(_BT_MESH_SCHEMA_MEMBER)                                \
+	}
+
+/** @brief Define the wire encoder and decoder of a message.
+ *
+ * Defines @c _name_encode, writing the packed message to a buffer of
+ * at least @ref BT_MESH_SCHEMA_LEN bytes, and @c _name_decode, reading it
+ * back. Both return the number of bytes written or read.
+ *
+ * @param _name Structure tag, also used as function name prefix.
+ * @param _fields Field list of the message.
+ */
+#define BT_MESH_SCHEMA_CODEC_DEFINE(_name, _fields)                            \
+	static inline size_t _name##_encode(const struct _name *val,           \
+					    uint8_t *buf)                      \
+	{                                                                      \
+		_fields(_BT_MESH_SCHEMA_ENCODE)                                \
+		return BT_MESH_SCHEMA_LEN(_fields);                            \
+	}                                                                      \
+	static inline size_t _name##_decode(struct _name *val,                 \
+					    const uint8_t *buf)                \
+	{                                                                      \
+		_fields(_BT_MESH_SCHEMA_DECODE)                                \
+		return BT_MESH_SCHEMA_LEN(_fields);                            \
+	}
+
+/** Movement set message parameters. */
+BT_MESH_SCHEMA_STRUCT(bt_mesh_movement_set, BT_MESH_MOVEMENT_SET_FIELDS);
+/** Light RGB set message parameters. */
+BT_MESH_SCHEMA_STRUCT(bt_mesh_light_rgb_set, BT_MESH_LIGHT_RGB_SET_FIELDS);
+/** Telemetry report message parameters. */
+BT_MESH_SCHEMA_STRUCT(bt_mesh_telemetry_report, BT_MESH_TELEMETRY_REPORT_FIELDS);
+/** Telemetry power summary parameters. */
+BT_MESH_SCHEMA_STRUCT(bt_mesh_telemetry_power, BT_MESH_TELEMETRY_POWER_FIELDS);
+/** Calibration status message parameters. */
+BT_MESH_SCHEMA_STRUCT(bt_mesh_calibration_status, BT_MESH_CALIBRATION_STATUS_FIELDS);
+
+BT_MESH_SCHEMA_CODEC_DEFINE(bt_mesh_movement_set, BT_MESH_MOVEMENT_SET_FIELDS)
+BT_MESH_SCHEMA_CODEC_DEFINE(bt_mesh_light_rgb_set, BT_MESH_LIGHT_RGB_SET_FIELDS)
+BT_MESH_SCHEMA_CODEC_DEFINE(bt_mesh_telemetry_report, BT_MESH_TELEMETRY_REPORT_FIELDS)
+BT_MESH_SCHEMA_CODEC_DEFINE(bt_mesh_telemetry_power, BT_MESH_TELEMETRY_POWER_FIELDS)
+BT_MESH_SCHEMA_CODEC_DEFINE(bt_mesh_calibration_status, BT_MESH_CALIBRATION_STATUS_FIELDS)
+
+/** Packed length of the movement set message. */
+#define BT_MESH_MOVEMENT_SET_LEN BT_MESH_SCHEMA_LEN(BT_MESH_MOVEMENT_SET_FIELDS)
+/** Packed length of the light RGB set message. */
+#define BT_MESH_LIGHT_RGB_SET_LEN BT_MESH_SCHEMA_LEN(BT_MESH_LIGHT_RGB_SET_FIELDS)
+/** Packed length of the telemetry report message. */
+#define BT_MESH_TELEMETRY_REPORT_LEN                                           \
+	BT_MESH_SCHEMA_LEN(BT_MESH_TELEMETRY_REPORT_FIELDS)
+/** Packed length of the telemetry power summary. */
+#define BT_MESH_TELEMETRY_POWER_LEN                                            \
+	BT_MESH_SCHEMA_LEN(BT_MESH_TELEMETRY_POWER_FIELDS)
+/** Packed length of the calibration status message. */
+#define BT_MESH_CALIBRATION_STATUS_LEN                                         \
+	BT_MESH_SCHEMA_LEN(BT_MESH_CALIBRATION_STATUS_FIELDS)
+
+/* Length of the round number trailing the movement set, ack and ready
+ * messages. Movements are staged per round, and a ready message starts the
+ * movement staged for its round. Round 0, or a message without a round
+ * number, is untagged, as sent by clients that do not pipeline rounds.
+ */
+#define BT_MESH_MOVEMENT_ROUND_LEN 1
+
+/* Untagged round number. */
+#define BT_MESH_MOVEMENT_ROUND_NONE 0
+
+/* Length of the stop mode trailing the round number of the movement set
+ * message. A set message without it stops with the default mode of the
+ * robot.
+ */
+#define BT_MESH_MOVEMENT_STOP_LEN 1
+
+/** How the motors are stopped at the end of each phase of a movement. */
+enum bt_mesh_movement_stop {
+	/** Default stop mode of the robot. */
+	BT_MESH_MOVEMENT_STOP_DEFAULT,
+	/** Release the motors, and let the body roll out. */
+	BT_MESH_MOVEMENT_STOP_COAST,
+	/** Short the motor windings, and hold the body. */
+	BT_MESH_MOVEMENT_STOP_BRAKE,
+	/** Short brake, then release the motors once the body stands still. */
+	BT_MESH_MOVEMENT_STOP_BRAKE_COAST,
+};
+
+/** The movement was aborted, a motor stalled. */
+#define BT_MESH_TELEMETRY_POWER_FLAG_STALL BIT(0)
+/** The battery is below its low threshold. */
+#define BT_MESH_TELEMETRY_POWER_FLAG_BATTERY_LOW BIT(1)
+
+/* The wire formats are fixed by deployed robots. */
+BUILD_ASSERT(BT_MESH_MOVEMENT_SET_LEN == 9, "Movement set wire format changed");
+BUILD_ASSERT(BT_MESH_LIGHT_RGB_SET_LEN == 5, "Light RGB set wire format changed");
+BUILD_ASSERT(BT_MESH_TELEMETRY_REPORT_LEN == 1, "Telemetry report wire format changed");
+BUILD_ASSERT(BT_MESH_TELEMETRY_POWER_LEN == 5, "Telemetry power wire format changed");
+BUILD_ASSERT(BT_MESH_CALIBRATION_STATUS_LEN == 9, "Calibration status wire format changed");
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BT_MESH_VND_SCHEMA_H__ */
@@ -9,16 +9,12 @@
 
 #include <zephyr/bluetooth/mesh.h>
 #include <bluetooth/mesh/model_types.h>
+#include <bluetooth/mesh/vnd/schema.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-/** Telemetry set message parameters.  */
-struct bt_mesh_telemetry_report {
-	uint8_t revolutions;
-};
-
 #define BT_MESH_TELEMETRY_OP_TELEMETRY_REPORT BT_MESH_MODEL_OP_3(0x0F, \
 				       CONFIG_BT_COMPANY_ID)
 
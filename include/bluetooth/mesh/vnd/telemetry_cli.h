@@ -24,9 +24,12 @@ struct bt_mesh_telemetry_cli_handlers {
 	/** @brief Handler for an report message. 
 	 *
 	 * @param[in] cli Telemetry Server that received the report message.
+	 * @param[in] power Power summary of the report, or NULL if the robot
+	 *                  did not send one.
 	 */
 	void (*const report)
-		(struct bt_mesh_telemetry_cli *cli, struct bt_mesh_msg_ctx *ctx, struct bt_mesh_telemetry_report telemetry);
+		(struct bt_mesh_telemetry_cli *cli, struct bt_mesh_msg_ctx *ctx, struct bt_mesh_telemetry_report telemetry,
+		 const struct bt_mesh_telemetry_power *power);
 };
 
 /** @def BT_MESH_MODEL_TELEMETRY_CLI
@@ -49,13 +49,25 @@ struct bt_mesh_telemetry_srv {
 	/* Publication data */
 	uint8_t buf[BT_MESH_MODEL_BUF_LEN(
 		BT_MESH_TELEMETRY_OP_TELEMETRY_REPORT, 
-		BT_MESH_LEN_EXACT(1))];
+		BT_MESH_LEN_EXACT(BT_MESH_TELEMETRY_REPORT_LEN +
+				  BT_MESH_TELEMETRY_POWER_LEN))];
 	/** Transaction ID tracker for the set messages. */
 	struct bt_mesh_tid_ctx prev_transaction;
 };
 
+/** @brief Publish a telemetry report.
+ *
+ * @param[in] srv Telemetry Server instance.
+ * @param[in] telemetry Telemetry of the movement.
+ * @param[in] power Power summary of the movement, appended to the report,
+ *                  or NULL to send the report without it.
+ *
+ * @retval 0 Successfully published the report.
+ * @return Negative errno code from the mesh stack otherwise.
+ */
 int bt_mesh_telemetry_report(struct bt_mesh_telemetry_srv *srv,
-					   		struct bt_mesh_telemetry_report telemetry);
+					   		struct bt_mesh_telemetry_report telemetry,
+					   		const struct bt_mesh_telemetry_power *power);
 
 extern const struct bt_mesh_model_cb _bt_mesh_telemetry_srv_cb;
 
@@ -12,35 +12,34 @@
 #include <zephyr/logging/log.h>
 LOG_MODULE_REGISTER(id_srv);
 
-uint8_t *id = NULL;
-
 static int bt_mesh_id_srv_update_handler(struct bt_mesh_model *model)
 {
-	if (id == NULL) {
+	struct bt_mesh_id_srv *srv = model->user_data;
+
+	if (srv->id == NULL) {
 		return -ENODATA;
 	}
 
 	bt_mesh_model_msg_init(model->pub->msg, BT_MESH_ID_OP_STATUS);
-	net_buf_simple_add_mem(model->pub->msg, id, CONFIG_BT_MESH_ID_LEN);
+	net_buf_simple_add_mem(model->pub->msg, srv->id, CONFIG_BT_MESH_ID_LEN);
 
     return 0;
 }
 
 static int bt_mesh_id_srv_identify(struct bt_mesh_model *model)
 {
-	static uint8_t retries = 0;
-	if (retries >= 5) {
+	struct bt_mesh_id_srv *srv = model->user_data;
+
+	if (srv->retries >= 5) {
 		LOG_WRN("Id server was not able to get an id");
 	}
 
-	struct bt_mesh_id_srv *srv = model->user_data;
-
 	if (srv->handlers->identify) {
-		id = srv->handlers->identify(srv);
-		if (id == NULL) 
+		srv->id = srv->handlers->identify(srv);
+		if (srv->id == NULL) 
 		{
 			LOG_WRN("No ID, retrying");
-			retries++;
+			srv->retries++;
 			k_work_schedule(&srv->id_work, K_MSEC(50));
 			return 0;
 		}
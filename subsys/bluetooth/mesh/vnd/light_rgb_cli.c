@@ -20,12 +20,10 @@ int bt_mesh_light_rgb_cli_rgb_set(struct bt_mesh_light_rgb_cli *cli,
 		return -EINVAL;
 	}
 
-	BT_MESH_MODEL_BUF_DEFINE(buf, BT_MESH_LIGHT_RGB_OP_RGB_SET, sizeof(struct bt_mesh_light_rgb_set));
+	BT_MESH_MODEL_BUF_DEFINE(buf, BT_MESH_LIGHT_RGB_OP_RGB_SET, BT_MESH_LIGHT_RGB_SET_LEN);
 	bt_mesh_model_msg_init(&buf, BT_MESH_LIGHT_RGB_OP_RGB_SET);
-	net_buf_simple_add_be16(&buf, set.blink_time);
-	net_buf_simple_add_u8(&buf, set.red);
-	net_buf_simple_add_u8(&buf, set.green);
-	net_buf_simple_add_u8(&buf, set.blue);
+	bt_mesh_light_rgb_set_encode(&set,
+		net_buf_simple_add(&buf, BT_MESH_LIGHT_RGB_SET_LEN));
 
 	LOG_INF("sending packet over mesh! %d", buf.len);
 	LOG_HEXDUMP_INF(buf.data, buf.len, "packet:");
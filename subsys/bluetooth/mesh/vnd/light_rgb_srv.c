@@ -14,10 +14,9 @@ LOG_MODULE_REGISTER(light_rgb_srv);
 struct bt_mesh_light_rgb_set extract_rgb(struct net_buf_simple *buf)
 {
 	struct bt_mesh_light_rgb_set rgb;
-    rgb.blink_time = net_buf_simple_pull_be16(buf);
-    rgb.red = net_buf_simple_pull_u8(buf);
-    rgb.green = net_buf_simple_pull_u8(buf);
-    rgb.blue = net_buf_simple_pull_u8(buf);
+
+	bt_mesh_light_rgb_set_decode(&rgb,
+		net_buf_simple_pull_mem(buf, BT_MESH_LIGHT_RGB_SET_LEN));
 	return rgb;
 }
 
@@ -39,7 +38,7 @@ static int handle_message_light_rgb_set(struct bt_mesh_model *model, struct bt_m
 
 const struct bt_mesh_model_op _bt_mesh_light_rgb_srv_op[] = {
 	{
-		BT_MESH_LIGHT_RGB_OP_RGB_SET, BT_MESH_LEN_EXACT(5),
+		BT_MESH_LIGHT_RGB_OP_RGB_SET, BT_MESH_LEN_EXACT(BT_MESH_LIGHT_RGB_SET_LEN),
 		handle_message_light_rgb_set
 	},
 	BT_MESH_MODEL_OP_END,
@@ -14,17 +14,21 @@ LOG_MODULE_REGISTER(movement_cli);
 
 int bt_mesh_movement_cli_movement_set(struct bt_mesh_movement_cli *cli,
 					   struct bt_mesh_msg_ctx *ctx,
-					   const struct bt_mesh_movement_set set)
+					   const struct bt_mesh_movement_set set,
+					   uint8_t round, uint8_t stop)
 {
 	if (!cli || !ctx) {
 		return -EINVAL;
 	}
 
-	BT_MESH_MODEL_BUF_DEFINE(buf, BT_MESH_MOVEMENT_OP_MOVEMENT_SET, sizeof(struct bt_mesh_movement_set));
+	BT_MESH_MODEL_BUF_DEFINE(buf, BT_MESH_MOVEMENT_OP_MOVEMENT_SET,
+				 BT_MESH_MOVEMENT_SET_LEN + BT_MESH_MOVEMENT_ROUND_LEN +
+				 BT_MESH_MOVEMENT_STOP_LEN);
 	bt_mesh_model_msg_init(&buf, BT_MESH_MOVEMENT_OP_MOVEMENT_SET);
-	net_buf_simple_add_be32(&buf, set.time);
-	net_buf_simple_add_be32(&buf, set.angle);
-	net_buf_simple_add_u8(&buf, set.speed);
+	bt_mesh_movement_set_encode(&set,
+		net_buf_simple_add(&buf, BT_MESH_MOVEMENT_SET_LEN));
+	net_buf_simple_add_u8(&buf, round);
+	net_buf_simple_add_u8(&buf, stop);
 
 	LOG_INF("sending packet over mesh! %d", buf.len);
 	LOG_HEXDUMP_INF(buf.data, buf.len, "packet:");
@@ -33,13 +37,28 @@ int bt_mesh_movement_cli_movement_set(struct bt_mesh_movement_cli *cli,
 }
 
 int bt_mesh_movement_cli_ready_set(struct bt_mesh_movement_cli *cli,
-					   struct bt_mesh_msg_ctx *ctx)
+					   struct bt_mesh_msg_ctx *ctx,
+					   uint8_t round)
 {	
 	if (!cli || !ctx) {
 		return -EINVAL;
 	}
-	BT_MESH_MODEL_BUF_DEFINE(buf, BT_MESH_MOVEMENT_OP_READY_SET, 0);
+	BT_MESH_MODEL_BUF_DEFINE(buf, BT_MESH_MOVEMENT_OP_READY_SET,
+				 BT_MESH_MOVEMENT_ROUND_LEN);
 	bt_mesh_model_msg_init(&buf, BT_MESH_MOVEMENT_OP_READY_SET);
+	net_buf_simple_add_u8(&buf, round);
+
+	return bt_mesh_model_send(cli->model, ctx, &buf, NULL, NULL);
+}
+
+int bt_mesh_movement_cli_calibrate(struct bt_mesh_movement_cli *cli,
+					   struct bt_mesh_msg_ctx *ctx)
+{
+	if (!cli || !ctx) {
+		return -EINVAL;
+	}
+	BT_MESH_MODEL_BUF_DEFINE(buf, BT_MESH_MOVEMENT_OP_CALIBRATE, 0);
+	bt_mesh_model_msg_init(&buf, BT_MESH_MOVEMENT_OP_CALIBRATE);
 
 	return bt_mesh_model_send(cli->model, ctx, &buf, NULL, NULL);
 }
@@ -48,9 +67,30 @@ static int handle_message_ack(struct bt_mesh_model *model, struct bt_mesh_msg_ct
 			  struct net_buf_simple *buf)
 {
 	struct bt_mesh_movement_cli *cli = model->user_data;
+	uint8_t round = BT_MESH_MOVEMENT_ROUND_NONE;
+
+	if (buf->len >= BT_MESH_MOVEMENT_ROUND_LEN) {
+		round = net_buf_simple_pull_u8(buf);
+	}
 
 	if (cli->handlers->ack) {
-		cli->handlers->ack(cli, ctx);
+		cli->handlers->ack(cli, ctx, round);
+	}
+
+	return 0;
+}
+
+static int handle_message_calibration_status(struct bt_mesh_model *model,
+			  struct bt_mesh_msg_ctx *ctx, struct net_buf_simple *buf)
+{
+	struct bt_mesh_movement_cli *cli = model->user_data;
+	struct bt_mesh_calibration_status status;
+
+	bt_mesh_calibration_status_decode(&status,
+		net_buf_simple_pull_mem(buf, BT_MESH_CALIBRATION_STATUS_LEN));
+
+	if (cli->handlers->calibration_status) {
+		cli->handlers->calibration_status(cli, ctx, status);
 	}
 
 	return 0;
@@ -58,9 +98,14 @@ static int handle_message_ack(struct bt_mesh_model *model, struct bt_mesh_msg_ct
 
 const struct bt_mesh_model_op _bt_mesh_movement_cli_op[] = {
 	{
-		BT_MESH_MOVEMENT_OP_MOVEMENT_ACK, BT_MESH_LEN_EXACT(0),
+		BT_MESH_MOVEMENT_OP_MOVEMENT_ACK, BT_MESH_LEN_MIN(0),
 		handle_message_ack
 	},
+	{
+		BT_MESH_MOVEMENT_OP_CALIBRATION_STATUS,
+		BT_MESH_LEN_MIN(BT_MESH_CALIBRATION_STATUS_LEN),
+		handle_message_calibration_status
+	},
 	BT_MESH_MODEL_OP_END,
 };
 
@@ -14,9 +14,9 @@ LOG_MODULE_REGISTER(movement_srv);
 struct bt_mesh_movement_set extract_movement(struct net_buf_simple *buf)
 {
 	struct bt_mesh_movement_set mov_conf;
-    mov_conf.time = net_buf_simple_pull_be32(buf);
-    mov_conf.angle = (int32_t)net_buf_simple_pull_be32(buf);
-    mov_conf.speed = net_buf_simple_pull_u8(buf);
+
+	bt_mesh_movement_set_decode(&mov_conf,
+		net_buf_simple_pull_mem(buf, BT_MESH_MOVEMENT_SET_LEN));
 	return mov_conf;
 }
 
@@ -26,16 +26,29 @@ static int handle_message_movement_set(struct bt_mesh_model *model, struct bt_me
 	LOG_INF("received message");
 	struct bt_mesh_movement_srv *srv = model->user_data;
 	struct bt_mesh_movement_set movement;
+	uint8_t round = BT_MESH_MOVEMENT_ROUND_NONE;
+	uint8_t stop = BT_MESH_MOVEMENT_STOP_DEFAULT;
 	int err;
 
 	movement = extract_movement(buf);
+	if (buf->len >= BT_MESH_MOVEMENT_ROUND_LEN) {
+		round = net_buf_simple_pull_u8(buf);
+	}
+	if (buf->len >= BT_MESH_MOVEMENT_STOP_LEN) {
+		stop = net_buf_simple_pull_u8(buf);
+	}
 
 	if (srv->handlers->set) {
-		srv->handlers->set(srv, movement);
+		srv->handlers->set(srv, movement, round, stop);
 	}
 
-	BT_MESH_MODEL_BUF_DEFINE(ack, BT_MESH_MOVEMENT_OP_MOVEMENT_ACK, 0);
+	/* The ack echoes the round, so the client can tell a late ack of a
+	 * replaced movement from the one it is waiting for.
+	 */
+	BT_MESH_MODEL_BUF_DEFINE(ack, BT_MESH_MOVEMENT_OP_MOVEMENT_ACK,
+				 BT_MESH_MOVEMENT_ROUND_LEN);
     bt_mesh_model_msg_init(&ack, BT_MESH_MOVEMENT_OP_MOVEMENT_ACK);
+    net_buf_simple_add_u8(&ack, round);
     err = bt_mesh_model_send(model, ctx, &ack, NULL, NULL);
     if (err)
     {
@@ -49,21 +62,60 @@ static int handle_message_ready_set(struct bt_mesh_model *model, struct bt_mesh_
 			  struct net_buf_simple *buf)
 {
 	struct bt_mesh_movement_srv *srv = model->user_data;
+	uint8_t round = BT_MESH_MOVEMENT_ROUND_NONE;
+
+	if (buf->len >= BT_MESH_MOVEMENT_ROUND_LEN) {
+		round = net_buf_simple_pull_u8(buf);
+	}
 
 	if (srv->handlers->ready) {
-		srv->handlers->ready(srv);
+		srv->handlers->ready(srv, round);
 	}
 
 	return 0;
 }
 
+static int handle_message_calibrate(struct bt_mesh_model *model, struct bt_mesh_msg_ctx *ctx,
+			  struct net_buf_simple *buf)
+{
+	struct bt_mesh_movement_srv *srv = model->user_data;
+
+	srv->calibrate_ctx = *ctx;
+	srv->calibrate_ctx.send_ttl = BT_MESH_TTL_DEFAULT;
+
+	if (srv->handlers->calibrate) {
+		srv->handlers->calibrate(srv);
+	}
+
+	return 0;
+}
+
+int bt_mesh_movement_srv_calibration_status(struct bt_mesh_movement_srv *srv,
+		const struct bt_mesh_calibration_status *status)
+{
+	if (srv->calibrate_ctx.addr == BT_MESH_ADDR_UNASSIGNED) {
+		return -EADDRNOTAVAIL;
+	}
+
+	BT_MESH_MODEL_BUF_DEFINE(buf, BT_MESH_MOVEMENT_OP_CALIBRATION_STATUS,
+				 BT_MESH_CALIBRATION_STATUS_LEN);
+	bt_mesh_model_msg_init(&buf, BT_MESH_MOVEMENT_OP_CALIBRATION_STATUS);
+	bt_mesh_calibration_status_encode(status,
+		net_buf_simple_add(&buf, BT_MESH_CALIBRATION_STATUS_LEN));
+
+	return bt_mesh_model_send(srv->model, &srv->calibrate_ctx, &buf, NULL, NULL);
+}
+
 const struct bt_mesh_model_op _bt_mesh_movement_srv_op[] = {
 	{
-		BT_MESH_MOVEMENT_OP_MOVEMENT_SET, BT_MESH_LEN_EXACT(9),
+		BT_MESH_MOVEMENT_OP_MOVEMENT_SET, BT_MESH_LEN_MIN(BT_MESH_MOVEMENT_SET_LEN),
 		handle_message_movement_set
 	},
 	{
-		BT_MESH_MOVEMENT_OP_READY_SET, BT_MESH_LEN_EXACT(0), handle_message_ready_set
+		BT_MESH_MOVEMENT_OP_READY_SET, BT_MESH_LEN_MIN(0), handle_message_ready_set
+	},
+	{
+		BT_MESH_MOVEMENT_OP_CALIBRATE, BT_MESH_LEN_MIN(0), handle_message_calibrate
 	},
 	BT_MESH_MODEL_OP_END,
 };
@@ -14,38 +14,60 @@ LOG_MODULE_REGISTER(robot_cli);
 
 int bt_mesh_robot_cli_movement_set(struct bt_mesh_robot_cli *cli,
 					   	struct bt_mesh_msg_ctx *ctx,
-						struct bt_mesh_movement_set set)
+						struct bt_mesh_movement_set set,
+						uint8_t round, uint8_t stop)
 {
-	return bt_mesh_movement_cli_movement_set(&cli->movement, ctx, set);
+	return bt_mesh_movement_cli_movement_set(&cli->movement, ctx, set, round, stop);
 }
 
 int bt_mesh_robot_cli_ready_set(struct bt_mesh_robot_cli *cli,
-					   struct bt_mesh_msg_ctx *ctx)
+					   struct bt_mesh_msg_ctx *ctx,
+					   uint8_t round)
 {
-	return bt_mesh_movement_cli_ready_set(&cli->movement, ctx);
+	return bt_mesh_movement_cli_ready_set(&cli->movement, ctx, round);
 }
 
-static void handle_ack(struct bt_mesh_movement_cli *cli, struct bt_mesh_msg_ctx *ctx) 
+int bt_mesh_robot_cli_calibrate(struct bt_mesh_robot_cli *cli,
+					   	struct bt_mesh_msg_ctx *ctx)
+{
+	return bt_mesh_movement_cli_calibrate(&cli->movement, ctx);
+}
+
+static void handle_ack(struct bt_mesh_movement_cli *cli, struct bt_mesh_msg_ctx *ctx,
+		       uint8_t round) 
 {
 	struct bt_mesh_robot_cli *robot_cli = 
 		CONTAINER_OF(cli, struct bt_mesh_robot_cli, movement);
 	if (robot_cli->handlers->movement_configured) {
-		robot_cli->handlers->movement_configured(robot_cli, ctx);
+		robot_cli->handlers->movement_configured(robot_cli, ctx, round);
+	}
+}
+
+static void handle_calibration_status(struct bt_mesh_movement_cli *cli,
+				      struct bt_mesh_msg_ctx *ctx,
+				      struct bt_mesh_calibration_status status)
+{
+	struct bt_mesh_robot_cli *robot_cli = 
+		CONTAINER_OF(cli, struct bt_mesh_robot_cli, movement);
+	if (robot_cli->handlers->calibrated) {
+		robot_cli->handlers->calibrated(robot_cli, status, ctx);
 	}
 }
 
 static const struct bt_mesh_movement_cli_handlers movement_cb = {
 	.ack = handle_ack,
+	.calibration_status = handle_calibration_status,
 };
 
 static void handle_report(struct bt_mesh_telemetry_cli *cli, 
 						struct bt_mesh_msg_ctx *ctx, 
-						struct bt_mesh_telemetry_report telemetry) 
+						struct bt_mesh_telemetry_report telemetry,
+						const struct bt_mesh_telemetry_power *power) 
 {
 	struct bt_mesh_robot_cli *robot_cli = 
 		CONTAINER_OF(cli, struct bt_mesh_robot_cli, telemetry);
 	if (robot_cli->handlers->telemetry_reported) {
-		robot_cli->handlers->telemetry_reported(robot_cli, telemetry, ctx);
+		robot_cli->handlers->telemetry_reported(robot_cli, telemetry, power, ctx);
 	}
 }
 
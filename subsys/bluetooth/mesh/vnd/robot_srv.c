@@ -11,14 +11,17 @@
 #include <zephyr/logging/log.h>
 LOG_MODULE_REGISTER(robot_srv);
 
-uint8_t *identity = NULL;
-
-static struct bt_mesh_movement_set movement_config;
-
 int bt_mesh_robot_report_telemetry(struct bt_mesh_robot_srv *srv,
-					  struct bt_mesh_telemetry_report telemetry)
+					  struct bt_mesh_telemetry_report telemetry,
+					  const struct bt_mesh_telemetry_power *power)
+{
+	return bt_mesh_telemetry_report(&srv->telemetry, telemetry, power);
+}
+
+int bt_mesh_robot_calibration_status(struct bt_mesh_robot_srv *srv,
+				     struct bt_mesh_calibration_status status)
 {
-	return bt_mesh_telemetry_report(&srv->telemetry, telemetry);
+	return bt_mesh_movement_srv_calibration_status(&srv->movement, &status);
 }
 
 static uint8_t * handle_identify(struct bt_mesh_id_srv *srv)
@@ -37,26 +40,122 @@ static const struct bt_mesh_id_srv_handlers id_cb = {
 };
 
 
+/* Rounds wrap around, a round is older than another if it is less than half
+ * the sequence space behind it.
+ */
+static bool round_is_before(uint8_t round, uint8_t ref)
+{
+	return (int8_t)(round - ref) < 0;
+}
+
+/* Picks the slot of the round if it is already staged, otherwise a free slot,
+ * or the slot of the oldest round.
+ */
+static struct bt_mesh_robot_srv_stage *stage_get(struct bt_mesh_robot_srv *srv,
+						 uint8_t round)
+{
+	struct bt_mesh_robot_srv_stage *free = NULL;
+	struct bt_mesh_robot_srv_stage *oldest = NULL;
+
+	for (size_t i = 0; i < ARRAY_SIZE(srv->staged); i++) {
+		struct bt_mesh_robot_srv_stage *stage = &srv->staged[i];
+
+		if (!stage->valid) {
+			if (!free) {
+				free = stage;
+			}
+			continue;
+		}
+
+		if (stage->round == round) {
+			return stage;
+		}
+
+		if (!oldest || round_is_before(stage->round, oldest->round)) {
+			oldest = stage;
+		}
+	}
+
+	if (free) {
+		return free;
+	}
+
+	LOG_WRN("Dropping movement staged for round %d", oldest->round);
+	return oldest;
+}
+
 static void handle_movement_set(struct bt_mesh_movement_srv *srv, 
-				struct bt_mesh_movement_set msg)
+				struct bt_mesh_movement_set msg, uint8_t round,
+				uint8_t stop)
 {
-	movement_config = msg;
-	LOG_INF("movement set, time: %d, rotation: %d, speed: %d", movement_config.time, movement_config.angle, movement_config.speed);
+	struct bt_mesh_robot_srv *robot_srv = 
+		CONTAINER_OF(srv, struct bt_mesh_robot_srv, movement);
+	struct bt_mesh_robot_srv_stage *stage = stage_get(robot_srv, round);
+
+	stage->movement = msg;
+	stage->round = round;
+	stage->stop = stop;
+	stage->valid = true;
+	LOG_INF("movement set, round: %d, time: %d, rotation: %d, speed: %d, stop: %d",
+		round, msg.time, msg.angle, msg.speed, stop);
+
+	if (robot_srv->handlers->configure) {
+		robot_srv->handlers->configure(robot_srv, &stage->movement);
+	}
 }
 
-static void handle_movement_ready(struct bt_mesh_movement_srv *srv)
+static void handle_movement_ready(struct bt_mesh_movement_srv *srv, uint8_t round)
 {	
 	struct bt_mesh_robot_srv *robot_srv = 
 		CONTAINER_OF(srv, struct bt_mesh_robot_srv, movement);
+	bool found = false;
+
+	for (size_t i = 0; i < ARRAY_SIZE(robot_srv->staged); i++) {
+		struct bt_mesh_robot_srv_stage *stage = &robot_srv->staged[i];
+
+		if (!stage->valid) {
+			continue;
+		}
+
+		if (stage->round == round) {
+			robot_srv->movement_config = stage->movement;
+			robot_srv->movement_stop = stage->stop;
+			stage->valid = false;
+			found = true;
+		} else if (round != BT_MESH_MOVEMENT_ROUND_NONE &&
+			   stage->round != BT_MESH_MOVEMENT_ROUND_NONE &&
+			   round_is_before(stage->round, round)) {
+			/* Staged for a round that was skipped. */
+			stage->valid = false;
+		}
+	}
+
+	if (!found) {
+		LOG_WRN("No movement staged for round %d", round);
+		return;
+	}
 
 	if (robot_srv->handlers->move) {
-		robot_srv->handlers->move(robot_srv, &movement_config);
+		robot_srv->handlers->move(robot_srv, &robot_srv->movement_config);
+	}
+}
+
+static void handle_movement_calibrate(struct bt_mesh_movement_srv *srv)
+{
+	struct bt_mesh_robot_srv *robot_srv = 
+		CONTAINER_OF(srv, struct bt_mesh_robot_srv, movement);
+
+	LOG_INF("calibration requested");
+
+	if (robot_srv->handlers->calibrate) {
+		robot_srv->handlers->calibrate(robot_srv);
 	}
 }
 
 static const struct bt_mesh_movement_srv_handlers movement_cb = {
 	.set = handle_movement_set,
 	.ready = handle_movement_ready,
+	.calibrate = handle_movement_calibrate,
 };
 
 // static int bt_mesh_robot_srv_start(struct bt_mesh_model *model)
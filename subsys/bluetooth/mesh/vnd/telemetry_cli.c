@@ -16,10 +16,21 @@ static int handle_message_report(struct bt_mesh_model *model, struct bt_mesh_msg
 {
 	struct bt_mesh_telemetry_cli *cli = model->user_data;
 	struct bt_mesh_telemetry_report telemetry;
-	telemetry.revolutions = net_buf_simple_pull_u8(buf);
+	struct bt_mesh_telemetry_power power;
+	bool has_power = false;
+
+	bt_mesh_telemetry_report_decode(&telemetry,
+		net_buf_simple_pull_mem(buf, BT_MESH_TELEMETRY_REPORT_LEN));
+
+	/* Robots without power monitoring send the report alone. */
+	if (buf->len >= BT_MESH_TELEMETRY_POWER_LEN) {
+		bt_mesh_telemetry_power_decode(&power,
+			net_buf_simple_pull_mem(buf, BT_MESH_TELEMETRY_POWER_LEN));
+		has_power = true;
+	}
 
 	if (cli->handlers->report) {
-		cli->handlers->report(cli, ctx, telemetry);
+		cli->handlers->report(cli, ctx, telemetry, has_power ? &power : NULL);
 	}
 
 	return 0;
@@ -27,7 +38,7 @@ static int handle_message_report(struct bt_mesh_model *model, struct bt_mesh_msg
 
 const struct bt_mesh_model_op _bt_mesh_telemetry_cli_op[] = {
 	{
-		BT_MESH_TELEMETRY_OP_TELEMETRY_REPORT, BT_MESH_LEN_EXACT(1),
+		BT_MESH_TELEMETRY_OP_TELEMETRY_REPORT, BT_MESH_LEN_MIN(BT_MESH_TELEMETRY_REPORT_LEN),
 		handle_message_report
 	},
 	BT_MESH_MODEL_OP_END,
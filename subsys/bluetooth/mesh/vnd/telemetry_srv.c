@@ -12,10 +12,16 @@
 LOG_MODULE_REGISTER(telemetry_srv);
 
 int bt_mesh_telemetry_report(struct bt_mesh_telemetry_srv *srv,
-					   		struct bt_mesh_telemetry_report telemetry)
+					   		struct bt_mesh_telemetry_report telemetry,
+					   		const struct bt_mesh_telemetry_power *power)
 {
 	bt_mesh_model_msg_init(&srv->pub_msg, BT_MESH_TELEMETRY_OP_TELEMETRY_REPORT);
-	net_buf_simple_add_mem(&srv->pub_msg, &telemetry.revolutions, sizeof(uint8_t));
+	bt_mesh_telemetry_report_encode(&telemetry,
+		net_buf_simple_add(&srv->pub_msg, BT_MESH_TELEMETRY_REPORT_LEN));
+	if (power) {
+		bt_mesh_telemetry_power_encode(power,
+			net_buf_simple_add(&srv->pub_msg, BT_MESH_TELEMETRY_POWER_LEN));
+	}
 	return bt_mesh_model_publish(srv->model);
 }
 
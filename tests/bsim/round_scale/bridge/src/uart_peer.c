@@ -0,0 +1,283 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/* Scripted stand-in for the nRF9160 on the other end of the bridge UART.
+ * It replaces the UART handler of the bridge, waits for the robots to join,
+ * and runs rounds the way the gateway robot module does, printing the
+ * timing of every round as a JSON line.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <bluetooth/mesh/vnd/id.h>
+#include <bluetooth/mesh/vnd/id_cli.h>
+#include <bluetooth/mesh/vnd/movement.h>
+#include <bluetooth/mesh/vnd/movement_cli.h>
+#include <bluetooth/mesh/vnd/telemetry.h>
+#include <bluetooth/mesh/vnd/telemetry_cli.h>
+#include "posix_board_if.h"
+
+#include "uart_handler.h"
+#include "groups.h"
+
+#define DT_DRV_COMPAT nordic_uart_peer
+
+#define PEER_STACK_SIZE 2048
+#define PEER_PRIORITY 5
+
+/* Message from the bridge, as far as the script needs it. */
+struct peer_msg {
+	uint32_t type;
+	uint32_t id;
+	uint16_t addr;
+	uint8_t round;
+	bool all;
+	int64_t time_us;
+};
+
+struct peer_robot {
+	uint16_t addr;
+	/* Subscribed to the all robots group */
+	bool all;
+	bool acked;
+	bool reported;
+};
+
+K_MSGQ_DEFINE(peer_msgq, sizeof(struct peer_msg), 2 * CONFIG_ROUND_SCALE_ROBOTS + 8, 4);
+
+static struct peer_robot robots[CONFIG_ROUND_SCALE_ROBOTS];
+static size_t robot_count;
+static const struct device *peer_dev;
+static struct uart_msg_handlers *peer_handlers;
+
+/* Round being run, and the time of its last acknowledgment and report. */
+static uint8_t round_number;
+static size_t acked;
+static size_t reported;
+static int64_t ack_us;
+static int64_t telemetry_us;
+
+static int64_t now_us(void)
+{
+	return k_ticks_to_us_floor64(k_uptime_ticks());
+}
+
+static struct peer_robot *robot_get(uint16_t addr, bool add)
+{
+	for (size_t i = 0; i < robot_count; i++) {
+		if (robots[i].addr == addr) {
+			return &robots[i];
+		}
+	}
+
+	if (!add || robot_count == ARRAY_SIZE(robots)) {
+		return NULL;
+	}
+
+	robots[robot_count] = (struct peer_robot){ .addr = addr };
+	return &robots[robot_count++];
+}
+
+static size_t robots_joined(void)
+{
+	size_t joined = 0;
+
+	for (size_t i = 0; i < robot_count; i++) {
+		joined += robots[i].all;
+	}
+
+	return joined;
+}
+
+static void peer_process(const struct peer_msg *msg)
+{
+	struct peer_robot *robot = robot_get(msg->addr, msg->id == ID_CLI_MODEL_ID);
+
+	if (!robot) {
+		return;
+	}
+
+	if (msg->id == BRIDGE_CTRL_ID && msg->type == BRIDGE_CTRL_OP_GROUPS_STATUS) {
+		robot->all = msg->all;
+	} else if (msg->id == MOVEMENT_CLI_MODEL_ID &&
+		   msg->type == BT_MESH_MOVEMENT_OP_MOVEMENT_ACK) {
+		if (msg->round == round_number && !robot->acked) {
+			robot->acked = true;
+			acked++;
+			ack_us = msg->time_us;
+		}
+	} else if (msg->id == TELEMETRY_CLI_MODEL_ID &&
+		   msg->type == BT_MESH_TELEMETRY_OP_TELEMETRY_REPORT) {
+		if (robot->acked && !robot->reported) {
+			robot->reported = true;
+			reported++;
+			telemetry_us = msg->time_us;
+		}
+	}
+}
+
+/* Processes the next message from the bridge. Returns false once the
+ * deadline, in uptime milliseconds, has passed.
+ */
+static bool peer_wait(int64_t deadline)
+{
+	struct peer_msg msg;
+	int64_t timeout = deadline - k_uptime_get();
+
+	if (timeout <= 0 || k_msgq_get(&peer_msgq, &msg, K_MSEC(timeout))) {
+		return false;
+	}
+
+	peer_process(&msg);
+	return true;
+}
+
+static void peer_send(uint8_t *data, uint8_t len, uint32_t type, uint16_t id, uint16_t addr)
+{
+	peer_handlers->rx(peer_dev, data, len, type, id, addr);
+}
+
+static void movement_send(uint16_t addr)
+{
+	struct bt_mesh_movement_set movement = {
+		.time = CONFIG_ROUND_SCALE_DRIVE_MS,
+		.speed = 100,
+	};
+	uint8_t payload[BT_MESH_MOVEMENT_SET_LEN + BT_MESH_MOVEMENT_ROUND_LEN +
+			BT_MESH_MOVEMENT_STOP_LEN];
+
+	bt_mesh_movement_set_encode(&movement, payload);
+	payload[BT_MESH_MOVEMENT_SET_LEN] = round_number;
+	payload[BT_MESH_MOVEMENT_SET_LEN + BT_MESH_MOVEMENT_ROUND_LEN] =
+		BT_MESH_MOVEMENT_STOP_DEFAULT;
+	peer_send(payload, sizeof(payload), BT_MESH_MOVEMENT_OP_MOVEMENT_SET,
+		  MOVEMENT_CLI_MODEL_ID, addr);
+}
+
+static void ready_send(uint16_t addr)
+{
+	peer_send(&round_number, BT_MESH_MOVEMENT_ROUND_LEN, BT_MESH_MOVEMENT_OP_READY_SET,
+		  MOVEMENT_CLI_MODEL_ID, addr);
+}
+
+static void round_run(void)
+{
+	int64_t configure_us;
+	int64_t ready_us;
+	int64_t deadline;
+
+	acked = 0;
+	reported = 0;
+	ack_us = 0;
+	telemetry_us = 0;
+	for (size_t i = 0; i < robot_count; i++) {
+		robots[i].acked = false;
+		robots[i].reported = false;
+	}
+
+	configure_us = now_us();
+	for (size_t i = 0; i < robot_count; i++) {
+		movement_send(robots[i].addr);
+	}
+
+	deadline = k_uptime_get() + CONFIG_ROUND_SCALE_PHASE_TIMEOUT_MS;
+	while (acked < robot_count && peer_wait(deadline)) {
+	}
+
+	/* Like the robot module, one ready message on the all robots group,
+	 * and one for every robot that is not subscribed to it.
+	 */
+	ready_us = now_us();
+	ready_send(GROUPS_ADDR_ALL);
+	for (size_t i = 0; i < robot_count; i++) {
+		if (robots[i].acked && !robots[i].all) {
+			ready_send(robots[i].addr);
+		}
+	}
+
+	deadline = k_uptime_get() + CONFIG_ROUND_SCALE_DRIVE_MS +
+		   CONFIG_ROUND_SCALE_PHASE_TIMEOUT_MS;
+	while (reported < acked && peer_wait(deadline)) {
+	}
+
+	printk("round_scale {\"robots\":%d,\"round\":%d,\"acked\":%d,\"reported\":%d,"
+	       "\"configure_ms\":%d,\"ack_ms\":%d,\"telemetry_ms\":%d,"
+	       "\"ready_us\":%lld}\n",
+	       (int)robot_count, round_number, (int)acked, (int)reported,
+	       (int)((ready_us - configure_us) / 1000),
+	       ack_us ? (int)((ack_us - configure_us) / 1000) : -1,
+	       telemetry_us ? (int)((telemetry_us - ready_us) / 1000) : -1,
+	       ready_us);
+}
+
+static void peer_thread_fn(void)
+{
+	int64_t deadline = k_uptime_get() + CONFIG_ROUND_SCALE_JOIN_TIMEOUT_MS;
+
+	/* Robots are provisioned by the bridge, and then identify themselves
+	 * and get subscribed to the all robots group.
+	 */
+	while (robots_joined() < CONFIG_ROUND_SCALE_ROBOTS && peer_wait(deadline)) {
+	}
+
+	printk("round_scale {\"robots\":%d,\"identified\":%d,\"joined\":%d,\"join_ms\":%lld}\n",
+	       CONFIG_ROUND_SCALE_ROBOTS, (int)robot_count, (int)robots_joined(),
+	       k_uptime_get());
+
+	for (int i = 0; i < CONFIG_ROUND_SCALE_ROUNDS && robot_count; i++) {
+		round_number++;
+		round_run();
+	}
+
+	posix_exit(robot_count == CONFIG_ROUND_SCALE_ROBOTS ? 0 : 1);
+}
+
+K_THREAD_DEFINE(peer_thread, PEER_STACK_SIZE, peer_thread_fn, NULL, NULL, NULL,
+		PEER_PRIORITY, 0, SYS_FOREVER_MS);
+
+/* Messages from the bridge to the nRF9160. */
+int uart_send(const struct device *dev, uint8_t *data, uint32_t len, uint32_t type,
+	      uint32_t id, uint32_t addr)
+{
+	struct peer_msg msg = {
+		.type = type,
+		.id = id,
+		.addr = addr,
+		.time_us = now_us(),
+	};
+
+	if (id == MOVEMENT_CLI_MODEL_ID && type == BT_MESH_MOVEMENT_OP_MOVEMENT_ACK &&
+	    len >= BT_MESH_MOVEMENT_ROUND_LEN) {
+		msg.round = data[0];
+	} else if (id == BRIDGE_CTRL_ID && type == BRIDGE_CTRL_OP_GROUPS_STATUS &&
+		   len == sizeof(struct groups_status)) {
+		msg.all = ((struct groups_status *)data)->all;
+	}
+
+	if (k_msgq_put(&peer_msgq, &msg, K_NO_WAIT)) {
+		printk("round_scale: dropped message %x from %x\n", type, addr);
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+int init_uart(const struct device *dev, struct uart_msg_handlers *handlers)
+{
+	peer_dev = dev;
+	peer_handlers = handlers;
+	k_thread_start(peer_thread);
+
+	return 0;
+}
+
+static int peer_dev_init(const struct device *dev)
+{
+	return 0;
+}
+
+DEVICE_DT_INST_DEFINE(0, peer_dev_init, NULL, NULL, NULL, POST_KERNEL,
+		      CONFIG_KERNEL_INIT_PRIORITY_DEVICE, NULL);
@@ -0,0 +1,28 @@
+#!/usr/bin/env bash
+# Copyright (c) 2022 Nordic Semiconductor ASA
+# SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+
+# Builds the robot, and the bridge with the scripted gateway for every robot
+# count, for nrf52_bsim, and installs them in ${BSIM_OUT_PATH}/bin.
+
+set -ue
+
+: "${BSIM_OUT_PATH:?BSIM_OUT_PATH must be defined}"
+: "${BSIM_COMPONENTS_PATH:?BSIM_COMPONENTS_PATH must be defined}"
+: "${ZEPHYR_BASE:?ZEPHYR_BASE must be set}"
+
+HERE=$(cd "$(dirname "$0")" && pwd)
+REPO=$(cd "${HERE}/../../.." && pwd)
+BUILD=${BUILD:-${HERE}/build}
+ROUND_SCALE_COUNTS=${ROUND_SCALE_COUNTS:-"2 4 8 16 32 64"}
+
+west build -p auto -b nrf52_bsim -d "${BUILD}/robot" "${REPO}/applications/robot_wars/robot" -- \
+	-DOVERLAY_CONFIG="${HERE}/robot.conf"
+cp "${BUILD}/robot/zephyr/zephyr.exe" "${BSIM_OUT_PATH}/bin/bs_nrf52_bsim_round_scale_robot"
+
+for n in ${ROUND_SCALE_COUNTS}; do
+	west build -p auto -b nrf52_bsim -d "${BUILD}/bridge_${n}" "${HERE}/bridge" -- \
+		-DCONFIG_ROUND_SCALE_ROBOTS="${n}"
+	cp "${BUILD}/bridge_${n}/zephyr/zephyr.exe" \
+		"${BSIM_OUT_PATH}/bin/bs_nrf52_bsim_round_scale_bridge_${n}"
+done
@@ -0,0 +1,129 @@
+#!/usr/bin/env python3
+# Copyright (c) 2022 Nordic Semiconductor ASA
+# SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+
+"""Prints the metrics of every round of a round scale run as JSON lines.
+
+The bridge log gives the timing seen from the gateway side of the UART, and
+the robot logs give the time each robot got the ready message. All devices
+share the simulation clock, so the skew between robots is measured instead
+of guessed.
+
+Exits with 1 if fewer rounds than expected ran, if a robot missed a round,
+or if a round exceeds a threshold. The thresholds can be overridden through
+the environment.
+"""
+
+import argparse
+import glob
+import json
+import os
+import sys
+
+
+def records(path, tag):
+    """Yields the JSON objects printed after tag in a device log."""
+    with open(path, encoding='utf-8', errors='replace') as log:
+        for line in log:
+            start = line.find(tag + ' {')
+            if start < 0:
+                continue
+            try:
+                yield json.loads(line[start + len(tag) + 1:].strip())
+            except json.JSONDecodeError:
+                continue
+
+
+def env_int(name, default):
+    return int(os.environ.get(name, default))
+
+
+def arguments():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('out', help='directory of the device logs')
+    parser.add_argument('count', type=int, help='robot count of the run')
+    parser.add_argument('--rounds', type=int, default=env_int('ROUND_SCALE_ROUNDS', 5),
+                        help='rounds the bridge runs, CONFIG_ROUND_SCALE_ROUNDS')
+    parser.add_argument('--drive-ms', type=int, default=env_int('ROUND_SCALE_DRIVE_MS', 1000),
+                        help='movement time, CONFIG_ROUND_SCALE_DRIVE_MS')
+    parser.add_argument('--max-skew-ms', type=int,
+                        default=env_int('ROUND_SCALE_MAX_SKEW_MS', 100),
+                        help='largest skew of the movement starts')
+    parser.add_argument('--max-start-ms', type=int,
+                        default=env_int('ROUND_SCALE_MAX_START_MS', 500),
+                        help='largest time from the ready message to the last start')
+    parser.add_argument('--max-configure-ms-per-robot', type=int,
+                        default=env_int('ROUND_SCALE_MAX_CONFIGURE_MS_PER_ROBOT', 250),
+                        help='largest configure phase per robot, over a 1 s base')
+    parser.add_argument('--max-telemetry-ms', type=int,
+                        default=env_int('ROUND_SCALE_MAX_TELEMETRY_MS', 2000),
+                        help='largest time from the end of the movement to the last report')
+    return parser.parse_args()
+
+
+def failures(args, metrics):
+    """Returns the thresholds a round misses."""
+    robots = metrics['robots']
+    limits = {
+        'skew_ms': args.max_skew_ms,
+        'start_ms': args.max_start_ms,
+        'configure_ms': 1000 + args.max_configure_ms_per_robot * robots,
+        'telemetry_ms': args.drive_ms + args.max_telemetry_ms,
+    }
+
+    missed = [f'{key} {metrics[key]} > {limit}' for key, limit in limits.items()
+              if metrics[key] > limit]
+    missed += [f'{key} {metrics[key]} of {robots}'
+               for key in ('acked', 'reported', 'started') if metrics[key] != robots]
+    missed += [f'{key} not measured' for key in ('skew_ms', 'start_ms') if metrics[key] < 0]
+    return missed
+
+
+def main():
+    args = arguments()
+    out, count = args.out, args.count
+
+    rounds = [r for r in records(os.path.join(out, f'{count}_bridge.log'), 'round_scale')
+              if 'round' in r]
+    if len(rounds) < args.rounds:
+        print(f'round_scale: {len(rounds)} of {args.rounds} rounds run with {count} robots',
+              file=sys.stderr)
+        return 1
+
+    # First ready message of every robot, in every round
+    starts = [[] for _ in rounds]
+    for path in glob.glob(os.path.join(out, f'{count}_robot_*.log')):
+        ready = [e['time_us'] for e in records(path, 'sim') if e['event'] == 'ready']
+        for i, r in enumerate(rounds):
+            end = rounds[i + 1]['ready_us'] if i + 1 < len(rounds) else None
+            times = [t for t in ready if t >= r['ready_us'] and (end is None or t < end)]
+            if times:
+                starts[i].append(min(times))
+
+    status = 0
+    for r, times in zip(rounds, starts):
+        metrics = {
+            'robots': r['robots'],
+            'round': r['round'],
+            'acked': r['acked'],
+            'reported': r['reported'],
+            'started': len(times),
+            'configure_ms': r['configure_ms'],
+            'ack_ms': r['ack_ms'],
+            'start_ms': (max(times) - r['ready_us']) // 1000 if times else -1,
+            'skew_ms': (max(times) - min(times)) // 1000 if times else -1,
+            'telemetry_ms': r['telemetry_ms'],
+        }
+        print(json.dumps(metrics))
+
+        missed = failures(args, metrics)
+        if missed:
+            print(f"round_scale: round {r['round']} with {count} robots failed: "
+                  + ', '.join(missed), file=sys.stderr)
+            status = 1
+
+    return status
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,48 @@
+#!/usr/bin/env bash
+# Copyright (c) 2022 Nordic Semiconductor ASA
+# SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+
+# Runs the round scale simulation for every robot count built by compile.sh,
+# and prints the metrics of every round as JSON lines. Fails if a device
+# fails, or a round misses the thresholds of metrics.py. The logs of every
+# device are kept in ${OUT}.
+
+set -ue
+
+: "${BSIM_OUT_PATH:?BSIM_OUT_PATH must be defined}"
+
+HERE=$(cd "$(dirname "$0")" && pwd)
+OUT=${OUT:-${HERE}/out}
+ROUND_SCALE_COUNTS=${ROUND_SCALE_COUNTS:-"2 4 8 16 32 64"}
+# Upper bound of the simulated time of a run, joining included
+SIM_LENGTH_S=${SIM_LENGTH_S:-1200}
+
+mkdir -p "${OUT}"
+cd "${BSIM_OUT_PATH}/bin"
+
+status=0
+for n in ${ROUND_SCALE_COUNTS}; do
+	sim_id="round_scale_${n}"
+	rm -f "${OUT}/${n}_"*.log
+
+	pids=()
+	./bs_2G4_phy_v1 -s="${sim_id}" -D=$((n + 1)) -sim_length=$((SIM_LENGTH_S * 1000000)) \
+		> "${OUT}/${n}_phy.log" 2>&1 &
+	pids+=($!)
+	./bs_nrf52_bsim_round_scale_bridge_${n} -s="${sim_id}" -d=0 -rs=1 \
+		> "${OUT}/${n}_bridge.log" 2>&1 &
+	pids+=($!)
+	for i in $(seq 1 "${n}"); do
+		./bs_nrf52_bsim_round_scale_robot -s="${sim_id}" -d="${i}" -rs=$((i + 1)) \
+			> "${OUT}/${n}_robot_${i}.log" 2>&1 &
+		pids+=($!)
+	done
+
+	# A bare wait returns 0 whatever the devices exit with
+	for pid in "${pids[@]}"; do
+		wait "${pid}" || status=1
+	done
+	python3 "${HERE}/metrics.py" "${OUT}" "${n}" || status=1
+done
+
+exit ${status}
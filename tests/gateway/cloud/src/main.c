@@ -0,0 +1,233 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/* Set by the AWS IoT and MQTT libraries, which are stubbed below. */
+#define CONFIG_AWS_IOT_CLIENT_ID_STATIC "test-gateway"
+#define CONFIG_MQTT_KEEPALIVE 60
+
+/* Built in, to reach the backoff and the reconnect statistics. */
+#include "cloud_module.c"
+
+#include <ztest.h>
+
+/* Keepalive the stubbed broker asks for, the poll thread pings after it. */
+#define STUB_KEEPALIVE_MS 100
+
+static aws_iot_evt_handler_t stub_handler;
+static atomic_t stub_connects;
+static atomic_t stub_pings;
+static int stub_connect_err;
+
+K_SEM_DEFINE(stub_connected, 0, 1);
+
+int aws_iot_init(const struct aws_iot_config *const config,
+		 aws_iot_evt_handler_t event_handler)
+{
+	stub_handler = event_handler;
+	return 0;
+}
+
+/* Every successful connect opens a new socket, like the library does. */
+int aws_iot_connect(struct aws_iot_config *const config)
+{
+	atomic_inc(&stub_connects);
+	k_sem_give(&stub_connected);
+
+	if (stub_connect_err) {
+		return stub_connect_err;
+	}
+
+	config->socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	return config->socket < 0 ? -errno : 0;
+}
+
+int aws_iot_disconnect(void)
+{
+	if (aws_config.socket >= 0) {
+		close(aws_config.socket);
+		aws_config.socket = -1;
+	}
+
+	return 0;
+}
+
+int aws_iot_send(const struct aws_iot_data *const tx_data)
+{
+	return 0;
+}
+
+int aws_iot_input(void)
+{
+	return 0;
+}
+
+int aws_iot_ping(void)
+{
+	atomic_inc(&stub_pings);
+	return 0;
+}
+
+int aws_iot_keepalive_time_left(void)
+{
+	return STUB_KEEPALIVE_MS;
+}
+
+int aws_iot_subscription_topics_add(const struct aws_iot_topic_data *const topic_list,
+				    size_t list_count)
+{
+	return 0;
+}
+
+static void stub_event(enum aws_iot_evt_type type)
+{
+	struct aws_iot_evt evt = {
+		.type = type,
+	};
+
+	zassert_not_null(stub_handler, "AWS IoT not initialized");
+	stub_handler(&evt);
+}
+
+/* The library closes the socket and reports the lost connection. */
+static void stub_connection_lost(void)
+{
+	aws_iot_disconnect();
+	stub_event(AWS_IOT_EVT_DISCONNECTED);
+}
+
+static void stub_connect_wait(k_timeout_t timeout)
+{
+	zassert_equal(k_sem_take(&stub_connected, timeout), 0, "No connection attempt");
+}
+
+/* Lets the cloud module handle the events submitted so far. */
+static void cloud_settle(void)
+{
+	k_sleep(K_MSEC(50));
+}
+
+static void cloud_connect(void)
+{
+	stub_connect_wait(K_SECONDS(1));
+	stub_event(AWS_IOT_EVT_READY);
+	cloud_settle();
+	zassert_equal(sub_state, SUB_STATE_CLOUD_CONNECTED, NULL);
+}
+
+ZTEST(cloud_backoff, test_bounds)
+{
+	uint32_t upper = CONFIG_CLOUD_BACKOFF_BASE_SEC;
+	bool max_reached = false;
+
+	backoff_reset();
+
+	for (int i = 0; i < 1000; i++) {
+		uint32_t delay;
+
+		upper = MIN(upper * 3, CONFIG_CLOUD_BACKOFF_MAX_SEC);
+		delay = backoff_next();
+
+		zassert_true(delay >= CONFIG_CLOUD_BACKOFF_BASE_SEC && delay <= upper,
+			     "Delay %u s out of %u..%u s", delay,
+			     CONFIG_CLOUD_BACKOFF_BASE_SEC, upper);
+		max_reached |= (delay == CONFIG_CLOUD_BACKOFF_MAX_SEC);
+		upper = delay;
+	}
+
+	zassert_true(max_reached, "Backoff never reached its maximum");
+
+	backoff_reset();
+	zassert_equal(backoff_sec, CONFIG_CLOUD_BACKOFF_BASE_SEC, NULL);
+	zassert_equal(connect_retries, 0, NULL);
+}
+
+/* A lost connection is resumed right away, and the poll thread polls the
+ * socket of the new connection.
+ */
+ZTEST(cloud_supervision, test_reconnect)
+{
+	atomic_val_t pings;
+
+	cloud_connect();
+	zassert_equal(atomic_get(&stub_connects), 1, NULL);
+
+	stub_connection_lost();
+	stub_connect_wait(K_MSEC(500));
+	zassert_equal(atomic_get(&stub_connects), 2, NULL);
+
+	stub_event(AWS_IOT_EVT_READY);
+	cloud_settle();
+	zassert_equal(sub_state, SUB_STATE_CLOUD_CONNECTED, NULL);
+	zassert_equal(reconnect_stats.count, 1, NULL);
+	zassert_true(reconnect_stats.last_ms < 500, "Reconnected in %u ms",
+		     reconnect_stats.last_ms);
+
+	pings = atomic_get(&stub_pings);
+	k_sleep(K_MSEC(3 * STUB_KEEPALIVE_MS));
+	zassert_true(atomic_get(&stub_pings) > pings, "New socket not polled");
+}
+
+/* Failed attempts are retried after the backoff, until one succeeds. */
+ZTEST(cloud_supervision, test_reconnect_backoff)
+{
+	cloud_connect();
+
+	stub_connect_err = -ECONNREFUSED;
+	stub_connection_lost();
+	stub_connect_wait(K_MSEC(500));
+
+	/* Decorrelated jitter after a reset is at most three times the base. */
+	stub_connect_wait(K_SECONDS(MIN(3 * CONFIG_CLOUD_BACKOFF_BASE_SEC,
+					CONFIG_CLOUD_BACKOFF_MAX_SEC) + 1));
+	zassert_equal(sub_state, SUB_STATE_CLOUD_DISCONNECTED, NULL);
+
+	stub_connect_err = 0;
+	stub_connect_wait(K_SECONDS(CONFIG_CLOUD_BACKOFF_MAX_SEC + 1));
+	stub_event(AWS_IOT_EVT_READY);
+	cloud_settle();
+	zassert_equal(sub_state, SUB_STATE_CLOUD_CONNECTED, NULL);
+	zassert_equal(connect_retries, 0, NULL);
+}
+
+ZTEST_SUITE(cloud_backoff, NULL, NULL, NULL, NULL, NULL);
+
+static void *cloud_setup(void)
+{
+	zassert_equal(app_event_manager_init(), 0, "Application Event Manager not initialized");
+	return NULL;
+}
+
+/* Every test starts with LTE connected and the first cloud connection
+ * attempt underway.
+ */
+static void cloud_before(void *fixture)
+{
+	struct modem_module_event *event = new_modem_module_event();
+
+	ARG_UNUSED(fixture);
+
+	atomic_clear(&stub_connects);
+	stub_connect_err = 0;
+	k_sem_reset(&stub_connected);
+	memset(&reconnect_stats, 0, sizeof(reconnect_stats));
+
+	event->type = MODEM_EVT_LTE_CONNECTED;
+	APP_EVENT_SUBMIT(event);
+}
+
+static void cloud_after(void *fixture)
+{
+	struct modem_module_event *event = new_modem_module_event();
+
+	ARG_UNUSED(fixture);
+
+	event->type = MODEM_EVT_LTE_DISCONNECTED;
+	APP_EVENT_SUBMIT(event);
+	cloud_settle();
+	zassert_equal(state, STATE_LTE_DISCONNECTED, NULL);
+}
+
+ZTEST_SUITE(cloud_supervision, NULL, cloud_setup, cloud_before, cloud_after, NULL);
@@ -0,0 +1,331 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr.h>
+#include <ztest.h>
+#include <timing/timing.h>
+#include <stdio.h>
+#include <string.h>
+#include <cJSON.h>
+#include <zcbor_encode.h>
+
+#include "codec.h"
+#include "codec_cbor.h"
+#include "codec_heap.h"
+
+/* Robot counts the codec is measured at, up to a full arena. */
+static const size_t robot_counts[] = { 1, 8, 16, 32, 64, 128 };
+
+/* Robot counts the JSON and CBOR protocols are compared at. */
+static const size_t protocol_counts[] = { 8, 32, 128 };
+
+#define BENCHMARK_ROBOTS_MAX 128
+#define BENCHMARK_ITERATIONS 50
+/* Applying a JSON delta parses it once per robot, so the protocol
+ * comparison runs fewer iterations.
+ */
+#define BENCHMARK_PROTOCOL_ITERATIONS 5
+/* Longest robot entry of the delta, and the delta of every robot */
+#define BENCHMARK_DELTA_ROBOT_SIZE 72
+#define BENCHMARK_DELTA_SIZE (64 + BENCHMARK_ROBOTS_MAX * BENCHMARK_DELTA_ROBOT_SIZE)
+
+static char ids[BENCHMARK_ROBOTS_MAX][8];
+static struct codec_robot robots[BENCHMARK_ROBOTS_MAX];
+static char delta[BENCHMARK_DELTA_SIZE];
+/* Longest robot entry of the CBOR commands, and the commands of every robot */
+#define BENCHMARK_COMMANDS_ROBOT_SIZE 32
+#define BENCHMARK_COMMANDS_SIZE (8 + BENCHMARK_ROBOTS_MAX * BENCHMARK_COMMANDS_ROBOT_SIZE)
+
+static uint8_t commands[BENCHMARK_COMMANDS_SIZE];
+
+/* Shadow delta carrying a movement and an LED setting for every robot. */
+static size_t delta_build(size_t count)
+{
+	size_t len;
+
+	/* Every write is checked before the next one, which would start
+	 * past the end of a truncated delta.
+	 */
+	len = snprintf(delta, sizeof(delta), "{\"version\":1,\"state\":{\"robots\":{");
+	for (size_t i = 0; i < count; i++) {
+		zassert_true(len < sizeof(delta), "Delta of %d robots too large", (int)count);
+		len += snprintf(&delta[len], sizeof(delta) - len,
+				"%s\"%s\":{\"driveTimeMs\":%d,\"angleDeg\":%d,"
+				"\"led\":[255,128,0,500]}",
+				i ? "," : "", ids[i], 1000 + (int)i, -180 + (int)i);
+	}
+	zassert_true(len < sizeof(delta), "Delta of %d robots too large", (int)count);
+	len += snprintf(&delta[len], sizeof(delta) - len, "}}}");
+
+	zassert_true(len < sizeof(delta), "Delta of %d robots too large", (int)count);
+	return len;
+}
+
+/* CBOR commands carrying the same movements and LED settings as the delta. */
+static size_t commands_build(size_t count)
+{
+	zcbor_state_t states[5];
+	bool ok;
+
+	zcbor_new_state(states, ARRAY_SIZE(states), commands, sizeof(commands), 1);
+
+	ok = zcbor_list_start_encode(states, count + 1) &&
+	     zcbor_uint32_put(states, 1);
+	for (size_t i = 0; i < count; i++) {
+		struct zcbor_string id = {
+			.value = (const uint8_t *)ids[i],
+			.len = strlen(ids[i]),
+		};
+
+		ok = ok && zcbor_list_start_encode(states, 3) &&
+		     zcbor_tstr_encode(states, &id) &&
+		     zcbor_list_start_encode(states, 3) &&
+		     zcbor_uint32_put(states, 1000 + i) &&
+		     zcbor_int32_put(states, -180 + (int32_t)i) &&
+		     zcbor_uint32_put(states, 100) &&
+		     zcbor_list_end_encode(states, 3) &&
+		     zcbor_list_start_encode(states, 4) &&
+		     zcbor_uint32_put(states, 500) &&
+		     zcbor_uint32_put(states, 255) &&
+		     zcbor_uint32_put(states, 128) &&
+		     zcbor_uint32_put(states, 0) &&
+		     zcbor_list_end_encode(states, 4) &&
+		     zcbor_list_end_encode(states, 3);
+	}
+	ok = ok && zcbor_list_end_encode(states, count + 1);
+
+	zassert_true(ok, "Commands of %d robots too large", (int)count);
+	return states[0].payload - commands;
+}
+
+static void command_count(const struct codec_cbor_command *cmd, void *user_data)
+{
+	size_t *count = user_data;
+
+	zassert_true(cmd->has_movement && cmd->has_led, NULL);
+	(*count)++;
+}
+
+static uint64_t ops_per_s(timing_t start, timing_t end, uint32_t ops)
+{
+	uint64_t ns = timing_cycles_to_ns(timing_cycles_get(&start, &end));
+
+	return ns ? (uint64_t)ops * NSEC_PER_SEC / ns : 0;
+}
+
+/* Decodes the movement of every robot out of the delta, the way the robot
+ * module applies it, and encodes the full robots report.
+ */
+static void benchmark_run(size_t count)
+{
+	struct bt_mesh_movement_set movement;
+	size_t delta_len = delta_build(count);
+	size_t report_len = 0;
+	size_t decode_peak;
+	size_t encode_peak;
+	timing_t start;
+	timing_t end;
+	uint64_t decode_ops;
+	uint64_t encode_ops;
+
+	codec_heap_peak_reset();
+	start = timing_counter_get();
+	for (int i = 0; i < BENCHMARK_ITERATIONS; i++) {
+		zassert_true(codec_decode_movement(ids[count - 1], delta, delta_len, &movement),
+			     NULL);
+	}
+	end = timing_counter_get();
+	decode_ops = ops_per_s(start, end, BENCHMARK_ITERATIONS);
+	decode_peak = codec_heap_peak();
+
+	codec_heap_peak_reset();
+	start = timing_counter_get();
+	for (int i = 0; i < BENCHMARK_ITERATIONS; i++) {
+		char *msg = codec_encode_robots_report(robots, count);
+
+		zassert_not_null(msg, NULL);
+		report_len = strlen(msg);
+		cJSON_free(msg);
+	}
+	end = timing_counter_get();
+	encode_ops = ops_per_s(start, end, BENCHMARK_ITERATIONS);
+	encode_peak = codec_heap_peak();
+
+	zassert_equal(codec_heap_outstanding(), 0, NULL);
+
+	printk("{\"benchmark\":\"codec\",\"robots\":%d,"
+	       "\"decode\":{\"bytes\":%d,\"opsPerS\":%d,\"peakHeap\":%d},"
+	       "\"encode\":{\"bytes\":%d,\"opsPerS\":%d,\"peakHeap\":%d}}\n",
+	       (int)count, (int)delta_len, (int)decode_ops, (int)decode_peak,
+	       (int)report_len, (int)encode_ops, (int)encode_peak);
+}
+
+ZTEST(codec_benchmark, test_throughput)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(robot_counts); i++) {
+		benchmark_run(robot_counts[i]);
+	}
+}
+
+/* Applies the delta to every robot the way the robot module does, parsing it
+ * for the movement and the LED of each robot.
+ */
+static void delta_apply(size_t count, size_t len)
+{
+	struct bt_mesh_movement_set movement;
+	struct bt_mesh_light_rgb_set led;
+
+	for (size_t i = 0; i < count; i++) {
+		zassert_true(codec_decode_movement(ids[i], delta, len, &movement), NULL);
+		zassert_true(codec_decode_led(ids[i], delta, len, &led), NULL);
+	}
+}
+
+/* Reports the movement and revolutions of every robot at the end of a
+ * round, as JSON shadow updates. Returns the number of bytes published.
+ */
+static size_t reports_json(size_t count)
+{
+	size_t len = 0;
+
+	for (size_t i = 0; i < count; i++) {
+		char *msg = codec_encode_movement_report(ids[i], robots[i].movement);
+
+		zassert_not_null(msg, NULL);
+		len += strlen(msg);
+		cJSON_free(msg);
+
+		msg = codec_encode_revolution_count_report(ids[i], robots[i].revolutions);
+		zassert_not_null(msg, NULL);
+		len += strlen(msg);
+		cJSON_free(msg);
+	}
+
+	return len;
+}
+
+/* The same reports as CBOR messages on the report topic. */
+static size_t reports_cbor(size_t count)
+{
+	uint8_t buf[CODEC_CBOR_REPORT_SIZE_MAX];
+	size_t len = 0;
+	int err;
+
+	for (size_t i = 0; i < count; i++) {
+		err = codec_cbor_encode_movement_report(buf, sizeof(buf), ids[i],
+							&robots[i].movement);
+		zassert_true(err > 0, NULL);
+		len += err;
+
+		err = codec_cbor_encode_revolution_count_report(buf, sizeof(buf), ids[i],
+								robots[i].revolutions);
+		zassert_true(err > 0, NULL);
+		len += err;
+	}
+
+	return len;
+}
+
+/* Compares the commands and the reports of one round in both protocols. */
+static void protocol_run(size_t count)
+{
+	size_t delta_len = delta_build(count);
+	size_t commands_len = commands_build(count);
+	size_t json_report_len = 0;
+	size_t cbor_report_len = 0;
+	timing_t start;
+	timing_t end;
+	uint64_t json_apply_ops;
+	uint64_t cbor_apply_ops;
+	uint64_t json_report_ops;
+	uint64_t cbor_report_ops;
+
+	start = timing_counter_get();
+	for (int i = 0; i < BENCHMARK_PROTOCOL_ITERATIONS; i++) {
+		delta_apply(count, delta_len);
+	}
+	end = timing_counter_get();
+	json_apply_ops = ops_per_s(start, end, BENCHMARK_PROTOCOL_ITERATIONS);
+
+	start = timing_counter_get();
+	for (int i = 0; i < BENCHMARK_PROTOCOL_ITERATIONS; i++) {
+		size_t decoded = 0;
+
+		zassert_equal(codec_cbor_decode_commands(commands, commands_len,
+							 command_count, &decoded), 0, NULL);
+		zassert_equal(decoded, count, NULL);
+	}
+	end = timing_counter_get();
+	cbor_apply_ops = ops_per_s(start, end, BENCHMARK_PROTOCOL_ITERATIONS);
+
+	start = timing_counter_get();
+	for (int i = 0; i < BENCHMARK_PROTOCOL_ITERATIONS; i++) {
+		json_report_len = reports_json(count);
+	}
+	end = timing_counter_get();
+	json_report_ops = ops_per_s(start, end, BENCHMARK_PROTOCOL_ITERATIONS);
+
+	start = timing_counter_get();
+	for (int i = 0; i < BENCHMARK_PROTOCOL_ITERATIONS; i++) {
+		cbor_report_len = reports_cbor(count);
+	}
+	end = timing_counter_get();
+	cbor_report_ops = ops_per_s(start, end, BENCHMARK_PROTOCOL_ITERATIONS);
+
+	zassert_equal(codec_heap_outstanding(), 0, NULL);
+	zassert_true(commands_len < delta_len, NULL);
+	zassert_true(cbor_report_len < json_report_len, NULL);
+
+	printk("{\"benchmark\":\"protocol\",\"robots\":%d,"
+	       "\"commands\":{\"jsonBytes\":%d,\"cborBytes\":%d,"
+	       "\"jsonOpsPerS\":%d,\"cborOpsPerS\":%d},"
+	       "\"reports\":{\"jsonBytes\":%d,\"cborBytes\":%d,"
+	       "\"jsonOpsPerS\":%d,\"cborOpsPerS\":%d}}\n",
+	       (int)count, (int)delta_len, (int)commands_len,
+	       (int)json_apply_ops, (int)cbor_apply_ops,
+	       (int)json_report_len, (int)cbor_report_len,
+	       (int)json_report_ops, (int)cbor_report_ops);
+}
+
+/* Size and CPU time of a round in the JSON shadow and the CBOR protocol.
+ * Commands are applied to every robot, and every robot reports its movement
+ * and revolutions.
+ */
+ZTEST(codec_benchmark, test_protocols)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(protocol_counts); i++) {
+		protocol_run(protocol_counts[i]);
+	}
+}
+
+static void *codec_benchmark_setup(void)
+{
+	for (size_t i = 0; i < BENCHMARK_ROBOTS_MAX; i++) {
+		snprintf(ids[i], sizeof(ids[i]), "r%d", (int)i);
+		robots[i] = (struct codec_robot) {
+			.id = ids[i],
+			.fields = CODEC_ROBOT_ALL,
+			.movement = { .time = 1000, .angle = 90, .speed = 100 },
+			.revolutions = i,
+			.led = { .red = 255, .blink_time = 500 },
+		};
+	}
+
+	codec_heap_init();
+	timing_init();
+	timing_start();
+	return NULL;
+}
+
+static void codec_benchmark_teardown(void *fixture)
+{
+	ARG_UNUSED(fixture);
+
+	timing_stop();
+}
+
+ZTEST_SUITE(codec_benchmark, NULL, codec_benchmark_setup, NULL, NULL,
+	    codec_benchmark_teardown);
@@ -0,0 +1,449 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr.h>
+#include <ztest.h>
+#include <string.h>
+#include <errno.h>
+#include <cJSON.h>
+#include <zcbor_decode.h>
+
+#include "codec.h"
+#include "codec_cbor.h"
+#include "codec_heap.h"
+
+#define DELTA(robots) "{\"state\":{\"robots\":{" robots "}}}"
+#define REPORTED(robots) "{\"state\":{\"reported\":{\"robots\":{" robots "}}}}"
+
+static char robot_id[] = "r1";
+
+/* Encoders under test, called with fixed input. */
+static char *encode_movement(void)
+{
+	struct bt_mesh_movement_set movement = {
+		.time = 1000,
+		.angle = -90,
+	};
+
+	return codec_encode_movement_report(robot_id, movement);
+}
+
+static char *encode_led(void)
+{
+	return codec_encode_led_report(robot_id, 255, 0, 16, 500);
+}
+
+static char *encode_revolutions(void)
+{
+	return codec_encode_revolution_count_report(robot_id, 12);
+}
+
+static char *encode_calibration(void)
+{
+	struct bt_mesh_calibration_status status = {
+		.err = 0,
+		.turn_rate = 180,
+		.speed = 250,
+		.turn_offset = -20,
+		.drive_offset = 40,
+	};
+
+	return codec_encode_calibration_report(robot_id, 2, &status);
+}
+
+static char *encode_power(void)
+{
+	struct bt_mesh_telemetry_power power = {
+		.battery = 7400,
+		.current = 850,
+		.flags = 1,
+	};
+
+	return codec_encode_power_report(robot_id, &power);
+}
+
+static char *encode_remove_robot(void)
+{
+	return codec_encode_remove_robot_report(robot_id);
+}
+
+static char *encode_remove_robots(void)
+{
+	return codec_encode_remove_robots_report();
+}
+
+static char *encode_robots(void)
+{
+	static char id_a[] = "a";
+	static char id_b[] = "b";
+	static char id_c[] = "c";
+	const struct codec_robot robots[] = {
+		{
+			.id = id_a,
+			.fields = CODEC_ROBOT_ALL,
+			.movement = { .time = 500, .angle = 45 },
+			.revolutions = 3,
+			.led = { .red = 1, .green = 2, .blue = 3, .blink_time = 4 },
+		},
+		{
+			.id = id_b,
+			.fields = CODEC_ROBOT_REVOLUTIONS,
+			.revolutions = 7,
+		},
+		{
+			.id = id_c,
+			.removed = true,
+		},
+	};
+
+	return codec_encode_robots_report(robots, ARRAY_SIZE(robots));
+}
+
+static const struct {
+	char *(*encode)(void);
+	const char *expected;
+} encoders[] = {
+	{ encode_movement, REPORTED("\"r1\":{\"driveTimeMs\":1000,\"angleDeg\":-90}") },
+	{ encode_led, REPORTED("\"r1\":{\"led\":[255,0,16,500]}") },
+	{ encode_revolutions, REPORTED("\"r1\":{\"revolutionCount\":12}") },
+	{ encode_calibration, REPORTED("\"r1\":{\"calibration\":{\"err\":0,\"turnRateDps\":180,"
+				       "\"speedMms\":250,\"turnOffsetMs\":-20,\"driveOffsetMs\":40},"
+				       "\"calibrate\":2}") },
+	{ encode_power, REPORTED("\"r1\":{\"power\":{\"batteryMv\":7400,"
+				 "\"motorCurrentMa\":850,\"powerFlags\":1}}") },
+	{ encode_remove_robot, REPORTED("\"r1\":null") },
+	{ encode_remove_robots, "{\"state\":null}" },
+	{ encode_robots, REPORTED("\"a\":{\"driveTimeMs\":500,\"angleDeg\":45,"
+				  "\"revolutionCount\":3,\"led\":[1,2,3,4]},"
+				  "\"b\":{\"revolutionCount\":7},\"c\":null") },
+};
+
+static void codec_before(void *fixture)
+{
+	ARG_UNUSED(fixture);
+
+	codec_heap_fail_at(CODEC_HEAP_FAIL_NONE);
+}
+
+static void codec_after(void *fixture)
+{
+	ARG_UNUSED(fixture);
+
+	zassert_equal(codec_heap_outstanding(), 0, "Codec leaked %d allocations",
+		      (int)codec_heap_outstanding());
+}
+
+static void *codec_setup(void)
+{
+	codec_heap_init();
+	return NULL;
+}
+
+ZTEST(codec, test_decode_version)
+{
+	const char valid[] = "{\"version\":3}";
+	const char missing[] = "{\"state\":{}}";
+	const char array[] = "[1,2]";
+	const char truncated[] = "{\"version\":";
+
+	zassert_equal(codec_decode_version(valid, strlen(valid)), 3, NULL);
+	zassert_equal(codec_decode_version(missing, strlen(missing)), -ENODATA, NULL);
+	zassert_equal(codec_decode_version(array, strlen(array)), -EINVAL, NULL);
+	zassert_equal(codec_decode_version(truncated, strlen(truncated)), -EINVAL, NULL);
+}
+
+ZTEST(codec, test_decode_movement)
+{
+	const char valid[] = DELTA("\"r1\":{\"driveTimeMs\":1500,\"angleDeg\":-45}");
+	const char other[] = DELTA("\"r2\":{\"driveTimeMs\":1500}");
+	const char no_robots[] = "{\"state\":{\"version\":1}}";
+	const char no_fields[] = DELTA("\"r1\":{\"team\":1}");
+	struct bt_mesh_movement_set movement = {0};
+
+	zassert_true(codec_decode_movement(robot_id, valid, strlen(valid), &movement), NULL);
+	zassert_equal(movement.time, 1500, NULL);
+	zassert_equal(movement.angle, -45, NULL);
+
+	zassert_false(codec_decode_movement(robot_id, other, strlen(other), &movement), NULL);
+	zassert_false(codec_decode_movement(robot_id, no_robots, strlen(no_robots), &movement),
+		      NULL);
+	zassert_false(codec_decode_movement(robot_id, no_fields, strlen(no_fields), &movement),
+		      NULL);
+}
+
+ZTEST(codec, test_decode_led)
+{
+	const char valid[] = DELTA("\"r1\":{\"led\":[10,20,30,400]}");
+	const char partial[] = DELTA("\"r1\":{\"led\":[1]}");
+	const char other[] = DELTA("\"r2\":{\"led\":[10,20,30,400]}");
+	struct bt_mesh_light_rgb_set led = {0};
+
+	zassert_true(codec_decode_led(robot_id, valid, strlen(valid), &led), NULL);
+	zassert_equal(led.red, 10, NULL);
+	zassert_equal(led.green, 20, NULL);
+	zassert_equal(led.blue, 30, NULL);
+	zassert_equal(led.blink_time, 400, NULL);
+
+	/* Missing entries keep their value */
+	zassert_true(codec_decode_led(robot_id, partial, strlen(partial), &led), NULL);
+	zassert_equal(led.red, 1, NULL);
+	zassert_equal(led.blink_time, 400, NULL);
+
+	zassert_false(codec_decode_led(robot_id, other, strlen(other), &led), NULL);
+}
+
+ZTEST(codec, test_decode_robot_settings)
+{
+	const char valid[] = DELTA("\"r1\":{\"team\":2,\"stopMode\":1,\"calibrate\":3}");
+	const char strings[] = DELTA("\"r1\":{\"team\":\"a\",\"stopMode\":\"b\",\"calibrate\":\"c\"}");
+	const char other[] = DELTA("\"r2\":{\"team\":2,\"stopMode\":1,\"calibrate\":3}");
+	uint8_t team = 0;
+	uint8_t stop = 0;
+	uint8_t request = 0;
+
+	zassert_true(codec_decode_team(robot_id, valid, strlen(valid), &team), NULL);
+	zassert_true(codec_decode_stop_mode(robot_id, valid, strlen(valid), &stop), NULL);
+	zassert_true(codec_decode_calibrate(robot_id, valid, strlen(valid), &request), NULL);
+	zassert_equal(team, 2, NULL);
+	zassert_equal(stop, 1, NULL);
+	zassert_equal(request, 3, NULL);
+
+	zassert_false(codec_decode_team(robot_id, strings, strlen(strings), &team), NULL);
+	zassert_false(codec_decode_stop_mode(robot_id, strings, strlen(strings), &stop), NULL);
+	zassert_false(codec_decode_calibrate(robot_id, strings, strlen(strings), &request), NULL);
+
+	/* A robot missing from the delta is not an error */
+	zassert_false(codec_decode_team(robot_id, other, strlen(other), &team), NULL);
+	zassert_false(codec_decode_stop_mode(robot_id, other, strlen(other), &stop), NULL);
+	zassert_false(codec_decode_calibrate(robot_id, other, strlen(other), &request), NULL);
+}
+
+static void reported_id_cb(const char *id, void *user_data)
+{
+	char *ids = user_data;
+
+	strcat(ids, id);
+	strcat(ids, ",");
+}
+
+ZTEST(codec, test_decode_reported_ids)
+{
+	const char shadow[] = "{\"state\":{\"desired\":{\"robots\":{\"r9\":{}}},"
+			      "\"reported\":{\"robots\":{\"r1\":{\"revolutions\":2},"
+			      "\"r2\":{},\"r3\":null}}},\"version\":7}";
+	const char no_robots[] = "{\"state\":{\"desired\":{\"robots\":{\"r1\":{}}}}}";
+	const char truncated[] = "{\"state\":{\"reported\":";
+	char ids[16] = "";
+
+	zassert_equal(codec_decode_reported_ids(shadow, strlen(shadow), reported_id_cb, ids),
+		      0, NULL);
+	zassert_equal(strcmp(ids, "r1,r2,"), 0, "Decoded ids %s", ids);
+
+	zassert_equal(codec_decode_reported_ids(no_robots, strlen(no_robots), reported_id_cb,
+						ids), -ENODATA, NULL);
+	zassert_equal(codec_decode_reported_ids(truncated, strlen(truncated), reported_id_cb,
+						ids), -EINVAL, NULL);
+	zassert_equal(strcmp(ids, "r1,r2,"), 0, "Decoded ids %s", ids);
+}
+
+ZTEST(codec, test_encode)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(encoders); i++) {
+		char *msg = encoders[i].encode();
+
+		zassert_not_null(msg, "Encoder %d failed", (int)i);
+		zassert_equal(strcmp(msg, encoders[i].expected), 0,
+			      "Encoder %d: %s", (int)i, msg);
+		cJSON_free(msg);
+	}
+}
+
+/* Fails every allocation of every encoder in turn. An encoder either
+ * returns the full message or NULL, and frees what it allocated.
+ */
+ZTEST(codec, test_encode_alloc_failure)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(encoders); i++) {
+		for (int fail = 0; ; fail++) {
+			char *msg;
+
+			codec_heap_fail_at(fail);
+			msg = encoders[i].encode();
+			if (!codec_heap_failed()) {
+				zassert_not_null(msg, NULL);
+				cJSON_free(msg);
+				break;
+			}
+
+			zassert_is_null(msg, "Encoder %d ignored failed allocation %d",
+					(int)i, fail);
+			zassert_equal(codec_heap_outstanding(), 0,
+				      "Encoder %d leaked on failed allocation %d", (int)i, fail);
+		}
+	}
+}
+
+ZTEST(codec, test_decode_alloc_failure)
+{
+	const char delta[] = DELTA("\"r1\":{\"driveTimeMs\":1500,\"led\":[1,2,3,4],\"team\":1}");
+	struct bt_mesh_movement_set movement;
+	struct bt_mesh_light_rgb_set led;
+	uint8_t team;
+
+	for (int fail = 0; ; fail++) {
+		bool decoded;
+
+		codec_heap_fail_at(fail);
+		decoded = codec_decode_movement(robot_id, delta, strlen(delta), &movement) &&
+			  codec_decode_led(robot_id, delta, strlen(delta), &led) &&
+			  codec_decode_team(robot_id, delta, strlen(delta), &team) &&
+			  codec_decode_version(delta, strlen(delta)) == -ENODATA;
+		zassert_equal(codec_heap_outstanding(), 0,
+			      "Decoder leaked on failed allocation %d", fail);
+		if (!codec_heap_failed()) {
+			zassert_true(decoded, NULL);
+			break;
+		}
+
+		zassert_false(decoded, NULL);
+	}
+}
+
+ZTEST_SUITE(codec, NULL, codec_setup, codec_before, codec_after, NULL);
+
+/* CBOR command message [1, ["r1", [1000, -90, 50], nil], ["r2", nil, [500, 255, 0, 16]]] */
+static const uint8_t cbor_commands[] = {
+	0x83, 0x01,
+	0x83, 0x62, 'r', '1',
+	0x83, 0x19, 0x03, 0xe8, 0x38, 0x59, 0x18, 0x32,
+	0xf6,
+	0x83, 0x62, 'r', '2',
+	0xf6,
+	0x84, 0x19, 0x01, 0xf4, 0x18, 0xff, 0x00, 0x10,
+};
+
+struct cbor_commands_ctx {
+	struct codec_cbor_command cmds[2];
+	size_t count;
+};
+
+static void cbor_command_cb(const struct codec_cbor_command *cmd, void *user_data)
+{
+	struct cbor_commands_ctx *ctx = user_data;
+
+	zassert_true(ctx->count < ARRAY_SIZE(ctx->cmds), "Too many commands");
+	ctx->cmds[ctx->count++] = *cmd;
+}
+
+ZTEST(codec_cbor, test_decode_commands)
+{
+	struct cbor_commands_ctx ctx = {0};
+
+	zassert_equal(codec_cbor_decode_version(cbor_commands, sizeof(cbor_commands)), 1, NULL);
+	zassert_equal(codec_cbor_decode_commands(cbor_commands, sizeof(cbor_commands),
+						 cbor_command_cb, &ctx), 0, NULL);
+	zassert_equal(ctx.count, 2, NULL);
+
+	zassert_equal(ctx.cmds[0].id_len, 2, NULL);
+	zassert_mem_equal(ctx.cmds[0].id, "r1", 2, NULL);
+	zassert_true(ctx.cmds[0].has_movement, NULL);
+	zassert_false(ctx.cmds[0].has_led, NULL);
+	zassert_equal(ctx.cmds[0].movement.time, 1000, NULL);
+	zassert_equal(ctx.cmds[0].movement.angle, -90, NULL);
+	zassert_equal(ctx.cmds[0].movement.speed, 50, NULL);
+
+	zassert_mem_equal(ctx.cmds[1].id, "r2", 2, NULL);
+	zassert_false(ctx.cmds[1].has_movement, NULL);
+	zassert_true(ctx.cmds[1].has_led, NULL);
+	zassert_equal(ctx.cmds[1].led.blink_time, 500, NULL);
+	zassert_equal(ctx.cmds[1].led.red, 255, NULL);
+	zassert_equal(ctx.cmds[1].led.blue, 16, NULL);
+}
+
+/* A message cut short anywhere is rejected before any robot is acted on. */
+ZTEST(codec_cbor, test_decode_truncated)
+{
+	for (size_t len = 0; len < sizeof(cbor_commands); len++) {
+		struct cbor_commands_ctx ctx = {0};
+
+		zassert_equal(codec_cbor_decode_commands(cbor_commands, len,
+							 cbor_command_cb, &ctx), -EBADMSG,
+			      "Accepted %d bytes", (int)len);
+		zassert_equal(ctx.count, 0, "Acted on %d bytes", (int)len);
+	}
+}
+
+ZTEST(codec_cbor, test_decode_out_of_range)
+{
+	/* [1, ["r1", [1000, -90, 256], nil]], speed does not fit the schema */
+	const uint8_t speed[] = {
+		0x82, 0x01,
+		0x83, 0x62, 'r', '1',
+		0x83, 0x19, 0x03, 0xe8, 0x38, 0x59, 0x19, 0x01, 0x00,
+		0xf6,
+	};
+
+	zassert_equal(codec_cbor_decode_commands(speed, sizeof(speed), NULL, NULL),
+		      -EBADMSG, NULL);
+}
+
+/* Checks a report [kind, id, values...] against the expected values. */
+static void cbor_report_check(const uint8_t *buf, size_t len, uint32_t kind,
+			      const int32_t *values, size_t count)
+{
+	zcbor_state_t states[3];
+	struct zcbor_string id;
+	uint32_t decoded_kind;
+	int32_t value;
+
+	zcbor_new_state(states, ARRAY_SIZE(states), buf, len, 1);
+
+	zassert_true(zcbor_list_start_decode(states), NULL);
+	zassert_true(zcbor_uint32_decode(states, &decoded_kind), NULL);
+	zassert_equal(decoded_kind, kind, NULL);
+	zassert_true(zcbor_tstr_decode(states, &id), NULL);
+	zassert_equal(id.len, strlen(robot_id), NULL);
+	zassert_mem_equal(id.value, robot_id, id.len, NULL);
+
+	for (size_t i = 0; i < count; i++) {
+		zassert_true(zcbor_int32_decode(states, &value), NULL);
+		zassert_equal(value, values[i], "Field %d", (int)i);
+	}
+
+	zassert_true(zcbor_list_end_decode(states), NULL);
+	zassert_equal(states[0].payload, buf + len, "Trailing bytes in report");
+}
+
+ZTEST(codec_cbor, test_encode_reports)
+{
+	const int32_t movement_values[] = { 1000, -90, 50 };
+	const int32_t revolutions_values[] = { 12 };
+	struct bt_mesh_movement_set movement = {
+		.time = 1000,
+		.angle = -90,
+		.speed = 50,
+	};
+	uint8_t buf[CODEC_CBOR_REPORT_SIZE_MAX];
+	int len;
+
+	len = codec_cbor_encode_movement_report(buf, sizeof(buf), robot_id, &movement);
+	zassert_true(len > 0, NULL);
+	cbor_report_check(buf, len, CODEC_CBOR_REPORT_MOVEMENT, movement_values,
+			  ARRAY_SIZE(movement_values));
+
+	/* Every buffer short of the report is rejected */
+	for (size_t size = 0; size < (size_t)len; size++) {
+		zassert_equal(codec_cbor_encode_movement_report(buf, size, robot_id, &movement),
+			      -ENOMEM, "Encoded into %d bytes", (int)size);
+	}
+
+	len = codec_cbor_encode_revolution_count_report(buf, sizeof(buf), robot_id, 12);
+	zassert_true(len > 0, NULL);
+	cbor_report_check(buf, len, CODEC_CBOR_REPORT_TELEMETRY, revolutions_values,
+			  ARRAY_SIZE(revolutions_values));
+}
+
+ZTEST_SUITE(codec_cbor, NULL, NULL, NULL, NULL, NULL);
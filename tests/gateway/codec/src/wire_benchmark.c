@@ -0,0 +1,185 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr.h>
+#include <ztest.h>
+#include <timing/timing.h>
+#include <string.h>
+#include <net/buf.h>
+#include <bluetooth/mesh/vnd/schema.h>
+
+#define WIRE_BENCHMARK_ITERATIONS 10000
+
+/* Generated codecs may be this much slower than the hand-written ones, in
+ * percent, to absorb the jitter of the emulated cycle counter.
+ */
+#define WIRE_BENCHMARK_MARGIN_PCT 10
+
+/* Largest message, with room for the movement round and stop mode. */
+#define WIRE_BENCHMARK_BUF_LEN 16
+
+static const struct bt_mesh_movement_set movement = {
+	.time = 1000,
+	.angle = -90,
+	.speed = 100,
+};
+
+static const struct bt_mesh_light_rgb_set led = {
+	.blink_time = 500,
+	.red = 255,
+	.green = 128,
+	.blue = 0,
+};
+
+static const struct bt_mesh_telemetry_power power = {
+	.battery = 7400,
+	.current = 1200,
+	.flags = 0,
+};
+
+/* The codecs the mesh models used before the schema, kept as the reference
+ * the generated codecs are measured against.
+ */
+static void movement_encode_hand(const struct bt_mesh_movement_set *set,
+				 struct net_buf_simple *buf)
+{
+	net_buf_simple_add_be32(buf, set->time);
+	net_buf_simple_add_be32(buf, set->angle);
+	net_buf_simple_add_u8(buf, set->speed);
+}
+
+static void movement_decode_hand(struct bt_mesh_movement_set *set,
+				 struct net_buf_simple *buf)
+{
+	set->time = net_buf_simple_pull_be32(buf);
+	set->angle = (int32_t)net_buf_simple_pull_be32(buf);
+	set->speed = net_buf_simple_pull_u8(buf);
+}
+
+static void led_encode_hand(const struct bt_mesh_light_rgb_set *set,
+			    struct net_buf_simple *buf)
+{
+	net_buf_simple_add_be16(buf, set->blink_time);
+	net_buf_simple_add_u8(buf, set->red);
+	net_buf_simple_add_u8(buf, set->green);
+	net_buf_simple_add_u8(buf, set->blue);
+}
+
+static void led_decode_hand(struct bt_mesh_light_rgb_set *set,
+			    struct net_buf_simple *buf)
+{
+	set->blink_time = net_buf_simple_pull_be16(buf);
+	set->red = net_buf_simple_pull_u8(buf);
+	set->green = net_buf_simple_pull_u8(buf);
+	set->blue = net_buf_simple_pull_u8(buf);
+}
+
+static void power_encode_hand(const struct bt_mesh_telemetry_power *set,
+			      struct net_buf_simple *buf)
+{
+	net_buf_simple_add_be16(buf, set->battery);
+	net_buf_simple_add_be16(buf, set->current);
+	net_buf_simple_add_u8(buf, set->flags);
+}
+
+static void power_decode_hand(struct bt_mesh_telemetry_power *set,
+			      struct net_buf_simple *buf)
+{
+	set->battery = net_buf_simple_pull_be16(buf);
+	set->current = net_buf_simple_pull_be16(buf);
+	set->flags = net_buf_simple_pull_u8(buf);
+}
+
+/* Runs the generated and the hand-written codec of one message, both
+ * through a net_buf_simple the way the mesh models use them. Checks that
+ * they agree on the wire, and that the generated one is not slower.
+ */
+#define WIRE_BENCHMARK_RUN(_name, _type, _val, _len, _hand_encode, _hand_decode)  \
+	do {                                                                      \
+		NET_BUF_SIMPLE_DEFINE(gen, WIRE_BENCHMARK_BUF_LEN);               \
+		NET_BUF_SIMPLE_DEFINE(hand, WIRE_BENCHMARK_BUF_LEN);              \
+		struct _type gen_val;                                             \
+		struct _type hand_val;                                            \
+		uint64_t gen_cycles;                                              \
+		uint64_t hand_cycles;                                             \
+		timing_t start;                                                   \
+		timing_t end;                                                     \
+                                                                                  \
+		memset(&gen_val, 0, sizeof(gen_val));                             \
+		memset(&hand_val, 0, sizeof(hand_val));                           \
+                                                                                  \
+		start = timing_counter_get();                                     \
+		for (int i = 0; i < WIRE_BENCHMARK_ITERATIONS; i++) {             \
+			net_buf_simple_reset(&gen);                               \
+			_type##_encode(&(_val), net_buf_simple_add(&gen, _len));  \
+			_type##_decode(&gen_val, net_buf_simple_pull_mem(&gen, _len)); \
+		}                                                                 \
+		end = timing_counter_get();                                       \
+		gen_cycles = timing_cycles_get(&start, &end);                     \
+                                                                                  \
+		start = timing_counter_get();                                     \
+		for (int i = 0; i < WIRE_BENCHMARK_ITERATIONS; i++) {             \
+			net_buf_simple_reset(&hand);                              \
+			_hand_encode(&(_val), &hand);                             \
+			_hand_decode(&hand_val, &hand);                           \
+		}                                                                 \
+		end = timing_counter_get();                                       \
+		hand_cycles = timing_cycles_get(&start, &end);                    \
+                                                                                  \
+		zassert_equal(memcmp(gen.__buf, hand.__buf, _len), 0,             \
+			      _name " wire formats differ");                      \
+		zassert_equal(memcmp(&gen_val, &(_val), sizeof(gen_val)), 0,     \
+			      _name " did not decode");                           \
+		zassert_equal(memcmp(&hand_val, &(_val), sizeof(hand_val)), 0,   \
+			      _name " did not decode");                           \
+                                                                                  \
+		printk("{\"benchmark\":\"wire\",\"message\":\"%s\",\"bytes\":%d," \
+		       "\"generatedNs\":%d,\"handNs\":%d}\n",                     \
+		       _name, (int)(_len),                                        \
+		       (int)(timing_cycles_to_ns(gen_cycles) / WIRE_BENCHMARK_ITERATIONS), \
+		       (int)(timing_cycles_to_ns(hand_cycles) / WIRE_BENCHMARK_ITERATIONS)); \
+                                                                                  \
+		zassert_true(gen_cycles * 100 <=                                  \
+			     hand_cycles * (100 + WIRE_BENCHMARK_MARGIN_PCT),     \
+			     _name " generated codec slower than hand-written");  \
+	} while (0)
+
+ZTEST(wire_benchmark, test_movement_set)
+{
+	WIRE_BENCHMARK_RUN("movement", bt_mesh_movement_set, movement,
+			   BT_MESH_MOVEMENT_SET_LEN, movement_encode_hand,
+			   movement_decode_hand);
+}
+
+ZTEST(wire_benchmark, test_light_rgb_set)
+{
+	WIRE_BENCHMARK_RUN("led", bt_mesh_light_rgb_set, led,
+			   BT_MESH_LIGHT_RGB_SET_LEN, led_encode_hand, led_decode_hand);
+}
+
+ZTEST(wire_benchmark, test_telemetry_power)
+{
+	WIRE_BENCHMARK_RUN("power", bt_mesh_telemetry_power, power,
+			   BT_MESH_TELEMETRY_POWER_LEN, power_encode_hand,
+			   power_decode_hand);
+}
+
+static void *wire_benchmark_setup(void)
+{
+	timing_init();
+	timing_start();
+	return NULL;
+}
+
+static void wire_benchmark_teardown(void *fixture)
+{
+	ARG_UNUSED(fixture);
+
+	timing_stop();
+}
+
+ZTEST_SUITE(wire_benchmark, NULL, wire_benchmark_setup, NULL, NULL,
+	    wire_benchmark_teardown);
@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr.h>
+#include <irq.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "codec.h"
+#include "codec_cbor.h"
+#include "codec_heap.h"
+
+/* Input handed over by libFuzzer, see arch/posix/core/fuzz.c */
+extern const uint8_t *posix_fuzz_buf;
+extern size_t posix_fuzz_sz;
+
+/* The first input byte selects the decoder, the second the allocation to
+ * fail, and the rest is the message.
+ */
+enum fuzz_target {
+	FUZZ_VERSION,
+	FUZZ_MOVEMENT,
+	FUZZ_LED,
+	FUZZ_TEAM,
+	FUZZ_STOP_MODE,
+	FUZZ_CALIBRATE,
+	FUZZ_CBOR_VERSION,
+	FUZZ_CBOR_COMMANDS,
+	FUZZ_TARGET_COUNT,
+};
+
+#define FUZZ_HEADER_LEN 2
+
+/* No allocation is failed for these values of the second byte */
+#define FUZZ_FAIL_NONE_MIN 0x80
+
+static char robot_id[] = "r1";
+static K_SEM_DEFINE(fuzz_sem, 0, 1);
+
+static void cbor_command_cb(const struct codec_cbor_command *cmd, void *user_data)
+{
+	size_t *count = user_data;
+
+	/* Every command points into the message */
+	if (cmd->id < (const char *)posix_fuzz_buf ||
+	    cmd->id + cmd->id_len > (const char *)posix_fuzz_buf + posix_fuzz_sz) {
+		__builtin_trap();
+	}
+
+	(*count)++;
+}
+
+static void fuzz_run(const uint8_t *data, size_t len)
+{
+	struct bt_mesh_movement_set movement;
+	struct bt_mesh_light_rgb_set led;
+	const char *input;
+	size_t count = 0;
+	uint8_t value;
+
+	if (len < FUZZ_HEADER_LEN) {
+		return;
+	}
+
+	codec_heap_fail_at(data[1] < FUZZ_FAIL_NONE_MIN ? data[1] : CODEC_HEAP_FAIL_NONE);
+	input = (const char *)&data[FUZZ_HEADER_LEN];
+	len -= FUZZ_HEADER_LEN;
+
+	switch (data[0] % FUZZ_TARGET_COUNT) {
+	case FUZZ_VERSION:
+		(void)codec_decode_version(input, len);
+		break;
+	case FUZZ_MOVEMENT:
+		(void)codec_decode_movement(robot_id, input, len, &movement);
+		break;
+	case FUZZ_LED:
+		(void)codec_decode_led(robot_id, input, len, &led);
+		break;
+	case FUZZ_TEAM:
+		(void)codec_decode_team(robot_id, input, len, &value);
+		break;
+	case FUZZ_STOP_MODE:
+		(void)codec_decode_stop_mode(robot_id, input, len, &value);
+		break;
+	case FUZZ_CALIBRATE:
+		(void)codec_decode_calibrate(robot_id, input, len, &value);
+		break;
+	case FUZZ_CBOR_VERSION:
+		(void)codec_cbor_decode_version((const uint8_t *)input, len);
+		break;
+	case FUZZ_CBOR_COMMANDS:
+		if (codec_cbor_decode_commands((const uint8_t *)input, len,
+					       cbor_command_cb, &count) != 0 && count != 0) {
+			/* Rejected messages must not be acted on */
+			__builtin_trap();
+		}
+		break;
+	}
+
+	/* Every path through the decoders frees what it allocated */
+	if (codec_heap_outstanding() != 0) {
+		__builtin_trap();
+	}
+}
+
+static void fuzz_isr(const void *arg)
+{
+	ARG_UNUSED(arg);
+
+	k_sem_give(&fuzz_sem);
+}
+
+void main(void)
+{
+	codec_heap_init();
+
+	IRQ_CONNECT(CONFIG_ARCH_POSIX_FUZZ_IRQ, 0, fuzz_isr, NULL, 0);
+	irq_enable(CONFIG_ARCH_POSIX_FUZZ_IRQ);
+
+	while (true) {
+		k_sem_take(&fuzz_sem, K_FOREVER);
+		fuzz_run(posix_fuzz_buf, posix_fuzz_sz);
+	}
+}
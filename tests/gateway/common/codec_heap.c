@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr.h>
+#include <stdbool.h>
+#include <cJSON.h>
+
+#include "codec_heap.h"
+
+/* Stored in front of every allocation, so that the size is known when it
+ * is freed.
+ */
+struct codec_heap_block {
+	size_t size;
+} __aligned(8);
+
+static size_t outstanding;
+static size_t bytes;
+static size_t peak;
+static int fail_countdown = CODEC_HEAP_FAIL_NONE;
+static bool failed;
+
+static void *codec_heap_malloc(size_t size)
+{
+	struct codec_heap_block *block;
+
+	if (fail_countdown != CODEC_HEAP_FAIL_NONE && fail_countdown-- == 0) {
+		failed = true;
+		return NULL;
+	}
+
+	block = k_malloc(sizeof(*block) + size);
+	if (block == NULL) {
+		return NULL;
+	}
+
+	block->size = size;
+	outstanding++;
+	bytes += size;
+	peak = MAX(peak, bytes);
+
+	return block + 1;
+}
+
+static void codec_heap_free(void *ptr)
+{
+	struct codec_heap_block *block;
+
+	if (ptr == NULL) {
+		return;
+	}
+
+	block = (struct codec_heap_block *)ptr - 1;
+	outstanding--;
+	bytes -= block->size;
+	k_free(block);
+}
+
+void codec_heap_init(void)
+{
+	cJSON_Hooks hooks = {
+		.malloc_fn = codec_heap_malloc,
+		.free_fn = codec_heap_free,
+	};
+
+	cJSON_InitHooks(&hooks);
+}
+
+void codec_heap_fail_at(int idx)
+{
+	fail_countdown = idx;
+	failed = false;
+}
+
+bool codec_heap_failed(void)
+{
+	return failed;
+}
+
+size_t codec_heap_outstanding(void)
+{
+	return outstanding;
+}
+
+void codec_heap_peak_reset(void)
+{
+	peak = bytes;
+}
+
+size_t codec_heap_peak(void)
+{
+	return peak;
+}
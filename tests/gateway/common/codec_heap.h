@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef CODEC_HEAP_H_
+#define CODEC_HEAP_H_
+
+/**
+ * @brief Instrumented heap for the cloud codec tests.
+ * @defgroup codec_heap Codec test heap
+ * @{
+ *
+ * Replaces the cJSON allocator with one that counts the outstanding
+ * allocations and the peak heap use, and that can fail a chosen
+ * allocation to exercise the error paths of the codec.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Do not fail any allocation. */
+#define CODEC_HEAP_FAIL_NONE -1
+
+/** @brief Install the instrumented allocator as the cJSON allocator. */
+void codec_heap_init(void);
+
+/** @brief Fail allocation @p idx, counted from now.
+ *
+ * @param[in] idx Index of the allocation to fail, or CODEC_HEAP_FAIL_NONE.
+ */
+void codec_heap_fail_at(int idx);
+
+/** @brief Check whether an allocation was failed since the last call to
+ *         codec_heap_fail_at().
+ */
+bool codec_heap_failed(void);
+
+/** @brief Number of allocations that have not been freed. */
+size_t codec_heap_outstanding(void);
+
+/** @brief Restart the peak measurement from the current heap use. */
+void codec_heap_peak_reset(void);
+
+/** @brief Highest number of allocated bytes since the last peak reset. */
+size_t codec_heap_peak(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @}
+ */
+
+#endif /* CODEC_HEAP_H_ */
@@ -0,0 +1,243 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr.h>
+#include <ztest.h>
+#include <stdlib.h>
+#include <math.h>
+#include <app_event_manager.h>
+
+#define MODULE test_motion
+
+#include "mesh_module_event.h"
+#include "motor_module_event.h"
+#include "sim_motor.h"
+#include "sim_module.h"
+
+#define SIM_PI 3.14159265f
+
+#define DRIVE_MS 1000
+
+/* Motion of the default emulated motor at full power: 200 rpm, reached
+ * with a 50 ms time constant, with 360 encoder ticks per revolution.
+ */
+#define MOTOR_RPS (200.0f / 60.0f)
+#define MOTOR_TIME_CONSTANT_MS 50
+#define MOTOR_TICKS_PER_REV 360
+#define WHEEL_MM (SIM_PI * CONFIG_SIM_WHEEL_DIAMETER_MM)
+
+/* Ticks a motor stopping from full speed runs on for, with the time
+ * constant of its stop mode.
+ */
+#define RUN_OUT_TICKS(time_constant_ms) \
+	(MOTOR_RPS * (time_constant_ms) / 1000.0f * MOTOR_TICKS_PER_REV)
+#define BRAKE_RUN_OUT_TICKS RUN_OUT_TICKS(10)
+#define COAST_RUN_OUT_TICKS RUN_OUT_TICKS(200)
+
+/* Time a coasting body is given to stand still, five time constants */
+#define RUN_OUT_MS 1000
+
+/* Largest error of the stop time, one kernel tick and the integration step */
+#define STOP_JITTER_US (k_ticks_to_us_ceil32(1) + 1000)
+
+/* Heading error of a straight drive with the weaker motor of
+ * heading.overlay, held by the gyroscope, and drifting without the hold.
+ * The weaker motor turns the body by about 14 degrees a second.
+ */
+#define HEADING_DRIVE_MS 5000
+#define HEADING_HELD_DEG 2.0f
+#define HEADING_DRIFT_DEG 20.0f
+
+static const struct device *const motors[] = {
+	DEVICE_DT_GET(DT_NODELABEL(motor_0_a)),
+	DEVICE_DT_GET(DT_NODELABEL(motor_0_b)),
+};
+
+K_SEM_DEFINE(movement_done, 0, 1);
+
+static bool app_event_handler(const struct app_event_header *aeh)
+{
+	if (is_motor_module_event(aeh)) {
+		struct motor_module_event *event = cast_motor_module_event(aeh);
+
+		if (event->type == MOTOR_EVT_MOVEMENT_REPORT) {
+			k_sem_give(&movement_done);
+		}
+	}
+
+	return false;
+}
+
+APP_EVENT_LISTENER(MODULE, app_event_handler);
+APP_EVENT_SUBSCRIBE(MODULE, motor_module_event);
+
+/* Runs a movement on body 0, and lets the body run out. */
+static void movement_run(int32_t angle, uint32_t time, uint8_t speed, uint8_t stop)
+{
+	struct mesh_module_event *event = new_mesh_module_event();
+
+	event->type = MESH_EVT_MOVE;
+	event->body = 0;
+	event->data.move.movement = (struct bt_mesh_movement_set){
+		.time = time,
+		.angle = angle,
+		.speed = speed,
+	};
+	event->data.move.stop = stop;
+	APP_EVENT_SUBMIT(event);
+
+	zassert_equal(k_sem_take(&movement_done, K_MSEC(time + 5000)), 0,
+		      "Movement not reported");
+	k_sleep(K_MSEC(RUN_OUT_MS));
+}
+
+static void motor_state_get(size_t i, struct sim_motor_state *state)
+{
+	zassert_equal(sim_motor_state_get(motors[i], state), 0, NULL);
+	zassert_true(state->stop_time_us > state->start_time_us, "Motor %d still running",
+		     (int)i);
+}
+
+static int overrun_ticks(const struct sim_motor_state *state)
+{
+	return abs(state->ticks - state->stop_ticks);
+}
+
+/* Distance a wheel covers driving at full power for time_ms. */
+static float drive_mm(uint32_t time_ms)
+{
+	return MOTOR_RPS * (time_ms - MOTOR_TIME_CONSTANT_MS) / 1000.0f * WHEEL_MM;
+}
+
+/* Checks a straight drive of DRIVE_MS, stopped with a run out of
+ * run_out_ticks on both motors.
+ */
+static void drive_check(float run_out_ticks)
+{
+	struct sim_motor_state state;
+	struct sim_pose pose;
+	float distance_mm = drive_mm(DRIVE_MS) + run_out_ticks / MOTOR_TICKS_PER_REV * WHEEL_MM;
+
+	for (size_t i = 0; i < ARRAY_SIZE(motors); i++) {
+		motor_state_get(i, &state);
+		zassert_within(state.stop_time_us - state.start_time_us, DRIVE_MS * 1000,
+			       STOP_JITTER_US, "Motor %d ran for %d us", (int)i,
+			       (int)(state.stop_time_us - state.start_time_us));
+		zassert_within(overrun_ticks(&state), run_out_ticks, run_out_ticks / 10 + 2,
+			       "Motor %d ran on for %d ticks", (int)i, overrun_ticks(&state));
+	}
+
+	zassert_equal(sim_pose_get(0, &pose), 0, NULL);
+	zassert_within(pose.x_mm, distance_mm, distance_mm / 20, "Drove %d mm of %d mm",
+		       (int)pose.x_mm, (int)distance_mm);
+	zassert_within(pose.y_mm, 0.0f, 1.0f, "Drifted %d mm", (int)pose.y_mm);
+	zassert_within(pose.heading, 0.0f, 0.01f, NULL);
+	zassert_within(pose.distance_mm, pose.x_mm, 1.0f, NULL);
+}
+
+ZTEST(motion, test_drive_brake)
+{
+	movement_run(0, DRIVE_MS, 100, BT_MESH_MOVEMENT_STOP_BRAKE);
+	drive_check(BRAKE_RUN_OUT_TICKS);
+}
+
+ZTEST(motion, test_drive_coast)
+{
+	movement_run(0, DRIVE_MS, 100, BT_MESH_MOVEMENT_STOP_COAST);
+	drive_check(COAST_RUN_OUT_TICKS);
+}
+
+/* The load preempts the motor module thread, not the work queue that
+ * stops the motors, so neither the stop time nor the distance suffers.
+ */
+ZTEST(motion, test_drive_under_load)
+{
+	zassert_equal(sim_load_set(50), 0, NULL);
+	movement_run(0, DRIVE_MS, 100, BT_MESH_MOVEMENT_STOP_BRAKE);
+	drive_check(BRAKE_RUN_OUT_TICKS);
+}
+
+/* Positive angles turn counterclockwise on the spot, with the motors
+ * running in opposite directions.
+ */
+ZTEST(motion, test_turn)
+{
+	struct sim_motor_state left;
+	struct sim_motor_state right;
+	struct sim_pose pose;
+
+	movement_run(90, 0, 0, BT_MESH_MOVEMENT_STOP_BRAKE);
+
+	motor_state_get(0, &left);
+	motor_state_get(1, &right);
+	zassert_true(left.ticks < 0 && right.ticks > 0, "Turned with %d and %d ticks",
+		     left.ticks, right.ticks);
+	zassert_within(left.ticks + right.ticks, 0, 2, NULL);
+	zassert_within(overrun_ticks(&right), BRAKE_RUN_OUT_TICKS, BRAKE_RUN_OUT_TICKS / 10 + 2,
+		       "Ran on for %d ticks", overrun_ticks(&right));
+
+	zassert_equal(sim_pose_get(0, &pose), 0, NULL);
+	zassert_true(pose.heading > 0.0f, "Turned %d mrad", (int)(pose.heading * 1000.0f));
+	zassert_within(pose.x_mm, 0.0f, 1.0f, NULL);
+	zassert_within(pose.y_mm, 0.0f, 1.0f, NULL);
+}
+
+/* The hold corrects the power of the motors, so the body keeps its
+ * heading although one motor is weaker.
+ */
+ZTEST(heading, test_drive)
+{
+	struct sim_pose pose;
+	float heading_deg;
+
+	movement_run(0, HEADING_DRIVE_MS, 100, BT_MESH_MOVEMENT_STOP_BRAKE);
+
+	zassert_equal(sim_pose_get(0, &pose), 0, NULL);
+	heading_deg = fabsf(pose.heading) * 180.0f / SIM_PI;
+	printk("Heading off by %d mdeg after %d ms\n", (int)(heading_deg * 1000.0f),
+	       HEADING_DRIVE_MS);
+
+	if (IS_ENABLED(CONFIG_MOTOR_HEADING_HOLD)) {
+		zassert_true(heading_deg < HEADING_HELD_DEG, "Held to %d mdeg",
+			     (int)(heading_deg * 1000.0f));
+	} else {
+		zassert_true(heading_deg > HEADING_DRIFT_DEG, "Drifted only %d mdeg",
+			     (int)(heading_deg * 1000.0f));
+	}
+}
+
+/* The drives are checked on identical motors, and the heading with the
+ * weaker motor and gyroscope of heading.overlay.
+ */
+static bool motion_predicate(const void *global_state)
+{
+	return !IS_ENABLED(CONFIG_SIM_GYRO);
+}
+
+static bool heading_predicate(const void *global_state)
+{
+	return IS_ENABLED(CONFIG_SIM_GYRO);
+}
+
+static void *motion_setup(void)
+{
+	zassert_equal(app_event_manager_init(), 0, "Application Event Manager not initialized");
+	return NULL;
+}
+
+static void motion_before(void *fixture)
+{
+	sim_reset();
+	k_sem_reset(&movement_done);
+}
+
+static void motion_after(void *fixture)
+{
+	sim_load_set(0);
+}
+
+ZTEST_SUITE(motion, motion_predicate, motion_setup, motion_before, motion_after, NULL);
+ZTEST_SUITE(heading, heading_predicate, motion_setup, motion_before, motion_after, NULL);